@@ -44,7 +44,6 @@ if(WINDOWS)
         libapr-1.dll
         libaprutil-1.dll
         libapriconv-1.dll
-        glod.dll    
         libhunspell.dll
         )
 
@@ -53,7 +52,6 @@ if(WINDOWS)
         libapr-1.dll
         libaprutil-1.dll
         libapriconv-1.dll
-        glod.dll
         libhunspell.dll
         )
 
@@ -119,7 +117,6 @@ elseif(DARWIN)
         libexception_handler.dylib
         libexpat.1.5.2.dylib
         libexpat.dylib
-        libGLOD.dylib
         libhunspell-1.3.0.dylib
         libndofdev.dylib
        )
@@ -159,7 +156,6 @@ elseif(LINUX)
         libaprutil-1.so.0
         libexpat.so
         libexpat.so.1
-        libGLOD.so
         libopenal.so
        )
 
@@ -51,6 +51,29 @@ MACRO(ADD_BUILD_TEST name parent)
 ENDMACRO(ADD_BUILD_TEST name parent)
 
 
+MACRO(ADD_LIBRARY_BUILD_TEST name library)
+    # Like ADD_BUILD_TEST, for the classes of library itself: the test links
+    # against library instead of building ${name}.cpp again, which header-only
+    # classes don't have and which would clash with the classes exported by a
+    # shared llcommon.  No parent: the library can't depend on its own test.
+    IF (EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/tests/${name}_test.cpp")
+        SET(library_libraries
+            ${library}
+            ${APRUTIL_LIBRARIES}
+            ${APR_LIBRARIES}
+            ${PTHREAD_LIBRARY}
+            ${WINDOWS_LIBRARIES}
+            )
+        SET(library_source_files
+            tests/${name}_test.cpp
+            ${CMAKE_SOURCE_DIR}/test/test.cpp
+            ${CMAKE_SOURCE_DIR}/test/lltut.cpp
+            )
+        ADD_BUILD_TEST_INTERNAL("${name}" "" "${library_libraries}" "${library_source_files}")
+    ENDIF (EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/tests/${name}_test.cpp")
+ENDMACRO(ADD_LIBRARY_BUILD_TEST name library)
+
+
 MACRO(ADD_VIEWER_BUILD_TEST name parent)
     # This is just like the generic ADD_BUILD_TEST, but we implicitly
     # add the necessary precompiled header .cpp file (anyone else find that
@@ -106,6 +129,24 @@ MACRO(ADD_BUILD_TEST_INTERNAL name parent libraries source_files)
       SET(LD_LIBRARY_PATH "$ENV{LD_LIBRARY_PATH}:${LD_LIBRARY_PATH}")
     ENDIF (NOT "$ENV{LD_LIBRARY_PATH}" STREQUAL "")
 
+    # Run the test as part of the build; the output file is only touched when it passes
+    IF (WINDOWS)
+      ADD_CUSTOM_COMMAND(
+        OUTPUT ${TEST_OUTPUT}
+        COMMAND ${TEST_CMD}
+        DEPENDS ${name}_test
+        WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+        )
+    ELSE (WINDOWS)
+      ADD_CUSTOM_COMMAND(
+        OUTPUT ${TEST_OUTPUT}
+        COMMAND ${CMAKE_COMMAND} -E env "LD_LIBRARY_PATH=${LD_LIBRARY_PATH}" ${TEST_CMD}
+        DEPENDS ${name}_test
+        WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+        )
+    ENDIF (WINDOWS)
+    ADD_TEST(NAME ${name} COMMAND ${TEST_EXE} --sourcedir=${CMAKE_CURRENT_SOURCE_DIR})
+
     ADD_CUSTOM_TARGET(${name}_test_ok ALL DEPENDS ${TEST_OUTPUT})
     IF (${parent})
       ADD_DEPENDENCIES(${parent} ${name}_test_ok)
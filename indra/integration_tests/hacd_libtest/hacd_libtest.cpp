@@ -0,0 +1,550 @@
+/**
+ * @file hacd_libtest.cpp
+ * @brief Benchmark and determinism test of the convex decomposition in libhacd.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+//
+// Decomposes every mesh of a corpus into convex hulls the way the physics
+// tab of the model upload floater does (libndhacd's parameters), once for
+// each --threads count, and reports for each mesh and thread count:
+//   - the time of the decomposition (best of --iterations runs)
+//   - the speedup over the first thread count
+//   - the number of hulls and a CRC of their vertices and triangles
+//
+// The corpus is generated (a twisted torus and a bumpy sphere at a few
+// resolutions) unless COLLADA files are given with --input, in which case
+// every <geometry> of the files is one mesh.  Only the triangles and
+// polylists of the geometries are read, node transforms are ignored.
+//
+// The decomposition must give the same hulls at every thread count and on
+// every run; the exit code is non-zero if it does not.
+//
+
+#include "linden_common.h"
+
+#include "llcommon.h"
+#include "llcrc.h"
+#include "llerrorcontrol.h"
+#include "llmath.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+#include "llxmltree.h"
+
+#include "hacdHACD.h"
+#include "hacdWorkerPool.h"
+#include "nd_hacdDefines.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+static const char USAGE[] = "\n"
+"usage:\thacd_libtest [options]\n"
+"\n"
+" -i, --input <file> [<file> ...]\n"
+"        COLLADA (.dae) files to decompose. Without this a generated corpus is used.\n"
+" -n, --iterations <n>\n"
+"        Runs of each decomposition; the fastest one is reported. Default 1.\n"
+" -t, --threads <n> [<n> ...]\n"
+"        Thread counts to run every decomposition with, 0 for one per core. Default 1 0.\n"
+" -h, --help\n"
+"        Print this help.\n"
+"\n";
+
+// Runs the loops of the decomposition on the shared worker pool, as libndhacd does in the viewer
+class LLHACDExecutor : public HACD::Executor
+{
+public:
+	/*virtual*/ size_t GetNThreads() const
+	{
+		LLThreadPool* pool = LLThreadPool::getShared();
+		return pool ? pool->getWorkerCount() + 1 : 1;
+	}
+
+	/*virtual*/ void ParallelFor(size_t n, size_t max_threads, const Body& body)
+	{
+		LLThreadPool* pool = LLThreadPool::getShared();
+		if (!pool)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				body(i, 0);
+			}
+			return;
+		}
+		pool->parallelFor(n, max_threads, [&body](S32 i, S32 thread) { body(i, thread); });
+	}
+};
+
+static LLHACDExecutor sExecutor;
+
+struct LLHACDSample
+{
+	std::string						mName;
+	std::vector<tVecDbl>			mPoints;
+	std::vector<tVecLong>			mTriangles;
+};
+
+struct LLHACDResult
+{
+	size_t	mThreads;	// resolved, never 0
+	F64		mSeconds;
+	size_t	mHulls;
+	U32		mChecksum;
+};
+
+class LLHACDLibTest
+{
+public:
+	LLHACDLibTest(S32 iterations, const std::vector<size_t>& threads) : mIterations(iterations), mThreads(threads), mFailures(0) {}
+
+	void generateCorpus();
+	bool loadDAE(const std::string& filename);
+	void run();
+	void report(std::ostream& out) const;
+
+	S32 getFailures() const	{ return mFailures; }
+
+private:
+	LLHACDResult decompose(const LLHACDSample& sample, size_t threads);
+	void addTorus(S32 rings);
+	void addBumpySphere(S32 rings);
+	void fail(const std::string& what);
+
+private:
+	S32 mIterations;
+	std::vector<size_t> mThreads;
+	std::vector<LLHACDSample> mSamples;
+	std::vector<std::vector<LLHACDResult> > mResults;	// per sample, per thread count
+	S32 mFailures;
+};
+
+void LLHACDLibTest::fail(const std::string& what)
+{
+	std::cerr << "FAILED: " << what << std::endl;
+	++mFailures;
+}
+
+void LLHACDLibTest::addTorus(S32 rings)
+{
+	LLHACDSample sample;
+	sample.mName = llformat("torus%d", rings);
+	S32 sides = rings / 2;
+	for (S32 i = 0; i < rings; ++i)
+	{
+		F64 u = F_TWO_PI * i / rings;
+		for (S32 j = 0; j < sides; ++j)
+		{
+			F64 v = F_TWO_PI * j / sides;
+			F64 r = 1.0 + 0.4 * cos(v) + 0.1 * sin(5.0 * u);
+			sample.mPoints.push_back(tVecDbl((3.0 + r * cos(v)) * cos(u) + 0.3 * sin(3.0 * v),
+											 (3.0 + r * cos(v)) * sin(u),
+											 r * sin(v) + 0.5 * sin(2.0 * u)));
+		}
+	}
+	for (S32 i = 0; i < rings; ++i)
+	{
+		for (S32 j = 0; j < sides; ++j)
+		{
+			long a = i * sides + j;
+			long b = ((i + 1) % rings) * sides + j;
+			long c = ((i + 1) % rings) * sides + (j + 1) % sides;
+			long d = i * sides + (j + 1) % sides;
+			sample.mTriangles.push_back(tVecLong(a, b, c));
+			sample.mTriangles.push_back(tVecLong(a, c, d));
+		}
+	}
+	mSamples.push_back(sample);
+}
+
+void LLHACDLibTest::addBumpySphere(S32 rings)
+{
+	LLHACDSample sample;
+	sample.mName = llformat("sphere%d", rings);
+	S32 sides = rings * 2;
+	// Poles and rings - 1 parallels in between
+	sample.mPoints.push_back(tVecDbl(0.0, 0.0, 1.0));
+	for (S32 i = 1; i < rings; ++i)
+	{
+		F64 theta = F_PI * i / rings;
+		for (S32 j = 0; j < sides; ++j)
+		{
+			F64 phi = F_TWO_PI * j / sides;
+			F64 r = 1.0 + 0.3 * sin(6.0 * theta) * sin(6.0 * phi);
+			sample.mPoints.push_back(tVecDbl(r * sin(theta) * cos(phi), r * sin(theta) * sin(phi), r * cos(theta)));
+		}
+	}
+	sample.mPoints.push_back(tVecDbl(0.0, 0.0, -1.0));
+	long south = (long)sample.mPoints.size() - 1;
+	for (S32 j = 0; j < sides; ++j)
+	{
+		long j1 = (j + 1) % sides;
+		sample.mTriangles.push_back(tVecLong(0, 1 + j, 1 + j1));
+		for (S32 i = 1; i < rings - 1; ++i)
+		{
+			long a = 1 + (i - 1) * sides;
+			long b = 1 + i * sides;
+			sample.mTriangles.push_back(tVecLong(a + j, b + j, b + j1));
+			sample.mTriangles.push_back(tVecLong(a + j, b + j1, a + j1));
+		}
+		long last = 1 + (rings - 2) * sides;
+		sample.mTriangles.push_back(tVecLong(last + j, south, last + j1));
+	}
+	mSamples.push_back(sample);
+}
+
+void LLHACDLibTest::generateCorpus()
+{
+	addTorus(24);
+	addTorus(48);
+	addBumpySphere(12);
+	addBumpySphere(24);
+}
+
+// Reads the whitespace separated numbers of an element
+template<class T>
+static void read_numbers(LLXmlTreeNode* node, std::vector<T>& numbers)
+{
+	std::istringstream in(node->getContents());
+	T value;
+	while (in >> value)
+	{
+		numbers.push_back(value);
+	}
+}
+
+bool LLHACDLibTest::loadDAE(const std::string& filename)
+{
+	LLXmlTree tree;
+	LLXmlTreeNode* root = tree.parseFile(filename) ? tree.getRoot() : NULL;
+	if (!root || !root->hasName("COLLADA"))
+	{
+		fail("can't read " + filename);
+		return false;
+	}
+	LLXmlTreeNode* library = root->getChildByName("library_geometries");
+	for (LLXmlTreeNode* geometry = library ? library->getFirstChild() : NULL; geometry; geometry = library->getNextChild())
+	{
+		LLXmlTreeNode* mesh = geometry->getChildByName("mesh");
+		if (!mesh)
+		{
+			continue;
+		}
+		std::string name;
+		geometry->getAttributeString("id", name);
+		LLHACDSample sample;
+		sample.mName = name.empty() ? filename : name;
+
+		// Sources by id, and the one the <vertices> positions come from
+		std::map<std::string, LLXmlTreeNode*> sources;
+		std::string positions_id;
+		for (LLXmlTreeNode* child = mesh->getFirstChild(); child; child = mesh->getNextChild())
+		{
+			std::string id;
+			child->getAttributeString("id", id);
+			if (child->hasName("source"))
+			{
+				sources["#" + id] = child;
+			}
+			else if (child->hasName("vertices"))
+			{
+				for (LLXmlTreeNode* input = child->getFirstChild(); input; input = child->getNextChild())
+				{
+					std::string semantic;
+					if (input->hasName("input") && input->getAttributeString("semantic", semantic) && semantic == "POSITION")
+					{
+						input->getAttributeString("source", positions_id);
+					}
+				}
+			}
+		}
+		LLXmlTreeNode* positions = sources.count(positions_id) ? sources[positions_id]->getChildByName("float_array") : NULL;
+		if (!positions)
+		{
+			fail(filename + ": no positions in geometry " + name);
+			continue;
+		}
+		std::vector<F64> coords;
+		read_numbers(positions, coords);
+		for (size_t i = 0; i + 2 < coords.size(); i += 3)
+		{
+			sample.mPoints.push_back(tVecDbl(coords[i], coords[i + 1], coords[i + 2]));
+		}
+
+		for (LLXmlTreeNode* prim = mesh->getFirstChild(); prim; prim = mesh->getNextChild())
+		{
+			bool polylist = prim->hasName("polylist");
+			if (!polylist && !prim->hasName("triangles"))
+			{
+				continue;
+			}
+			// Every index of <p> belongs to an input, the vertex one gives the position
+			S32 stride = 1;
+			S32 vertex_offset = -1;
+			for (LLXmlTreeNode* input = prim->getFirstChild(); input; input = prim->getNextChild())
+			{
+				if (!input->hasName("input"))
+				{
+					continue;
+				}
+				S32 offset = 0;
+				std::string semantic;
+				input->getAttributeS32("offset", offset);
+				stride = llmax(stride, offset + 1);
+				if (input->getAttributeString("semantic", semantic) && semantic == "VERTEX")
+				{
+					vertex_offset = offset;
+				}
+			}
+			LLXmlTreeNode* p = prim->getChildByName("p");
+			if (vertex_offset < 0 || !p)
+			{
+				continue;
+			}
+			std::vector<long> indices;
+			read_numbers(p, indices);
+			std::vector<S32> counts;
+			if (polylist && prim->getChildByName("vcount"))
+			{
+				read_numbers(prim->getChildByName("vcount"), counts);
+			}
+			else
+			{
+				counts.assign(indices.size() / (3 * stride), 3);
+			}
+			// Polygons are fanned into triangles
+			size_t first = 0;
+			for (size_t poly = 0; poly < counts.size(); ++poly)
+			{
+				if (first + counts[poly] * stride > indices.size())
+				{
+					break;
+				}
+				for (S32 k = 1; k + 1 < counts[poly]; ++k)
+				{
+					long a = indices[first + vertex_offset];
+					long b = indices[first + k * stride + vertex_offset];
+					long c = indices[first + (k + 1) * stride + vertex_offset];
+					if (a >= 0 && b >= 0 && c >= 0 &&
+						(size_t)llmax(a, b, c) < sample.mPoints.size())
+					{
+						sample.mTriangles.push_back(tVecLong(a, b, c));
+					}
+				}
+				first += counts[poly] * stride;
+			}
+		}
+		if (sample.mTriangles.empty())
+		{
+			fail(filename + ": no triangles in geometry " + name);
+			continue;
+		}
+		mSamples.push_back(sample);
+	}
+	return true;
+}
+
+LLHACDResult LLHACDLibTest::decompose(const LLHACDSample& sample, size_t threads)
+{
+	// HACD scales the points it is given in place
+	std::vector<tVecDbl> points(sample.mPoints);
+	std::vector<tVecLong> triangles(sample.mTriangles);
+
+	// Same parameters as nd_hacdConvexDecomposition::executeStage()
+	tHACD* hacd = HACD::CreateHACD(0);
+	hacd->SetPoints(&points[0]);
+	hacd->SetNPoints(points.size());
+	hacd->SetTriangles(&triangles[0]);
+	hacd->SetNTriangles(triangles.size());
+	hacd->SetCompacityWeight(0.1f);
+	hacd->SetVolumeWeight(0);
+	hacd->SetNClusters(MIN_NUMBER_OF_CLUSTERS);
+	hacd->SetAddExtraDistPoints(true);
+	hacd->SetAddFacesPoints(true);
+	hacd->SetNVerticesPerCH(MAX_VERTICES_PER_HULL);
+	hacd->SetConcavity(1);
+	hacd->SetConnectDist(CONNECT_DISTS[0]);
+	hacd->SetNThreads(threads);
+	hacd->SetExecutor(&sExecutor);
+
+	LLHACDResult result;
+	result.mThreads = HACD::WorkerPool::GetNThreads(threads, &sExecutor);
+	LLTimer timer;
+	hacd->Compute();
+	result.mSeconds = timer.getElapsedTimeF64();
+
+	LLCRC crc;
+	result.mHulls = hacd->GetNClusters();
+	for (size_t i = 0; i < result.mHulls; ++i)
+	{
+		std::vector<tVecDbl> hull_points(hacd->GetNPointsCH(i));
+		std::vector<tVecLong> hull_triangles(hacd->GetNTrianglesCH(i));
+		if (hull_points.empty() || hull_triangles.empty())
+		{
+			continue;
+		}
+		hacd->GetCH(i, &hull_points[0], &hull_triangles[0]);
+		crc.update((const U8*)&hull_points[0], hull_points.size() * sizeof(tVecDbl));
+		crc.update((const U8*)&hull_triangles[0], hull_triangles.size() * sizeof(tVecLong));
+	}
+	result.mChecksum = crc.getCRC();
+	HACD::DestroyHACD(hacd);
+	return result;
+}
+
+void LLHACDLibTest::run()
+{
+	mResults.resize(mSamples.size());
+	for (size_t s = 0; s < mSamples.size(); ++s)
+	{
+		const LLHACDSample& sample = mSamples[s];
+		for (size_t t = 0; t < mThreads.size(); ++t)
+		{
+			LLHACDResult best;
+			for (S32 i = 0; i < mIterations; ++i)
+			{
+				LLHACDResult result = decompose(sample, mThreads[t]);
+				if (i == 0 || result.mSeconds < best.mSeconds)
+				{
+					best = result;
+				}
+				// Every run, at every thread count, must give the hulls of the first one
+				const LLHACDResult& first = mResults[s].empty() ? best : mResults[s].front();
+				if (result.mChecksum != first.mChecksum || result.mHulls != first.mHulls)
+				{
+					fail(llformat("%s: %d threads gave %d hulls (%08x), %d threads %d hulls (%08x)",
+								  sample.mName.c_str(), (S32)result.mThreads, (S32)result.mHulls, result.mChecksum,
+								  (S32)first.mThreads, (S32)first.mHulls, first.mChecksum));
+				}
+			}
+			mResults[s].push_back(best);
+		}
+	}
+}
+
+void LLHACDLibTest::report(std::ostream& out) const
+{
+	out << std::left << std::setw(24) << "mesh" << std::right
+		<< std::setw(10) << "triangles" << std::setw(8) << "threads" << std::setw(10) << "ms"
+		<< std::setw(9) << "speedup" << std::setw(7) << "hulls" << "  checksum" << std::endl;
+	for (size_t s = 0; s < mSamples.size(); ++s)
+	{
+		for (size_t t = 0; t < mResults[s].size(); ++t)
+		{
+			const LLHACDResult& result = mResults[s][t];
+			out << std::left << std::setw(24) << mSamples[s].mName << std::right
+				<< std::setw(10) << mSamples[s].mTriangles.size()
+				<< std::setw(8) << result.mThreads
+				<< std::setw(10) << llformat("%.1f", result.mSeconds * 1000.0)
+				<< std::setw(9) << llformat("%.2f", mResults[s].front().mSeconds / llmax(result.mSeconds, 1e-9))
+				<< std::setw(7) << result.mHulls
+				<< "  " << llformat("%08x", result.mChecksum) << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> input_files;
+	std::vector<size_t> threads;
+	S32 iterations = 1;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+		bool has_value = arg + 1 < argc && argv[arg + 1][0] != '-';
+		if ((option == "--input" || option == "-i") && has_value)
+		{
+			while (arg + 1 < argc && argv[arg + 1][0] != '-')
+			{
+				input_files.push_back(argv[++arg]);
+			}
+		}
+		else if ((option == "--iterations" || option == "-n") && has_value)
+		{
+			iterations = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((option == "--threads" || option == "-t") && has_value)
+		{
+			while (arg + 1 < argc && argv[arg + 1][0] != '-')
+			{
+				threads.push_back(llmax(atoi(argv[++arg]), 0));
+			}
+		}
+		else
+		{
+			std::cout << USAGE;
+			return option == "--help" || option == "-h" ? 0 : 1;
+		}
+	}
+	if (threads.empty())
+	{
+		threads.push_back(1);
+		threads.push_back(0);
+	}
+
+#ifdef CWDEBUG
+	Debug(debug::init());
+#endif
+	LLError::initForApplication(".");
+	LLError::setDefaultLevel(LLError::LEVEL_WARN);
+	LLCommon::initClass();
+
+	// Enough workers for the largest thread count, the calling thread being one of the threads
+	S32 workers = 0;
+	for (std::vector<size_t>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+	{
+		workers = *iter ? llmax(workers, (S32)*iter - 1) : -1;
+		if (workers < 0)
+		{
+			break;
+		}
+	}
+	LLThreadPool::startShared(workers);
+
+	S32 failures = 0;
+	{
+		LLHACDLibTest test(iterations, threads);
+		if (input_files.empty())
+		{
+			test.generateCorpus();
+		}
+		for (std::vector<std::string>::const_iterator iter = input_files.begin(); iter != input_files.end(); ++iter)
+		{
+			test.loadDAE(*iter);
+		}
+		test.run();
+		test.report(std::cout);
+		failures = test.getFailures();
+	}
+
+	LLThreadPool::stopShared();
+	LLCommon::cleanupClass();
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
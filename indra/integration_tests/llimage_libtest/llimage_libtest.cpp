@@ -0,0 +1,640 @@
+/**
+ * @file llimage_libtest.cpp
+ * @brief Benchmark and regression test of the image codecs in llimage and llimagej2coj.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+//
+// Runs every codec over a corpus of images and reports, for each encode and
+// for each decode at every discard level the codec supports:
+//   - throughput in MB/s of raw pixels (best of --iterations runs)
+//   - image buffer allocations per run (LLImageBase::getAllocationCount())
+//   - a CRC of the output
+// plus the peak raw image memory and process RSS growth over the whole run.
+//
+// The corpus is generated (photo-like gradients, edges and noise, RGB and
+// RGBA, 64 to 1024 pixels) unless files are given with --input.  Generated
+// images are checked: lossless codecs must give back the exact pixels and
+// lossy ones must stay above a PSNR floor.  Every run of the same decode must
+// also give the same output, which catches races in the threaded decoders.
+//
+// --baseline <file> compares the CRCs with those stored in file, or stores them
+// there if the file does not exist yet (or with --record).  Record a baseline
+// before changing llimage or llimagej2coj and check against it afterwards.
+//
+// The exit code is non-zero if any check fails.
+//
+
+#include "linden_common.h"
+
+#include "llcommon.h"
+#include "llcrc.h"
+#include "llerrorcontrol.h"
+#include "llfile.h"
+#include "llmath.h"
+#include "llmemory.h"
+#include "llpointer.h"
+#include "llsd.h"
+#include "llsdserialize.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+
+#include "llimage.h"
+#include "llimagebmp.h"
+#include "llimagedxt.h"
+#include "llimagej2c.h"
+#include "llimagejpeg.h"
+#include "llimagepng.h"
+#include "llimagetga.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+static const char USAGE[] = "\n"
+"usage:\tllimage_libtest [options]\n"
+"\n"
+" -i, --input <file> [<file> ...]\n"
+"        Images to benchmark (j2c, png, tga, jpg, bmp, dxt). Without this a\n"
+"        generated corpus is used, which is also checked for correctness.\n"
+" -n, --iterations <n>\n"
+"        Runs of each encode and decode; the fastest one is reported. Default 3.\n"
+" -t, --threads <n>\n"
+"        JPEG2000 code-block worker threads, -1 for one per spare core. Default 0.\n"
+" -b, --baseline <file>\n"
+"        Compare the output checksums with file, or write them there if it does not exist.\n"
+" -r, --record\n"
+"        Always write the checksums to the --baseline file.\n"
+" -c, --csv <file>\n"
+"        Also write the results to file as comma separated values.\n"
+" -h, --help\n"
+"        Print this help.\n"
+"\n";
+
+// Lowest acceptable PSNR of the lossy codecs on the generated corpus, in dB
+static const F64 MIN_PSNR_J2C = 30.0;
+static const F64 MIN_PSNR_JPEG = 28.0;
+static const F64 MIN_PSNR_DXT = 28.0;
+
+struct LLCodecSample
+{
+	std::string					mName;		// image name, unique in the corpus
+	std::string					mCodec;		// codec name, also unique per image
+	LLPointer<LLImageRaw>		mSource;	// pixels the image was encoded from, NULL for input files
+	LLPointer<LLImageFormatted>	mImage;
+	bool						mLossless;
+	F64							mMinPSNR;
+};
+
+struct LLCodecResult
+{
+	std::string	mKey;
+	std::string	mOperation;
+	S32			mDiscard;
+	S32			mWidth;
+	S32			mHeight;
+	S32			mComponents;
+	S32			mBytes;		// encoded size
+	F64			mMBPerSec;
+	F64			mAllocations;
+	U32			mChecksum;
+	F64			mPSNR;		// negative if not measured
+};
+
+class LLImageLibTest
+{
+public:
+	LLImageLibTest(S32 iterations) : mIterations(iterations), mFailures(0), mPeakRawMemory(0), mStartRSS(LLMemory::getCurrentRSS()), mPeakRSS(mStartRSS) {}
+
+	void generateCorpus();
+	void loadCorpus(const std::vector<std::string>& files);
+	void runDecodes();
+	void compareBaseline(const std::string& filename, bool record);
+	void report(std::ostream& out) const;
+	void reportCSV(std::ostream& out) const;
+
+	S32 getFailures() const	{ return mFailures; }
+
+private:
+	void encodeSample(const std::string& name, LLImageRaw* source, const std::string& codec);
+	void decodeSample(const LLCodecSample& sample, S32 discard);
+	S32 getMaxDiscard(LLImageFormatted* image) const;
+	void sampleMemory();
+	void fail(const std::string& what);
+
+	static U32 checksum(const U8* data, S32 size);
+	static F64 computePSNR(const LLImageRaw* a, const LLImageRaw* b);
+
+private:
+	S32 mIterations;
+	S32 mFailures;
+	std::vector<LLCodecSample> mSamples;
+	std::vector<LLCodecResult> mResults;
+	S64 mPeakRawMemory;
+	U64 mStartRSS;
+	U64 mPeakRSS;
+};
+
+//static
+U32 LLImageLibTest::checksum(const U8* data, S32 size)
+{
+	LLCRC crc;
+	if (data && size > 0)
+	{
+		crc.update(data, size);
+	}
+	return crc.getCRC();
+}
+
+//static
+F64 LLImageLibTest::computePSNR(const LLImageRaw* a, const LLImageRaw* b)
+{
+	if (a->getWidth() != b->getWidth() || a->getHeight() != b->getHeight() || a->getComponents() != b->getComponents())
+	{
+		return 0.0;
+	}
+	const U8* pa = a->getData();
+	const U8* pb = b->getData();
+	S32 count = a->getWidth() * a->getHeight() * a->getComponents();
+	F64 sum = 0.0;
+	for (S32 i = 0; i < count; ++i)
+	{
+		F64 diff = (F64)pa[i] - (F64)pb[i];
+		sum += diff * diff;
+	}
+	if (sum == 0.0)
+	{
+		return 99.0;
+	}
+	return 10.0 * log10(255.0 * 255.0 * count / sum);
+}
+
+void LLImageLibTest::fail(const std::string& what)
+{
+	std::cerr << "FAILED: " << what << std::endl;
+	++mFailures;
+}
+
+void LLImageLibTest::sampleMemory()
+{
+	mPeakRawMemory = llmax(mPeakRawMemory, *AIAccess<S64>(LLImageRaw::sGlobalRawMemory));
+	mPeakRSS = llmax(mPeakRSS, LLMemory::getCurrentRSS());
+}
+
+// Deterministic, roughly photo-like content: smooth gradients, hard edges and noise,
+// so that neither the wavelet nor the block codecs get an unrealistically easy time
+static LLPointer<LLImageRaw> generate_image(S32 width, S32 height, S32 components, U32 seed)
+{
+	LLPointer<LLImageRaw> raw = new LLImageRaw(width, height, components);
+	U8* data = raw->getData();
+	U32 rng = seed * 2654435761u + 1;
+	for (S32 y = 0; y < height; ++y)
+	{
+		for (S32 x = 0; x < width; ++x)
+		{
+			F32 fx = (F32)x / width;
+			F32 fy = (F32)y / height;
+			bool edge = ((x * 7 / width) + (y * 5 / height)) & 1;
+			for (S32 c = 0; c < components; ++c)
+			{
+				rng = rng * 1664525u + 1013904223u;
+				F32 value = 128.f + 80.f * sinf(fx * (3.f + c) * F_PI + seed) * cosf(fy * (2.f + seed % 3) * F_PI);
+				if (edge)
+				{
+					value = 255.f - value;
+				}
+				if (c == 3)
+				{
+					// Alpha: mostly opaque with a soft hole, like most textures that have one
+					F32 dx = fx - .5f, dy = fy - .5f;
+					value = llclamp(1024.f * (dx * dx + dy * dy) - 16.f, 0.f, 255.f);
+				}
+				else
+				{
+					value += (F32)((rng >> 24) & 7) - 4.f;
+				}
+				*data++ = (U8)llclamp(value, 0.f, 255.f);
+			}
+		}
+	}
+	return raw;
+}
+
+void LLImageLibTest::generateCorpus()
+{
+	static const S32 sizes[][2] = { { 64, 64 }, { 256, 256 }, { 512, 128 }, { 1024, 1024 } };
+	U32 seed = 1;
+	for (size_t i = 0; i < LL_ARRAY_SIZE(sizes); ++i)
+	{
+		for (S32 components = 3; components <= 4; ++components)
+		{
+			std::string name = llformat("gen%dx%dx%d", sizes[i][0], sizes[i][1], components);
+			LLPointer<LLImageRaw> source = generate_image(sizes[i][0], sizes[i][1], components, seed++);
+			encodeSample(name, source, "j2c");
+			encodeSample(name, source, "j2c-lossless");
+			encodeSample(name, source, "png");
+			encodeSample(name, source, "tga");
+			encodeSample(name, source, "dxt");
+			encodeSample(name, source, "dxt-raw");
+			if (components == 3)
+			{
+				// Neither supports an alpha channel
+				encodeSample(name, source, "jpeg");
+				encodeSample(name, source, "bmp");
+			}
+		}
+	}
+}
+
+void LLImageLibTest::encodeSample(const std::string& name, LLImageRaw* source, const std::string& codec)
+{
+	LLCodecSample sample;
+	sample.mName = name;
+	sample.mCodec = codec;
+	sample.mSource = source;
+	sample.mLossless = true;
+	sample.mMinPSNR = 0.0;
+
+	LLCodecResult result;
+	result.mKey = name + "/" + codec + "/encode";
+	result.mOperation = "encode";
+	result.mDiscard = 0;
+	result.mWidth = source->getWidth();
+	result.mHeight = source->getHeight();
+	result.mComponents = source->getComponents();
+	result.mPSNR = -1.0;
+
+	F64 best_time = 0.0;
+	U32 allocations = LLImageBase::getAllocationCount();
+	for (S32 i = 0; i < mIterations; ++i)
+	{
+		LLPointer<LLImageFormatted> image;
+		BOOL success = FALSE;
+		LLTimer timer;
+		if (codec == "j2c" || codec == "j2c-lossless")
+		{
+			LLPointer<LLImageJ2C> j2c = new LLImageJ2C;
+			sample.mLossless = codec == "j2c-lossless";
+			sample.mMinPSNR = MIN_PSNR_J2C;
+			j2c->setReversible(sample.mLossless);
+			success = j2c->encode(source, 0.f);
+			image = j2c;
+		}
+		else if (codec == "jpeg")
+		{
+			LLPointer<LLImageJPEG> jpeg = new LLImageJPEG(75);
+			sample.mLossless = false;
+			sample.mMinPSNR = MIN_PSNR_JPEG;
+			success = jpeg->encode(source, 0.f);
+			image = jpeg;
+		}
+		else if (codec == "dxt")
+		{
+			// Block compression, as done on the decode threads for the GL upload
+			LLPointer<LLImageDXT> dxt = new LLImageDXT;
+			sample.mLossless = false;
+			sample.mMinPSNR = MIN_PSNR_DXT;
+			success = dxt->encodeCompressed(source);
+			if (success)
+			{
+				result.mPSNR = dxt->getCompressionPSNR();
+			}
+			image = dxt;
+		}
+		else
+		{
+			image = LLImageFormatted::createFromExtension(codec == "dxt-raw" ? "dxt" : codec);
+			success = image.notNull() && image->encode(source, 0.f);
+		}
+		F64 elapsed = timer.getElapsedTimeF64();
+		if (!success)
+		{
+			fail(result.mKey + ": " + LLImage::getLastError());
+			return;
+		}
+		if (i == 0 || elapsed < best_time)
+		{
+			best_time = elapsed;
+		}
+		U32 crc = checksum(image->getData(), image->getDataSize());
+		if (i == 0)
+		{
+			result.mChecksum = crc;
+			result.mBytes = image->getDataSize();
+			sample.mImage = image;
+		}
+		else if (crc != result.mChecksum)
+		{
+			fail(result.mKey + ": output differs between runs");
+		}
+		sampleMemory();
+	}
+	result.mAllocations = (F64)(LLImageBase::getAllocationCount() - allocations) / mIterations;
+	result.mMBPerSec = source->getDataSize() / (1024.0 * 1024.0) / llmax(best_time, 1e-9);
+	mResults.push_back(result);
+	mSamples.push_back(sample);
+}
+
+void LLImageLibTest::loadCorpus(const std::vector<std::string>& files)
+{
+	for (std::vector<std::string>::const_iterator iter = files.begin(); iter != files.end(); ++iter)
+	{
+		LLPointer<LLImageFormatted> image = LLImageFormatted::createFromExtension(*iter);
+		if (image.isNull() || !image->load(*iter) || !image->updateData())
+		{
+			fail(*iter + ": " + LLImage::getLastError());
+			continue;
+		}
+		LLCodecSample sample;
+		sample.mName = iter->substr(iter->find_last_of("/\\") + 1);
+		sample.mCodec = image->getExtension();
+		sample.mImage = image;
+		sample.mLossless = false;
+		sample.mMinPSNR = 0.0;
+		mSamples.push_back(sample);
+	}
+}
+
+S32 LLImageLibTest::getMaxDiscard(LLImageFormatted* image) const
+{
+	S32 max_discard = 0;
+	S8 codec = image->getCodec();
+	if (codec == IMG_CODEC_J2C || codec == IMG_CODEC_DXT)
+	{
+		// Down to 8 pixels, the smallest level the fetcher ever asks for
+		S32 size = llmin(image->getWidth(), image->getHeight());
+		while (max_discard < MAX_DISCARD_LEVEL && (size >> (max_discard + 1)) >= 8)
+		{
+			++max_discard;
+		}
+	}
+	return max_discard;
+}
+
+void LLImageLibTest::runDecodes()
+{
+	for (std::vector<LLCodecSample>::const_iterator iter = mSamples.begin(); iter != mSamples.end(); ++iter)
+	{
+		LLImageDXT* dxt = dynamic_cast<LLImageDXT*>(iter->mImage.get());
+		if (dxt && iter->mCodec == "dxt")
+		{
+			// Only the GL driver decodes block compressed data
+			continue;
+		}
+		S32 max_discard = getMaxDiscard(iter->mImage);
+		for (S32 discard = 0; discard <= max_discard; ++discard)
+		{
+			decodeSample(*iter, discard);
+		}
+	}
+}
+
+void LLImageLibTest::decodeSample(const LLCodecSample& sample, S32 discard)
+{
+	LLImageFormatted* image = sample.mImage;
+
+	LLCodecResult result;
+	result.mKey = llformat("%s/%s/decode%d", sample.mName.c_str(), sample.mCodec.c_str(), discard);
+	result.mOperation = "decode";
+	result.mDiscard = discard;
+	result.mBytes = image->getDataSize();
+	result.mPSNR = -1.0;
+
+	F64 best_time = 0.0;
+	U32 allocations = LLImageBase::getAllocationCount();
+	LLPointer<LLImageRaw> raw;
+	for (S32 i = 0; i < mIterations; ++i)
+	{
+		// A new raw image every time, the way the texture fetcher decodes
+		raw = new LLImageRaw;
+		image->setDiscardLevel(discard);
+		LLTimer timer;
+		BOOL success = image->decode(raw, 0.f);
+		F64 elapsed = timer.getElapsedTimeF64();
+		if (!success || raw->isBufferInvalid())
+		{
+			fail(result.mKey + ": " + LLImage::getLastError());
+			return;
+		}
+		if (i == 0 || elapsed < best_time)
+		{
+			best_time = elapsed;
+		}
+		U32 crc = checksum(raw->getData(), raw->getDataSize());
+		if (i == 0)
+		{
+			result.mChecksum = crc;
+		}
+		else if (crc != result.mChecksum)
+		{
+			fail(result.mKey + ": output differs between runs");
+		}
+		sampleMemory();
+	}
+	result.mWidth = raw->getWidth();
+	result.mHeight = raw->getHeight();
+	result.mComponents = raw->getComponents();
+	result.mAllocations = (F64)(LLImageBase::getAllocationCount() - allocations) / mIterations;
+	result.mMBPerSec = raw->getDataSize() / (1024.0 * 1024.0) / llmax(best_time, 1e-9);
+
+	// Full resolution decodes of generated images are checked against the pixels they came from
+	if (sample.mSource.notNull() && discard == 0)
+	{
+		result.mPSNR = computePSNR(sample.mSource, raw);
+		if (sample.mLossless ? result.mPSNR < 99.0 : result.mPSNR < sample.mMinPSNR)
+		{
+			fail(llformat("%s: PSNR %.1f dB", result.mKey.c_str(), result.mPSNR));
+		}
+	}
+	mResults.push_back(result);
+}
+
+void LLImageLibTest::compareBaseline(const std::string& filename, bool record)
+{
+	LLSD checksums;
+	for (std::vector<LLCodecResult>::const_iterator iter = mResults.begin(); iter != mResults.end(); ++iter)
+	{
+		checksums[iter->mKey] = llformat("%08x", iter->mChecksum);
+	}
+
+	if (!record && LLFile::isfile(filename))
+	{
+		LLSD baseline;
+		llifstream in(filename);
+		if (LLSDSerialize::fromXMLDocument(baseline, in) < 0 || !baseline.isMap())
+		{
+			fail("can't read baseline " + filename);
+			return;
+		}
+		S32 compared = 0;
+		for (LLSD::map_const_iterator iter = checksums.beginMap(); iter != checksums.endMap(); ++iter)
+		{
+			if (!baseline.has(iter->first))
+			{
+				continue;
+			}
+			++compared;
+			if (baseline[iter->first].asString() != iter->second.asString())
+			{
+				fail(iter->first + ": checksum " + iter->second.asString() + ", baseline " + baseline[iter->first].asString());
+			}
+		}
+		std::cout << "Compared " << compared << " of " << checksums.size() << " checksums with " << filename << std::endl;
+		return;
+	}
+
+	llofstream out(filename);
+	if (!out.is_open())
+	{
+		fail("can't write baseline " + filename);
+		return;
+	}
+	LLSDSerialize::toPrettyXML(checksums, out);
+	std::cout << "Wrote " << checksums.size() << " checksums to " << filename << std::endl;
+}
+
+void LLImageLibTest::report(std::ostream& out) const
+{
+	out << std::left << std::setw(40) << "image/codec/operation" << std::right
+		<< std::setw(12) << "size" << std::setw(10) << "bytes" << std::setw(10) << "MB/s"
+		<< std::setw(8) << "allocs" << std::setw(10) << "PSNR" << "  checksum" << std::endl;
+	for (std::vector<LLCodecResult>::const_iterator iter = mResults.begin(); iter != mResults.end(); ++iter)
+	{
+		out << std::left << std::setw(40) << iter->mKey << std::right
+			<< std::setw(12) << llformat("%dx%dx%d", iter->mWidth, iter->mHeight, iter->mComponents)
+			<< std::setw(10) << iter->mBytes
+			<< std::setw(10) << llformat("%.1f", iter->mMBPerSec)
+			<< std::setw(8) << llformat("%.1f", iter->mAllocations)
+			<< std::setw(10) << (iter->mPSNR < 0.0 ? std::string("-") : llformat("%.1f", iter->mPSNR))
+			<< "  " << llformat("%08x", iter->mChecksum) << std::endl;
+	}
+	out << "Peak raw image memory: " << mPeakRawMemory / 1024 << " KB, peak RSS growth: "
+		<< (S64)(mPeakRSS - mStartRSS) / 1024 << " KB" << std::endl;
+}
+
+void LLImageLibTest::reportCSV(std::ostream& out) const
+{
+	out << "image/codec/operation,discard,width,height,components,bytes,MB/s,allocations,PSNR,checksum" << std::endl;
+	for (std::vector<LLCodecResult>::const_iterator iter = mResults.begin(); iter != mResults.end(); ++iter)
+	{
+		out << iter->mKey << "," << iter->mDiscard << "," << iter->mWidth << "," << iter->mHeight << ","
+			<< iter->mComponents << "," << iter->mBytes << "," << llformat("%.2f", iter->mMBPerSec) << ","
+			<< llformat("%.2f", iter->mAllocations) << "," << llformat("%.2f", iter->mPSNR) << ","
+			<< llformat("%08x", iter->mChecksum) << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> input_files;
+	S32 iterations = 3;
+	S32 threads = 0;
+	std::string baseline_file;
+	std::string csv_file;
+	bool record = false;
+
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+		bool has_value = arg + 1 < argc && argv[arg + 1][0] != '-';
+		if ((option == "--input" || option == "-i") && has_value)
+		{
+			while (arg + 1 < argc && argv[arg + 1][0] != '-')
+			{
+				input_files.push_back(argv[++arg]);
+			}
+		}
+		else if ((option == "--iterations" || option == "-n") && has_value)
+		{
+			iterations = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((option == "--threads" || option == "-t") && arg + 1 < argc)
+		{
+			threads = atoi(argv[++arg]);
+		}
+		else if ((option == "--baseline" || option == "-b") && has_value)
+		{
+			baseline_file = argv[++arg];
+		}
+		else if ((option == "--csv" || option == "-c") && has_value)
+		{
+			csv_file = argv[++arg];
+		}
+		else if (option == "--record" || option == "-r")
+		{
+			record = true;
+		}
+		else
+		{
+			std::cout << USAGE;
+			return option == "--help" || option == "-h" ? 0 : 1;
+		}
+	}
+
+#ifdef CWDEBUG
+	Debug(debug::init());
+#endif
+	LLError::initForApplication(".");
+	LLError::setDefaultLevel(LLError::LEVEL_WARN);
+	LLCommon::initClass();
+	LLPrivateMemoryPoolManager::initClass(FALSE, 0);
+	LLImage::initClass();
+	LLThreadPool::startShared(threads);
+	LLImageJ2C::startDecodeThreads(threads);
+
+	S32 failures = 0;
+	{
+		LLImageLibTest test(iterations);
+		if (input_files.empty())
+		{
+			test.generateCorpus();
+		}
+		else
+		{
+			test.loadCorpus(input_files);
+		}
+		test.runDecodes();
+		if (!baseline_file.empty())
+		{
+			test.compareBaseline(baseline_file, record);
+		}
+
+		test.report(std::cout);
+		if (!csv_file.empty())
+		{
+			llofstream csv(csv_file);
+			test.reportCSV(csv);
+		}
+		failures = test.getFailures();
+	}
+
+	LLImageJ2C::stopDecodeThreads();
+	LLThreadPool::stopShared();
+	LLImage::cleanupClass();
+	LLPrivateMemoryPoolManager::destroyClass();
+	LLCommon::cleanupClass();
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,398 @@
+/**
+ * @file llmeshsimplifier_libtest.cpp
+ * @brief Benchmark and regression test of the mesh simplifier generating levels of detail.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+//
+// Generates the levels of detail of a few meshes the way the model upload
+// floater does by default (each level a third of the triangles of the one
+// above, carrying on from it) and reports for each mesh and level:
+//   - the time the simplification took (best of --iterations runs)
+//   - the triangles asked for and the triangles left
+//   - how far the triangles left are from the original surface
+//
+// The meshes are unit spheres, so the distance of a triangle to the surface is
+// taken at its centre: a closed sphere split in two faces at the equator with
+// a texture seam, and a dome with an open border.
+//
+// The exit code is non-zero if a level has more triangles than asked for, an
+// index out of range, a border that moved off the original border, border
+// vertices gone with --lock-borders, or strays further than --max-distance.
+//
+
+#include "linden_common.h"
+
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+#include "llmath.h"
+#include "llmeshsimplifier.h"
+#include "lltimer.h"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+static const char USAGE[] = "\n"
+"usage:\tllmeshsimplifier_libtest [options]\n"
+"\n"
+" -t, --triangles <n>\n"
+"        Triangles of each generated mesh. Default 200000.\n"
+" -n, --iterations <n>\n"
+"        Runs of each simplification; the fastest one is reported. Default 1.\n"
+" -l, --lock-borders\n"
+"        Keep the open borders in place, as ImporterLODLockBorders does.\n"
+" -d, --max-distance <d>\n"
+"        Furthest a triangle of the lowest level may be from the surface. Default 0.05.\n"
+" -h, --help\n"
+"        Print this help.\n"
+"\n";
+
+// Levels of detail generated, from high to lowest, each a third of the previous one
+static const S32 NUM_LEVELS = 4;
+static const S32 DECIMATION = 3;
+
+struct LLSimplifierSample
+{
+	std::string					mName;
+	std::vector<LLVolumeFace>	mFaces;
+	S32							mTriangles;
+	S32							mBorderVertices;	// vertices on the equator, the open border of the dome
+};
+
+struct LLSimplifierResult
+{
+	S32	mTarget;
+	S32	mTriangles;
+	F64	mSeconds;
+	F32	mDistance;		// furthest centre of a triangle from the surface
+};
+
+class LLMeshSimplifierLibTest
+{
+public:
+	LLMeshSimplifierLibTest(S32 iterations, bool lock_borders, F32 max_distance)
+	:	mIterations(iterations), mLockBorders(lock_borders), mMaxDistance(max_distance), mFailures(0) {}
+
+	void generateCorpus(S32 triangles);
+	void run();
+	void report(std::ostream& out) const;
+
+	S32 getFailures() const	{ return mFailures; }
+
+private:
+	void addSphere(const std::string& name, S32 triangles, bool dome);
+	void check(const LLSimplifierSample& sample, const std::vector<LLVolumeFace>& faces, LLSimplifierResult& result);
+	void fail(const std::string& what);
+
+private:
+	S32 mIterations;
+	bool mLockBorders;
+	F32 mMaxDistance;
+	std::vector<LLSimplifierSample> mSamples;
+	std::vector<std::vector<LLSimplifierResult> > mResults;	// per sample, per level
+	S32 mFailures;
+};
+
+void LLMeshSimplifierLibTest::fail(const std::string& what)
+{
+	std::cerr << "FAILED: " << what << std::endl;
+	++mFailures;
+}
+
+void LLMeshSimplifierLibTest::addSphere(const std::string& name, S32 triangles, bool dome)
+{
+	// rings * segments * 2 triangles, twice as many segments as rings
+	S32 rings = llmax((S32)sqrtf((dome ? 2.f : 1.f) * triangles / 4.f), 4);
+	S32 segments = rings * 2;
+	S32 last_ring = dome ? rings / 2 : rings;
+
+	LLSimplifierSample sample;
+	sample.mName = name;
+	sample.mTriangles = 0;
+	sample.mBorderVertices = 0;
+
+	// One face per hemisphere, like two materials, or more to keep within 16 bit
+	// indices; the last column of vertices has the same positions as the first
+	// one but other texture coordinates
+	S32 columns = segments + 1;
+	S32 step = llmin(rings / 2, 65536 / columns - 1);
+	for (S32 first_ring = 0; first_ring < last_ring; first_ring += step)
+	{
+		S32 face_rings = llmin(step, last_ring - first_ring);
+		LLVolumeFace face;
+		face.resizeVertices((face_rings + 1) * columns);
+		for (S32 r = 0; r <= face_rings; ++r)
+		{
+			S32 ring = first_ring + r;
+			F32 theta = F_PI * ring / rings;
+			// Exact poles and equator, for the welding
+			F32 sin_theta = ring == 0 || ring == rings ? 0.f : sinf(theta);
+			F32 cos_theta = ring * 2 == rings ? 0.f : cosf(theta);
+			for (S32 s = 0; s < columns; ++s)
+			{
+				F32 phi = F_TWO_PI * (s % segments) / segments;
+				S32 v = r * columns + s;
+				face.mPositions[v].set(sin_theta * cosf(phi), sin_theta * sinf(phi), cos_theta);
+				face.mNormals[v] = face.mPositions[v];
+				face.mTexCoords[v].set((F32)s / segments, (F32)ring / rings);
+				if (dome && ring * 2 == rings && r == face_rings && s < segments)
+				{
+					++sample.mBorderVertices;
+				}
+			}
+		}
+
+		std::vector<U16> indices;
+		for (S32 r = 0; r < face_rings; ++r)
+		{
+			S32 ring = first_ring + r;
+			for (S32 s = 0; s < segments; ++s)
+			{
+				U16 a = r * columns + s;
+				U16 b = a + 1;
+				U16 c = a + columns;
+				U16 d = c + 1;
+				if (ring != 0)
+				{
+					indices.push_back(a); indices.push_back(c); indices.push_back(b);
+				}
+				if (ring + 1 != rings)
+				{
+					indices.push_back(b); indices.push_back(c); indices.push_back(d);
+				}
+			}
+		}
+		face.resizeIndices(indices.size());
+		std::copy(indices.begin(), indices.end(), face.mIndices);
+		sample.mTriangles += indices.size() / 3;
+		sample.mFaces.push_back(face);
+	}
+
+	mSamples.push_back(sample);
+}
+
+void LLMeshSimplifierLibTest::generateCorpus(S32 triangles)
+{
+	triangles = llmin(triangles, 1000000);
+	addSphere("sphere", triangles, false);
+	addSphere("dome", triangles, true);
+}
+
+void LLMeshSimplifierLibTest::check(const LLSimplifierSample& sample, const std::vector<LLVolumeFace>& faces, LLSimplifierResult& result)
+{
+	// Count the edges by position to find the open borders
+	typedef std::pair<LLVector3, LLVector3> edge_t;
+	struct CompareEdges
+	{
+		bool operator()(const edge_t& a, const edge_t& b) const
+		{
+			LLVolumeFace::VertexMapData::ComparePosition less;
+			if (less(a.first, b.first)) return true;
+			if (less(b.first, a.first)) return false;
+			return less(a.second, b.second);
+		}
+	};
+	std::map<edge_t, S32, CompareEdges> edges;
+	LLVolumeFace::VertexMapData::ComparePosition less;
+
+	result.mTriangles = 0;
+	result.mDistance = 0.f;
+	S32 border_vertices = 0;
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		const LLVolumeFace& face = faces[f];
+		for (S32 i = 0; i < face.mNumIndices; ++i)
+		{
+			if (face.mIndices[i] >= face.mNumVertices)
+			{
+				fail(llformat("%s: index %d of face %d out of range", sample.mName.c_str(), i, (S32)f));
+				return;
+			}
+		}
+		for (S32 i = 0; i < face.mNumVertices; ++i)
+		{
+			if (face.mPositions[i][VZ] == 0.f && face.mPositions[i][VX] * face.mPositions[i][VX] + face.mPositions[i][VY] * face.mPositions[i][VY] > 0.5f)
+			{
+				++border_vertices;
+			}
+		}
+		for (S32 i = 0; i + 2 < face.mNumIndices; i += 3)
+		{
+			LLVector3 corners[3];
+			for (S32 c = 0; c < 3; ++c)
+			{
+				corners[c].set(face.mPositions[face.mIndices[i + c]].getF32ptr());
+			}
+			LLVector3 centre = (corners[0] + corners[1] + corners[2]) / 3.f;
+			result.mDistance = llmax(result.mDistance, fabsf(1.f - centre.length()));
+			for (S32 c = 0; c < 3; ++c)
+			{
+				const LLVector3& a = corners[c];
+				const LLVector3& b = corners[(c + 1) % 3];
+				++edges[less(a, b) ? edge_t(a, b) : edge_t(b, a)];
+			}
+			++result.mTriangles;
+		}
+	}
+
+	if (result.mTriangles > result.mTarget)
+	{
+		fail(llformat("%s: %d triangles left, %d asked for", sample.mName.c_str(), result.mTriangles, result.mTarget));
+	}
+	for (std::map<edge_t, S32, CompareEdges>::const_iterator iter = edges.begin(); iter != edges.end(); ++iter)
+	{
+		if (iter->second == 1 && (iter->first.first.mV[VZ] != 0.f || iter->first.second.mV[VZ] != 0.f))
+		{
+			fail(llformat("%s: open edge off the border at %f %f %f", sample.mName.c_str(),
+						  iter->first.first.mV[VX], iter->first.first.mV[VY], iter->first.first.mV[VZ]));
+			break;
+		}
+	}
+	if (mLockBorders && border_vertices < sample.mBorderVertices)
+	{
+		fail(llformat("%s: %d of the %d border vertices left", sample.mName.c_str(), border_vertices, sample.mBorderVertices));
+	}
+}
+
+void LLMeshSimplifierLibTest::run()
+{
+	mResults.resize(mSamples.size());
+	for (size_t s = 0; s < mSamples.size(); ++s)
+	{
+		const LLSimplifierSample& sample = mSamples[s];
+		mResults[s].resize(NUM_LEVELS);
+		for (S32 i = 0; i < mIterations; ++i)
+		{
+			LLTimer timer;
+			LLMeshSimplifier simplifier(sample.mFaces, mLockBorders);
+			S32 target = sample.mTriangles;
+			for (S32 level = 0; level < NUM_LEVELS; ++level)
+			{
+				if (level)
+				{
+					target /= DECIMATION;
+				}
+				simplifier.simplify(target);
+				// The first level includes setting the simplifier up
+				F64 seconds = timer.getElapsedTimeF64();
+
+				std::vector<LLVolumeFace> faces(sample.mFaces.size());
+				for (size_t f = 0; f < faces.size(); ++f)
+				{
+					simplifier.getFace(f, faces[f]);
+				}
+
+				LLSimplifierResult& result = mResults[s][level];
+				if (i == 0 || seconds < result.mSeconds)
+				{
+					result.mSeconds = seconds;
+				}
+				result.mTarget = target;
+				check(sample, faces, result);
+				timer.reset();
+			}
+		}
+
+		if (mResults[s].back().mDistance > mMaxDistance)
+		{
+			fail(llformat("%s: triangles %f away from the surface", sample.mName.c_str(), mResults[s].back().mDistance));
+		}
+	}
+}
+
+void LLMeshSimplifierLibTest::report(std::ostream& out) const
+{
+	out << std::left << std::setw(12) << "mesh" << std::right
+		<< std::setw(7) << "level" << std::setw(10) << "target" << std::setw(11) << "triangles"
+		<< std::setw(10) << "ms" << std::setw(11) << "distance" << std::endl;
+	for (size_t s = 0; s < mSamples.size(); ++s)
+	{
+		for (size_t level = 0; level < mResults[s].size(); ++level)
+		{
+			const LLSimplifierResult& result = mResults[s][level];
+			out << std::left << std::setw(12) << mSamples[s].mName << std::right
+				<< std::setw(7) << level
+				<< std::setw(10) << result.mTarget
+				<< std::setw(11) << result.mTriangles
+				<< std::setw(10) << llformat("%.1f", result.mSeconds * 1000.0)
+				<< std::setw(11) << llformat("%.5f", result.mDistance) << std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	S32 triangles = 200000;
+	S32 iterations = 1;
+	bool lock_borders = false;
+	F32 max_distance = 0.05f;
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		std::string option = argv[arg];
+		bool has_value = arg + 1 < argc && argv[arg + 1][0] != '-';
+		if ((option == "--triangles" || option == "-t") && has_value)
+		{
+			triangles = llmax(atoi(argv[++arg]), 100);
+		}
+		else if ((option == "--iterations" || option == "-n") && has_value)
+		{
+			iterations = llmax(atoi(argv[++arg]), 1);
+		}
+		else if (option == "--lock-borders" || option == "-l")
+		{
+			lock_borders = true;
+		}
+		else if ((option == "--max-distance" || option == "-d") && has_value)
+		{
+			max_distance = (F32)atof(argv[++arg]);
+		}
+		else
+		{
+			std::cout << USAGE;
+			return option == "--help" || option == "-h" ? 0 : 1;
+		}
+	}
+
+#ifdef CWDEBUG
+	Debug(debug::init());
+#endif
+	LLError::initForApplication(".");
+	LLError::setDefaultLevel(LLError::LEVEL_WARN);
+	LLCommon::initClass();
+
+	S32 failures = 0;
+	{
+		LLMeshSimplifierLibTest test(iterations, lock_borders, max_distance);
+		test.generateCorpus(triangles);
+		test.run();
+		test.report(std::cout);
+		failures = test.getFailures();
+	}
+
+	LLCommon::cleanupClass();
+
+	if (failures)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -212,7 +212,6 @@ namespace HACD
         if (&rhs != this)
         {
             Clear();
-            m_heapManager = rhs.m_heapManager;
             if (rhs.m_size > 0)
             {
                 CircularListElement<T> * current = rhs.m_head;
@@ -22,9 +22,24 @@
 #include <limits>
 #include "hacdMeshDecimator.h"
 #include "hacdRaycastMesh.h"
+#include "hacdWorkerPool.h"
 //#define HACD_DEBUG
 namespace HACD
 { 
+	// Offset in [-5, 4]^3 moving a point off a degenerate convex-hull construction. It stands in for
+	// rand() and only depends on the point and the try, so that the decomposition comes out the same
+	// whatever the number of threads and the order they run in.
+	static Vec3<Real> HullNoise(long ptIndex, size_t attempt)
+	{
+		unsigned long long h = (static_cast<unsigned long long>(ptIndex) << 16) ^ attempt;
+		Real noise[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			h = h * 6364136223846793005ULL + 1442695040888963407ULL;
+			noise[k] = static_cast<Real>(static_cast<long>((h >> 33) % 10) - 5);
+		}
+		return Vec3<Real>(noise[0], noise[1], noise[2]);
+	}
 	double  HACD::Concavity(ICHull & ch, std::map<long, DPoint> & distPoints)
     {
 		double concavity = 0.0;
@@ -435,6 +450,9 @@ namespace HACD
 		m_flatRegionThreshold = 1.0;
 		m_smallClusterThreshold = 0.25;
 		m_area = 0.0;					
+		m_nThreads = 0;
+		m_executor = 0;
+		m_workerPool = 0;
 	}																
 	HACD::~HACD(void)
 	{
@@ -449,18 +467,33 @@ namespace HACD
         delete [] m_extraDistNormals;
 	}
 
-    void HACD::ComputeEdgeCost(size_t e)
+    void HACD::ComputeEdgeCosts(const std::vector<long> & edges)
+    {
+		// orient the edges and number the meshes of the convex-hulls they start from here, the
+		// worker threads then copy those hulls without writing to them
+		for(size_t i = 0; i < edges.size(); ++i)
+		{
+			GraphEdge & gE = m_graph.m_edges[edges[i]];
+			if (m_graph.m_vertices[gE.m_v2].m_ancestors.size()>m_graph.m_vertices[gE.m_v1].m_ancestors.size())
+			{
+				std::swap(gE.m_v1, gE.m_v2);
+			}
+			m_graph.m_vertices[gE.m_v1].m_convexHull->GetMesh().UpdateIDs();
+		}
+		m_workerPool->Run(edges.size(), [this, &edges](size_t i, HeapManager * heapManager)
+		{
+			ComputeEdgeCost(edges[i], heapManager);
+		});
+		for(size_t i = 0; i < edges.size(); ++i)
+		{
+			m_pqueue.push(GraphEdgePriorityQueue(edges[i], m_graph.m_edges[edges[i]].m_error));
+		}
+    }
+    void HACD::ComputeEdgeCost(size_t e, HeapManager * heapManager)
     {
 		GraphEdge & gE = m_graph.m_edges[e];
         long v1 = gE.m_v1;
         long v2 = gE.m_v2;
-
-        if (m_graph.m_vertices[v2].m_ancestors.size()>m_graph.m_vertices[v1].m_ancestors.size())
-        {
-            gE.m_v1 = v2;
-            gE.m_v2 = v1;
-			std::swap(v1, v2);
-        }
 		GraphVertex & gV1 = m_graph.m_vertices[v1];
 		GraphVertex & gV2 = m_graph.m_vertices[v2];
 #ifdef HACD_DEBUG
@@ -473,8 +506,11 @@ namespace HACD
 #endif
 	
         // create the edge's convex-hull
-        ICHull  * ch = new ICHull(m_heapManager);
-        (*ch) = (*gV1.m_convexHull);       
+#ifdef HACD_PRECOMPUTE_CHULLS
+		heapManager = m_heapManager;	// the hull is kept with the edge, past the worker threads' heaps
+#endif
+        ICHull  * ch = new ICHull(heapManager);
+        ch->CopyNumbered(*gV1.m_convexHull);       
 		// update distPoints
 #ifdef HACD_PRECOMPUTE_CHULLS
         delete gE.m_convexHull;
@@ -512,18 +548,19 @@ namespace HACD
 		
 		ch->SetDistPoints(&distPoints);
         // create the convex-hull
+		size_t attempt = 0;
         while (ch->Process() == ICHullErrorInconsistent)		// if we face problems when constructing the visual-hull. really ugly!!!!
 		{
 //			if (m_callBack) (*m_callBack)("\t Problem with convex-hull construction [HACD::ComputeEdgeCost]\n", 0.0, 0.0, 0);
             ICHull  * chOld = ch;
-			ch = new ICHull(m_heapManager);
+			ch = new ICHull(heapManager);
 			CircularList<TMMVertex> & verticesCH = chOld->GetMesh().m_vertices;
 			size_t nV = verticesCH.GetSize();
 			long ptIndex = 0;
 			verticesCH.Next();
 			// add noise to avoid the problem
 			ptIndex = verticesCH.GetHead()->GetData().m_name;			
-			ch->AddPoint(m_points[ptIndex]+ m_scale * 0.0001 * Vec3<Real>(rand() % 10 - 5, rand() % 10 - 5, rand() % 10 - 5), ptIndex);
+			ch->AddPoint(m_points[ptIndex]+ m_scale * 0.0001 * HullNoise(ptIndex, attempt++), ptIndex);
 			for(size_t v = 1; v < nV; ++v)
 			{
 				ptIndex = verticesCH.GetHead()->GetData().m_name;			
@@ -621,11 +658,12 @@ namespace HACD
     bool HACD::InitializePriorityQueue()
     {
 		m_pqueue.reserve(m_graph.m_nE + 100);
+		std::vector<long> edges(m_graph.m_nE);
         for (size_t e=0; e < m_graph.m_nE; ++e) 
         {
-            ComputeEdgeCost(static_cast<long>(e));
-			m_pqueue.push(GraphEdgePriorityQueue(static_cast<long>(e), m_graph.m_edges[e].m_error));
+			edges[e] = static_cast<long>(e);
         }
+		ComputeEdgeCosts(edges);
 		return true;
     }
 	void HACD::Simplify()
@@ -776,6 +814,7 @@ namespace HACD
 						gV1.m_distPoints.PushBack(itDP->second);
 					}
 					ch->SetDistPoints(0);
+					size_t attempt = 0;
 					while (ch->Process() == ICHullErrorInconsistent)		// if we face problems when constructing the visual-hull. really ugly!!!!
 					{
 			//			if (m_callBack) (*m_callBack)("\t Problem with convex-hull construction [HACD::ComputeEdgeCost]\n", 0.0, 0.0, 0);
@@ -787,7 +826,7 @@ namespace HACD
 						verticesCH.Next();
 						// add noise to avoid the problem
 						ptIndex = verticesCH.GetHead()->GetData().m_name;			
-						ch->AddPoint(m_points[ptIndex]+ m_scale * 0.0001 * Vec3<Real>(rand() % 10 - 5, rand() % 10 - 5, rand() % 10 - 5), ptIndex);
+						ch->AddPoint(m_points[ptIndex]+ m_scale * 0.0001 * HullNoise(ptIndex, attempt++), ptIndex);
 						for(size_t v = 1; v < nV; ++v)
 						{
 							ptIndex = verticesCH.GetHead()->GetData().m_name;			
@@ -863,13 +902,12 @@ namespace HACD
 					printf("v1 %i v2 %i \n", v1, v2);
 	#endif
 					m_graph.EdgeCollapse(v1, v2);
-					long idEdge;
-					for(size_t itE = 0; itE < m_graph.m_vertices[v1].m_edges.Size(); ++itE)
+					m_edgesToUpdate.resize(m_graph.m_vertices[v1].m_edges.Size());
+					for(size_t itE = 0; itE < m_edgesToUpdate.size(); ++itE)
 					{
-						idEdge = m_graph.m_vertices[v1].m_edges[itE];
-						ComputeEdgeCost(idEdge);
-						m_pqueue.push(GraphEdgePriorityQueue(idEdge, m_graph.m_edges[idEdge].m_error));
+						m_edgesToUpdate[itE] = m_graph.m_vertices[v1].m_edges[itE];
 					}
+					ComputeEdgeCosts(m_edgesToUpdate);
 				}
 			}
 			else
@@ -912,6 +950,8 @@ namespace HACD
 		{
 			return false;
 		}
+		WorkerPool workerPool(m_nThreads, m_executor);
+		m_workerPool = &workerPool;
 
 		Vec3<Real> *	pointsOld		= m_points;
 		Vec3<long> *	triangles		= m_triangles;
@@ -972,7 +1012,8 @@ namespace HACD
         m_convexHulls = new ICHull[m_nClusters];
 		delete [] m_partition;
 	    m_partition = new long [m_nTriangles];
-		for (size_t p = 0; p != m_cVertices.size(); ++p) 
+		// the clusters only share the input data, which is not modified any more
+		m_workerPool->Run(m_cVertices.size(), [&](size_t p, HeapManager * heapManager)
 		{
 			size_t v = m_cVertices[p];
 			m_partition[v] = static_cast<long>(p);
@@ -991,18 +1032,19 @@ namespace HACD
             }
 			if (p < m_nClusters)
 				m_convexHulls[p].SetDistPoints(0); //&m_graph.m_vertices[v].m_distPoints
+			size_t attempt = 0;
             if (fullCH)
             {
 				while (m_convexHulls[p].Process() == ICHullErrorInconsistent)		// if we face problems when constructing the visual-hull. really ugly!!!!
 				{
-					ICHull * ch = new ICHull(m_heapManager);
+					ICHull * ch = new ICHull(heapManager);
 					CircularList<TMMVertex> & verticesCH = m_convexHulls[p].GetMesh().m_vertices;
 					size_t nV = verticesCH.GetSize();
 					long ptIndex = 0;
 					verticesCH.Next();
 					// add noise to avoid the problem
 					ptIndex = verticesCH.GetHead()->GetData().m_name;			
-					ch->AddPoint(m_points[ptIndex]+ m_diag * 0.0001 * Vec3<Real>(rand() % 10 - 5, rand() % 10 - 5, rand() % 10 - 5), ptIndex);
+					ch->AddPoint(m_points[ptIndex]+ m_diag * 0.0001 * HullNoise(ptIndex, attempt++), ptIndex);
 					for(size_t v = 1; v < nV; ++v)
 					{
 						ptIndex = verticesCH.GetHead()->GetData().m_name;			
@@ -1017,14 +1059,14 @@ namespace HACD
             {
 				while ( m_convexHulls[p].Process(static_cast<unsigned long>(m_nVerticesPerCH)) == ICHullErrorInconsistent)		// if we face problems when constructing the visual-hull. really ugly!!!!
 				{
-					ICHull * ch = new ICHull(m_heapManager);
+					ICHull * ch = new ICHull(heapManager);
 					CircularList<TMMVertex> & verticesCH = m_convexHulls[p].GetMesh().m_vertices;
 					size_t nV = verticesCH.GetSize();
 					long ptIndex = 0;
 					verticesCH.Next();
 					// add noise to avoid the problem
 					ptIndex = verticesCH.GetHead()->GetData().m_name;			
-					ch->AddPoint(m_points[ptIndex]+ m_diag * 0.0001 * Vec3<Real>(rand() % 10 - 5, rand() % 10 - 5, rand() % 10 - 5), ptIndex);
+					ch->AddPoint(m_points[ptIndex]+ m_diag * 0.0001 * HullNoise(ptIndex, attempt++), ptIndex);
 					for(size_t v = 1; v < nV; ++v)
 					{
 						ptIndex = verticesCH.GetHead()->GetData().m_name;			
@@ -1059,7 +1101,7 @@ namespace HACD
                     }
                 }
             }
-		}
+		});
 		if (decimatedMeshComputed)
 		{
             m_trianglesDecimated  = m_triangles;
@@ -1071,6 +1113,7 @@ namespace HACD
 			m_nTriangles = nTrianglesOld;
 			m_nPoints	 = PointsOld;
 		}
+		m_workerPool = 0;
         return true;
     }
     
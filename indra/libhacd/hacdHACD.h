@@ -29,6 +29,8 @@ namespace HACD
 {
     const double                                    sc_pi = 3.14159265;
 	class HACD;
+	class WorkerPool;
+	class Executor;
 
 	// just to be able to set the capcity of the container
 	
@@ -199,6 +201,15 @@ namespace HACD
 		//! Gives the maximum number of vertices for each generated convex-hull.
 		//! @return maximum # vertices per CH
 		const size_t								GetNVerticesPerCH() const { return m_nVerticesPerCH;}
+		//! Sets the number of threads computing the edge costs and the convex-hulls (default 0, as many as the executor has). The result does not depend on it.
+		//! @param nThreads number of threads, 0 for as many as the executor has
+        void										SetNThreads(size_t nThreads) { m_nThreads = nThreads;}
+		//! Gives the number of threads computing the edge costs and the convex-hulls.
+		//! @return number of threads, 0 for as many as the executor has
+		const size_t								GetNThreads() const { return m_nThreads;}
+		//! Sets the threads to compute the edge costs and the convex-hulls on (default 0, the calling thread only).
+		//! @param executor threads, owned by the caller
+        void										SetExecutor(Executor * executor) { m_executor = executor;}
 		//! Gives the number of vertices for the cluster number numCH.
 		//! @return number of vertices
 		size_t                                      GetNPointsCH(size_t numCH) const;
@@ -259,9 +270,13 @@ namespace HACD
         void										CreateGraph();	
 		//! Initializes the graph costs and computes the vertices normals
         void										InitializeDualGraph();
-		//! Computes the cost of an edge
+		//! Computes the cost of an edge, possibly on a worker thread: only the edge is modified
 		//! @param e edge's id
-        void                                        ComputeEdgeCost(size_t e);
+		//! @param heapManager heap manager of the calling thread
+        void                                        ComputeEdgeCost(size_t e, HeapManager * heapManager);
+		//! Computes the costs of edges on the worker threads and pushes them to the priority queue in the given order
+		//! @param edges edges' ids
+        void                                        ComputeEdgeCosts(const std::vector<long> & edges);
 		//! Initializes the priority queue
 		//! @param fast specifies whether fast mode is used
 		//! @return true if success
@@ -316,6 +331,10 @@ namespace HACD
         HeapManager *                               m_heapManager;              //>! Heap Manager
         bool                                        m_addFacesPoints;           //>! specifies whether to add faces points or not
         bool                                        m_addExtraDistPoints;       //>! specifies whether to add extra points for concave shapes or not
+        size_t                                      m_nThreads;                 //>! number of threads, 0 for as many as m_executor has
+        Executor *                                  m_executor;                 //>! threads to run on, 0 for the calling thread only
+        WorkerPool *                                m_workerPool;               //>! threads used by Compute()
+        std::vector<long>                           m_edgesToUpdate;            //>! edges whose costs are computed by Simplify() after a collapse
 
         friend HACD * const                         CreateHACD(HeapManager * heapManager);
         friend void                                 DestroyHACD(HACD * const hacd);
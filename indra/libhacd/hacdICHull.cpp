@@ -795,15 +795,22 @@ namespace HACD
     {
         if (&rhs != this)
         {
-            m_mesh.Copy(rhs.m_mesh);
+            rhs.m_mesh.UpdateIDs();
+            CopyNumbered(rhs);
+        }
+        return (*this);
+    }   
+    void ICHull::CopyNumbered(const ICHull & rhs)
+    {
+        if (&rhs != this)
+        {
+            m_mesh.CopyNumbered(rhs.m_mesh);
             m_edgesToDelete = rhs.m_edgesToDelete;
             m_edgesToUpdate = rhs.m_edgesToUpdate;
             m_trianglesToDelete = rhs.m_trianglesToDelete;
 			m_isFlat = rhs.m_isFlat;
-            m_heapManager = rhs.m_heapManager;
         }
-        return (*this);
-    }   
+    }
     double ICHull::ComputeArea()
     {
 		size_t nT = m_mesh.GetNTriangles();
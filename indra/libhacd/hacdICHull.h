@@ -74,8 +74,10 @@ namespace HACD
             bool                                                IsInside(const Vec3<Real> & pt0, const double eps = 0.0);
 			//!
 			double												ComputeDistance(long name, const Vec3<Real> & pt, const Vec3<Real> & normal, bool & insideHull, bool updateIncidentPoints);
-            //!
+            //! Copies rhs, the copy keeps allocating from this convex-hull's heap manager
             const ICHull &                                      operator=(ICHull & rhs);        
+            //! Copies rhs, whose mesh was numbered by TMMesh::UpdateIDs(), without modifying it
+            void                                                CopyNumbered(const ICHull & rhs);
 
 			//!	Constructor
 																ICHull(HeapManager * const heapManager=0);
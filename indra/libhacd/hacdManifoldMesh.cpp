@@ -265,32 +265,41 @@ namespace HACD
 	}
     void TMMesh::Copy(TMMesh & mesh)
     {
-        Clear();
-        // updating the id's
-        size_t nV = mesh.m_vertices.GetSize();
-        size_t nE = mesh. m_edges.GetSize();
-        size_t nT = mesh.m_triangles.GetSize();
+        mesh.UpdateIDs();
+        CopyNumbered(mesh);
+    }
+    void TMMesh::UpdateIDs()
+    {
+        size_t nV = m_vertices.GetSize();
+        size_t nE = m_edges.GetSize();
+        size_t nT = m_triangles.GetSize();
         for(size_t v = 0; v < nV; v++)
         {
-            mesh.m_vertices.GetData().m_id = v;
-            mesh.m_vertices.Next();            
+            m_vertices.GetData().m_id = v;
+            m_vertices.Next();            
         }
         for(size_t e = 0; e < nE; e++)
         {
-            mesh.m_edges.GetData().m_id = e;
-            mesh.m_edges.Next();
+            m_edges.GetData().m_id = e;
+            m_edges.Next();
             
         }        
         for(size_t f = 0; f < nT; f++)
         {
-            mesh.m_triangles.GetData().m_id = f;
-            mesh.m_triangles.Next();
+            m_triangles.GetData().m_id = f;
+            m_triangles.Next();
         }
-        // copying data
+    }
+    void TMMesh::CopyNumbered(const TMMesh & mesh)
+    {
+        Clear();
+        size_t nV = mesh.m_vertices.GetSize();
+        size_t nE = mesh. m_edges.GetSize();
+        size_t nT = mesh.m_triangles.GetSize();
+        // copying data, the elements are allocated from this mesh's heap
         m_vertices  = mesh.m_vertices;
         m_edges     = mesh.m_edges;
         m_triangles = mesh.m_triangles;
-        m_heapManager = mesh.m_heapManager;
  
         // generating mapping
         CircularListElement<TMMVertex> ** vertexMap     = new CircularListElement<TMMVertex> * [nV];
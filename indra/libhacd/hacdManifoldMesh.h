@@ -208,8 +208,12 @@ namespace HACD
 #endif
             //!  
             void												Clear();
-            //!
+            //! Copies mesh, numbering its elements first
             void                                                Copy(TMMesh & mesh);
+            //! Numbers the vertices, edges and triangles in list order, as CopyNumbered() expects them
+            void                                                UpdateIDs();
+            //! Copies a mesh numbered by UpdateIDs() without touching it, so that several threads can copy the same mesh
+            void                                                CopyNumbered(const TMMesh & mesh);
 			//!
 			bool												CheckConsistancy();
 			//!
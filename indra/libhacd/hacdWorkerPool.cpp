@@ -0,0 +1,71 @@
+/**
+ * @file hacdWorkerPool.cpp
+ * @brief Threads running the loops of the convex decomposition, each with its own heap.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+#include "hacdWorkerPool.h"
+#include <algorithm>
+namespace HACD
+{
+	// Size of the blocks each heap manager reserves for every one of its micro allocation pools
+	static const NxU32 sc_heapChunkSize = 65536;
+
+	size_t WorkerPool::GetNThreads(size_t nThreads, const Executor * executor)
+	{
+		size_t available = executor ? executor->GetNThreads() : 1;
+		if (nThreads == 0 || nThreads > available)
+		{
+			nThreads = available;
+		}
+		return nThreads > 0 ? nThreads : 1;
+	}
+	WorkerPool::WorkerPool(size_t nThreads, Executor * executor)
+	{
+		m_executor = executor;
+		nThreads = GetNThreads(nThreads, executor);
+		m_heapManagers.resize(nThreads);
+		for(size_t t = 0; t < nThreads; ++t)
+		{
+			m_heapManagers[t] = createHeapManager(sc_heapChunkSize);
+		}
+	}
+	WorkerPool::~WorkerPool(void)
+	{
+		for(size_t t = 0; t < m_heapManagers.size(); ++t)
+		{
+			releaseHeapManager(m_heapManagers[t]);
+		}
+	}
+	void WorkerPool::Run(size_t n, const Task & task)
+	{
+		if (m_heapManagers.size() < 2 || n < 2)
+		{
+			for(size_t i = 0; i < n; ++i)
+			{
+				task(i, m_heapManagers[0]);
+			}
+			return;
+		}
+		m_executor->ParallelFor(n, m_heapManagers.size(), [this, &task](size_t i, size_t thread)
+		{
+			task(i, m_heapManagers[thread]);
+		});
+	}
+}
@@ -0,0 +1,81 @@
+/**
+ * @file hacdWorkerPool.h
+ * @brief Threads running the loops of the convex decomposition, each with its own heap.
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+#pragma once
+#ifndef HACD_WORKER_POOL_H
+#define HACD_WORKER_POOL_H
+#include "hacdVersion.h"
+#include "hacdMicroAllocator.h"
+#include <functional>
+#include <vector>
+namespace HACD
+{
+	//! Supplies the threads the loops of the decomposition run on, normally the application's own thread pool.
+	//! Without one the decomposition runs on the calling thread only.
+	class Executor
+	{
+	public:
+		//! Loop body, called with the iteration number and the number of the thread running it
+		typedef std::function<void (size_t, size_t)>	Body;
+
+		//! Gives the largest number of threads ParallelFor() can use, including the calling one
+		virtual size_t								GetNThreads() const = 0;
+		//! Calls body(i, thread) for every i in [0, n) on at most maxThreads threads and returns when all the calls are done.
+		//! thread is 0 on the calling thread and below maxThreads on the others; two calls running at once never get the same one.
+		virtual void								ParallelFor(size_t n, size_t maxThreads, const Body & body) = 0;
+
+	protected:
+		virtual										~Executor(void) {}
+	};
+
+	//! Runs the iterations of a loop on the threads of an executor. The calling thread takes part too.
+	//! Every thread owns a heap manager, which the iterations it runs allocate from, so that the
+	//! threads never share a micro allocator (nor its lock).
+	class WorkerPool
+	{
+	public:
+		//! Loop body, called with the iteration number and the heap manager of the thread running it
+		typedef std::function<void (size_t, HeapManager *)>	Task;
+
+		//! Gives the number of threads used for nThreads, 0 meaning as many as executor has
+		static size_t								GetNThreads(size_t nThreads, const Executor * executor);
+		//! Gives the number of threads, including the calling one
+		size_t										GetNThreads() const { return m_heapManagers.size(); }
+		//! Calls task(i, heapManager) for every i in [0, n) and returns when all the calls are done.
+		//! The calls can run in any order and on any thread, so task must only write what belongs to iteration i.
+		void										Run(size_t n, const Task & task);
+		//! Constructor
+		//! @param nThreads number of threads including the calling one, 0 for as many as executor has
+		//! @param executor threads to run on, 0 to run on the calling thread only
+													WorkerPool(size_t nThreads, Executor * executor);
+		//! Destructor, all the memory allocated from the heap managers is released with them
+													~WorkerPool(void);
+
+	private:
+		Executor *									m_executor;
+		std::vector<HeapManager *>					m_heapManagers;	//>! one per thread, the calling thread uses the first one
+
+													WorkerPool(const WorkerPool & rhs);
+		const WorkerPool &							operator=(const WorkerPool & rhs);
+	};
+}
+#endif
@@ -16,11 +16,41 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include "linden_common.h"
 #include "nd_hacdUtils.h"
+#include "hacdWorkerPool.h"
+#include "llthreadpool.h"
+
+// Runs the loops of HACD::Compute() on the viewer's shared worker pool
+class ndHACDExecutor : public HACD::Executor
+{
+public:
+	size_t GetNThreads() const
+	{
+		LLThreadPool *pPool = LLThreadPool::getShared();
+		return pPool ? pPool->getWorkerCount() + 1 : 1;
+	}
+
+	void ParallelFor( size_t n, size_t maxThreads, const Body &aBody )
+	{
+		LLThreadPool *pPool = LLThreadPool::getShared();
+		if ( !pPool )
+		{
+			for ( size_t i = 0; i < n; ++i )
+				aBody( i, 0 );
+			return;
+		}
+
+		pPool->parallelFor( n, maxThreads, [&aBody]( S32 i, S32 nThread ) { aBody( i, nThread ); } );
+	}
+};
+
+static ndHACDExecutor sExecutor;
 
 tHACD* init( int nConcavity, int nClusters, int nMaxVerticesPerHull, double dMaxConnectDist, HACDDecoder *aData )
 {
 	tHACD *pDec = HACD::CreateHACD(0);
+	pDec->SetExecutor( &sExecutor );
 	pDec->SetPoints( &aData->mVertices[0] );
 	pDec->SetNPoints( aData->mVertices.size() );
 
@@ -153,6 +153,40 @@ void OPJ_CALLCONV opj_setup_decoder(opj_dinfo_t *dinfo, opj_dparameters_t *param
 	}
 }
 
+void OPJ_CALLCONV opj_set_decode_parallel_for(opj_dinfo_t *dinfo, opj_parallel_for_fn parallel_for, int thread_count, void *parallel_data) {
+	if(dinfo) {
+		dinfo->parallel_for = parallel_for;
+		dinfo->parallel_thread_count = thread_count;
+		dinfo->parallel_data = parallel_data;
+	}
+}
+
+void OPJ_CALLCONV opj_set_encode_parallel_for(opj_cinfo_t *cinfo, opj_parallel_for_fn parallel_for, int thread_count, void *parallel_data) {
+	if(cinfo) {
+		cinfo->parallel_for = parallel_for;
+		cinfo->parallel_thread_count = thread_count;
+		cinfo->parallel_data = parallel_data;
+	}
+}
+
+opj_cblk_cache_t* OPJ_CALLCONV opj_create_cblk_cache(void) {
+	return t1_cache_create();
+}
+
+void OPJ_CALLCONV opj_destroy_cblk_cache(opj_cblk_cache_t *cache) {
+	t1_cache_destroy(cache);
+}
+
+int OPJ_CALLCONV opj_cblk_cache_size(opj_cblk_cache_t *cache) {
+	return t1_cache_size(cache);
+}
+
+void OPJ_CALLCONV opj_set_decode_cblk_cache(opj_dinfo_t *dinfo, opj_cblk_cache_t *cache) {
+	if(dinfo) {
+		dinfo->cblk_cache = cache;
+	}
+}
+
 opj_image_t* OPJ_CALLCONV opj_decode(opj_dinfo_t *dinfo, opj_cio_t *cio) {
 	return opj_decode_with_info(dinfo, cio, NULL);
 }
@@ -450,6 +450,23 @@ typedef struct opj_dparameters {
 	unsigned int flags;
 } opj_dparameters_t;
 
+/**
+Unit of work handed to an opj_parallel_for_fn
+@param job_data Data passed along with the job
+@param index Index of the job, 0 <= index < count
+@param thread_index Index of the thread running the job, 0 <= thread_index < the thread count given to opj_set_decode_parallel_for or opj_set_encode_parallel_for
+*/
+typedef void (*opj_job_fn) (void *job_data, int index, int thread_index);
+/**
+Callback used to run count jobs, possibly concurrently. Must not return before every job has completed.
+*/
+typedef void (*opj_parallel_for_fn) (void *parallel_data, int count, opj_job_fn job, void *job_data);
+
+/**
+Decoded code-blocks kept between decodes of the same image, see opj_set_decode_cblk_cache
+*/
+typedef struct opj_cblk_cache opj_cblk_cache_t;
+
 /** Common fields between JPEG-2000 compression and decompression master structs. */
 
 #define opj_common_fields \
@@ -459,7 +476,11 @@ typedef struct opj_dparameters {
 	OPJ_CODEC_FORMAT codec_format;	/**< selected codec */\
 	void *j2k_handle;			/**< pointer to the J2K codec */\
 	void *jp2_handle;			/**< pointer to the JP2 codec */\
-	void *mj2_handle			/**< pointer to the MJ2 codec */
+	void *mj2_handle;			/**< pointer to the MJ2 codec */\
+	opj_parallel_for_fn parallel_for;	/**< optional scheduler for tier-1 decoding */\
+	void *parallel_data;		/**< passed to parallel_for */\
+	int parallel_thread_count;	/**< number of distinct thread indices parallel_for may use */\
+	opj_cblk_cache_t *cblk_cache	/**< optional code-blocks of a previous decode */
 	
 /* Routines that are to be used by both halves of the library are declared
  * to receive a pointer to this structure.  There are no actual instances of
@@ -865,6 +886,41 @@ Decoding parameters are returned in j2k->cp.
 */
 OPJ_API void OPJ_CALLCONV opj_setup_decoder(opj_dinfo_t *dinfo, opj_dparameters_t *parameters);
 /**
+Decode the code-blocks of each tile concurrently.
+The code-blocks are handed to parallel_for as independent jobs; the inverse wavelet
+transform and the colour transform still run on the calling thread.
+@param dinfo decompressor handle
+@param parallel_for Scheduler for the jobs, or NULL to decode on the calling thread
+@param thread_count Number of distinct thread indices parallel_for may pass to a job
+@param parallel_data Passed to parallel_for
+*/
+OPJ_API void OPJ_CALLCONV opj_set_decode_parallel_for(opj_dinfo_t *dinfo, opj_parallel_for_fn parallel_for, int thread_count, void *parallel_data);
+/**
+Create a cache of decoded code-blocks
+@return Returns a new cache if successful, returns NULL otherwise
+*/
+OPJ_API opj_cblk_cache_t* OPJ_CALLCONV opj_create_cblk_cache(void);
+/**
+Destroy a cache of decoded code-blocks
+@param cache cache to destroy
+*/
+OPJ_API void OPJ_CALLCONV opj_destroy_cblk_cache(opj_cblk_cache_t *cache);
+/**
+Get the memory used by a cache of decoded code-blocks
+@param cache cache handle
+@return Returns the size of the cache in bytes
+*/
+OPJ_API int OPJ_CALLCONV opj_cblk_cache_size(opj_cblk_cache_t *cache);
+/**
+Decode incrementally: keep the tier-1 output of every code-block in cache, and reuse it in a
+later decode of the same codestream (typically with more data, or a lower cp_reduce) for the
+code-blocks whose compressed data did not change.
+The cache must only be used by one decompressor at a time.
+@param dinfo decompressor handle
+@param cache cache handle, or NULL to stop using a cache
+*/
+OPJ_API void OPJ_CALLCONV opj_set_decode_cblk_cache(opj_dinfo_t *dinfo, opj_cblk_cache_t *cache);
+/**
 Decode an image from a JPEG-2000 codestream 
 @param dinfo decompressor handle
 @param cio Input buffer stream
@@ -921,6 +977,16 @@ Setup the encoder parameters using the current image and using user parameters.
 */
 OPJ_API void OPJ_CALLCONV opj_setup_encoder(opj_cinfo_t *cinfo, opj_cparameters_t *parameters, opj_image_t *image);
 /**
+Encode the code-blocks of each tile concurrently.
+The code-blocks are handed to parallel_for as independent jobs; the colour transform, the
+wavelet transform and the rate allocation still run on the calling thread.
+@param cinfo compressor handle
+@param parallel_for Scheduler for the jobs, or NULL to encode on the calling thread
+@param thread_count Number of distinct thread indices parallel_for may pass to a job
+@param parallel_data Passed to parallel_for
+*/
+OPJ_API void OPJ_CALLCONV opj_set_encode_parallel_for(opj_cinfo_t *cinfo, opj_parallel_for_fn parallel_for, int thread_count, void *parallel_data);
+/**
 Encode an image into a JPEG-2000 codestream
 3@param cinfo compressor handle
 @param cio Output buffer stream
@@ -241,7 +241,7 @@ Encode 1 code-block
 @param cblksty Code-block style
 @param numcomps
 @param mct
-@param tile
+@param distortion Incremented by the distortion of each pass (fixed_quality)
 */
 static void t1_encode_cblk(
 		opj_t1_t *t1,
@@ -254,7 +254,27 @@ static void t1_encode_cblk(
 		int cblksty,
 		int numcomps,
 		int mct,
-		opj_tcd_tile_t * tile);
+		double *distortion);
+/**
+Copy one code-block out of a tile component and encode it
+@param t1 T1 handle
+@param tile Tile of the code-block
+@param tcp Tile coding parameters
+@param compno Component of the code-block
+@param resno Resolution of the code-block
+@param band Band of the code-block
+@param cblk Code-block coding parameters
+@param distortion Incremented by the distortion of each pass (fixed_quality)
+*/
+static void t1_encode_cblk_from_tile(
+		opj_t1_t *t1,
+		opj_tcd_tile_t *tile,
+		opj_tcp_t *tcp,
+		int compno,
+		int resno,
+		opj_tcd_band_t *band,
+		opj_tcd_cblk_enc_t* cblk,
+		double *distortion);
 /**
 Decode 1 code-block
 @param t1 T1 handle
@@ -1167,7 +1187,7 @@ static void t1_encode_cblk(
 		int cblksty,
 		int numcomps,
 		int mct,
-		opj_tcd_tile_t * tile)
+		double *distortion)
 {
 	double cumwmsedec = 0.0;
 
@@ -1219,7 +1239,7 @@ static void t1_encode_cblk(
 		/* fixed_quality */
 		tempwmsedec = t1_getwmsedec(nmsedec, compno, level, orient, bpno, qmfbid, stepsize, numcomps, mct);
 		cumwmsedec += tempwmsedec;
-		tile->distotile += tempwmsedec;
+		*distortion += tempwmsedec;
 		
 		/* Code switch "RESTART" (i.e. TERMALL) */
 		if ((cblksty & J2K_CCP_CBLKSTY_TERMALL)	&& !((passtype == 2) && (bpno - 1 < 0))) {
@@ -1409,6 +1429,83 @@ void t1_destroy(opj_t1_t *t1) {
 	}
 }
 
+static void t1_encode_cblk_from_tile(
+		opj_t1_t *t1,
+		opj_tcd_tile_t *tile,
+		opj_tcp_t *tcp,
+		int compno,
+		int resno,
+		opj_tcd_band_t *band,
+		opj_tcd_cblk_enc_t* cblk,
+		double *distortion)
+{
+	opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
+	opj_tccp_t* tccp = &tcp->tccps[compno];
+	int tile_w = tilec->x1 - tilec->x0;
+	int bandconst = 8192 * 8192 / ((int) floor(band->stepsize * 8192));
+	int* OPJ_RESTRICT datap;
+	int* OPJ_RESTRICT tiledp;
+	int cblk_w;
+	int cblk_h;
+	int i, j;
+
+	int x = cblk->x0 - band->x0;
+	int y = cblk->y0 - band->y0;
+	if (band->bandno & 1) {
+		opj_tcd_resolution_t *pres = &tilec->resolutions[resno - 1];
+		x += pres->x1 - pres->x0;
+	}
+	if (band->bandno & 2) {
+		opj_tcd_resolution_t *pres = &tilec->resolutions[resno - 1];
+		y += pres->y1 - pres->y0;
+	}
+
+	if(!allocate_buffers(
+				t1,
+				cblk->x1 - cblk->x0,
+				cblk->y1 - cblk->y0))
+	{
+		return;
+	}
+
+	datap=t1->data;
+	cblk_w = t1->w;
+	cblk_h = t1->h;
+
+	tiledp=&tilec->data[(y * tile_w) + x];
+	if (tccp->qmfbid == 1) {
+		for (j = 0; j < cblk_h; ++j) {
+			for (i = 0; i < cblk_w; ++i) {
+				int tmp = tiledp[(j * tile_w) + i];
+				datap[(j * cblk_w) + i] = tmp << T1_NMSEDEC_FRACBITS;
+			}
+		}
+	} else {		/* if (tccp->qmfbid == 0) */
+		for (j = 0; j < cblk_h; ++j) {
+			for (i = 0; i < cblk_w; ++i) {
+				int tmp = tiledp[(j * tile_w) + i];
+				datap[(j * cblk_w) + i] =
+					fix_mul(
+					tmp,
+					bandconst) >> (11 - T1_NMSEDEC_FRACBITS);
+			}
+		}
+	}
+
+	t1_encode_cblk(
+			t1,
+			cblk,
+			band->bandno,
+			compno,
+			tilec->numresolutions - 1 - resno,
+			tccp->qmfbid,
+			band->stepsize,
+			tccp->cblksty,
+			tile->numcomps,
+			tcp->mct,
+			distortion);
+}
+
 void t1_encode_cblks(
 		opj_t1_t *t1,
 		opj_tcd_tile_t *tile,
@@ -1420,83 +1517,18 @@ void t1_encode_cblks(
 
 	for (compno = 0; compno < tile->numcomps; ++compno) {
 		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
-		opj_tccp_t* tccp = &tcp->tccps[compno];
-		int tile_w = tilec->x1 - tilec->x0;
 
 		for (resno = 0; resno < tilec->numresolutions; ++resno) {
 			opj_tcd_resolution_t *res = &tilec->resolutions[resno];
 
 			for (bandno = 0; bandno < res->numbands; ++bandno) {
 				opj_tcd_band_t* OPJ_RESTRICT band = &res->bands[bandno];
-        int bandconst = 8192 * 8192 / ((int) floor(band->stepsize * 8192));
 
 				for (precno = 0; precno < res->pw * res->ph; ++precno) {
 					opj_tcd_precinct_t *prc = &band->precincts[precno];
 
 					for (cblkno = 0; cblkno < prc->cw * prc->ch; ++cblkno) {
-						opj_tcd_cblk_enc_t* cblk = &prc->cblks.enc[cblkno];
-						int* OPJ_RESTRICT datap;
-						int* OPJ_RESTRICT tiledp;
-						int cblk_w;
-						int cblk_h;
-						int i, j;
-
-						int x = cblk->x0 - band->x0;
-						int y = cblk->y0 - band->y0;
-						if (band->bandno & 1) {
-							opj_tcd_resolution_t *pres = &tilec->resolutions[resno - 1];
-							x += pres->x1 - pres->x0;
-						}
-						if (band->bandno & 2) {
-							opj_tcd_resolution_t *pres = &tilec->resolutions[resno - 1];
-							y += pres->y1 - pres->y0;
-						}
-
-						if(!allocate_buffers(
-									t1,
-									cblk->x1 - cblk->x0,
-									cblk->y1 - cblk->y0))
-						{
-							return;
-						}
-
-						datap=t1->data;
-						cblk_w = t1->w;
-						cblk_h = t1->h;
-
-						tiledp=&tilec->data[(y * tile_w) + x];
-						if (tccp->qmfbid == 1) {
-							for (j = 0; j < cblk_h; ++j) {
-								for (i = 0; i < cblk_w; ++i) {
-									int tmp = tiledp[(j * tile_w) + i];
-									datap[(j * cblk_w) + i] = tmp << T1_NMSEDEC_FRACBITS;
-								}
-							}
-						} else {		/* if (tccp->qmfbid == 0) */
-							for (j = 0; j < cblk_h; ++j) {
-								for (i = 0; i < cblk_w; ++i) {
-									int tmp = tiledp[(j * tile_w) + i];
-									datap[(j * cblk_w) + i] =
-										fix_mul(
-										tmp,
-										bandconst) >> (11 - T1_NMSEDEC_FRACBITS);
-								}
-							}
-						}
-
-						t1_encode_cblk(
-								t1,
-								cblk,
-								band->bandno,
-								compno,
-								tilec->numresolutions - 1 - resno,
-								tccp->qmfbid,
-								band->stepsize,
-								tccp->cblksty,
-								tile->numcomps,
-								tcp->mct,
-								tile);
-
+						t1_encode_cblk_from_tile(t1, tile, tcp, compno, resno, band, &prc->cblks.enc[cblkno], &tile->distotile);
 					} /* cblkno */
 				} /* precno */
 			} /* bandno */
@@ -1504,6 +1536,362 @@ void t1_encode_cblks(
 	} /* compno  */
 }
 
+/**
+One code-block of a tile, queued for t1_encode_tile_cblks
+*/
+typedef struct opj_t1_cblk_enc_job {
+	int compno;
+	int resno;
+	opj_tcd_band_t* band;
+	opj_tcd_cblk_enc_t* cblk;
+	double distortion;
+} opj_t1_cblk_enc_job_t;
+
+typedef struct opj_t1_cblk_enc_jobs {
+	opj_t1_t** t1s;
+	opj_tcd_tile_t* tile;
+	opj_tcp_t* tcp;
+	opj_t1_cblk_enc_job_t* jobs;
+} opj_t1_cblk_enc_jobs_t;
+
+static void t1_run_cblk_enc_job(void* job_data, int index, int thread_index) {
+	opj_t1_cblk_enc_jobs_t* jobs = (opj_t1_cblk_enc_jobs_t*) job_data;
+	opj_t1_cblk_enc_job_t* job = &jobs->jobs[index];
+	t1_encode_cblk_from_tile(jobs->t1s[thread_index], jobs->tile, jobs->tcp, job->compno, job->resno, job->band, job->cblk, &job->distortion);
+}
+
+opj_bool t1_encode_tile_cblks(
+		opj_t1_t** t1s,
+		int t1_count,
+		opj_tcd_tile_t *tile,
+		opj_tcp_t *tcp)
+{
+	opj_common_ptr cinfo = t1s[0]->cinfo;
+	opj_t1_cblk_enc_jobs_t jobs;
+	int compno, resno, bandno, precno, cblkno;
+	int count = 0;
+	int i;
+
+	for (compno = 0; compno < tile->numcomps; ++compno) {
+		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
+		for (resno = 0; resno < tilec->numresolutions; ++resno) {
+			opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+			for (bandno = 0; bandno < res->numbands; ++bandno) {
+				opj_tcd_band_t* band = &res->bands[bandno];
+				for (precno = 0; precno < res->pw * res->ph; ++precno) {
+					count += band->precincts[precno].cw * band->precincts[precno].ch;
+				}
+			}
+		}
+	}
+
+	jobs.t1s = t1s;
+	jobs.tile = tile;
+	jobs.tcp = tcp;
+	jobs.jobs = (opj_t1_cblk_enc_job_t*) opj_malloc(count * sizeof(opj_t1_cblk_enc_job_t));
+	if (!jobs.jobs && count) {
+		return OPJ_FALSE;
+	}
+
+	/* Each code-block only reads its own part of the tile and writes its own cblk->data
+	   and passes. The distortion is kept per job and summed afterwards, in code-block
+	   order, so the rate allocation sees the same numbers whatever the thread count. */
+	count = 0;
+	for (compno = 0; compno < tile->numcomps; ++compno) {
+		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
+		for (resno = 0; resno < tilec->numresolutions; ++resno) {
+			opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+			for (bandno = 0; bandno < res->numbands; ++bandno) {
+				opj_tcd_band_t* band = &res->bands[bandno];
+				for (precno = 0; precno < res->pw * res->ph; ++precno) {
+					opj_tcd_precinct_t* prc = &band->precincts[precno];
+					for (cblkno = 0; cblkno < prc->cw * prc->ch; ++cblkno) {
+						opj_t1_cblk_enc_job_t* job = &jobs.jobs[count++];
+						job->compno = compno;
+						job->resno = resno;
+						job->band = band;
+						job->cblk = &prc->cblks.enc[cblkno];
+						job->distortion = 0;
+					}
+				}
+			}
+		}
+	}
+
+	if (t1_count > 1 && count) {
+		cinfo->parallel_for(cinfo->parallel_data, count, t1_run_cblk_enc_job, &jobs);
+	} else {
+		for (i = 0; i < count; ++i) {
+			t1_run_cblk_enc_job(&jobs, i, 0);
+		}
+	}
+
+	tile->distotile = 0;		/* fixed_quality */
+	for (i = 0; i < count; ++i) {
+		tile->distotile += jobs.jobs[i].distortion;
+	}
+	opj_free(jobs.jobs);
+
+	return OPJ_TRUE;
+}
+
+/**
+Code-block of a previous decode, see opj_cblk_cache_t
+*/
+typedef struct opj_cblk_cache_entry {
+	int valid;
+	int x0, y0, x1, y1;
+	int numbps;
+	int numsegs;
+	int len;
+	int* segs;				/* numpasses and len of each segment */
+	unsigned char* data;	/* compressed data */
+	int* coefs;				/* decoded coefficients, after the ROI shift */
+} opj_cblk_cache_entry_t;
+
+typedef struct opj_cblk_cache_tile {
+	int tileno;
+	int numentries;
+	opj_cblk_cache_entry_t* entries;
+} opj_cblk_cache_tile_t;
+
+struct opj_cblk_cache {
+	int numtiles;
+	opj_cblk_cache_tile_t* tiles;
+	int size;
+};
+
+static void t1_cache_clear_entry(opj_cblk_cache_entry_t* entry) {
+	opj_free(entry->segs);
+	opj_free(entry->data);
+	opj_free(entry->coefs);
+	memset(entry, 0, sizeof(opj_cblk_cache_entry_t));
+}
+
+static int t1_cache_entry_size(opj_cblk_cache_entry_t* entry) {
+	if (!entry->valid) {
+		return 0;
+	}
+	return entry->numsegs * 2 * sizeof(int) + entry->len
+		+ (entry->x1 - entry->x0) * (entry->y1 - entry->y0) * sizeof(int);
+}
+
+opj_cblk_cache_t* t1_cache_create(void) {
+	return (opj_cblk_cache_t*) opj_calloc(1, sizeof(opj_cblk_cache_t));
+}
+
+void t1_cache_destroy(opj_cblk_cache_t* cache) {
+	int tileno, i;
+	if (!cache) {
+		return;
+	}
+	for (tileno = 0; tileno < cache->numtiles; ++tileno) {
+		opj_cblk_cache_tile_t* tile = &cache->tiles[tileno];
+		for (i = 0; i < tile->numentries; ++i) {
+			t1_cache_clear_entry(&tile->entries[i]);
+		}
+		opj_free(tile->entries);
+	}
+	opj_free(cache->tiles);
+	opj_free(cache);
+}
+
+int t1_cache_size(opj_cblk_cache_t* cache) {
+	return cache ? cache->size : 0;
+}
+
+/**
+Get the cache entries of a tile, with room for count code-blocks
+*/
+static opj_cblk_cache_entry_t* t1_cache_get_tile(opj_cblk_cache_t* cache, int tileno, int count) {
+	opj_cblk_cache_tile_t* tile = NULL;
+	int i;
+
+	for (i = 0; i < cache->numtiles; ++i) {
+		if (cache->tiles[i].tileno == tileno) {
+			tile = &cache->tiles[i];
+			break;
+		}
+	}
+	if (!tile) {
+		opj_cblk_cache_tile_t* tiles = (opj_cblk_cache_tile_t*) opj_realloc(cache->tiles, (cache->numtiles + 1) * sizeof(opj_cblk_cache_tile_t));
+		if (!tiles) {
+			return NULL;
+		}
+		cache->tiles = tiles;
+		tile = &cache->tiles[cache->numtiles++];
+		tile->tileno = tileno;
+		tile->numentries = 0;
+		tile->entries = NULL;
+	}
+	if (tile->numentries != count) {
+		/* The code-block layout only depends on the main header, so this is a different image */
+		for (i = 0; i < tile->numentries; ++i) {
+			t1_cache_clear_entry(&tile->entries[i]);
+		}
+		opj_free(tile->entries);
+		tile->entries = (opj_cblk_cache_entry_t*) opj_calloc(count, sizeof(opj_cblk_cache_entry_t));
+		tile->numentries = tile->entries ? count : 0;
+	}
+	return tile->entries;
+}
+
+static void t1_cache_update_size(opj_cblk_cache_t* cache) {
+	int tileno, i;
+	cache->size = 0;
+	for (tileno = 0; tileno < cache->numtiles; ++tileno) {
+		opj_cblk_cache_tile_t* tile = &cache->tiles[tileno];
+		cache->size += tile->numentries * sizeof(opj_cblk_cache_entry_t);
+		for (i = 0; i < tile->numentries; ++i) {
+			cache->size += t1_cache_entry_size(&tile->entries[i]);
+		}
+	}
+}
+
+/* len and numbps are only set once a packet included the code-block */
+#define T1_CBLK_LEN(cblk) ((cblk)->numsegs ? (cblk)->len : 0)
+#define T1_CBLK_NUMBPS(cblk) ((cblk)->numsegs ? (cblk)->numbps : 0)
+
+/**
+Check whether a code-block has exactly the same compressed data as when it was cached
+*/
+static opj_bool t1_cache_match(opj_cblk_cache_entry_t* entry, opj_tcd_cblk_dec_t* cblk) {
+	int segno;
+
+	if (!entry->valid ||
+		entry->x0 != cblk->x0 || entry->y0 != cblk->y0 ||
+		entry->x1 != cblk->x1 || entry->y1 != cblk->y1 ||
+		entry->numbps != T1_CBLK_NUMBPS(cblk) ||
+		entry->numsegs != cblk->numsegs ||
+		entry->len != T1_CBLK_LEN(cblk)) {
+		return OPJ_FALSE;
+	}
+	for (segno = 0; segno < cblk->numsegs; ++segno) {
+		if (entry->segs[segno * 2] != cblk->segs[segno].numpasses ||
+			entry->segs[segno * 2 + 1] != cblk->segs[segno].len) {
+			return OPJ_FALSE;
+		}
+	}
+	return entry->len == 0 || memcmp(entry->data, cblk->data, entry->len) == 0;
+}
+
+static void t1_cache_store(opj_cblk_cache_entry_t* entry, opj_tcd_cblk_dec_t* cblk, int* coefs, int w, int h) {
+	int segno;
+	int len = T1_CBLK_LEN(cblk);
+
+	t1_cache_clear_entry(entry);
+	entry->segs = (int*) opj_malloc(cblk->numsegs * 2 * sizeof(int) + 1);
+	entry->data = (unsigned char*) opj_malloc(len + 1);
+	entry->coefs = (int*) opj_malloc(w * h * sizeof(int) + 1);
+	if (!entry->segs || !entry->data || !entry->coefs) {
+		t1_cache_clear_entry(entry);
+		return;
+	}
+	entry->x0 = cblk->x0;
+	entry->y0 = cblk->y0;
+	entry->x1 = cblk->x1;
+	entry->y1 = cblk->y1;
+	entry->numbps = T1_CBLK_NUMBPS(cblk);
+	entry->numsegs = cblk->numsegs;
+	entry->len = len;
+	for (segno = 0; segno < cblk->numsegs; ++segno) {
+		entry->segs[segno * 2] = cblk->segs[segno].numpasses;
+		entry->segs[segno * 2 + 1] = cblk->segs[segno].len;
+	}
+	if (len) {
+		memcpy(entry->data, cblk->data, len);
+	}
+	memcpy(entry->coefs, coefs, w * h * sizeof(int));
+	entry->valid = 1;
+}
+
+/**
+Decode one code-block (or take it from the cache) and store its dequantized coefficients in the tile component
+*/
+static void t1_decode_cblk_to_tile(
+		opj_t1_t* t1,
+		opj_tcd_tilecomp_t* tilec,
+		opj_tccp_t* tccp,
+		int resno,
+		opj_tcd_band_t* band,
+		opj_tcd_cblk_dec_t* cblk,
+		opj_cblk_cache_entry_t* cached)
+{
+	int* OPJ_RESTRICT datap;
+	int tile_w = tilec->x1 - tilec->x0;
+	int cblk_w, cblk_h;
+	int x, y;
+	int i, j;
+
+	if (cached && t1_cache_match(cached, cblk)) {
+		datap = cached->coefs;
+		cblk_w = cblk->x1 - cblk->x0;
+		cblk_h = cblk->y1 - cblk->y0;
+	} else {
+		t1_decode_cblk(
+				t1,
+				cblk,
+				band->bandno,
+				tccp->roishift,
+				tccp->cblksty);
+
+		datap=t1->data;
+		cblk_w = t1->w;
+		cblk_h = t1->h;
+
+		if (tccp->roishift) {
+			int thresh = 1 << tccp->roishift;
+			for (j = 0; j < cblk_h; ++j) {
+				for (i = 0; i < cblk_w; ++i) {
+					int val = datap[(j * cblk_w) + i];
+					int mag = abs(val);
+					if (mag >= thresh) {
+						mag >>= tccp->roishift;
+						datap[(j * cblk_w) + i] = val < 0 ? -mag : mag;
+					}
+				}
+			}
+		}
+
+		if (cached) {
+			t1_cache_store(cached, cblk, datap, cblk_w, cblk_h);
+		}
+	}
+
+	x = cblk->x0 - band->x0;
+	y = cblk->y0 - band->y0;
+	if (band->bandno & 1) {
+		opj_tcd_resolution_t* pres = &tilec->resolutions[resno - 1];
+		x += pres->x1 - pres->x0;
+	}
+	if (band->bandno & 2) {
+		opj_tcd_resolution_t* pres = &tilec->resolutions[resno - 1];
+		y += pres->y1 - pres->y0;
+	}
+
+	if (tccp->qmfbid == 1) {
+		int* OPJ_RESTRICT tiledp = &tilec->data[(y * tile_w) + x];
+		for (j = 0; j < cblk_h; ++j) {
+			for (i = 0; i < cblk_w; ++i) {
+				int tmp = datap[(j * cblk_w) + i];
+				((int*)tiledp)[(j * tile_w) + i] = tmp / 2;
+			}
+		}
+	} else {		/* if (tccp->qmfbid == 0) */
+		float* OPJ_RESTRICT tiledp = (float*) &tilec->data[(y * tile_w) + x];
+		for (j = 0; j < cblk_h; ++j) {
+			float* OPJ_RESTRICT tiledp2 = tiledp;
+			for (i = 0; i < cblk_w; ++i) {
+				float tmp = *datap * band->stepsize;
+				*tiledp2 = tmp;
+				datap++;
+				tiledp2++;
+			}
+			tiledp += tile_w;
+		}
+	}
+}
+
 void t1_decode_cblks(
 		opj_t1_t* t1,
 		opj_tcd_tilecomp_t* tilec,
@@ -1511,8 +1899,6 @@ void t1_decode_cblks(
 {
 	int resno, bandno, precno, cblkno;
 
-	int tile_w = tilec->x1 - tilec->x0;
-
 	for (resno = 0; resno < tilec->numresolutions; ++resno) {
 		opj_tcd_resolution_t* res = &tilec->resolutions[resno];
 
@@ -1524,68 +1910,7 @@ void t1_decode_cblks(
 
 				for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno) {
 					opj_tcd_cblk_dec_t* cblk = &precinct->cblks.dec[cblkno];
-					int* OPJ_RESTRICT datap;
-					int cblk_w, cblk_h;
-					int x, y;
-					int i, j;
-
-					t1_decode_cblk(
-							t1,
-							cblk,
-							band->bandno,
-							tccp->roishift,
-							tccp->cblksty);
-
-					x = cblk->x0 - band->x0;
-					y = cblk->y0 - band->y0;
-					if (band->bandno & 1) {
-						opj_tcd_resolution_t* pres = &tilec->resolutions[resno - 1];
-						x += pres->x1 - pres->x0;
-					}
-					if (band->bandno & 2) {
-						opj_tcd_resolution_t* pres = &tilec->resolutions[resno - 1];
-						y += pres->y1 - pres->y0;
-					}
-
-					datap=t1->data;
-					cblk_w = t1->w;
-					cblk_h = t1->h;
-
-					if (tccp->roishift) {
-						int thresh = 1 << tccp->roishift;
-						for (j = 0; j < cblk_h; ++j) {
-							for (i = 0; i < cblk_w; ++i) {
-								int val = datap[(j * cblk_w) + i];
-								int mag = abs(val);
-								if (mag >= thresh) {
-									mag >>= tccp->roishift;
-									datap[(j * cblk_w) + i] = val < 0 ? -mag : mag;
-								}
-							}
-						}
-					}
-
-					if (tccp->qmfbid == 1) {
-						int* OPJ_RESTRICT tiledp = &tilec->data[(y * tile_w) + x];
-						for (j = 0; j < cblk_h; ++j) {
-							for (i = 0; i < cblk_w; ++i) {
-								int tmp = datap[(j * cblk_w) + i];
-								((int*)tiledp)[(j * tile_w) + i] = tmp / 2;
-							}
-						}
-					} else {		/* if (tccp->qmfbid == 0) */
-						float* OPJ_RESTRICT tiledp = (float*) &tilec->data[(y * tile_w) + x];
-						for (j = 0; j < cblk_h; ++j) {
-							float* OPJ_RESTRICT tiledp2 = tiledp;
-							for (i = 0; i < cblk_w; ++i) {
-								float tmp = *datap * band->stepsize;
-								*tiledp2 = tmp;
-								datap++;
-								tiledp2++;
-							}
-							tiledp += tile_w;
-						}
-					}
+					t1_decode_cblk_to_tile(t1, tilec, tccp, resno, band, cblk, NULL);
 					opj_free(cblk->data);
 					opj_free(cblk->segs);
 				} /* cblkno */
@@ -1596,3 +1921,128 @@ void t1_decode_cblks(
 	} /* resno */
 }
 
+/**
+One code-block of a tile, queued for t1_decode_tile_cblks
+*/
+typedef struct opj_t1_cblk_job {
+	opj_tcd_tilecomp_t* tilec;
+	opj_tccp_t* tccp;
+	int resno;
+	opj_tcd_band_t* band;
+	opj_tcd_cblk_dec_t* cblk;
+	opj_cblk_cache_entry_t* cached;
+} opj_t1_cblk_job_t;
+
+typedef struct opj_t1_cblk_jobs {
+	opj_t1_t** t1s;
+	opj_t1_cblk_job_t* jobs;
+} opj_t1_cblk_jobs_t;
+
+static void t1_run_cblk_job(void* job_data, int index, int thread_index) {
+	opj_t1_cblk_jobs_t* jobs = (opj_t1_cblk_jobs_t*) job_data;
+	opj_t1_cblk_job_t* job = &jobs->jobs[index];
+	t1_decode_cblk_to_tile(jobs->t1s[thread_index], job->tilec, job->tccp, job->resno, job->band, job->cblk, job->cached);
+}
+
+opj_bool t1_decode_tile_cblks(
+		opj_t1_t** t1s,
+		int t1_count,
+		opj_tcd_tile_t* tile,
+		int tileno,
+		opj_tcp_t* tcp,
+		int reduce)
+{
+	opj_common_ptr cinfo = t1s[0]->cinfo;
+	opj_cblk_cache_t* cache = (opj_cblk_cache_t*) cinfo->cblk_cache;
+	opj_cblk_cache_entry_t* entries = NULL;
+	opj_t1_cblk_jobs_t jobs;
+	int compno, resno, bandno, precno, cblkno;
+	int total = 0;
+	int count = 0;
+	int i;
+
+	for (compno = 0; compno < tile->numcomps; ++compno) {
+		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
+		for (resno = 0; resno < tilec->numresolutions; ++resno) {
+			opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+			for (bandno = 0; bandno < res->numbands; ++bandno) {
+				opj_tcd_band_t* band = &res->bands[bandno];
+				for (precno = 0; precno < res->pw * res->ph; ++precno) {
+					total += band->precincts[precno].cw * band->precincts[precno].ch;
+				}
+			}
+		}
+	}
+
+	jobs.t1s = t1s;
+	jobs.jobs = (opj_t1_cblk_job_t*) opj_malloc(total * sizeof(opj_t1_cblk_job_t));
+	if (!jobs.jobs && total) {
+		return OPJ_FALSE;
+	}
+	if (cache) {
+		entries = t1_cache_get_tile(cache, tileno, total);
+	}
+
+	/* Code-blocks write to disjoint parts of the tile components, so they can all go at once.
+	   The ones in the resolutions that cp_reduce drops are never looked at by the DWT. */
+	total = 0;
+	for (compno = 0; compno < tile->numcomps; ++compno) {
+		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
+		for (resno = 0; resno < tilec->numresolutions; ++resno) {
+			opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+			for (bandno = 0; bandno < res->numbands; ++bandno) {
+				opj_tcd_band_t* band = &res->bands[bandno];
+				for (precno = 0; precno < res->pw * res->ph; ++precno) {
+					opj_tcd_precinct_t* precinct = &band->precincts[precno];
+					for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno, ++total) {
+						opj_t1_cblk_job_t* job;
+						if (resno >= tilec->numresolutions - reduce) {
+							continue;
+						}
+						job = &jobs.jobs[count++];
+						job->tilec = tilec;
+						job->tccp = &tcp->tccps[compno];
+						job->resno = resno;
+						job->band = band;
+						job->cblk = &precinct->cblks.dec[cblkno];
+						job->cached = entries ? &entries[total] : NULL;
+					}
+				}
+			}
+		}
+	}
+
+	if (t1_count > 1 && count) {
+		cinfo->parallel_for(cinfo->parallel_data, count, t1_run_cblk_job, &jobs);
+	} else {
+		for (i = 0; i < count; ++i) {
+			t1_run_cblk_job(&jobs, i, 0);
+		}
+	}
+	opj_free(jobs.jobs);
+
+	if (cache) {
+		t1_cache_update_size(cache);
+	}
+
+	for (compno = 0; compno < tile->numcomps; ++compno) {
+		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
+		for (resno = 0; resno < tilec->numresolutions; ++resno) {
+			opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+			for (bandno = 0; bandno < res->numbands; ++bandno) {
+				opj_tcd_band_t* band = &res->bands[bandno];
+				for (precno = 0; precno < res->pw * res->ph; ++precno) {
+					opj_tcd_precinct_t* precinct = &band->precincts[precno];
+					for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno) {
+						opj_free(precinct->cblks.dec[cblkno].data);
+						opj_free(precinct->cblks.dec[cblkno].segs);
+					}
+					opj_free(precinct->cblks.dec);
+					precinct->cblks.dec = NULL;
+				}
+			}
+		}
+	}
+	return OPJ_TRUE;
+}
+
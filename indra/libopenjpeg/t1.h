@@ -133,12 +133,45 @@ Encode the code-blocks of a tile
 */
 void t1_encode_cblks(opj_t1_t *t1, opj_tcd_tile_t *tile, opj_tcp_t *tcp);
 /**
+Encode the code-blocks of a tile, through cinfo->parallel_for if there is more than one T1 handle
+@param t1s One T1 handle per thread index of the scheduler
+@param t1_count Number of T1 handles
+@param tile The tile to encode
+@param tcp Tile coding parameters
+@return Returns OPJ_FALSE if the job list could not be allocated
+*/
+opj_bool t1_encode_tile_cblks(opj_t1_t** t1s, int t1_count, opj_tcd_tile_t *tile, opj_tcp_t *tcp);
+/**
 Decode the code-blocks of a tile
 @param t1 T1 handle
 @param tilec The tile to decode
 @param tccp Tile coding parameters
 */
 void t1_decode_cblks(opj_t1_t* t1, opj_tcd_tilecomp_t* tilec, opj_tccp_t* tccp);
+/**
+Decode the code-blocks of every component of a tile, through cinfo->parallel_for if there is
+more than one T1 handle, and reusing the code-blocks of cinfo->cblk_cache that did not change
+@param t1s One T1 handle per thread index of the scheduler
+@param t1_count Number of T1 handles
+@param tile The tile to decode, with the data of its components already allocated
+@param tileno Number of the tile
+@param tcp Tile coding parameters
+@param reduce Number of highest resolution levels to skip
+@return Returns OPJ_FALSE if the job list could not be allocated
+*/
+opj_bool t1_decode_tile_cblks(opj_t1_t** t1s, int t1_count, opj_tcd_tile_t* tile, int tileno, opj_tcp_t* tcp, int reduce);
+/**
+Create an empty code-block cache
+*/
+opj_cblk_cache_t* t1_cache_create(void);
+/**
+Destroy a code-block cache
+*/
+void t1_cache_destroy(opj_cblk_cache_t* cache);
+/**
+Get the memory held by a code-block cache, in bytes
+*/
+int t1_cache_size(opj_cblk_cache_t* cache);
 /* ----------------------------------------------------------------------- */
 /*@}*/
 
@@ -1190,6 +1190,8 @@ int tcd_encode_tile(opj_tcd_t *tcd, int tileno, unsigned char *dest, int len, op
 	opj_image_t *image = tcd->image;
 	
 	opj_t1_t *t1 = NULL;		/* T1 component */
+	opj_t1_t **t1s = NULL;		/* one T1 component per thread of cinfo->parallel_for */
+	int t1_count = 1;
 	opj_t2_t *t2 = NULL;		/* T2 component */
 
 	tcd->tcd_tileno = tileno;
@@ -1281,9 +1283,35 @@ int tcd_encode_tile(opj_tcd_t *tcd, int tileno, unsigned char *dest, int len, op
 		}
 		
 		/*------------------TIER1-----------------*/
-		t1 = t1_create(tcd->cinfo);
-		t1_encode_cblks(t1, tile, tcd_tcp);
-		t1_destroy(t1);
+		if (tcd->cinfo->parallel_for && tcd->cinfo->parallel_thread_count > 1) {
+			t1_count = tcd->cinfo->parallel_thread_count;
+		}
+		t1s = (opj_t1_t**) opj_calloc(t1_count, sizeof(opj_t1_t*));
+		if (t1s) {
+			for (i = 0; i < t1_count; ++i) {
+				t1s[i] = t1_create(tcd->cinfo);
+				if (t1s[i] == NULL) {
+					/* parallel_for may use any of the thread indices, so it is all or nothing */
+					while (i-- > 0) {
+						t1_destroy(t1s[i]);
+					}
+					t1_count = 0;
+					break;
+				}
+			}
+		}
+		if (!t1s || !t1_count || !t1_encode_tile_cblks(t1s, t1_count, tile, tcd_tcp)) {
+			/* Not enough memory for the threads, encode on this thread instead */
+			t1 = t1_create(tcd->cinfo);
+			t1_encode_cblks(t1, tile, tcd_tcp);
+			t1_destroy(t1);
+		}
+		if (t1s) {
+			for (i = 0; i < t1_count; ++i) {
+				t1_destroy(t1s[i]);
+			}
+			opj_free(t1s);
+		}
 		
 		/*-----------RATE-ALLOCATE------------------*/
 		
@@ -1329,12 +1357,14 @@ int tcd_encode_tile(opj_tcd_t *tcd, int tileno, unsigned char *dest, int len, op
 
 opj_bool tcd_decode_tile(opj_tcd_t *tcd, unsigned char *src, int len, int tileno, opj_codestream_info_t *cstr_info) {
 	int l;
-	int compno;
+	int compno, i;
 	int eof = 0;
 	double tile_time, t1_time, dwt_time;
 	opj_tcd_tile_t *tile = NULL;
 
 	opj_t1_t *t1 = NULL;		/* T1 component */
+	opj_t1_t **t1s = NULL;		/* one T1 component per thread of cinfo->parallel_for */
+	int t1_count = 1;
 	opj_t2_t *t2 = NULL;		/* T2 component */
 	
 	tcd->tcd_tileno = tileno;
@@ -1386,13 +1416,28 @@ opj_bool tcd_decode_tile(opj_tcd_t *tcd, unsigned char *src, int len, int tileno
 	/*------------------TIER1-----------------*/
 	
 	t1_time = opj_clock();	/* time needed to decode a tile */
-	t1 = t1_create(tcd->cinfo);
-    if (t1 == NULL)
-    {
-        opj_event_msg(tcd->cinfo, EVT_ERROR, "Out of memory\n");
-        t1_destroy(t1);
-        return OPJ_FALSE;
-    }
+	if (tcd->cinfo->parallel_for && tcd->cinfo->parallel_thread_count > 1) {
+		t1_count = tcd->cinfo->parallel_thread_count;
+	}
+	t1s = (opj_t1_t**) opj_calloc(t1_count, sizeof(opj_t1_t*));
+	if (t1s == NULL)
+	{
+		opj_event_msg(tcd->cinfo, EVT_ERROR, "Out of memory\n");
+		return OPJ_FALSE;
+	}
+	for (i = 0; i < t1_count; ++i) {
+		t1s[i] = t1_create(tcd->cinfo);
+		if (t1s[i] == NULL)
+		{
+			opj_event_msg(tcd->cinfo, EVT_ERROR, "Out of memory\n");
+			for (i = 0; i < t1_count; ++i) {
+				if (t1s[i]) t1_destroy(t1s[i]);
+			}
+			opj_free(t1s);
+			return OPJ_FALSE;
+		}
+	}
+	t1 = t1s[0];
 
 	for (compno = 0; compno < tile->numcomps; ++compno) {
 		opj_tcd_tilecomp_t* tilec = &tile->comps[compno];
@@ -1403,10 +1448,17 @@ opj_bool tcd_decode_tile(opj_tcd_t *tcd, unsigned char *src, int len, int tileno
             opj_event_msg(tcd->cinfo, EVT_ERROR, "Out of memory\n");
             return OPJ_FALSE;
         }
-
-		t1_decode_cblks(t1, tilec, &tcd->tcp->tccps[compno]);
 	}
-	t1_destroy(t1);
+	if (!t1_decode_tile_cblks(t1s, t1_count, tile, tileno, tcd->tcp, tcd->cp->reduce)) {
+		/* Not enough memory for the job list, decode on this thread instead */
+		for (compno = 0; compno < tile->numcomps; ++compno) {
+			t1_decode_cblks(t1, &tile->comps[compno], &tcd->tcp->tccps[compno]);
+		}
+	}
+	for (i = 0; i < t1_count; ++i) {
+		t1_destroy(t1s[i]);
+	}
+	opj_free(t1s);
 	t1_time = opj_clock() - t1_time;
 	opj_event_msg(tcd->cinfo, EVT_INFO, "- tiers-1 took %f s\n", t1_time);
 	
@@ -1449,21 +1501,43 @@ opj_bool tcd_decode_tile(opj_tcd_t *tcd, unsigned char *src, int len, int tileno
 	/*----------------MCT-------------------*/
 
 	if (tcd->tcp->mct) {
-		int n = (tile->comps[0].x1 - tile->comps[0].x0) * (tile->comps[0].y1 - tile->comps[0].y0);
+		int tw = tile->comps[0].x1 - tile->comps[0].x0;
+		int n = tw * (tile->comps[0].y1 - tile->comps[0].y0);
+		int rows = 1;
 
 		if (tile->numcomps >= 3 ){
-			if (tcd->tcp->tccps[0].qmfbid == 1) {
-				mct_decode(
-						tile->comps[0].data,
-						tile->comps[1].data,
-						tile->comps[2].data,
-						n);
-			} else {
-				mct_decode_real(
-						(float*)tile->comps[0].data,
-						(float*)tile->comps[1].data,
-						(float*)tile->comps[2].data,
-						n);
+			/* When reducing, only the top left corner of the tile was decoded */
+			opj_tcd_resolution_t* res = &tile->comps[0].resolutions[tcd->image->comps[0].resno_decoded];
+			int w = res->x1 - res->x0;
+			int h = res->y1 - res->y0;
+			for (compno = 1; compno < 3; ++compno) {
+				opj_tcd_resolution_t* cres = &tile->comps[compno].resolutions[tcd->image->comps[compno].resno_decoded];
+				if (cres->x1 - cres->x0 != w || cres->y1 - cres->y0 != h || tile->comps[compno].x1 - tile->comps[compno].x0 != tw) {
+					break;
+				}
+			}
+			if (compno == 3 && w == tw) {
+				n = w * h;
+			} else if (compno == 3 && w * h < n && (tw & 3) == 0) {
+				/* row by row, keeping each row 16 byte aligned for the SSE version */
+				n = w;
+				rows = h;
+			}
+
+			for (i = 0; i < rows; ++i) {
+				if (tcd->tcp->tccps[0].qmfbid == 1) {
+					mct_decode(
+							tile->comps[0].data + i * tw,
+							tile->comps[1].data + i * tw,
+							tile->comps[2].data + i * tw,
+							n);
+				} else {
+					mct_decode_real(
+							(float*)tile->comps[0].data + i * tw,
+							(float*)tile->comps[1].data + i * tw,
+							(float*)tile->comps[2].data + i * tw,
+							n);
+				}
 			}
 		} else{
 			opj_event_msg(tcd->cinfo, EVT_WARNING,"Number of components (%d) is inconsistent with a MCT. Skip the MCT step.\n",tile->numcomps);
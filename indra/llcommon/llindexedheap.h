@@ -0,0 +1,199 @@
+/**
+ * @file   llindexedheap.h
+ * @brief  LLIndexedHeap is a d-ary heap of pointers whose elements know their
+ *         place in it, so that changing the priority of one is O(log n).
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINDEXEDHEAP_H
+#define LL_LLINDEXEDHEAP_H
+
+#include <vector>
+
+#include "lldefs.h"
+#include "llerror.h"
+
+/**
+ * A priority queue of T*, top() being the element that COMPARE puts before
+ * all others (COMPARE(a, b) is true when a goes first, like a std::set
+ * comparator). Each element keeps its position in the heap in its S32 member
+ * INDEX, -1 when it is not in one, which gives:
+ *
+ * - update() after the priority of an element changed: O(log n), in place,
+ *   instead of erasing it from a std::set and inserting it again;
+ * - erase() of any element: O(log n);
+ * - contains(): O(1);
+ * - no allocation per element, the heap is one vector.
+ *
+ * D children per node (4 by default) make the heap shallower than a binary
+ * one, and the children of a node share a cache line or two.
+ *
+ * An element can be in one LLIndexedHeap at a time. Iteration is in heap
+ * order, not in priority order.
+ */
+template <typename T, typename COMPARE, S32 T::*INDEX, U32 D = 4>
+class LLIndexedHeap
+{
+public:
+	typedef std::vector<T*> heap_t;
+	typedef typename heap_t::const_iterator const_iterator;
+
+	LLIndexedHeap(const COMPARE& compare = COMPARE())
+	:	mCompare(compare)
+	{
+	}
+
+	bool empty() const						{ return mHeap.empty(); }
+	size_t size() const						{ return mHeap.size(); }
+	const_iterator begin() const			{ return mHeap.begin(); }
+	const_iterator end() const				{ return mHeap.end(); }
+
+	T* top() const
+	{
+		llassert(!mHeap.empty());
+		return mHeap.front();
+	}
+
+	bool contains(const T* elem) const
+	{
+		S32 index = elem->*INDEX;
+		return index >= 0 && index < (S32)mHeap.size() && mHeap[index] == elem;
+	}
+
+	void push(T* elem)
+	{
+		llassert(!contains(elem));
+		mHeap.push_back(elem);
+		siftUp(mHeap.size() - 1);
+	}
+
+	void pop()
+	{
+		llassert(!mHeap.empty());
+		remove(0);
+	}
+
+	// Returns false if elem is not in this heap
+	bool erase(T* elem)
+	{
+		if (!contains(elem))
+		{
+			return false;
+		}
+		remove(elem->*INDEX);
+		return true;
+	}
+
+	// Call after changing what COMPARE looks at in elem
+	void update(T* elem)
+	{
+		llassert(contains(elem));
+		size_t index = elem->*INDEX;
+		if (index > 0 && mCompare(elem, mHeap[(index - 1) / D]))
+		{
+			siftUp(index);
+		}
+		else
+		{
+			siftDown(index);
+		}
+	}
+
+	void clear()
+	{
+		for (typename heap_t::iterator iter = mHeap.begin(); iter != mHeap.end(); ++iter)
+		{
+			(*iter)->*INDEX = -1;
+		}
+		mHeap.clear();
+	}
+
+private:
+	void remove(size_t index)
+	{
+		mHeap[index]->*INDEX = -1;
+		T* last = mHeap.back();
+		mHeap.pop_back();
+		if (index < mHeap.size())
+		{
+			mHeap[index] = last;
+			last->*INDEX = index;
+			update(last);
+		}
+	}
+
+	// Move the element at index up to its place, one move per level
+	void siftUp(size_t index)
+	{
+		T* elem = mHeap[index];
+		while (index > 0)
+		{
+			size_t parent = (index - 1) / D;
+			if (!mCompare(elem, mHeap[parent]))
+			{
+				break;
+			}
+			mHeap[index] = mHeap[parent];
+			mHeap[index]->*INDEX = index;
+			index = parent;
+		}
+		mHeap[index] = elem;
+		elem->*INDEX = index;
+	}
+
+	// Move the element at index down to its place
+	void siftDown(size_t index)
+	{
+		T* elem = mHeap[index];
+		const size_t count = mHeap.size();
+		while (true)
+		{
+			size_t first = index * D + 1;
+			if (first >= count)
+			{
+				break;
+			}
+			size_t last = llmin(first + D, count);
+			size_t best = first;
+			for (size_t child = first + 1; child < last; ++child)
+			{
+				if (mCompare(mHeap[child], mHeap[best]))
+				{
+					best = child;
+				}
+			}
+			if (!mCompare(mHeap[best], elem))
+			{
+				break;
+			}
+			mHeap[index] = mHeap[best];
+			mHeap[index]->*INDEX = index;
+			index = best;
+		}
+		mHeap[index] = elem;
+		elem->*INDEX = index;
+	}
+
+private:
+	heap_t mHeap;
+	COMPARE mCompare;
+};
+
+#endif // LL_LLINDEXEDHEAP_H
@@ -26,6 +26,7 @@
 #include "linden_common.h"
 #include "llqueuedthread.h"
 
+#include "llfasttimer.h"
 #include "llstl.h"
 #include "lltimer.h"	// ms_sleep()
 
@@ -128,6 +129,8 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 	LLTimer timer;
 	S32 pending = 1;
 
+	applyQueuedPriorities();
+
 	// Frame Update
 	if (mThreaded)
 	{
@@ -144,6 +147,8 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 			pending = processNextRequest();
 			if (max_time && timer.getElapsedTimeF64() > max_time)
 				break;
+			if (pending > 0 && isWaiting())
+				break;
 		}
 	}
 	return pending;
@@ -197,7 +202,7 @@ void LLQueuedThread::printQueueStats()
 	lockData();
 	if (!mRequestQueue.empty())
 	{
-		QueuedRequest *req = *mRequestQueue.begin();
+		QueuedRequest *req = mRequestQueue.top();
 		LL_INFOS() << llformat("Pending Requests:%d Current status:%d", mRequestQueue.size(), req->getStatus()) << LL_ENDL;
 	}
 	else
@@ -230,7 +235,7 @@ bool LLQueuedThread::addRequest(QueuedRequest* req)
 	
 	lockData();
 	req->setStatus(STATUS_QUEUED);
-	mRequestQueue.insert(req);
+	mRequestQueue.push(req);
 	mRequestHash.insert(req);
 #if _DEBUG
 // 	LL_INFOS() << llformat("LLQueuedThread::Added req [%08d]",handle) << LL_ENDL;
@@ -335,6 +340,9 @@ void LLQueuedThread::setFlags(handle_t handle, U32 flags)
 void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 {
 	lockData();
+	mQueuedPrioritiesMutex.lock();
+	mQueuedPriorities.erase(handle);
+	mQueuedPrioritiesMutex.unlock();
 	QueuedRequest* req = (QueuedRequest*)mRequestHash.find(handle);
 	if (req)
 	{
@@ -345,12 +353,62 @@ void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 		}
 		else if(req->getStatus() == STATUS_QUEUED)
 		{
-			// remove from list then re-insert
-			llverify(mRequestQueue.erase(req) == 1);
+			// move it in place
+			req->setPriority(priority);
+			mRequestQueue.update(req);
+		}
+	}
+	unlockData();
+}
+
+// MAIN thread
+void LLQueuedThread::queuePriority(handle_t handle, U32 priority)
+{
+	mQueuedPrioritiesMutex.lock();
+	mQueuedPriorities[handle] = priority;
+	mQueuedPrioritiesMutex.unlock();
+}
+
+// MAIN thread
+static LLTrace::BlockTimerStatHandle FTM_APPLY_QUEUED_PRIORITIES("Apply Queued Priorities");
+void LLQueuedThread::applyQueuedPriorities()
+{
+	mQueuedPrioritiesMutex.lock();
+	bool empty = mQueuedPriorities.empty();
+	mQueuedPrioritiesMutex.unlock();
+	if (empty)
+	{
+		return;
+	}
+	LL_RECORD_BLOCK_TIME(FTM_APPLY_QUEUED_PRIORITIES);
+	// Under the data lock a setPriority() on another thread has either dropped
+	// the entry of its request already, or comes after these changes
+	lockData();
+	mQueuedPrioritiesMutex.lock();
+	for (priority_map_t::iterator iter = mQueuedPriorities.begin(); iter != mQueuedPriorities.end(); ++iter)
+	{
+		QueuedRequest* req = (QueuedRequest*)mRequestHash.find(iter->first);
+		if (!req || (req->getFlags() & FLAG_ABORT))
+		{
+			continue;
+		}
+		U32 priority = (req->getPriority() & PRIORITY_HIGHBITS) | (iter->second & PRIORITY_LOWBITS);
+		if (priority == req->getPriority())
+		{
+			continue;
+		}
+		if (req->getStatus() == STATUS_INPROGRESS)
+		{
+			req->setPriority(priority);
+		}
+		else if (req->getStatus() == STATUS_QUEUED)
+		{
 			req->setPriority(priority);
-			mRequestQueue.insert(req);
+			mRequestQueue.update(req);
 		}
 	}
+	mQueuedPriorities.clear();
+	mQueuedPrioritiesMutex.unlock();
 	unlockData();
 }
 
@@ -418,8 +476,8 @@ S32 LLQueuedThread::processNextRequest()
 		{
 			break;
 		}
-		req = *mRequestQueue.begin();
-		mRequestQueue.erase(mRequestQueue.begin());
+		req = mRequestQueue.top();
+		mRequestQueue.pop();
 		if ((req->getFlags() & FLAG_ABORT) || (mStatus == QUITTING))
 		{
 			req->setStatus(STATUS_ABORTED);
@@ -509,7 +567,7 @@ S32 LLQueuedThread::processNextRequest()
 		{
 			lockData();
 			req->setStatus(STATUS_QUEUED);
-			mRequestQueue.insert(req);
+			mRequestQueue.push(req);
 			unlockData();
 			if (mThreaded && start_priority < PRIORITY_NORMAL)
 			{
@@ -589,7 +647,8 @@ LLQueuedThread::QueuedRequest::QueuedRequest(LLQueuedThread::handle_t handle, U3
 	LLSimpleHashEntry<LLQueuedThread::handle_t>(handle),
 	mStatus(STATUS_UNKNOWN),
 	mPriority(priority),
-	mFlags(flags)
+	mFlags(flags),
+	mQueueIndex(-1)
 {
 }
 
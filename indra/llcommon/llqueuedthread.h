@@ -32,7 +32,10 @@
 #include <map>
 #include <set>
 
+#include <boost/unordered_map.hpp>
+
 #include "llthread.h"
+#include "llindexedheap.h"
 #include "llsimplehash.h"
 
 //============================================================================
@@ -135,6 +138,7 @@ public:
 		LLAtomic32<status_t> mStatus;
 		U32 mPriority;
 		U32 mFlags;
+		S32 mQueueIndex;		// place in mRequestQueue, -1 when not queued
 	};
 
 protected:
@@ -142,7 +146,7 @@ protected:
 	{
 		bool operator()(const QueuedRequest* lhs, const QueuedRequest* rhs) const
 		{
-			return lhs->higherPriority(*rhs); // higher priority in front of queue (set)
+			return lhs->higherPriority(*rhs); // higher priority in front of queue
 		}
 	};
 
@@ -173,6 +177,10 @@ protected:
 	bool addRequest(QueuedRequest* req);
 	S32  processNextRequest(void);
 	void incQueue();
+	void applyQueuedPriorities();
+	// Without a thread: the requests left wait for something outside the queue,
+	// so update() leaves them for its next call instead of polling them again
+	virtual bool isWaiting() { return false; }
 
 public:
 	bool waitForResult(handle_t handle, bool auto_complete = true);
@@ -190,7 +198,12 @@ public:
 	status_t getRequestStatus(handle_t handle);
 	void abortRequest(handle_t handle, bool autocomplete);
 	void setFlags(handle_t handle, U32 flags);
+	// Also drops the change queued for the request by queuePriority(), which is older
 	void setPriority(handle_t handle, U32 priority);
+	// For many requests a frame (MAIN thread): the PRIORITY_LOWBITS of priority are applied
+	// with all the others queued since, under one lock, by the next update(). The request
+	// keeps its PRIORITY_HIGHBITS, whoever set them in the meantime.
+	void queuePriority(handle_t handle, U32 priority);
 	bool completeRequest(handle_t handle);
 	// This is public for support classes like LLWorkerThread,
 	// but generally the methods above should be used.
@@ -204,9 +217,15 @@ protected:
 	BOOL mStarted;  // required when mThreaded is false to call startThread() from update()
 	LLAtomic32<bool> mIdleThread; // request queue is empty (or we are quitting) and the thread is idle
 	
-	typedef std::set<QueuedRequest*, queued_request_less> request_queue_t;
+	typedef LLIndexedHeap<QueuedRequest, queued_request_less, &QueuedRequest::mQueueIndex> request_queue_t;
 	request_queue_t mRequestQueue;
 
+	// The latest queued priority of each request. setPriority() runs on any thread,
+	// so mQueuedPrioritiesMutex guards it, taken after the data lock when both are.
+	typedef boost::unordered_map<handle_t, U32> priority_map_t;
+	priority_map_t mQueuedPriorities;
+	LLMutex mQueuedPrioritiesMutex;
+
 	enum { REQUEST_HASH_SIZE = 512 }; // must be power of 2
 	typedef LLSimpleHash<handle_t, REQUEST_HASH_SIZE> request_hash_t;
 	request_hash_t mRequestHash;
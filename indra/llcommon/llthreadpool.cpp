@@ -0,0 +1,326 @@
+/**
+ * @file llthreadpool.cpp
+ * @brief A fixed set of worker threads shared by the CPU-bound subsystems.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llthreadpool.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+// Past this the workers mostly contend for memory bandwidth
+static const S32 MAX_SHARED_THREADS = 16;
+
+LLThreadPool* LLThreadPool::sShared = NULL;
+
+class LLThreadPool::Worker : public LLThread
+{
+public:
+	Worker(const std::string& name, LLThreadPool* pool)
+	:	LLThread(name),
+		mPool(pool)
+	{
+	}
+
+protected:
+	/*virtual*/ void run()
+	{
+		job_t job;
+		while (mPool->getJob(job))
+		{
+			job();
+			job.clear();
+		}
+	}
+
+private:
+	LLThreadPool* mPool;
+};
+
+// One parallelFor() call.  Shared with the helper jobs, which may only get to
+// run after the call has returned; they must not touch mBody then.
+struct LLThreadPool::LoopState
+{
+	LoopState(S32 count, const loop_body_t& body)
+	:	mCount(count),
+		mNext(0),
+		mActive(0),
+		mClosed(false),
+		mBody(body)
+	{
+	}
+
+	void run(S32 thread_index)
+	{
+		S32 index;
+		while ((index = mNext++) < mCount)
+		{
+			mBody(index, thread_index);
+		}
+	}
+
+	const S32		mCount;
+	LLAtomicS32		mNext;
+	LLCondition		mCondition;	// protects mActive and mClosed
+	S32				mActive;	// helpers inside run()
+	bool			mClosed;	// set once every index is handed out; late helpers do nothing
+	loop_body_t		mBody;
+};
+
+struct LLThreadPool::Queue::State
+{
+	State(LLThreadPool* pool)
+	:	mPool(pool),
+		mRunners(0),
+		mRunning(0)
+	{
+	}
+
+	LLThreadPool*		mPool;
+	LLCondition			mCondition;	// protects everything below
+	std::deque<job_t>	mJobs;
+	S32					mRunners;	// runOne() calls posted to the pool and not finished
+	S32					mRunning;	// jobs being run
+};
+
+LLThreadPool::LLThreadPool(const std::string& name, S32 count)
+:	mName(name),
+	mQuitting(false)
+{
+	for (S32 i = 0; i < count; ++i)
+	{
+		mWorkers.push_back(new Worker(name, this));
+		mWorkers.back()->start();
+	}
+}
+
+LLThreadPool::~LLThreadPool()
+{
+	mCondition.lock();
+	mQuitting = true;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		(*iter)->shutdown();
+		delete *iter;
+	}
+}
+
+void LLThreadPool::post(const job_t& job)
+{
+	mCondition.lock();
+	mJobs.push_back(job);
+	mCondition.signal();
+	mCondition.unlock();
+}
+
+bool LLThreadPool::getJob(job_t& job)
+{
+	mCondition.lock();
+	while (mJobs.empty() && !mQuitting)
+	{
+		mCondition.wait();
+	}
+	bool found = !mJobs.empty();
+	if (found)
+	{
+		job.swap(mJobs.front());
+		mJobs.pop_front();
+	}
+	mCondition.unlock();
+	return found;
+}
+
+void LLThreadPool::parallelFor(S32 count, S32 max_threads, const loop_body_t& body)
+{
+	S32 helpers = llmin(max_threads - 1, getWorkerCount(), count - 1);
+	if (helpers <= 0)
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			body(i, 0);
+		}
+		return;
+	}
+
+	boost::shared_ptr<LoopState> state(new LoopState(count, body));
+	mCondition.lock();
+	for (S32 i = 1; i <= helpers; ++i)
+	{
+		mJobs.push_back(boost::bind(&LLThreadPool::runLoop, state, i));
+	}
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	state->run(0);
+
+	// Every index has been handed out.  Wait for the helpers that got one;
+	// those the pool has not started yet will find nothing left to do.
+	state->mCondition.lock();
+	state->mClosed = true;
+	while (state->mActive > 0)
+	{
+		state->mCondition.wait();
+	}
+	state->mCondition.unlock();
+}
+
+//static
+void LLThreadPool::runLoop(boost::shared_ptr<LoopState> state, S32 thread_index)
+{
+	state->mCondition.lock();
+	if (state->mClosed)
+	{
+		state->mCondition.unlock();
+		return;
+	}
+	++state->mActive;
+	state->mCondition.unlock();
+
+	state->run(thread_index);
+
+	state->mCondition.lock();
+	if (--state->mActive == 0)
+	{
+		state->mCondition.signal();
+	}
+	state->mCondition.unlock();
+}
+
+//static
+void LLThreadPool::startShared(S32 count)
+{
+	stopShared();
+
+	if (count < 0)
+	{
+		count = llmax((S32)boost::thread::hardware_concurrency() - 1, 1);
+	}
+	count = llmin(count, MAX_SHARED_THREADS);
+	if (count > 0)
+	{
+		sShared = new LLThreadPool("Shared Worker", count);
+	}
+	LL_INFOS() << "Shared worker threads: " << count << LL_ENDL;
+}
+
+//static
+void LLThreadPool::stopShared()
+{
+	delete sShared;
+	sShared = NULL;
+}
+
+//============================================================================
+
+LLThreadPool::Queue::Queue(LLThreadPool* pool, S32 max_running)
+:	mPool(pool),
+	mMaxRunning(max_running),
+	mState(new State(pool))
+{
+}
+
+LLThreadPool::Queue::~Queue()
+{
+	mState->mCondition.lock();
+	mState->mJobs.clear();
+	while (mState->mRunners > 0)
+	{
+		mState->mCondition.wait();
+	}
+	mState->mCondition.unlock();
+}
+
+void LLThreadPool::Queue::post(const job_t& job)
+{
+	if (!isThreaded())
+	{
+		job();
+		return;
+	}
+
+	mState->mCondition.lock();
+	mState->mJobs.push_back(job);
+	bool start_runner = mState->mRunners < mMaxRunning;
+	if (start_runner)
+	{
+		++mState->mRunners;
+	}
+	mState->mCondition.unlock();
+
+	if (start_runner)
+	{
+		mPool->post(boost::bind(&Queue::runOne, mState));
+	}
+}
+
+S32 LLThreadPool::Queue::getPending()
+{
+	mState->mCondition.lock();
+	S32 pending = (S32)mState->mJobs.size() + mState->mRunning;
+	mState->mCondition.unlock();
+	return pending;
+}
+
+void LLThreadPool::Queue::clear()
+{
+	mState->mCondition.lock();
+	mState->mJobs.clear();
+	mState->mCondition.unlock();
+}
+
+// Runs one job, then goes to the back of the pool's queue for the next one,
+// so a long queue takes its turn with the other users of the pool.
+//static
+void LLThreadPool::Queue::runOne(boost::shared_ptr<State> state)
+{
+	state->mCondition.lock();
+	if (!state->mJobs.empty())
+	{
+		job_t job;
+		job.swap(state->mJobs.front());
+		state->mJobs.pop_front();
+		++state->mRunning;
+		state->mCondition.unlock();
+
+		job();
+
+		state->mCondition.lock();
+		--state->mRunning;
+	}
+
+	bool more = !state->mJobs.empty();
+	if (!more)
+	{
+		--state->mRunners;
+		state->mCondition.broadcast();
+	}
+	state->mCondition.unlock();
+
+	if (more)
+	{
+		state->mPool->post(boost::bind(&Queue::runOne, state));
+	}
+}
@@ -0,0 +1,123 @@
+/**
+ * @file llthreadpool.h
+ * @brief A fixed set of worker threads shared by the CPU-bound subsystems.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADPOOL_H
+#define LL_LLTHREADPOOL_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "llthread.h"
+
+//
+// Runs posted jobs in FIFO order on a fixed number of threads.  The viewer
+// starts one shared pool (getShared()) that the JPEG2000 code-block decoder,
+// the mesh LOD parser, the upload converter, HACD and the LOD generator all
+// use, instead of each keeping threads of its own that sit idle most of the
+// time.  Callers must cope with getShared() returning NULL (no pool started,
+// or the pool disabled) by doing their work on the calling thread.
+//
+// Jobs posted to the pool must not block waiting for other jobs: with every
+// worker blocked the pool would deadlock.  parallelFor() never waits for work
+// that has not started, so it is safe to call from a job.
+//
+class LL_COMMON_API LLThreadPool
+{
+public:
+	typedef boost::function<void ()> job_t;
+	// index runs over [0, count); thread_index is 0 for the calling thread and
+	// 1..max_threads-1 for the helpers, so it can select per-thread scratch data
+	typedef boost::function<void (S32 index, S32 thread_index)> loop_body_t;
+
+	LLThreadPool(const std::string& name, S32 count);
+	// Runs the jobs still queued, then stops the threads
+	~LLThreadPool();
+
+	S32 getWorkerCount() const	{ return (S32)mWorkers.size(); }
+
+	// Queue job to run on one of the workers
+	void post(const job_t& job);
+
+	// Run body for every index in [0, count) on the calling thread and up to
+	// max_threads - 1 workers, and return once all of them are done.  Indices
+	// are handed out one at a time, so uneven jobs balance themselves.
+	void parallelFor(S32 count, S32 max_threads, const loop_body_t& body);
+
+	// count < 0 picks one thread per core, less one for the main thread; 0 leaves the pool off
+	static void startShared(S32 count);
+	// Everything using the shared pool must have been stopped before this
+	static void stopShared();
+	static LLThreadPool* getShared()	{ return sShared; }
+
+	//
+	// Runs posted jobs on a pool with at most max_running of them at a time,
+	// so one subsystem cannot take every worker.  Without a pool, or with
+	// max_running 0, post() runs the job before returning.
+	//
+	class LL_COMMON_API Queue
+	{
+	public:
+		Queue(LLThreadPool* pool, S32 max_running);
+		// Drops the jobs not started yet and waits for the running ones
+		~Queue();
+
+		bool isThreaded() const		{ return mPool && mMaxRunning > 0; }
+
+		void post(const job_t& job);
+		// Jobs queued or running
+		S32 getPending();
+		// Drop the jobs not started yet
+		void clear();
+
+	private:
+		struct State;
+		static void runOne(boost::shared_ptr<State> state);
+
+		LLThreadPool* mPool;
+		S32 mMaxRunning;
+		boost::shared_ptr<State> mState;
+	};
+
+private:
+	class Worker;
+	struct LoopState;
+	static void runLoop(boost::shared_ptr<LoopState> state, S32 thread_index);
+
+	// Called by the workers; returns false once the pool is stopping and no jobs are left
+	bool getJob(job_t& job);
+
+private:
+	std::string			mName;
+	std::vector<Worker*> mWorkers;
+	LLCondition			mCondition;	// protects everything below
+	std::deque<job_t>	mJobs;
+	bool				mQuitting;
+
+	static LLThreadPool* sShared;
+};
+
+#endif // LL_LLTHREADPOOL_H
@@ -402,5 +402,18 @@ void LLWorkerClass::setPriority(U32 priority)
 	mMutex.unlock();
 }
 
+void LLWorkerClass::queuePriority(U32 priority)
+{
+	mMutex.lock();
+	// Only the low bits get applied, keep the class set by setPriority()
+	priority = (mRequestPriority & LLWorkerThread::PRIORITY_HIGHBITS) | (priority & LLWorkerThread::PRIORITY_LOWBITS);
+	if (mRequestHandle != LLWorkerThread::nullHandle() && mRequestPriority != priority)
+	{
+		mRequestPriority = priority;
+		mWorkerThread->queuePriority(mRequestHandle, priority);
+	}
+	mMutex.unlock();
+}
+
 //============================================================================
 
@@ -151,6 +151,9 @@ public:
 
 	// setPriority(): changes the priority of a request
 	void setPriority(U32 priority);
+	// queuePriority(): same for the PRIORITY_LOWBITS, applied with the other changes
+	// of the frame by the next LLWorkerThread::update() (MAIN THREAD)
+	void queuePriority(U32 priority);
 	U32  getPriority() { return mRequestPriority; }
 		
 	const std::string& getName() const { return mWorkerClassName; }
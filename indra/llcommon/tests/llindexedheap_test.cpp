@@ -0,0 +1,260 @@
+/**
+ * @file llindexedheap_test.cpp
+ * @brief Tests for LLIndexedHeap
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llindexedheap.h"
+
+#include <algorithm>
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct indexedheap_data
+	{
+		struct Elem
+		{
+			Elem(U32 priority = 0) : mPriority(priority), mIndex(-1) {}
+
+			U32 mPriority;
+			S32 mIndex;
+		};
+
+		// Highest priority first, like queued_request_less
+		struct Greater
+		{
+			bool operator()(const Elem* a, const Elem* b) const
+			{
+				return a->mPriority > b->mPriority;
+			}
+		};
+
+		typedef LLIndexedHeap<Elem, Greater, &Elem::mIndex> heap_t;
+		typedef LLIndexedHeap<Elem, Greater, &Elem::mIndex, 2> binary_heap_t;
+
+		indexedheap_data()
+		:	mSeed(4321)
+		{
+		}
+
+		U32 random(U32 range)
+		{
+			mSeed = mSeed * 1103515245 + 12345;
+			return (mSeed >> 16) % range;
+		}
+
+		// Every element knows its place, and no child goes before its parent
+		template <class HEAP>
+		void ensureValid(const std::string& msg, const HEAP& heap, U32 d)
+		{
+			S32 index = 0;
+			for (typename HEAP::const_iterator iter = heap.begin(); iter != heap.end(); ++iter, ++index)
+			{
+				ensure_equals(msg + ": index", (*iter)->mIndex, index);
+				ensure(msg + ": contains", heap.contains(*iter));
+				if (index > 0)
+				{
+					const Elem* parent = *(heap.begin() + (index - 1) / d);
+					ensure(msg + ": heap order", parent->mPriority >= (*iter)->mPriority);
+				}
+			}
+		}
+
+		template <class HEAP>
+		std::vector<U32> drain(HEAP& heap)
+		{
+			std::vector<U32> order;
+			while (!heap.empty())
+			{
+				Elem* top = heap.top();
+				heap.pop();
+				ensure_equals("popped element is out", top->mIndex, -1);
+				order.push_back(top->mPriority);
+			}
+			return order;
+		}
+
+		U32 mSeed;
+	};
+	typedef test_group<indexedheap_data> indexedheap_test;
+	typedef indexedheap_test::object indexedheap_object;
+	tut::indexedheap_test indexedheap_testcase("LLIndexedHeap");
+
+	template<> template<>
+	void indexedheap_object::test<1>()
+	{
+		// push() then pop() gives the priorities highest first, duplicates included
+		std::vector<Elem> elems;
+		for (U32 i = 0; i < 100; ++i)
+		{
+			elems.push_back(Elem(random(40)));
+		}
+		heap_t heap;
+		std::vector<U32> expected;
+		for (U32 i = 0; i < elems.size(); ++i)
+		{
+			heap.push(&elems[i]);
+			expected.push_back(elems[i].mPriority);
+		}
+		ensure_equals("size", heap.size(), elems.size());
+		ensureValid("after push", heap, 4);
+
+		std::sort(expected.rbegin(), expected.rend());
+		ensure("pop order", drain(heap) == expected);
+		ensure("empty", heap.empty());
+	}
+
+	template<> template<>
+	void indexedheap_object::test<2>()
+	{
+		// update() after raising or lowering a priority moves the element to its place
+		std::vector<Elem> elems;
+		for (U32 i = 0; i < 50; ++i)
+		{
+			elems.push_back(Elem(i * 2));
+		}
+		heap_t heap;
+		for (U32 i = 0; i < elems.size(); ++i)
+		{
+			heap.push(&elems[i]);
+		}
+
+		elems[3].mPriority = 1000;
+		heap.update(&elems[3]);
+		ensure("raised to the top", heap.top() == &elems[3]);
+		ensureValid("after raising", heap, 4);
+
+		elems[3].mPriority = 1;
+		heap.update(&elems[3]);
+		ensure("lowered off the top", heap.top() == &elems[49]);
+		ensureValid("after lowering", heap, 4);
+
+		// Unchanged priority, nothing moves
+		S32 index = elems[20].mIndex;
+		heap.update(&elems[20]);
+		ensure_equals("stays in place", elems[20].mIndex, index);
+
+		std::vector<U32> order = drain(heap);
+		ensure_equals("count", order.size(), elems.size());
+		ensure_equals("lowered one is second to last", order[order.size() - 2], 1U);
+	}
+
+	template<> template<>
+	void indexedheap_object::test<3>()
+	{
+		// erase() at any index: the top, the last slot, inner nodes and leaves
+		std::vector<Elem> elems;
+		for (U32 i = 0; i < 64; ++i)
+		{
+			elems.push_back(Elem(random(1000)));
+		}
+		heap_t heap;
+		for (U32 i = 0; i < elems.size(); ++i)
+		{
+			heap.push(&elems[i]);
+		}
+
+		std::vector<U32> expected;
+		for (U32 i = 0; i < elems.size(); ++i)
+		{
+			expected.push_back(elems[i].mPriority);
+		}
+
+		const S32 indices[] = { 0, -1, 1, 5, 20, -1, 0, 30 };	// -1 stands for the last slot
+		for (U32 i = 0; i < sizeof(indices) / sizeof(indices[0]); ++i)
+		{
+			S32 index = indices[i] < 0 ? (S32)heap.size() - 1 : indices[i];
+			Elem* elem = *(heap.begin() + index);
+			ensure(llformat("erase at %d", index), heap.erase(elem));
+			ensure_equals("erased element is out", elem->mIndex, -1);
+			ensure("not contained", !heap.contains(elem));
+			ensure("second erase fails", !heap.erase(elem));
+			expected.erase(std::find(expected.begin(), expected.end(), elem->mPriority));
+			ensureValid(llformat("after erase at %d", index), heap, 4);
+		}
+
+		std::sort(expected.rbegin(), expected.rend());
+		ensure("pop order after erase", drain(heap) == expected);
+	}
+
+	template<> template<>
+	void indexedheap_object::test<4>()
+	{
+		// Random push, pop, update and erase on a binary heap, checked against a sorted reference
+		std::vector<Elem> elems(200);
+		binary_heap_t heap;
+		std::vector<Elem*> in_heap;
+		for (U32 op = 0; op < 20000; ++op)
+		{
+			Elem* elem = &elems[random(elems.size())];
+			switch (random(4))
+			{
+			  case 0:
+				if (!heap.contains(elem))
+				{
+					elem->mPriority = random(500);
+					heap.push(elem);
+					in_heap.push_back(elem);
+				}
+				break;
+			  case 1:
+				if (heap.contains(elem))
+				{
+					elem->mPriority = random(500);
+					heap.update(elem);
+				}
+				break;
+			  case 2:
+				if (heap.erase(elem))
+				{
+					in_heap.erase(std::find(in_heap.begin(), in_heap.end(), elem));
+				}
+				break;
+			  default:
+				if (!heap.empty())
+				{
+					U32 best = 0;
+					for (U32 i = 0; i < in_heap.size(); ++i)
+					{
+						best = llmax(best, in_heap[i]->mPriority);
+					}
+					Elem* top = heap.top();
+					ensure_equals("top has the highest priority", top->mPriority, best);
+					heap.pop();
+					in_heap.erase(std::find(in_heap.begin(), in_heap.end(), top));
+				}
+				break;
+			}
+			ensure_equals("size", heap.size(), in_heap.size());
+		}
+		ensureValid("after random operations", heap, 2);
+
+		heap.clear();
+		ensure("empty after clear", heap.empty());
+		for (U32 i = 0; i < elems.size(); ++i)
+		{
+			ensure_equals("cleared element is out", elems[i].mIndex, -1);
+		}
+	}
+}
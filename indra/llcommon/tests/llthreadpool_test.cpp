@@ -0,0 +1,208 @@
+/**
+ * @file llthreadpool_test.cpp
+ * @brief Tests for LLThreadPool and LLThreadPool::Queue
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llthreadpool.h"
+#include "../lltimer.h"
+
+#include <boost/bind.hpp>
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct threadpool_data
+	{
+		threadpool_data()
+		:	mRunning(0),
+			mMaxRunning(0),
+			mRelease(0)
+		{
+		}
+
+		void count(LLAtomicS32* counter)
+		{
+			(*counter)++;
+		}
+
+		void countIndex(std::vector<LLAtomicS32>* hits, S32 max_threads, LLAtomicS32* bad_threads, S32 index, S32 thread_index)
+		{
+			(*hits)[index]++;
+			if (thread_index < 0 || thread_index >= max_threads)
+			{
+				(*bad_threads)++;
+			}
+		}
+
+		// Keeps running for a moment so that jobs overlap, and records how many did at most
+		void overlap()
+		{
+			mMutex.lock();
+			mMaxRunning = llmax(mMaxRunning, ++mRunning);
+			mMutex.unlock();
+			ms_sleep(5);
+			mMutex.lock();
+			--mRunning;
+			mMutex.unlock();
+		}
+
+		void block()
+		{
+			while (!mRelease)
+			{
+				ms_sleep(1);
+			}
+		}
+
+		void nestedLoop(LLThreadPool* pool, LLAtomicS32* counter)
+		{
+			pool->parallelFor(100, 4, boost::bind(&threadpool_data::count, this, counter));
+		}
+
+		LLMutex mMutex;
+		S32 mRunning;
+		S32 mMaxRunning;
+		LLAtomicS32 mRelease;
+	};
+	typedef test_group<threadpool_data> threadpool_test;
+	typedef threadpool_test::object threadpool_object;
+	tut::threadpool_test threadpool_testcase("LLThreadPool");
+
+	template<> template<>
+	void threadpool_object::test<1>()
+	{
+		// The jobs still queued run before the pool goes away
+		LLAtomicS32 counter(0);
+		{
+			LLThreadPool pool("test", 3);
+			ensure_equals("worker count", pool.getWorkerCount(), 3);
+			for (S32 i = 0; i < 200; ++i)
+			{
+				pool.post(boost::bind(&threadpool_data::count, this, &counter));
+			}
+		}
+		ensure_equals("every job ran", (S32)counter, 200);
+	}
+
+	template<> template<>
+	void threadpool_object::test<2>()
+	{
+		// Every index exactly once, on thread indices below max_threads
+		LLThreadPool pool("test", 4);
+		const S32 counts[] = { 0, 1, 2, 7, 1000 };
+		const S32 max_threads[] = { 1, 2, 3, 8 };
+		for (U32 c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+		{
+			for (U32 t = 0; t < sizeof(max_threads) / sizeof(max_threads[0]); ++t)
+			{
+				std::vector<LLAtomicS32> hits(counts[c]);
+				for (S32 i = 0; i < counts[c]; ++i)
+				{
+					hits[i] = 0;
+				}
+				LLAtomicS32 bad_threads(0);
+				pool.parallelFor(counts[c], max_threads[t],
+								 boost::bind(&threadpool_data::countIndex, this, &hits, max_threads[t], &bad_threads, _1, _2));
+				for (S32 i = 0; i < counts[c]; ++i)
+				{
+					ensure_equals(llformat("index %d of %d, %d threads", i, counts[c], max_threads[t]), (S32)hits[i], 1);
+				}
+				ensure_equals("thread index out of range", (S32)bad_threads, 0);
+			}
+		}
+	}
+
+	template<> template<>
+	void threadpool_object::test<3>()
+	{
+		// parallelFor() from inside jobs filling every worker does not wait for them
+		LLThreadPool pool("test", 2);
+		LLAtomicS32 counter(0);
+		{
+			LLThreadPool::Queue queue(&pool, 2);
+			for (S32 i = 0; i < 4; ++i)
+			{
+				queue.post(boost::bind(&threadpool_data::nestedLoop, this, &pool, &counter));
+			}
+			while (queue.getPending())
+			{
+				ms_sleep(1);
+			}
+		}
+		ensure_equals("every index ran", (S32)counter, 400);
+	}
+
+	template<> template<>
+	void threadpool_object::test<4>()
+	{
+		// A queue never runs more than max_running jobs at once
+		LLThreadPool pool("test", 4);
+		{
+			LLThreadPool::Queue queue(&pool, 2);
+			ensure("queue is threaded", queue.isThreaded());
+			for (S32 i = 0; i < 20; ++i)
+			{
+				queue.post(boost::bind(&threadpool_data::overlap, this));
+			}
+			ensure("jobs pending", queue.getPending() > 0);
+			while (queue.getPending())
+			{
+				ms_sleep(1);
+			}
+		}
+		ensure("at most 2 jobs at once", mMaxRunning <= 2);
+	}
+
+	template<> template<>
+	void threadpool_object::test<5>()
+	{
+		// Without a pool the job runs before post() returns
+		LLAtomicS32 counter(0);
+		LLThreadPool::Queue queue(NULL, 2);
+		ensure("queue is not threaded", !queue.isThreaded());
+		queue.post(boost::bind(&threadpool_data::count, this, &counter));
+		ensure_equals("job ran", (S32)counter, 1);
+		ensure_equals("nothing pending", queue.getPending(), 0);
+	}
+
+	template<> template<>
+	void threadpool_object::test<6>()
+	{
+		// clear() drops what has not started, the destructor waits for the rest
+		LLThreadPool pool("test", 1);
+		LLAtomicS32 counter(0);
+		{
+			LLThreadPool::Queue queue(&pool, 1);
+			queue.post(boost::bind(&threadpool_data::block, this));
+			for (S32 i = 0; i < 50; ++i)
+			{
+				queue.post(boost::bind(&threadpool_data::count, this, &counter));
+			}
+			queue.clear();
+			ensure("at most the blocking job is left", queue.getPending() <= 1);
+			mRelease = 1;
+		}
+		ensure_equals("the cleared jobs did not run", (S32)counter, 0);
+	}
+}
@@ -37,22 +37,23 @@
 #include "llimagejpeg.h"
 #include "llimagepng.h"
 #include "llimagedxt.h"
+#include "llimagefilters.h"
 #include "llimageworker.h"
 #include "llmemory.h"
+#include "lltimer.h"
 
 //---------------------------------------------------------------------------
 // LLImage
 //---------------------------------------------------------------------------
 
 //static
-std::string LLImage::sLastErrorMessage;
-LLMutex* LLImage::sMutex = NULL;
+thread_local std::string LLImage::sLastErrorMessage;
 LLPrivateMemoryPool* LLImageBase::sPrivatePoolp = NULL ;
+LLAtomicU32 LLImageBase::sAllocationCount(0);
 
 //static
 void LLImage::initClass()
 {
-	sMutex = new LLMutex;
 	LLImageJ2C::openDSO();
 	LLImageBase::createPrivatePool() ;
 }
@@ -61,8 +62,6 @@ void LLImage::initClass()
 void LLImage::cleanupClass()
 {
 	LLImageJ2C::closeDSO();
-	delete sMutex;
-	sMutex = NULL;
 
 	LLImageBase::destroyPrivatePool() ;
 }
@@ -77,10 +76,190 @@ const std::string& LLImage::getLastError()
 //static
 void LLImage::setLastError(const std::string& message)
 {
-	LLMutexLock m(sMutex);
 	sLastErrorMessage = message;
 }
 
+//---------------------------------------------------------------------------
+// LLImageBufferPool
+//---------------------------------------------------------------------------
+
+static const S32 POOL_MIN_SIZE_LOG2 = 14;	// 64x64 RGBA
+static const S32 POOL_MAX_SIZE_LOG2 = 24;	// 2048x2048 RGBA
+// 2^n for every n in range, plus 3 * 2^(n-1) in between
+static const S32 POOL_NUM_CLASSES = 2 * (POOL_MAX_SIZE_LOG2 - POOL_MIN_SIZE_LOG2) + 1;
+
+struct LLPooledImageBuffer
+{
+	U8* mData;
+	F64 mReleaseTime;
+};
+typedef std::vector<LLPooledImageBuffer> pooled_buffer_list_t;
+
+// Oldest first, allocate() takes the most recently released one
+static pooled_buffer_list_t sPooledBuffers[POOL_NUM_CLASSES];
+static LLGlobalMutex sBufferPoolMutex;		// protects the buffer lists and the counters below
+static S64 sPooledBytes = 0;
+static S64 sMaxPooledBytes = 64 * 1024 * 1024;
+static S64 sTrimmedBytes = 0;
+static U32 sPoolHits = 0;
+static U32 sPoolMisses = 0;
+
+// Returns the size class for size, or -1 if it is not pooled
+static S32 buffer_pool_class(S32 size)
+{
+	if (size <= 0 || size > (1 << POOL_MAX_SIZE_LOG2))
+	{
+		return -1;
+	}
+	if (size <= (1 << POOL_MIN_SIZE_LOG2))
+	{
+		return 0;
+	}
+	S32 log2 = POOL_MIN_SIZE_LOG2;
+	while ((1 << (log2 + 1)) < size)
+	{
+		++log2;
+	}
+	// size is in (2^log2, 2^(log2+1)]
+	S32 index = 2 * (log2 - POOL_MIN_SIZE_LOG2);
+	return size <= 3 << (log2 - 1) ? index + 1 : index + 2;
+}
+
+static S32 buffer_pool_class_size(S32 index)
+{
+	S32 log2 = POOL_MIN_SIZE_LOG2 + index / 2;
+	return index & 1 ? 3 << (log2 - 1) : 1 << log2;
+}
+
+//static
+S32 LLImageBufferPool::getCapacity(S32 size)
+{
+	S32 index = buffer_pool_class(size);
+	return index < 0 ? 0 : buffer_pool_class_size(index);
+}
+
+//static
+U8* LLImageBufferPool::allocate(S32 size, S32& capacity)
+{
+	S32 index = buffer_pool_class(size);
+	if (index >= 0)
+	{
+		capacity = buffer_pool_class_size(index);
+		LLMutexLock lock(&sBufferPoolMutex);
+		pooled_buffer_list_t& buffers = sPooledBuffers[index];
+		if (!buffers.empty())
+		{
+			U8* data = buffers.back().mData;
+			buffers.pop_back();
+			sPooledBytes -= capacity;
+			++sPoolHits;
+			return data;
+		}
+		++sPoolMisses;
+	}
+	else
+	{
+		capacity = 0;
+	}
+
+	LLImageBase::sAllocationCount++;
+	U8* data = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), capacity ? capacity : size);
+	if (!data)
+	{
+		capacity = 0;
+	}
+	return data;
+}
+
+//static
+void LLImageBufferPool::release(U8* data, S32 capacity)
+{
+	if (!data)
+	{
+		return;
+	}
+	if (capacity)
+	{
+		S32 index = buffer_pool_class(capacity);
+		llassert(index >= 0 && buffer_pool_class_size(index) == capacity);
+		LLMutexLock lock(&sBufferPoolMutex);
+		if (sPooledBytes + capacity <= sMaxPooledBytes)
+		{
+			LLPooledImageBuffer buffer;
+			buffer.mData = data;
+			buffer.mReleaseTime = LLTimer::getTotalSeconds();
+			sPooledBuffers[index].push_back(buffer);
+			sPooledBytes += capacity;
+			return;
+		}
+	}
+	FREE_MEM(LLImageBase::getPrivatePool(), data);
+}
+
+//static
+void LLImageBufferPool::trim(F32 max_age)
+{
+	std::vector<U8*> expired;
+	{
+		F64 oldest = (F64)LLTimer::getTotalSeconds() - max_age;
+		LLMutexLock lock(&sBufferPoolMutex);
+		for (S32 index = 0; index < POOL_NUM_CLASSES; ++index)
+		{
+			pooled_buffer_list_t& buffers = sPooledBuffers[index];
+			pooled_buffer_list_t::iterator end = buffers.begin();
+			while (end != buffers.end() && (max_age <= 0.f || end->mReleaseTime < oldest))
+			{
+				expired.push_back(end->mData);
+				++end;
+			}
+			S64 bytes = (S64)(end - buffers.begin()) * buffer_pool_class_size(index);
+			sPooledBytes -= bytes;
+			sTrimmedBytes += bytes;
+			buffers.erase(buffers.begin(), end);
+		}
+	}
+	// Free outside of the lock, the decode threads may be waiting for it
+	for (std::vector<U8*>::iterator iter = expired.begin(); iter != expired.end(); ++iter)
+	{
+		FREE_MEM(LLImageBase::getPrivatePool(), *iter);
+	}
+}
+
+//static
+void LLImageBufferPool::setMaxCachedBytes(S64 bytes)
+{
+	LLMutexLock lock(&sBufferPoolMutex);
+	sMaxPooledBytes = bytes;
+}
+
+//static
+S64 LLImageBufferPool::getCachedBytes()
+{
+	LLMutexLock lock(&sBufferPoolMutex);
+	return sPooledBytes;
+}
+
+//static
+U32 LLImageBufferPool::getHitCount()
+{
+	LLMutexLock lock(&sBufferPoolMutex);
+	return sPoolHits;
+}
+
+//static
+U32 LLImageBufferPool::getMissCount()
+{
+	LLMutexLock lock(&sBufferPoolMutex);
+	return sPoolMisses;
+}
+
+//static
+S64 LLImageBufferPool::getTrimmedBytes()
+{
+	LLMutexLock lock(&sBufferPoolMutex);
+	return sTrimmedBytes;
+}
+
 //---------------------------------------------------------------------------
 // LLImageBase
 //---------------------------------------------------------------------------
@@ -92,7 +271,9 @@ LLImageBase::LLImageBase()
 	  mHeight(0),
 	  mComponents(0),
 	  mBadBufferAllocation(false),
-	  mAllowOverSize(false)
+	  mAllowOverSize(false),
+	  mUseBufferPool(false),
+	  mPoolCapacity(0)
 {
 }
 
@@ -114,6 +295,8 @@ void LLImageBase::createPrivatePool()
 //static 
 void LLImageBase::destroyPrivatePool() 
 {
+	// The pooled buffers come out of the private pool
+	LLImageBufferPool::clear();
 	if(sPrivatePoolp)
 	{
 		LLPrivateMemoryPoolManager::getInstance()->deletePool(sPrivatePoolp) ;
@@ -154,9 +337,10 @@ void LLImageBase::sanityCheck()
 // virtual
 void LLImageBase::deleteData()
 {
-	FREE_MEM(sPrivatePoolp, mData) ;
+	LLImageBufferPool::release(mData, mPoolCapacity);
 	mData = NULL;
 	mDataSize = 0;
+	mPoolCapacity = 0;
 }
 
 // virtual
@@ -189,7 +373,15 @@ U8* LLImageBase::allocateData(S32 size)
 	{
 		deleteData(); // virtual
 		mBadBufferAllocation = false ;
-		mData = (U8*)ALLOCATE_MEM(sPrivatePoolp, size);
+		if (mUseBufferPool)
+		{
+			mData = LLImageBufferPool::allocate(size, mPoolCapacity);
+		}
+		else
+		{
+			mData = (U8*)ALLOCATE_MEM(sPrivatePoolp, size);
+			sAllocationCount++;
+		}
 		if (!mData)
 		{
 			LL_WARNS() << "Failed to allocate image data size [" << size << "]" << LL_ENDL;
@@ -222,7 +414,24 @@ U8* LLImageBase::reallocateData(S32 size)
 	if(mData && (mDataSize == size))
 		return mData;
 
-	U8 *new_datap = (U8*)ALLOCATE_MEM(sPrivatePoolp, size);
+	if (mData && mPoolCapacity && LLImageBufferPool::getCapacity(size) == mPoolCapacity)
+	{
+		// The buffer we have is already big enough
+		mDataSize = size;
+		return mData;
+	}
+
+	S32 new_capacity = 0;
+	U8 *new_datap;
+	if (mUseBufferPool)
+	{
+		new_datap = LLImageBufferPool::allocate(size, new_capacity);
+	}
+	else
+	{
+		new_datap = (U8*)ALLOCATE_MEM(sPrivatePoolp, size);
+		sAllocationCount++;
+	}
 	if (!new_datap)
 	{
 		LL_WARNS() << "Out of memory in LLImageBase::reallocateData" << LL_ENDL;
@@ -232,10 +441,11 @@ U8* LLImageBase::reallocateData(S32 size)
 	{
 		S32 bytes = llmin(mDataSize, size);
 		memcpy(new_datap, mData, bytes);	/* Flawfinder: ignore */
-		FREE_MEM(sPrivatePoolp, mData) ;
+		LLImageBufferPool::release(mData, mPoolCapacity);
 	}
 	mData = new_datap;
 	mDataSize = size;
+	mPoolCapacity = new_capacity;
 	return mData;
 }
 
@@ -288,6 +498,7 @@ S32 LLImageRaw::sRawImageCachedCount = 0;
 LLImageRaw::LLImageRaw()
 	: LLImageBase(), mCacheEntries(0)
 {
+	useBufferPool();
 	++sRawImageCount;
 }
 
@@ -295,6 +506,7 @@ LLImageRaw::LLImageRaw(U16 width, U16 height, S8 components)
 	: LLImageBase(), mCacheEntries(0)
 {
 	llassert( S32(width) * S32(height) * S32(components) <= MAX_IMAGE_DATA_SIZE );
+	useBufferPool();
 	allocateDataSize(width, height, components);
 	++sRawImageCount;
 }
@@ -302,7 +514,7 @@ LLImageRaw::LLImageRaw(U16 width, U16 height, S8 components)
 LLImageRaw::LLImageRaw(U8 *data, U16 width, U16 height, S8 components, bool no_copy)
 	: LLImageBase(), mCacheEntries(0)
 {
-
+	useBufferPool();
 	if(no_copy)
 	{
 		setDataAndSize(data, width, height, components);
@@ -317,6 +529,7 @@ LLImageRaw::LLImageRaw(U8 *data, U16 width, U16 height, S8 components, bool no_c
 LLImageRaw::LLImageRaw(LLImageRaw const* src, U16 width, U16 height, U16 crop_offset, bool crop_vertically) : mCacheEntries(0)
 {
 	llassert_always(src);
+	useBufferPool();
 	S8 const components = src->getComponents();
 	U8 const* const data = src->getData();
 	if (allocateDataSize(width, height, components))
@@ -378,6 +591,40 @@ void LLImageRaw::deleteData()
 		*AIAccess<S64>(sGlobalRawMemory) -= getDataSize();
 	}
 	LLImageBase::deleteData();
+	mCompressedMips = NULL;
+	mStagedUpload = NULL;
+}
+
+void LLImageRaw::setCompressedMips(LLImageDXT* compressed)
+{
+	mCompressedMips = compressed;
+}
+
+LLImageDXT* LLImageRaw::getCompressedMips() const
+{
+	if (mCompressedMips.notNull() &&
+		mCompressedMips->getWidth() == getWidth() && mCompressedMips->getHeight() == getHeight() &&
+		mCompressedMips->getComponents() == getComponents())
+	{
+		return mCompressedMips;
+	}
+	return NULL;
+}
+
+void LLImageRaw::setStagedUpload(LLImageStagedUpload* staged)
+{
+	mStagedUpload = staged;
+}
+
+LLImageStagedUpload* LLImageRaw::getStagedUpload() const
+{
+	if (mStagedUpload.notNull() &&
+		mStagedUpload->getWidth() == getWidth() && mStagedUpload->getHeight() == getHeight() &&
+		mStagedUpload->getComponents() == getComponents())
+	{
+		return mStagedUpload;
+	}
+	return NULL;
 }
 
 void LLImageRaw::setDataAndSize(U8 *data, S32 width, S32 height, S8 components) 
@@ -647,10 +894,7 @@ void LLImageRaw::compositeScaled4onto3(LLImageRaw* src)
 	std::vector<U8> temp_buffer(temp_data_size);
 
 	// Vertical: scale but no composite
-	for( S32 col = 0; col < src->getWidth(); col++ )
-	{
-		copyLineScaled( src->getData() + (src->getComponents() * col), &temp_buffer[0] + (src->getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-	}
+	copy_rows_scaled( src->getData(), &temp_buffer[0], src->getHeight(), dst->getHeight(), src->getWidth() * src->getComponents() );
 
 	// Horizontal: scale and composite
 	for( S32 row = 0; row < dst->getHeight(); row++ )
@@ -935,10 +1179,7 @@ void LLImageRaw::copyScaled( LLImageRaw* src )
 	std::vector<U8> temp_buffer(temp_data_size);
 
 	// Vertical
-	for( S32 col = 0; col < src->getWidth(); col++ )
-	{
-		copyLineScaled( src->getData() + (getComponents() * col), &temp_buffer[0] + (getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-	}
+	copy_rows_scaled( src->getData(), &temp_buffer[0], src->getHeight(), dst->getHeight(), src->getWidth() * getComponents() );
 
 	// Horizontal
 	for( S32 row = 0; row < dst->getHeight(); row++ )
@@ -1025,10 +1266,7 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 			// Resize vertically.
 			old_buffer = LLImageBase::release();
 			new_buffer = allocateDataSize(old_width, new_height, getComponents());
-			for (S32 col = 0; col < old_width; ++col)
-			{
-				copyLineScaled(old_buffer + getComponents() * col, new_buffer + getComponents() * col, old_height, new_height, old_width, old_width);
-			}
+			copy_rows_scaled(old_buffer, new_buffer, old_height, new_height, old_width_bytes);
 			LLImageBase::deleteData(old_buffer);
 		}
 		if (new_width != old_width)
@@ -1076,114 +1314,7 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 
 void LLImageRaw::copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step )
 {
-	const S32 components = getComponents();
-	llassert( components >= 1 && components <= 4 );
-
-	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
-	const F32 norm_factor = 1.f / ratio;
-
-	S32 goff = components >= 2 ? 1 : 0;
-	S32 boff = components >= 3 ? 2 : 0;
-	// This loop is awful.
-	for( S32 x = 0; x < out_pixel_len; x++ )
-	{
-		// Sample input pixels in range from sample0 to sample1.
-		// Avoid floating point accumulation error... don't just add ratio each time.  JC
-		const F32 sample0 = x * ratio;
-		const F32 sample1 = (x+1) * ratio;
-		const S32 index0 = llfloor(sample0);			// left integer (floor)
-		const S32 index1 = llfloor(sample1);			// right integer (floor)
-		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on left
-		const F32 fract1 = sample1 - F32(index1);			// spill-over on right
-
-		if( index0 == index1 )
-		{
-			// Interval is embedded in one input pixel
-			S32 t0 = x * out_pixel_step * components;
-			S32 t1 = index0 * in_pixel_step * components;
-			U8* outp = out + t0;
-			U8* inp = in + t1;
-			for (S32 i = 0; i < components; ++i)
-			{
-				*outp = *inp;
-				++outp;
-				++inp;
-			}
-		}
-		else
-		{
-			// Left straddle
-			S32 t1 = index0 * in_pixel_step * components;
-			F32 r = in[t1 + 0] * fract0;
-			F32 g = in[t1 + goff] * fract0;
-			F32 b = in[t1 + boff] * fract0;
-			F32 a = 0;
-			if( components == 4)
-			{
-				a = in[t1 + 3] * fract0;
-			}
-		
-			// Central interval
-			if (components < 4)
-			{
-				for( S32 u = index0 + 1; u < index1; u++ )
-				{
-					S32 t2 = u * in_pixel_step * components;
-					r += in[t2 + 0];
-					g += in[t2 + goff];
-					b += in[t2 + boff];
-				}
-			}
-			else
-			{
-				for( S32 u = index0 + 1; u < index1; u++ )
-				{
-					S32 t2 = u * in_pixel_step * components;
-					r += in[t2 + 0];
-					g += in[t2 + 1];
-					b += in[t2 + 2];
-					a += in[t2 + 3];
-				}
-			}
-
-			// right straddle
-			// Watch out for reading off of end of input array.
-			if( fract1 && index1 < in_pixel_len )
-			{
-				S32 t3 = index1 * in_pixel_step * components;
-				if (components < 4)
-				{
-					U8 in0 = in[t3 + 0];
-					U8 in1 = in[t3 + goff];
-					U8 in2 = in[t3 + boff];
-					r += in0 * fract1;
-					g += in1 * fract1;
-					b += in2 * fract1;
-				}
-				else
-				{
-					U8 in0 = in[t3 + 0];
-					U8 in1 = in[t3 + 1];
-					U8 in2 = in[t3 + 2];
-					U8 in3 = in[t3 + 3];
-					r += in0 * fract1;
-					g += in1 * fract1;
-					b += in2 * fract1;
-					a += in3 * fract1;
-				}
-			}
-
-			U8 arr[] = {
-				U8(ll_pos_round(r * norm_factor)),
-				U8(ll_pos_round(g * norm_factor)),
-				U8(ll_pos_round(b * norm_factor)),
-				U8(ll_pos_round(a * norm_factor))
-			};  // skip conditional
-
-			S32 t4 = x * out_pixel_step * components;
-			memcpy(out + t4, arr, sizeof(U8) * components);
-		}
-	}
+	copy_line_scaled(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, getComponents());
 }
 
 void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len )
@@ -1224,42 +1355,26 @@ void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S3
 		else
 		{
 			// Left straddle
-			S32 t1 = index0 * IN_COMPONENTS;
-			F32 r = in[t1 + 0] * fract0;
-			F32 g = in[t1 + 1] * fract0;
-			F32 b = in[t1 + 2] * fract0;
-			F32 a = in[t1 + 3] * fract0;
-		
+			__m128 sum = _mm_mul_ps(load_pixel_ps(in + index0 * IN_COMPONENTS, IN_COMPONENTS), _mm_set1_ps(fract0));
+
 			// Central interval
 			for( S32 u = index0 + 1; u < index1; u++ )
 			{
-				S32 t2 = u * IN_COMPONENTS;
-				r += in[t2 + 0];
-				g += in[t2 + 1];
-				b += in[t2 + 2];
-				a += in[t2 + 3];
+				sum = _mm_add_ps(sum, load_pixel_ps(in + u * IN_COMPONENTS, IN_COMPONENTS));
 			}
 
 			// right straddle
 			// Watch out for reading off of end of input array.
 			if( fract1 && index1 < in_pixel_len )
 			{
-				S32 t3 = index1 * IN_COMPONENTS;
-				r += in[t3 + 0] * fract1;
-				g += in[t3 + 1] * fract1;
-				b += in[t3 + 2] * fract1;
-				a += in[t3 + 3] * fract1;
+				sum = _mm_add_ps(sum, _mm_mul_ps(load_pixel_ps(in + index1 * IN_COMPONENTS, IN_COMPONENTS), _mm_set1_ps(fract1)));
 			}
 
-			r *= norm_factor;
-			g *= norm_factor;
-			b *= norm_factor;
-			a *= norm_factor;
-
-			in_scaled_r = U8(ll_pos_round(r));
-			in_scaled_g = U8(ll_pos_round(g));
-			in_scaled_b = U8(ll_pos_round(b));
-			in_scaled_a = U8(ll_pos_round(a));
+			U32 scaled = round_pixel_ps(sum, _mm_set1_ps(norm_factor));
+			in_scaled_r = U8(scaled);
+			in_scaled_g = U8(scaled >> 8);
+			in_scaled_b = U8(scaled >> 16);
+			in_scaled_a = U8(scaled >> 24);
 		}
 
 		if( in_scaled_a )
@@ -1729,31 +1844,10 @@ S8 LLImageFormatted::getCodec() const
 
 //============================================================================
 
-static void avg4_colors4(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
-{
-	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
-	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
-	dst[2] = (U8)(((U32)(a[2]) + b[2] + c[2] + d[2])>>2);
-	dst[3] = (U8)(((U32)(a[3]) + b[3] + c[3] + d[3])>>2);
-}
-
-static void avg4_colors3(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
-{
-	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
-	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
-	dst[2] = (U8)(((U32)(a[2]) + b[2] + c[2] + d[2])>>2);
-}
-
-static void avg4_colors2(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
-{
-	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
-	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
-}
-
 void LLImageBase::setDataAndSize(U8 *data, S32 size)
 { 
 	ll_assert_aligned(data, 16);
-	mData = data; mDataSize = size; 
+	mData = data; mDataSize = size; mPoolCapacity = 0;
 }	
 
 //static
@@ -1764,29 +1858,11 @@ void LLImageBase::generateMip(const U8* indata, U8* mipdata, S32 width, S32 heig
 	S32 in_width = width*2;
 	for (S32 h=0; h<height; h++)
 	{
-		for (S32 w=0; w<width; w++)
-		{
-			switch(nchannels)
-			{
-			  case 4:
-				avg4_colors4(indata, indata+4, indata+4*in_width, indata+4*in_width+4, data);
-				break;
-			  case 3:
-				avg4_colors3(indata, indata+3, indata+3*in_width, indata+3*in_width+3, data);
-				break;
-			  case 2:
-				avg4_colors2(indata, indata+2, indata+2*in_width, indata+2*in_width+2, data);
-				break;
-			  case 1:
-				*(U8*)data = (U8)(((U32)(indata[0]) + indata[1] + indata[in_width] + indata[in_width+1])>>2);
-				break;
-			  default:
-				LL_ERRS() << "generateMmip called with bad num channels" << LL_ENDL;
-			}
-			indata += nchannels*2;
-			data += nchannels;
-		}
-		indata += nchannels*in_width; // skip odd lines
+		const U8* row1 = indata + nchannels*in_width;
+		S32 done = generate_mip_row_sse2(indata, row1, data, width, nchannels);
+		generate_mip_row_scalar(indata + nchannels*2*done, row1 + nchannels*2*done, data + nchannels*done, width - done, nchannels);
+		indata += nchannels*in_width*2; // skip odd lines
+		data += nchannels*width;
 	}
 }
 
@@ -33,9 +33,11 @@
 #ifndef LL_LLIMAGE_H
 #define LL_LLIMAGE_H
 
+#include "llpointer.h"
 #include "lluuid.h"
 #include "llstring.h"
 #include "llthread.h"
+#include "llatomic.h"
 #include "aithreadsafe.h"
 
 const S32 MIN_IMAGE_MIP =  2; // 4x4, only used for expand/contract power of 2
@@ -60,6 +62,7 @@ const S32 MAX_IMG_PACKET_SIZE = 1000;
 
 class LLImageFormatted;
 class LLImageRaw;
+class LLImageDXT;
 class LLColor4U;
 class LLPrivateMemoryPool;
 
@@ -85,12 +88,75 @@ public:
 	static void initClass();
 	static void cleanupClass();
 
+	// The last error of the calling thread, so that images converted
+	// concurrently do not report each other's errors
 	static const std::string& getLastError();
 	static void setLastError(const std::string& message);
 	
 protected:
-	static LLMutex* sMutex;
-	static std::string sLastErrorMessage;
+	static thread_local std::string sLastErrorMessage;
+};
+
+//============================================================================
+// Size-classed cache of freed raw image buffers.
+//
+// Decoded textures come and go in a handful of sizes, so instead of returning
+// the buffer of a raw image to the heap when it is deleted we keep it for the
+// next image of the same size: the decode threads then write straight into a
+// buffer that was just uploaded from, and a texture costs no raw allocation at
+// all once the pool is warm. Buffers are rounded up to a power of two or one
+// and a half times a power of two, which is the exact size of any power of two
+// image with one to four components.
+//
+// Thread safe. Buffers that stay unused are freed by trim().
+
+class LLImageBufferPool
+{
+public:
+	// Returns a buffer of at least size bytes. capacity is set to the size of the pooled
+	// buffer, or 0 if size is outside of the pooled range; hand it back to release().
+	static U8* allocate(S32 size, S32& capacity);
+	static void release(U8* data, S32 capacity);
+	// The capacity allocate() gives a buffer of size bytes
+	static S32 getCapacity(S32 size);
+
+	// Free the buffers that were not reused for max_age seconds
+	static void trim(F32 max_age);
+	static void clear()							{ trim(0.f); }
+	// Buffers released while the pool holds this much are freed right away
+	static void setMaxCachedBytes(S64 bytes);
+
+	static S64 getCachedBytes();
+	// Allocations served from the pool and from the heap, and bytes freed by trim(), since startup
+	static U32 getHitCount();
+	static U32 getMissCount();
+	static S64 getTrimmedBytes();
+};
+
+//============================================================================
+// A copy of a raw image and its mips that already sits where the renderer
+// uploads textures from (see LLTextureUploadStream), made by the decode threads.
+
+class LLImageStagedUpload : public LLThreadSafeRefCount
+{
+protected:
+	virtual ~LLImageStagedUpload() {}
+
+public:
+	LLImageStagedUpload(U16 width, U16 height, S8 components, S32 levels)
+	:	mWidth(width), mHeight(height), mComponents(components), mLevels(levels) {}
+
+	U16 getWidth() const		{ return mWidth; }
+	U16 getHeight() const		{ return mHeight; }
+	S8	getComponents() const	{ return mComponents; }
+	// Number of mip levels staged, including the full size one
+	S32 getLevels() const		{ return mLevels; }
+
+private:
+	U16 mWidth;
+	U16 mHeight;
+	S8 mComponents;
+	S32 mLevels;
 };
 
 //============================================================================
@@ -114,7 +180,7 @@ public:
 	virtual U8* allocateData(S32 size = -1);
 	virtual U8* reallocateData(S32 size = -1);
 	static void deleteData(U8* data) { FREE_MEM(sPrivatePoolp, data); }
-	U8* release() { U8* data = mData; mData = NULL; mDataSize = 0; return data; }	// Same as deleteData(), but returns old data. Call deleteData(old_data) to free it.
+	U8* release() { U8* data = mData; mData = NULL; mDataSize = 0; mPoolCapacity = 0; return data; }	// Same as deleteData(), but returns old data. Call deleteData(old_data) to free it.
 
 	virtual void dump();
 	virtual void sanityCheck();
@@ -136,6 +202,8 @@ public:
 protected:
 	// special accessor to allow direct setting of mData and mDataSize by LLImageFormatted
 	void setDataAndSize(U8 *data, S32 size);
+	// Allocate the image data from LLImageBufferPool from now on
+	void useBufferPool()		{ mUseBufferPool = true; }
 	
 public:
 	static void generateMip(const U8 *indata, U8* mipdata, int width, int height, S32 nchannels);
@@ -149,6 +217,9 @@ public:
 	static void createPrivatePool() ;
 	static void destroyPrivatePool() ;
 	static LLPrivateMemoryPool* getPrivatePool() {return sPrivatePoolp;}
+
+	// Number of image buffers allocated so far, by any image on any thread (for benchmarks)
+	static U32 getAllocationCount() { return sAllocationCount; }
 private:
 	U8 *mData;
 	S32 mDataSize;
@@ -160,8 +231,13 @@ private:
 
 	bool mBadBufferAllocation ;
 	bool mAllowOverSize ;
+	bool mUseBufferPool;
+	S32 mPoolCapacity;		// size of the pooled buffer mData points to, 0 if it is not pooled
 
 	static LLPrivateMemoryPool* sPrivatePoolp ;
+	static LLAtomicU32 sAllocationCount;
+
+	friend class LLImageBufferPool;
 };
 
 // Raw representation of an image (used for textures, and other uncompressed formats
@@ -263,6 +339,21 @@ public:
 	static AIThreadSafeSimpleDC<S64> sGlobalRawMemory;
 	static S32 sRawImageCount;
 
+	// DXT1/DXT5 copy of this image and its mips, made by the decode threads so the
+	// texture can be uploaded compressed. Not returned once the image was resized.
+	void setCompressedMips(LLImageDXT* compressed);
+	LLImageDXT* getCompressedMips() const;
+
+	// Copy of this image and its mips staged for upload by the decode threads.
+	// Not returned once the image was resized.
+	void setStagedUpload(LLImageStagedUpload* staged);
+	LLImageStagedUpload* getStagedUpload() const;
+
+private:
+	LLPointer<LLImageDXT> mCompressedMips;
+	LLPointer<LLImageStagedUpload> mStagedUpload;
+
+public:
 	static S32 sRawImageCachedCount;
 	S32 mCacheEntries;
 	void setInCache(bool in_cache)
@@ -163,7 +163,8 @@ S32 LLImageDXT::calcNumMips(S32 width, S32 height)
 LLImageDXT::LLImageDXT()
 	: LLImageFormatted(IMG_CODEC_DXT),
 	  mFileFormat(FORMAT_UNKNOWN),
-	  mHeaderSize(0)
+	  mHeaderSize(0),
+	  mCompressionPSNR(0.f)
 {
 }
 
@@ -404,6 +405,359 @@ BOOL LLImageDXT::encode(const LLImageRaw* raw_image, F32 time)
 	return encodeDXT(raw_image, time, false);
 }
 
+//============================================================================
+// DXT1/DXT5 block compression
+
+// 4x4 block of RGBA pixels, edge pixels repeated for mips smaller than a block
+static void load_block(const U8* data, S32 width, S32 height, S32 ncomponents, S32 bx, S32 by, U8 block[16][4])
+{
+	for (S32 y = 0; y < 4; ++y)
+	{
+		const U8* row = data + llmin(by + y, height - 1) * width * ncomponents;
+		for (S32 x = 0; x < 4; ++x)
+		{
+			const U8* pixel = row + llmin(bx + x, width - 1) * ncomponents;
+			U8* out = block[y * 4 + x];
+			out[0] = pixel[0];
+			out[1] = pixel[1];
+			out[2] = pixel[2];
+			out[3] = ncomponents == 4 ? pixel[3] : 255;
+		}
+	}
+}
+
+static U16 pack_565(const F32* rgb)
+{
+	S32 r = llclamp((S32)(rgb[0] * (31.f / 255.f) + .5f), 0, 31);
+	S32 g = llclamp((S32)(rgb[1] * (63.f / 255.f) + .5f), 0, 63);
+	S32 b = llclamp((S32)(rgb[2] * (31.f / 255.f) + .5f), 0, 31);
+	return (U16)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(U16 color, S32* rgb)
+{
+	S32 r = (color >> 11) & 31;
+	S32 g = (color >> 5) & 63;
+	S32 b = color & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the closest of the four colors for each pixel; returns the squared error
+static U32 fit_color_indices(const U8 block[16][4], U16 color0, U16 color1, U32& indices)
+{
+	S32 palette[4][3];
+	unpack_565(color0, palette[0]);
+	unpack_565(color1, palette[1]);
+	for (S32 c = 0; c < 3; ++c)
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	U32 error = 0;
+	indices = 0;
+	for (S32 i = 0; i < 16; ++i)
+	{
+		S32 best = 0;
+		S32 best_dist = S32_MAX;
+		for (S32 p = 0; p < 4; ++p)
+		{
+			S32 dr = block[i][0] - palette[p][0];
+			S32 dg = block[i][1] - palette[p][1];
+			S32 db = block[i][2] - palette[p][2];
+			S32 dist = dr * dr + dg * dg + db * db;
+			if (dist < best_dist)
+			{
+				best_dist = dist;
+				best = p;
+			}
+		}
+		indices |= best << (i * 2);
+		error += best_dist;
+	}
+	return error;
+}
+
+// Always uses the four color mode (color0 > color1), so the block never has transparent texels
+static U32 compress_color_block(const U8 block[16][4], U8* out)
+{
+	// Principal axis of the colors
+	F32 mean[3] = { 0.f, 0.f, 0.f };
+	for (S32 i = 0; i < 16; ++i)
+	{
+		for (S32 c = 0; c < 3; ++c)
+		{
+			mean[c] += block[i][c];
+		}
+	}
+	for (S32 c = 0; c < 3; ++c)
+	{
+		mean[c] *= 1.f / 16.f;
+	}
+	F32 cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+	for (S32 i = 0; i < 16; ++i)
+	{
+		F32 r = block[i][0] - mean[0];
+		F32 g = block[i][1] - mean[1];
+		F32 b = block[i][2] - mean[2];
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+	F32 axis[3] = { 1.f, 1.f, 1.f };
+	for (S32 iter = 0; iter < 4; ++iter)
+	{
+		F32 x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		F32 y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		F32 z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		F32 len = llmax(llmax(fabsf(x), fabsf(y)), fabsf(z));
+		if (len < 1e-6f)
+		{
+			break;
+		}
+		axis[0] = x / len;
+		axis[1] = y / len;
+		axis[2] = z / len;
+	}
+
+	// Endpoints at the extremes along the axis, pulled in a little
+	F32 min_t = F32_MAX;
+	F32 max_t = -F32_MAX;
+	F32 axis_len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	for (S32 i = 0; i < 16; ++i)
+	{
+		F32 t = ((block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2]) / axis_len2;
+		min_t = llmin(min_t, t);
+		max_t = llmax(max_t, t);
+	}
+	F32 inset = (max_t - min_t) / 16.f;
+	min_t += inset;
+	max_t -= inset;
+	F32 end0[3], end1[3];
+	for (S32 c = 0; c < 3; ++c)
+	{
+		end0[c] = mean[c] + axis[c] * max_t;
+		end1[c] = mean[c] + axis[c] * min_t;
+	}
+
+	U16 color0 = pack_565(end0);
+	U16 color1 = pack_565(end1);
+	U32 indices = 0;
+	U32 error;
+	if (color0 == color1)
+	{
+		error = fit_color_indices(block, color0, color1, indices);
+		indices = 0;
+	}
+	else
+	{
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+		error = fit_color_indices(block, color0, color1, indices);
+
+		// One least squares refinement of the endpoints for the chosen indices
+		static const F32 weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+		F32 aa = 0.f, ab = 0.f, bb = 0.f;
+		F32 ax[3] = { 0.f, 0.f, 0.f };
+		F32 bx[3] = { 0.f, 0.f, 0.f };
+		for (S32 i = 0; i < 16; ++i)
+		{
+			F32 a = weights[(indices >> (i * 2)) & 3];
+			F32 b = 1.f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (S32 c = 0; c < 3; ++c)
+			{
+				ax[c] += a * block[i][c];
+				bx[c] += b * block[i][c];
+			}
+		}
+		F32 det = aa * bb - ab * ab;
+		if (fabsf(det) > 1e-6f)
+		{
+			F32 refined0[3], refined1[3];
+			for (S32 c = 0; c < 3; ++c)
+			{
+				refined0[c] = (ax[c] * bb - bx[c] * ab) / det;
+				refined1[c] = (bx[c] * aa - ax[c] * ab) / det;
+			}
+			U16 refined_color0 = pack_565(refined0);
+			U16 refined_color1 = pack_565(refined1);
+			if (refined_color0 < refined_color1)
+			{
+				std::swap(refined_color0, refined_color1);
+			}
+			if (refined_color0 != refined_color1)
+			{
+				U32 refined_indices;
+				U32 refined_error = fit_color_indices(block, refined_color0, refined_color1, refined_indices);
+				if (refined_error < error)
+				{
+					error = refined_error;
+					color0 = refined_color0;
+					color1 = refined_color1;
+					indices = refined_indices;
+				}
+			}
+		}
+	}
+
+	out[0] = color0 & 0xff;
+	out[1] = color0 >> 8;
+	out[2] = color1 & 0xff;
+	out[3] = color1 >> 8;
+	out[4] = indices & 0xff;
+	out[5] = (indices >> 8) & 0xff;
+	out[6] = (indices >> 16) & 0xff;
+	out[7] = indices >> 24;
+	return error;
+}
+
+// Eight level alpha block (alpha0 > alpha1); returns the squared error
+static U32 compress_alpha_block(const U8 block[16][4], U8* out)
+{
+	S32 alpha0 = 0;
+	S32 alpha1 = 255;
+	for (S32 i = 0; i < 16; ++i)
+	{
+		alpha0 = llmax(alpha0, (S32)block[i][3]);
+		alpha1 = llmin(alpha1, (S32)block[i][3]);
+	}
+
+	S32 palette[8];
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+	for (S32 p = 1; p < 7; ++p)
+	{
+		palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+	}
+
+	U64 indices = 0;
+	U32 error = 0;
+	if (alpha0 != alpha1)
+	{
+		for (S32 i = 0; i < 16; ++i)
+		{
+			S32 best = 0;
+			S32 best_dist = S32_MAX;
+			for (S32 p = 0; p < 8; ++p)
+			{
+				S32 dist = block[i][3] - palette[p];
+				dist *= dist;
+				if (dist < best_dist)
+				{
+					best_dist = dist;
+					best = p;
+				}
+			}
+			indices |= (U64)best << (i * 3);
+			error += best_dist;
+		}
+	}
+
+	out[0] = (U8)alpha0;
+	out[1] = (U8)alpha1;
+	for (S32 i = 0; i < 6; ++i)
+	{
+		out[2 + i] = (U8)(indices >> (i * 8));
+	}
+	return error;
+}
+
+// Returns the squared error summed over all channels
+static U64 compress_mip(const U8* data, S32 width, S32 height, S32 ncomponents, U8* out)
+{
+	U64 error = 0;
+	U8 block[16][4];
+	for (S32 by = 0; by < height; by += 4)
+	{
+		for (S32 bx = 0; bx < width; bx += 4)
+		{
+			load_block(data, width, height, ncomponents, bx, by, block);
+			if (ncomponents == 4)
+			{
+				error += compress_alpha_block(block, out);
+				out += 8;
+			}
+			error += compress_color_block(block, out);
+			out += 8;
+		}
+	}
+	return error;
+}
+
+BOOL LLImageDXT::encodeCompressed(const LLImageRaw* raw_image)
+{
+	llassert_always(raw_image);
+
+	S32 ncomponents = raw_image->getComponents();
+	S32 width = raw_image->getWidth();
+	S32 height = raw_image->getHeight();
+	if ((ncomponents != 3 && ncomponents != 4) || width < 4 || height < 4 ||
+		(width & (width - 1)) || (height & (height - 1)))
+	{
+		return FALSE;
+	}
+	EFileFormat format = ncomponents == 4 ? FORMAT_DXR5 : FORMAT_DXR1;
+
+	setSize(width, height, ncomponents);
+	mHeaderSize = sizeof(dxtfile_header_t);
+	mFileFormat = format;
+
+	S32 nmips = calcNumMips(width, height);
+	S32 totbytes = mHeaderSize;
+	for (S32 mip = 0; mip < nmips; mip++)
+	{
+		totbytes += formatBytes(format, width >> mip, height >> mip);
+	}
+	if (!allocateData(totbytes))
+	{
+		return FALSE;
+	}
+
+	U8* data = getData();
+	dxtfile_header_t* header = (dxtfile_header_t*)data;
+	memset(header, 0, mHeaderSize);
+	header->fourcc = 0x20534444;
+	header->pixel_fmt.fourcc = getFourCC(format);
+	header->num_mips = nmips;
+	header->maxwidth = width;
+	header->maxheight = height;
+
+	// Uncompressed mips are box filtered from the previous one, like LLImageGL does
+	std::vector<U8> mip_buffers[2];
+	const U8* mip_pixels = raw_image->getData();
+	S32 w = width;
+	S32 h = height;
+	for (S32 mip = 0; mip < nmips; mip++)
+	{
+		if (mip > 0)
+		{
+			std::vector<U8>& next = mip_buffers[mip & 1];
+			next.resize(w * h * ncomponents);
+			generateMip(mip_pixels, &next[0], w, h, ncomponents);
+			mip_pixels = &next[0];
+		}
+		U64 error = compress_mip(mip_pixels, w, h, ncomponents, data + getMipOffset(mip));
+		if (mip == 0)
+		{
+			F64 mse = (F64)error / ((F64)width * height * ncomponents);
+			mCompressionPSNR = mse > 0.0 ? (F32)(10.0 * log10(255.0 * 255.0 / mse)) : 99.f;
+		}
+		w >>= 1;
+		h >>= 1;
+	}
+	return TRUE;
+}
+
 // virtual
 bool LLImageDXT::convertToDXR()
 {
@@ -110,6 +110,12 @@ public:
 	/*virtual*/ BOOL decode(LLImageRaw* raw_image, F32 decode_time);
 	/*virtual*/ BOOL encode(const LLImageRaw* raw_image, F32 encode_time);
 
+	// Compress raw_image and its mips to DXR1 (3 components) or DXR5 (4 components),
+	// smallest mip first, ready for upload. Width and height must be powers of two, at least 4.
+	BOOL encodeCompressed(const LLImageRaw* raw_image);
+	// Peak signal to noise ratio of the full size mip after encodeCompressed(), in dB
+	F32 getCompressionPSNR() const { return mCompressionPSNR; }
+
 	/*virtual*/ S32 calcHeaderSize();
 	/*virtual*/ S32 calcDataSize(S32 discard_level = 0);
 
@@ -142,6 +148,7 @@ private:
 private:
 	EFileFormat mFileFormat;
 	S32 mHeaderSize;
+	F32 mCompressionPSNR;
 };
 
 #endif
@@ -0,0 +1,409 @@
+/**
+ * @file llimagefilters.cpp
+ * @brief Row kernels of the image scaling filters and of the software mip generation.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagefilters.h"
+
+#include "llmath.h"
+
+#include <vector>
+
+// Sixteen bytes as four vectors of four floats
+static inline void load16_ps(const U8* in, __m128* out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i bytes = _mm_loadu_si128((const __m128i*)in);
+	__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+	__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+	out[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+	out[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+	out[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+	out[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+
+// accum = row * weight, or accum += row * weight when add is set (weight 1 adds the row as is)
+static void accumulate_row(const U8* row, F32* accum, S32 len, F32 weight, bool add)
+{
+	const __m128 w = _mm_set1_ps(weight);
+	const bool weighted = weight != 1.f;
+	S32 i = 0;
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128 v[4];
+		load16_ps(row + i, v);
+		for (S32 j = 0; j < 4; ++j)
+		{
+			__m128 term = weighted ? _mm_mul_ps(v[j], w) : v[j];
+			if (add)
+			{
+				term = _mm_add_ps(_mm_loadu_ps(accum + i + j * 4), term);
+			}
+			_mm_storeu_ps(accum + i + j * 4, term);
+		}
+	}
+	for (; i < len; ++i)
+	{
+		F32 term = weighted ? row[i] * weight : (F32)row[i];
+		accum[i] = add ? accum[i] + term : term;
+	}
+}
+
+static void store_row(const F32* accum, U8* row, S32 len, F32 norm_factor)
+{
+	const __m128 norm = _mm_set1_ps(norm_factor);
+	const __m128 half = _mm_set1_ps(.5f);
+	const __m128i mask = _mm_set1_epi32(0xff);
+	S32 i = 0;
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i v[4];
+		for (S32 j = 0; j < 4; ++j)
+		{
+			v[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(accum + i + j * 4), norm), half));
+			v[j] = _mm_and_si128(v[j], mask);
+		}
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+		_mm_storeu_si128((__m128i*)(row + i), packed);
+	}
+	for (; i < len; ++i)
+	{
+		row[i] = U8(ll_pos_round(accum[i] * norm_factor));
+	}
+}
+
+void copy_line_scaled(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+	llassert( components >= 1 && components <= 4 );
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	// This loop is awful.
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		// Sample input pixels in range from sample0 to sample1.
+		// Avoid floating point accumulation error... don't just add ratio each time.  JC
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// left integer (floor)
+		const S32 index1 = llfloor(sample1);			// right integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on left
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on right
+
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input pixel
+			S32 t0 = x * out_pixel_step * components;
+			S32 t1 = index0 * in_pixel_step * components;
+			U8* outp = out + t0;
+			const U8* inp = in + t1;
+			for (S32 i = 0; i < components; ++i)
+			{
+				*outp = *inp;
+				++outp;
+				++inp;
+			}
+		}
+		else
+		{
+			// Left straddle
+			__m128 sum = _mm_mul_ps(load_pixel_ps(in + index0 * in_pixel_step * components, components), _mm_set1_ps(fract0));
+
+			// Central interval
+			for( S32 u = index0 + 1; u < index1; u++ )
+			{
+				sum = _mm_add_ps(sum, load_pixel_ps(in + u * in_pixel_step * components, components));
+			}
+
+			// right straddle
+			// Watch out for reading off of end of input array.
+			if( fract1 && index1 < in_pixel_len )
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(load_pixel_ps(in + index1 * in_pixel_step * components, components), _mm_set1_ps(fract1)));
+			}
+
+			U32 arr = round_pixel_ps(sum, _mm_set1_ps(norm_factor));
+
+			S32 t4 = x * out_pixel_step * components;
+			memcpy(out + t4, &arr, sizeof(U8) * components);	/* Flawfinder: ignore */
+		}
+	}
+}
+
+void copy_line_scaled_scalar(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+	llassert( components >= 1 && components <= 4 );
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	S32 goff = components >= 2 ? 1 : 0;
+	S32 boff = components >= 3 ? 2 : 0;
+	// This loop is awful.
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		// Sample input pixels in range from sample0 to sample1.
+		// Avoid floating point accumulation error... don't just add ratio each time.  JC
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// left integer (floor)
+		const S32 index1 = llfloor(sample1);			// right integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on left
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on right
+
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input pixel
+			S32 t0 = x * out_pixel_step * components;
+			S32 t1 = index0 * in_pixel_step * components;
+			U8* outp = out + t0;
+			const U8* inp = in + t1;
+			for (S32 i = 0; i < components; ++i)
+			{
+				*outp = *inp;
+				++outp;
+				++inp;
+			}
+		}
+		else
+		{
+			// Left straddle
+			S32 t1 = index0 * in_pixel_step * components;
+			F32 r = in[t1 + 0] * fract0;
+			F32 g = in[t1 + goff] * fract0;
+			F32 b = in[t1 + boff] * fract0;
+			F32 a = 0;
+			if( components == 4)
+			{
+				a = in[t1 + 3] * fract0;
+			}
+		
+			// Central interval
+			if (components < 4)
+			{
+				for( S32 u = index0 + 1; u < index1; u++ )
+				{
+					S32 t2 = u * in_pixel_step * components;
+					r += in[t2 + 0];
+					g += in[t2 + goff];
+					b += in[t2 + boff];
+				}
+			}
+			else
+			{
+				for( S32 u = index0 + 1; u < index1; u++ )
+				{
+					S32 t2 = u * in_pixel_step * components;
+					r += in[t2 + 0];
+					g += in[t2 + 1];
+					b += in[t2 + 2];
+					a += in[t2 + 3];
+				}
+			}
+
+			// right straddle
+			// Watch out for reading off of end of input array.
+			if( fract1 && index1 < in_pixel_len )
+			{
+				S32 t3 = index1 * in_pixel_step * components;
+				if (components < 4)
+				{
+					U8 in0 = in[t3 + 0];
+					U8 in1 = in[t3 + goff];
+					U8 in2 = in[t3 + boff];
+					r += in0 * fract1;
+					g += in1 * fract1;
+					b += in2 * fract1;
+				}
+				else
+				{
+					U8 in0 = in[t3 + 0];
+					U8 in1 = in[t3 + 1];
+					U8 in2 = in[t3 + 2];
+					U8 in3 = in[t3 + 3];
+					r += in0 * fract1;
+					g += in1 * fract1;
+					b += in2 * fract1;
+					a += in3 * fract1;
+				}
+			}
+
+			U8 arr[] = {
+				U8(ll_pos_round(r * norm_factor)),
+				U8(ll_pos_round(g * norm_factor)),
+				U8(ll_pos_round(b * norm_factor)),
+				U8(ll_pos_round(a * norm_factor))
+			};  // skip conditional
+
+			S32 t4 = x * out_pixel_step * components;
+			memcpy(out + t4, arr, sizeof(U8) * components);	/* Flawfinder: ignore */
+		}
+	}
+}
+
+void copy_rows_scaled(const U8* in, U8* out, S32 in_row_count, S32 out_row_count, S32 row_len)
+{
+	const F32 ratio = F32(in_row_count) / out_row_count; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	std::vector<F32> accum(row_len);
+	for( S32 y = 0; y < out_row_count; y++ )
+	{
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// top integer (floor)
+		const S32 index1 = llfloor(sample1);			// bottom integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on top
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on bottom
+
+		U8* outp = out + y * row_len;
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input row
+			memcpy(outp, in + index0 * row_len, row_len);	/* Flawfinder: ignore */
+			continue;
+		}
+
+		accumulate_row(in + index0 * row_len, &accum[0], row_len, fract0, false);
+		for( S32 u = index0 + 1; u < index1; u++ )
+		{
+			accumulate_row(in + u * row_len, &accum[0], row_len, 1.f, true);
+		}
+		// Watch out for reading off of end of input array.
+		if( fract1 && index1 < in_row_count )
+		{
+			accumulate_row(in + index1 * row_len, &accum[0], row_len, fract1, true);
+		}
+		store_row(&accum[0], outp, row_len, norm_factor);
+	}
+}
+
+// Each byte of the rows is a column of its own: the filter treats every channel alike
+void copy_rows_scaled_scalar(const U8* in, U8* out, S32 in_row_count, S32 out_row_count, S32 row_len)
+{
+	for (S32 col = 0; col < row_len; ++col)
+	{
+		copy_line_scaled_scalar(in + col, out + col, in_row_count, out_row_count, row_len, row_len, 1);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+static void avg4_colors4(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
+{
+	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
+	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
+	dst[2] = (U8)(((U32)(a[2]) + b[2] + c[2] + d[2])>>2);
+	dst[3] = (U8)(((U32)(a[3]) + b[3] + c[3] + d[3])>>2);
+}
+
+static void avg4_colors3(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
+{
+	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
+	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
+	dst[2] = (U8)(((U32)(a[2]) + b[2] + c[2] + d[2])>>2);
+}
+
+static void avg4_colors2(const U8* a, const U8* b, const U8* c, const U8* d, U8* dst)
+{
+	dst[0] = (U8)(((U32)(a[0]) + b[0] + c[0] + d[0])>>2);
+	dst[1] = (U8)(((U32)(a[1]) + b[1] + c[1] + d[1])>>2);
+}
+
+// Sixteen bytes of each input row at a time.  There is no byte shuffle in SSE2,
+// so 3 channel images are left to the scalar code.
+S32 generate_mip_row_sse2(const U8* row0, const U8* row1, U8* out, S32 width, S32 nchannels)
+{
+	if (nchannels != 1 && nchannels != 2 && nchannels != 4)
+	{
+		return 0;
+	}
+	const S32 pixels_per_step = 8 / nchannels;
+	const __m128i zero = _mm_setzero_si128();
+	S32 w = 0;
+	for (; w + pixels_per_step <= width; w += pixels_per_step)
+	{
+		__m128i in0 = _mm_loadu_si128((const __m128i*)row0);
+		__m128i in1 = _mm_loadu_si128((const __m128i*)row1);
+		// Vertical sums of input bytes 0-7 and 8-15
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(in0, zero), _mm_unpacklo_epi8(in1, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(in0, zero), _mm_unpackhi_epi8(in1, zero));
+		// Add each pixel to its right neighbour and gather the sums
+		__m128i sums;
+		switch (nchannels)
+		{
+		  case 1:
+		  {
+			const __m128i mask = _mm_set1_epi32(0xffff);
+			lo = _mm_and_si128(_mm_add_epi16(lo, _mm_srli_epi32(lo, 16)), mask);
+			hi = _mm_and_si128(_mm_add_epi16(hi, _mm_srli_epi32(hi, 16)), mask);
+			sums = _mm_packs_epi32(lo, hi);
+			break;
+		  }
+		  case 2:
+			lo = _mm_shuffle_epi32(_mm_add_epi16(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			hi = _mm_shuffle_epi32(_mm_add_epi16(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			sums = _mm_unpacklo_epi64(lo, hi);
+			break;
+		  default:
+			lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+			sums = _mm_unpacklo_epi64(lo, hi);
+			break;
+		}
+		sums = _mm_srli_epi16(sums, 2);
+		_mm_storel_epi64((__m128i*)out, _mm_packus_epi16(sums, sums));
+		row0 += 16;
+		row1 += 16;
+		out += 8;
+	}
+	return w;
+}
+
+void generate_mip_row_scalar(const U8* row0, const U8* row1, U8* out, S32 width, S32 nchannels)
+{
+	for (S32 w = 0; w < width; w++)
+	{
+		switch(nchannels)
+		{
+		  case 4:
+			avg4_colors4(row0, row0+4, row1, row1+4, out);
+			break;
+		  case 3:
+			avg4_colors3(row0, row0+3, row1, row1+3, out);
+			break;
+		  case 2:
+			avg4_colors2(row0, row0+2, row1, row1+2, out);
+			break;
+		  case 1:
+			*out = (U8)(((U32)(row0[0]) + row0[1] + row1[0] + row1[1])>>2);
+			break;
+		  default:
+			LL_ERRS() << "generateMmip called with bad num channels" << LL_ENDL;
+		}
+		row0 += nchannels*2;
+		row1 += nchannels*2;
+		out += nchannels;
+	}
+}
@@ -0,0 +1,90 @@
+/**
+ * @file llimagefilters.h
+ * @brief Row kernels of the image scaling filters and of the software mip generation.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLIMAGEFILTERS_H
+#define LL_LLIMAGEFILTERS_H
+
+#include <emmintrin.h>
+#include <string.h>
+
+//
+// The area filter behind LLImageRaw::scale(), copyScaled() and
+// compositeScaled4onto3(), and the box filter behind LLImageBase::generateMip().
+// The viewer requires SSE2, so the SSE2 versions are used unconditionally.
+// They do the same float or integer operations as the scalar versions, in the
+// same order, one lane per channel or byte, so the results must match the
+// scalar versions byte for byte.  The scalar versions are kept as the
+// reference for tests/llimagefilters_test.cpp.
+//
+
+// Up to four bytes of one pixel as floats; lanes past the last component are zero
+inline __m128 load_pixel_ps(const U8* in, S32 components)
+{
+	U32 packed;
+	switch (components)
+	{
+	  case 4:
+		memcpy(&packed, in, 4);		/* Flawfinder: ignore */
+		break;
+	  case 3:
+		packed = in[0] | (in[1] << 8) | (in[2] << 16);
+		break;
+	  case 2:
+		packed = in[0] | (in[1] << 8);
+		break;
+	  default:
+		packed = in[0];
+		break;
+	}
+	const __m128i zero = _mm_setzero_si128();
+	__m128i bytes = _mm_cvtsi32_si128(packed);
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+// Same as U8(ll_pos_round(sum * norm_factor)) per lane, packed into the low bytes
+inline U32 round_pixel_ps(__m128 sum, __m128 norm_factor)
+{
+	__m128i rounded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum, norm_factor), _mm_set1_ps(.5f)));
+	// U8() wraps, mask before packing so that saturation never kicks in
+	rounded = _mm_and_si128(rounded, _mm_set1_epi32(0xff));
+	rounded = _mm_packs_epi32(rounded, rounded);
+	return (U32)_mm_cvtsi128_si32(_mm_packus_epi16(rounded, rounded));
+}
+
+// Resample in_pixel_len pixels of components bytes to out_pixel_len; the steps
+// are in pixels, so a column can be scaled with the row width as step
+void copy_line_scaled(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components);
+void copy_line_scaled_scalar(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components);
+
+// Same filter as copy_line_scaled() down every column at once; in and out hold whole rows of row_len bytes
+void copy_rows_scaled(const U8* in, U8* out, S32 in_row_count, S32 out_row_count, S32 row_len);
+void copy_rows_scaled_scalar(const U8* in, U8* out, S32 in_row_count, S32 out_row_count, S32 row_len);
+
+// Box filter the start of one mip row of width pixels from the input rows row0
+// and row1, each 2*width pixels wide.  Returns the number of output pixels done;
+// the rest is left to generate_mip_row_scalar().  3 channels are not handled.
+S32 generate_mip_row_sse2(const U8* row0, const U8* row1, U8* out, S32 width, S32 nchannels);
+void generate_mip_row_scalar(const U8* row0, const U8* row1, U8* out, S32 width, S32 nchannels);
+
+#endif // LL_LLIMAGEFILTERS_H
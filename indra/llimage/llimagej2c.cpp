@@ -55,6 +55,8 @@ apr_dso_handle_t *j2cimpl_dso_handle;
 LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl();
 void fallbackDestroyLLImageJ2CImpl(LLImageJ2CImpl* impl);
 const char* fallbackEngineInfoLLImageJ2CImpl();
+void fallbackStartDecodeThreadsLLImageJ2CImpl(S32 count);
+void fallbackStopDecodeThreadsLLImageJ2CImpl();
 
 //static
 //Loads the required "create", "destroy" and "engineinfo" functions needed
@@ -175,11 +177,28 @@ std::string LLImageJ2C::getEngineInfo()
 	return j2cimpl_engineinfo_func();
 }
 
+//static
+void LLImageJ2C::startDecodeThreads(S32 count)
+{
+	// Only the built-in codec knows how to split a decode up
+	if (!j2cimpl_create_func || j2cimpl_create_func == fallbackCreateLLImageJ2CImpl)
+	{
+		fallbackStartDecodeThreadsLLImageJ2CImpl(count);
+	}
+}
+
+//static
+void LLImageJ2C::stopDecodeThreads()
+{
+	fallbackStopDecodeThreadsLLImageJ2CImpl();
+}
+
 LLImageJ2C::LLImageJ2C() : 	LLImageFormatted(IMG_CODEC_J2C),
 							mMaxBytes(0),
 							mRawDiscardLevel(-1),
 							mRate(0.0f),
 							mReversible(FALSE),
+							mIncrementalDecode(false),
 							mAreaUsedForDataSizeCalcs(0)
 {
 	//We assume here that if we wanted to create via
@@ -66,12 +66,23 @@ public:
 	void setMaxBytes(S32 max_bytes);
 	S32 getMaxBytes() const { return mMaxBytes; }
 
+	// Keep the decoder state between decodes, so that decoding again with more data or at a
+	// lower discard level only redoes the parts of the codestream that changed.
+	// Costs memory until the image reaches discard 0 or is deleted.
+	void setIncrementalDecode(bool incremental) { mIncrementalDecode = incremental; }
+	bool getIncrementalDecode() const { return mIncrementalDecode; }
+
 	static S32 calcHeaderSizeJ2C();
 	static S32 calcDataSizeJ2C(S32 w, S32 h, S32 comp, S32 discard_level, F32 rate = 0.f);
 
 	static void openDSO();
 	static void closeDSO();
 	static std::string getEngineInfo();
+
+	// Number of shared pool workers (LLThreadPool::startShared) that help decode the code-blocks
+	// of one large image.  A negative count picks a default; 0 decodes on the calling thread only.
+	static void startDecodeThreads(S32 count);
+	static void stopDecodeThreads();
 	
 protected:
 	friend class LLImageJ2CImpl;
@@ -86,6 +97,7 @@ protected:
 	S8  mRawDiscardLevel;
 	F32 mRate;
 	BOOL mReversible;
+	bool mIncrementalDecode;
 	LLImageJ2CImpl *mImpl;
 	std::string mLastError;
 };
@@ -28,42 +28,147 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "lltimer.h"
+
+#include <algorithm>
+#include <boost/thread/thread.hpp>
 
 //----------------------------------------------------------------------------
 
+// Number of recent requests the latency percentiles are taken over
+static const U32 LATENCY_SAMPLES = 256;
+static const S32 MAX_DECODE_THREADS = 4;
+
+// Extra decode thread, taking requests from the queue of its LLImageDecodeThread
+class LLImageDecodeThread::DecodeHelper : public LLThread
+{
+public:
+	DecodeHelper(LLImageDecodeThread* parent, S32 index)
+	:	LLThread(llformat("imagedecode %d", index)),
+		mParent(parent)
+	{
+	}
+
+protected:
+	/*virtual*/ void run()
+	{
+		mParent->runHelper(this);
+	}
+
+private:
+	LLImageDecodeThread* mParent;
+};
+
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, S32 num_threads)
+	: LLQueuedThread("imagedecode", threaded),
+	  mHelpersQuitting(false),
+	  mLatencyIndex(0)
 {
 	mCreationMutex = new LLMutex();
+	mHelperCondition = new LLCondition();
+	mLatencyMutex = new LLMutex();
+	mLatencies.reserve(LATENCY_SAMPLES);
+
+	if (num_threads < 0)
+	{
+		num_threads = llclamp((S32)boost::thread::hardware_concurrency() - 1, 1, MAX_DECODE_THREADS);
+	}
+	if (threaded)
+	{
+		LL_INFOS() << "Image decode threads: " << num_threads << LL_ENDL;
+		for (S32 i = 1; i < num_threads; ++i)
+		{
+			mHelpers.push_back(new DecodeHelper(this, i));
+			mHelpers.back()->start();
+		}
+	}
 }
 
 //virtual 
 LLImageDecodeThread::~LLImageDecodeThread()
 {
+	stopHelpers();
 	delete mCreationMutex ;
+	delete mHelperCondition;
+	delete mLatencyMutex;
+}
+
+//virtual
+void LLImageDecodeThread::shutdown()
+{
+	// The helpers use the request queue, stop them before it gets emptied
+	stopHelpers();
+	LLQueuedThread::shutdown();
+}
+
+void LLImageDecodeThread::stopHelpers()
+{
+	if (mHelpers.empty())
+	{
+		return;
+	}
+	mHelperCondition->lock();
+	mHelpersQuitting = true;
+	mHelperCondition->broadcast();
+	mHelperCondition->unlock();
+
+	for (std::vector<DecodeHelper*>::iterator iter = mHelpers.begin(); iter != mHelpers.end(); ++iter)
+	{
+		(*iter)->shutdown();
+		delete *iter;
+	}
+	mHelpers.clear();
+}
+
+// HELPER THREAD
+void LLImageDecodeThread::runHelper(DecodeHelper* helper)
+{
+	while (true)
+	{
+		mHelperCondition->lock();
+		while (!mHelpersQuitting && getPending() == 0)
+		{
+			mHelperCondition->wait();
+		}
+		bool quitting = mHelpersQuitting;
+		mHelperCondition->unlock();
+		if (quitting)
+		{
+			break;
+		}
+		processNextRequest();
+	}
 }
 
 // MAIN THREAD
 // virtual
 S32 LLImageDecodeThread::update(F32 max_time_ms)
 {
-	LLMutexLock lock(mCreationMutex);
-	for (creation_list_t::iterator iter = mCreationList.begin();
-		 iter != mCreationList.end(); ++iter)
 	{
-		creation_info& info = *iter;
-		ImageRequest* req = new ImageRequest(info.handle, info.image,
-						     info.priority, info.discard, info.needs_aux,
-						     info.responder);
+		LLMutexLock lock(mCreationMutex);
+		for (creation_list_t::iterator iter = mCreationList.begin();
+			 iter != mCreationList.end(); ++iter)
+		{
+			creation_info& info = *iter;
+			ImageRequest* req = new ImageRequest(info.handle, info.image,
+							     info.priority, info.discard, info.needs_aux,
+							     info.responder, this, info.queued_time);
 
-		bool res = addRequest(req);
-		if (!res)
+			bool res = addRequest(req);
+			if (!res)
+			{
+				LL_ERRS() << "request added after LLLFSThread::cleanupClass()" << LL_ENDL;
+			}
+		}
+		if (!mCreationList.empty() && !mHelpers.empty())
 		{
-			LL_ERRS() << "request added after LLLFSThread::cleanupClass()" << LL_ENDL;
+			mHelperCondition->lock();
+			mHelperCondition->broadcast();
+			mHelperCondition->unlock();
 		}
+		mCreationList.clear();
 	}
-	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
 	return res;
 }
@@ -73,10 +178,88 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(LLImageFormatted*
 {
 	LLMutexLock lock(mCreationMutex);
 	handle_t handle = generateHandle();
-	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder));
+	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder, totalTime()));
 	return handle;
 }
 
+void LLImageDecodeThread::setDecodePriority(handle_t handle, U32 priority)
+{
+	{
+		LLMutexLock lock(mCreationMutex);
+		for (creation_list_t::iterator iter = mCreationList.begin(); iter != mCreationList.end(); ++iter)
+		{
+			if (iter->handle == handle)
+			{
+				iter->priority = priority;
+				return;
+			}
+		}
+	}
+	// Only moves requests that are still queued, with the others at the next update()
+	queuePriority(handle, priority);
+}
+
+void LLImageDecodeThread::cancelDecode(handle_t handle)
+{
+	{
+		LLMutexLock lock(mCreationMutex);
+		for (creation_list_t::iterator iter = mCreationList.begin(); iter != mCreationList.end(); ++iter)
+		{
+			if (iter->handle == handle)
+			{
+				mCreationList.erase(iter);
+				return;
+			}
+		}
+	}
+	abortRequest(handle, false);
+}
+
+S32 LLImageDecodeThread::getQueueDepth()
+{
+	S32 creating;
+	{
+		LLMutexLock lock(mCreationMutex);
+		creating = mCreationList.size();
+	}
+	return creating + getPending();
+}
+
+// ANY THREAD
+void LLImageDecodeThread::recordLatency(U64 queued_time)
+{
+	F32 latency_ms = (F32)(totalTime() - queued_time) / 1000.f;
+	LLMutexLock lock(mLatencyMutex);
+	if (mLatencies.size() < LATENCY_SAMPLES)
+	{
+		mLatencies.push_back(latency_ms);
+	}
+	else
+	{
+		mLatencies[mLatencyIndex] = latency_ms;
+		mLatencyIndex = (mLatencyIndex + 1) % LATENCY_SAMPLES;
+	}
+}
+
+void LLImageDecodeThread::getLatencyPercentiles(F32& p50_ms, F32& p90_ms, F32& p99_ms)
+{
+	std::vector<F32> latencies;
+	{
+		LLMutexLock lock(mLatencyMutex);
+		latencies = mLatencies;
+	}
+	if (latencies.empty())
+	{
+		p50_ms = p90_ms = p99_ms = 0.f;
+		return;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	size_t last = latencies.size() - 1;
+	p50_ms = latencies[last * 50 / 100];
+	p90_ms = latencies[last * 90 / 100];
+	p99_ms = latencies[last * 99 / 100];
+}
+
 // Used by unit test only
 // Returns the size of the mutex guarded list as an indication of sanity
 S32 LLImageDecodeThread::tut_size()
@@ -94,14 +277,17 @@ LLImageDecodeThread::Responder::~Responder()
 
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder,
+												LLImageDecodeThread* thread, U64 queued_time)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
-	  mResponder(responder)
+	  mResponder(responder),
+	  mThread(thread),
+	  mQueuedTime(queued_time)
 {
 }
 
@@ -163,6 +349,10 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 
 void LLImageDecodeThread::ImageRequest::finishRequest(bool completed)
 {
+	if (completed && mThread)
+	{
+		mThread->recordLatency(mQueuedTime);
+	}
 	if (mResponder.notNull())
 	{
 		bool success = completed && mDecodedRaw && mDecodedImageRaw->getDataSize() && (!mNeedsAux || mDecodedAux);
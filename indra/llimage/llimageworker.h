@@ -50,7 +50,8 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder,
+					 LLImageDecodeThread* thread = NULL, U64 queued_time = 0);
 
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
@@ -69,21 +70,44 @@ public:
 		BOOL mDecodedRaw;
 		BOOL mDecodedAux;
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
+		// stats
+		LLImageDecodeThread* mThread;
+		U64 mQueuedTime;
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// With num_threads > 1 (and threaded), that many threads take requests from the
+	// same priority queue; this one plus num_threads - 1 helpers. -1 picks one per spare CPU core.
+	LLImageDecodeThread(bool threaded = true, S32 num_threads = 1);
 	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
 
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(F32 max_time_ms);
 
+	// Change the priority of a decode that did not start yet (MAIN THREAD)
+	void setDecodePriority(handle_t handle, U32 priority);
+	// Drop a decode that did not start yet; its responder is not called
+	void cancelDecode(handle_t handle);
+
+	// Requests waiting for a decode thread
+	S32 getQueueDepth();
+	S32 getNumThreads() const { return mHelpers.size() + 1; }
+	// Time from decodeImage() to completion, over the last requests
+	void getLatencyPercentiles(F32& p50_ms, F32& p90_ms, F32& p99_ms);
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	class DecodeHelper;
+	friend class DecodeHelper;
+	void runHelper(DecodeHelper* helper);
+	void stopHelpers();
+	void recordLatency(U64 queued_time);
+
 	struct creation_info
 	{
 		handle_t handle;
@@ -92,13 +116,22 @@ private:
 		S32 discard;
 		BOOL needs_aux;
 		LLPointer<Responder> responder;
-		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r)
-			: handle(h), image(i), priority(p), discard(d), needs_aux(aux), responder(r)
+		U64 queued_time;
+		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r, U64 t)
+			: handle(h), image(i), priority(p), discard(d), needs_aux(aux), responder(r), queued_time(t)
 		{}
 	};
 	typedef std::list<creation_info> creation_list_t;
 	creation_list_t mCreationList;
 	LLMutex* mCreationMutex;
+
+	std::vector<DecodeHelper*> mHelpers;
+	LLCondition* mHelperCondition;	// signalled when requests are added
+	bool mHelpersQuitting;
+
+	LLMutex* mLatencyMutex;
+	std::vector<F32> mLatencies;	// ring buffer, ms
+	U32 mLatencyIndex;
 };
 
 #endif
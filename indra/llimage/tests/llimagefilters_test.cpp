@@ -0,0 +1,177 @@
+/**
+ * @file llimagefilters_test.cpp
+ * @brief Tests of the SSE2 image filter kernels against their scalar reference
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llimagefilters.h"
+#include "llmath.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct imagefilters_data
+	{
+		imagefilters_data()
+		:	mSeed(12345)
+		{
+		}
+
+		// Same bytes on every run, with 0 and 255 showing up often enough to hit the extremes
+		void fill(std::vector<U8>& buffer)
+		{
+			for (U32 i = 0; i < buffer.size(); ++i)
+			{
+				mSeed = mSeed * 1103515245 + 12345;
+				U32 value = (mSeed >> 16) & 0x1ff;
+				buffer[i] = value >= 0x180 ? 255 : (value >= 0x100 ? 0 : (U8)value);
+			}
+		}
+
+		void ensureSame(const std::string& msg, const std::vector<U8>& simd, const std::vector<U8>& scalar)
+		{
+			ensure_equals(msg + " size", simd.size(), scalar.size());
+			for (U32 i = 0; i < simd.size(); ++i)
+			{
+				if (simd[i] != scalar[i])
+				{
+					ensure_equals(llformat("%s byte %d", msg.c_str(), i), (S32)simd[i], (S32)scalar[i]);
+				}
+			}
+		}
+
+		U32 mSeed;
+	};
+	typedef test_group<imagefilters_data> imagefilters_test;
+	typedef imagefilters_test::object imagefilters_object;
+	tut::imagefilters_test imagefilters_testcase("LLImageFilters");
+
+	// Odd sizes leave a tail past the last full SSE2 step
+	static const S32 sLengths[] = { 1, 2, 3, 5, 7, 8, 9, 15, 16, 17, 31, 33, 64, 101 };
+	static const S32 sNumLengths = sizeof(sLengths) / sizeof(sLengths[0]);
+
+	template<> template<>
+	void imagefilters_object::test<1>()
+	{
+		// round_pixel_ps() rounds and wraps each lane like U8(ll_pos_round())
+		const F32 norm_factors[] = { 1.f, 0.5f, 1.f / 3.f, 0.3f, 2.f / 7.f, 1.5f };
+		for (U32 n = 0; n < sizeof(norm_factors) / sizeof(norm_factors[0]); ++n)
+		{
+			for (S32 i = 0; i < 1024; ++i)
+			{
+				F32 sums[4] = { (F32)i, i + 0.25f, i + 0.5f, i * 0.37f };
+				U32 packed = round_pixel_ps(_mm_loadu_ps(sums), _mm_set1_ps(norm_factors[n]));
+				for (S32 lane = 0; lane < 4; ++lane)
+				{
+					ensure_equals(llformat("sum %f norm %f", sums[lane], norm_factors[n]),
+								  (S32)(U8)(packed >> (lane * 8)), (S32)U8(ll_pos_round(sums[lane] * norm_factors[n])));
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagefilters_object::test<2>()
+	{
+		// copy_line_scaled() up and down, along a row and down a column, for every component count
+		for (S32 components = 1; components <= 4; ++components)
+		{
+			for (S32 i = 0; i < sNumLengths; ++i)
+			{
+				for (S32 o = 0; o < sNumLengths; ++o)
+				{
+					S32 in_len = sLengths[i];
+					S32 out_len = sLengths[o];
+					for (S32 step = 1; step <= 3; step += 2)
+					{
+						std::vector<U8> in(in_len * step * components);
+						fill(in);
+						std::vector<U8> simd(out_len * step * components, 0);
+						std::vector<U8> scalar(simd.size(), 0);
+						copy_line_scaled(&in[0], &simd[0], in_len, out_len, step, step, components);
+						copy_line_scaled_scalar(&in[0], &scalar[0], in_len, out_len, step, step, components);
+						ensureSame(llformat("%d components, %d to %d pixels, step %d", components, in_len, out_len, step), simd, scalar);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagefilters_object::test<3>()
+	{
+		// copy_rows_scaled() over whole rows of odd widths, for every component count
+		for (S32 components = 1; components <= 4; ++components)
+		{
+			for (S32 w = 0; w < sNumLengths; ++w)
+			{
+				S32 row_len = sLengths[w] * components;
+				for (S32 i = 0; i < sNumLengths; ++i)
+				{
+					for (S32 o = 0; o < sNumLengths; ++o)
+					{
+						S32 in_rows = sLengths[i];
+						S32 out_rows = sLengths[o];
+						std::vector<U8> in(in_rows * row_len);
+						fill(in);
+						std::vector<U8> simd(out_rows * row_len, 0);
+						std::vector<U8> scalar(simd.size(), 0);
+						copy_rows_scaled(&in[0], &simd[0], in_rows, out_rows, row_len);
+						copy_rows_scaled_scalar(&in[0], &scalar[0], in_rows, out_rows, row_len);
+						ensureSame(llformat("%d components, width %d, %d to %d rows", components, sLengths[w], in_rows, out_rows), simd, scalar);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagefilters_object::test<4>()
+	{
+		// generate_mip_row_sse2() and the scalar tail give the scalar row, for every channel count
+		for (S32 nchannels = 1; nchannels <= 4; ++nchannels)
+		{
+			for (S32 w = 0; w < sNumLengths; ++w)
+			{
+				S32 width = sLengths[w];
+				std::vector<U8> row0(width * 2 * nchannels);
+				std::vector<U8> row1(row0.size());
+				fill(row0);
+				fill(row1);
+				std::vector<U8> simd(width * nchannels, 0);
+				std::vector<U8> scalar(simd.size(), 0);
+
+				S32 done = generate_mip_row_sse2(&row0[0], &row1[0], &simd[0], width, nchannels);
+				ensure(llformat("%d channels, width %d: done in range", nchannels, width), done >= 0 && done <= width);
+				if (nchannels == 3)
+				{
+					ensure_equals("3 channels are left to the scalar code", done, 0);
+				}
+				generate_mip_row_scalar(&row0[0] + done * 2 * nchannels, &row1[0] + done * 2 * nchannels, &simd[0] + done * nchannels, width - done, nchannels);
+
+				generate_mip_row_scalar(&row0[0], &row1[0], &scalar[0], width, nchannels);
+				ensureSame(llformat("%d channels, width %d", nchannels, width), simd, scalar);
+			}
+		}
+	}
+}
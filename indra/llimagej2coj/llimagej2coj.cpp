@@ -30,9 +30,13 @@
 // this is defined so that we get static linking.
 #include "openjpeg.h"
 
+#include "llatomic.h"
+#include "llthreadpool.h"
 #include "lltimer.h"
 //#include "llmemory.h"
 
+#include <boost/bind.hpp>
+
 // Factory function: see declaration in llimagej2c.cpp
 LLImageJ2CImpl* fallbackCreateLLImageJ2CImpl()
 {
@@ -96,15 +100,99 @@ int ceildivpow2(int a, int b)
 	return (a + (1 << b) - 1) >> b;
 }
 
+// More threads than this stop paying off: the wavelet transform and the
+// colour conversion that follow the code-block decoding are serial.
+static const S32 MAX_DECODE_THREADS = 3;
+// Below this many code-blocks waking the workers costs more than it saves
+static const S32 MIN_PARALLEL_JOBS = 16;
+
+// Shared pool workers that help with the code-blocks of one image, 0 when the
+// decoding thread does them all
+static S32 sDecodeHelpers = 0;
+
+static void run_j2c_job(opj_job_fn job, void* job_data, S32 index, S32 thread_index)
+{
+	job(job_data, index, thread_index);
+}
+
+//
+// Runs the tier-1 jobs that OpenJPEG hands to opj_parallel_for_fn: the
+// independent code-blocks of one tile.  The decoding thread takes part as
+// thread index 0, the shared pool workers use 1..sDecodeHelpers.  Several
+// decode threads can each borrow workers at once; encodes use the same path
+// for their code-blocks.
+//
+static void j2c_parallel_for(void*, int count, opj_job_fn job, void* job_data)
+{
+	LLThreadPool* pool = LLThreadPool::getShared();
+	if (count < MIN_PARALLEL_JOBS || !pool)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			job(job_data, i, 0);
+		}
+		return;
+	}
+
+	// Every job is done when this returns, before OpenJPEG goes on with the tile
+	pool->parallelFor(count, sDecodeHelpers + 1, boost::bind(run_j2c_job, job, job_data, _1, _2));
+}
+
+static bool use_parallel_for()
+{
+	return sDecodeHelpers > 0 && LLThreadPool::getShared();
+}
+
+void fallbackStopDecodeThreadsLLImageJ2CImpl()
+{
+	sDecodeHelpers = 0;
+}
+
+void fallbackStartDecodeThreadsLLImageJ2CImpl(S32 count)
+{
+	if (count < 0)
+	{
+		count = MAX_DECODE_THREADS;
+	}
+	sDecodeHelpers = llclamp(count, 0, MAX_DECODE_THREADS);
+	if (LLThreadPool* pool = LLThreadPool::getShared())
+	{
+		sDecodeHelpers = llmin(sDecodeHelpers, pool->getWorkerCount());
+	}
+	else
+	{
+		sDecodeHelpers = 0;
+	}
+	LL_INFOS() << "JPEG2000 decode helper threads: " << sDecodeHelpers << LL_ENDL;
+}
+
+
+// Incremental decoding stops being worth it beyond this much memory
+static const S32 MAX_CODE_BLOCK_CACHE_BYTES = 64 * 1024 * 1024;
+static LLAtomicS32 sCodeBlockCacheBytes(0);	// held by all images
 
 LLImageJ2COJ::LLImageJ2COJ()
-	: LLImageJ2CImpl()
+	: LLImageJ2CImpl(),
+	mCodeBlockCache(NULL),
+	mCodeBlockCacheSize(0)
 {
 }
 
 
 LLImageJ2COJ::~LLImageJ2COJ()
 {
+	releaseCodeBlockCache();
+}
+
+void LLImageJ2COJ::releaseCodeBlockCache()
+{
+	if (mCodeBlockCache)
+	{
+		opj_destroy_cblk_cache(mCodeBlockCache);
+		mCodeBlockCache = NULL;
+		sCodeBlockCacheBytes -= mCodeBlockCacheSize;
+		mCodeBlockCacheSize = 0;
+	}
 }
 
 
@@ -204,6 +292,19 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	/* setup the decoder decoding parameters using user parameters */
 	opj_setup_decoder(dinfo, &parameters);
 
+	if (use_parallel_for())
+	{
+		opj_set_decode_parallel_for(dinfo, j2c_parallel_for, sDecodeHelpers + 1, NULL);
+	}
+
+	// Nothing left to refine once we decode at full resolution
+	if (base.getIncrementalDecode() && parameters.cp_reduce > 0 && !mCodeBlockCache &&
+		sCodeBlockCacheBytes < MAX_CODE_BLOCK_CACHE_BYTES)
+	{
+		mCodeBlockCache = opj_create_cblk_cache();
+	}
+	opj_set_decode_cblk_cache(dinfo, mCodeBlockCache);
+
 	/* open a byte stream */
 	cio = opj_cio_open((opj_common_ptr)dinfo, base.getData(), base.getDataSize());
 
@@ -219,6 +320,20 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		opj_destroy_decompress(dinfo);
 	}
 
+	if (mCodeBlockCache)
+	{
+		if (parameters.cp_reduce == 0 || !base.getIncrementalDecode() || sCodeBlockCacheBytes > MAX_CODE_BLOCK_CACHE_BYTES)
+		{
+			releaseCodeBlockCache();
+		}
+		else
+		{
+			S32 size = opj_cblk_cache_size(mCodeBlockCache);
+			sCodeBlockCacheBytes += size - mCodeBlockCacheSize;
+			mCodeBlockCacheSize = size;
+		}
+	}
+
 	// The image decode failed if the return was NULL or the component
 	// count was zero.  The latter is just a sanity check before we
 	// dereference the array.
@@ -356,6 +471,10 @@ BOOL LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
                 parameters.tcp_rates[3] = 30.0f;
 		parameters.tcp_rates[4] = 10.0f;
 		parameters.irreversible = 1;
+		// Resolution first, like the KDU based encoder: a
+		// partial download then holds every layer of the lower resolutions,
+		// which keeps them unchanged when more data arrives.
+		parameters.prog_order = RPCL;
 		if (raw_image.getComponents() >= 3)
 		{
 			parameters.tcp_mct = 1;
@@ -432,6 +551,12 @@ BOOL LLImageJ2COJ::encodeImpl(LLImageJ2C &base, const LLImageRaw &raw_image, con
 	/* setup the encoder parameters using the current image and using user parameters */
 	opj_setup_encoder(cinfo, &parameters, image);
 
+	// Uploads convert on shared pool jobs; the tier-1 coding can still borrow other workers
+	if (use_parallel_for())
+	{
+		opj_set_encode_parallel_for(cinfo, j2c_parallel_for, sDecodeHelpers + 1, NULL);
+	}
+
 	/* open a byte stream for writing */
 	/* allocate memory for all tiles */
 	cio = opj_cio_open((opj_common_ptr)cinfo, nullptr, 0);
@@ -35,6 +35,8 @@
 
 #include "llimagej2c.h"
 
+struct opj_cblk_cache;
+
 class LLImageJ2COJ : public LLImageJ2CImpl
 {	
 public:
@@ -52,6 +54,12 @@ protected:
 		return (a + (1 << b) - 1) >> b;
 	}
 
+private:
+	void releaseCodeBlockCache();
+
+	// Decoded code-blocks of the last decode, when incremental decoding is on
+	struct opj_cblk_cache* mCodeBlockCache;
+	S32 mCodeBlockCacheSize;
 };
 
 #endif
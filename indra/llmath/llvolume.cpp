@@ -51,6 +51,8 @@
 #include "llvector4a.h"
 #include "lltimer.h"
 
+#include <emmintrin.h>
+
 #define DEBUG_SILHOUETTE_BINORMALS 0
 #define DEBUG_SILHOUETTE_NORMALS 0 // TomY: Use this to display normals using the silhouette
 #define DEBUG_SILHOUETTE_EDGE_MAP 0 // DaveP: Use this to display edge map using the silhouette
@@ -2369,6 +2371,54 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 	return retval;
 }
 
+// out[j] = in[j] / 65535 * scale + offset for count packed U16 triplets, w = 0 / 65535 * scale.w + offset.w,
+// the same arithmetic as LLVector4a::set(x, y, z), div(), mul() and add(). Each triplet is read with one
+// 8 byte load and widened in registers instead of three scalar conversions; the last one is read on its
+// own so as not to read past the end of in.
+static void dequantize_u16x3(const U16* in, U32 count, const LLVector4a& scale, const LLVector4a& offset, LLVector4a* out)
+{
+	const __m128i mask = _mm_set_epi32(0, -1, -1, -1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 max = _mm_set1_ps(65535.f);
+	const LLQuad scale4 = scale;
+	const LLQuad offset4 = offset;
+	for (U32 j = 0; j + 1 < count; ++j, in += 3)
+	{
+		__m128i v = _mm_loadl_epi64((const __m128i*) in);
+		v = _mm_and_si128(_mm_unpacklo_epi16(v, zero), mask);
+		out[j] = _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(v), max), scale4), offset4);
+	}
+	LLVector4a& last = out[count - 1];
+	last.set((F32) in[0], (F32) in[1], (F32) in[2]);
+	last.div(65535.f);
+	last.mul(scale);
+	last.add(offset);
+}
+
+// Same for texture coordinates, two vertices (four U16) per LLVector4a. An odd last vertex
+// gets zeros in its second half before scaling.
+static void dequantize_u16x2(const U16* in, U32 count, const LLVector4a& scale, const LLVector4a& offset, LLVector4a* out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 max = _mm_set1_ps(65535.f);
+	const LLQuad scale4 = scale;
+	const LLQuad offset4 = offset;
+	const U32 pairs = count / 2;
+	for (U32 j = 0; j < pairs; ++j, in += 4)
+	{
+		__m128i v = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*) in), zero);
+		out[j] = _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(v), max), scale4), offset4);
+	}
+	if (count & 1)
+	{
+		LLVector4a& last = out[pairs];
+		last.set((F32) in[0], (F32) in[1], 0.f, 0.f);
+		last.div(65535.f);
+		last.mul(scale);
+		last.add(offset);
+	}
+}
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	//input stream is now pointing at a zlib compressed block of LLSD
@@ -2458,33 +2508,15 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 			LLVector4a* norm_out = face.mNormals;
 			LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
 
+			if (num_verts)
 			{
-				U16* v = (U16*) &(pos[0]);
-				for (U32 j = 0; j < num_verts; ++j)
-				{
-					pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
-					pos_out->div(65535.f);
-					pos_out->mul(pos_range);
-					pos_out->add(min_pos);
-					pos_out++;
-					v += 3;
-				}
-
+				dequantize_u16x3((const U16*) &(pos[0]), num_verts, pos_range, min_pos, pos_out);
 			}
 
 			{
 				if (!norm.empty())
 				{
-					U16* n = (U16*) &(norm[0]);
-					for (U32 j = 0; j < num_verts; ++j)
-					{
-						norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
-						norm_out->div(65535.f);
-						norm_out->mul(2.f);
-						norm_out->sub(1.f);
-						norm_out++;
-						n += 3;
-					}
+					dequantize_u16x3((const U16*) &(norm[0]), num_verts, LLVector4a(2.f), LLVector4a(-1.f), norm_out);
 				}
 				else
 				{
@@ -2495,26 +2527,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 			{
 				if (!tc.empty())
 				{
-					U16* t = (U16*) &(tc[0]);
-					for (U32 j = 0; j < num_verts; j+=2)
-					{
-						if (j < num_verts-1)
-						{
-							tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
-						}
-						else
-						{
-							tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
-						}
-
-						t += 4;
-
-						tc_out->div(65535.f);
-						tc_out->mul(tc_range);
-						tc_out->add(min_tc4);
-
-						tc_out++;
-					}
+					dequantize_u16x2((const U16*) &(tc[0]), num_verts, tc_range, min_tc4, tc_out);
 				}
 				else
 				{
@@ -98,7 +98,7 @@ void ll_debug_socket(const char* msg, apr_socket_t* apr_sock)
 ///
 
 // static
-LLSocket::ptr_t LLSocket::create(EType type, U16 port)
+LLSocket::ptr_t LLSocket::create(EType type, U16 port, const char* address)
 {
 	apr_status_t status = APR_EGENERAL;
 	LLSocket::ptr_t rv(new LLSocket);
@@ -127,7 +127,7 @@ LLSocket::ptr_t LLSocket::create(EType type, U16 port)
 		apr_sockaddr_t* sa = NULL;
 		status = apr_sockaddr_info_get(
 			&sa,
-			APR_ANYADDR,
+			address ? address : APR_ANYADDR,
 			APR_UNSPEC,
 			port,
 			0,
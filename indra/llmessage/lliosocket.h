@@ -90,11 +90,14 @@ public:
 	 * PORT_EPHEMERAL.
 	 * @param type The type of socket to create
 	 * @param port The port for the socket
+	 * @param address The local address to bind to, NULL for all of them.
+	 * Ignored for PORT_EPHEMERAL.
 	 * @return A valid socket shared pointer if the call worked.
 	 */
 	static ptr_t create(
 		EType type,
-		U16 port = PORT_EPHEMERAL);
+		U16 port = PORT_EPHEMERAL,
+		const char* address = NULL);
 
 	/** 
 	 * @brief Create a LLSocket by accepting a connection from a listen socket.
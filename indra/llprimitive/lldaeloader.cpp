@@ -1372,7 +1372,7 @@ void LLDAELoader::processDomModel(LLModel* model, DAE* dae, daeElement* root, do
 							{
 								name = joint_found->second;
 							}
-							model->mSkinInfo.mJointNames.push_back(name);
+							model->mSkinInfo.mJointNames.push_back(LLMeshJointName(name));
 							model->mSkinInfo.mJointNums.push_back(-1);
 						}
 					}
@@ -1387,7 +1387,7 @@ void LLDAELoader::processDomModel(LLModel* model, DAE* dae, daeElement* root, do
 							{
 								name = joint_found->second;
 							}
-							model->mSkinInfo.mJointNames.push_back(name);
+							model->mSkinInfo.mJointNames.push_back(LLMeshJointName(name));
 							model->mSkinInfo.mJointNums.push_back(-1);
 						}
 					}
@@ -1479,7 +1479,7 @@ void LLDAELoader::processDomModel(LLModel* model, DAE* dae, daeElement* root, do
 
 		for (auto const& joint : model->mSkinInfo.mJointNames | boost::adaptors::indexed(0))
 		{
-			std::string lookingForJoint = joint.value().c_str();
+			std::string lookingForJoint = joint.value().str();
 			//Look for the joint xform that we extracted from the skeleton, using the jointIt as the key
 			//and store it in the alternate bind matrix
 			if (mJointMap.find(lookingForJoint) != mJointMap.end())
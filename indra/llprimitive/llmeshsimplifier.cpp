@@ -0,0 +1,750 @@
+/**
+ * @file llmeshsimplifier.cpp
+ * @brief Quadric error simplification of the faces of a model, for generating levels of detail.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmeshsimplifier.h"
+
+#include <algorithm>
+
+// Weight of the planes through the open borders and the seams, which keep them
+// from caving in, relative to the planes of the triangles
+static const F64 EDGE_WEIGHT = 10.0;
+// Weight of the change of normal and texture coordinates of a collapse, relative
+// to moving the surface by the size of the model
+static const F64 ATTRIBUTE_WEIGHT = 0.01;
+
+enum
+{
+	POINT_BORDER = 0x01,	// on an open border
+	POINT_LOCKED = 0x02,	// on a non-manifold edge, never moves
+	POINT_DEAD = 0x04		// collapsed
+};
+
+LLMeshSimplifier::Quadric::Quadric()
+{
+	for (S32 i = 0; i < 10; ++i)
+	{
+		mA[i] = 0.0;
+	}
+}
+
+void LLMeshSimplifier::Quadric::addPlane(const LLVector3& normal, F32 d, F64 weight)
+{
+	const F64 a = normal.mV[VX];
+	const F64 b = normal.mV[VY];
+	const F64 c = normal.mV[VZ];
+	mA[0] += weight * a * a;
+	mA[1] += weight * a * b;
+	mA[2] += weight * a * c;
+	mA[3] += weight * a * d;
+	mA[4] += weight * b * b;
+	mA[5] += weight * b * c;
+	mA[6] += weight * b * d;
+	mA[7] += weight * c * c;
+	mA[8] += weight * c * d;
+	mA[9] += weight * d * d;
+}
+
+void LLMeshSimplifier::Quadric::add(const Quadric& rhs)
+{
+	for (S32 i = 0; i < 10; ++i)
+	{
+		mA[i] += rhs.mA[i];
+	}
+}
+
+F64 LLMeshSimplifier::Quadric::eval(const LLVector3& p) const
+{
+	const F64 x = p.mV[VX];
+	const F64 y = p.mV[VY];
+	const F64 z = p.mV[VZ];
+	return mA[0] * x * x + 2.0 * mA[1] * x * y + 2.0 * mA[2] * x * z + 2.0 * mA[3] * x
+		 + mA[4] * y * y + 2.0 * mA[5] * y * z + 2.0 * mA[6] * y
+		 + mA[7] * z * z + 2.0 * mA[8] * z
+		 + mA[9];
+}
+
+namespace
+{
+	// Orders vertices by position, for welding them
+	struct ComparePositions
+	{
+		ComparePositions(const std::vector<LLVector3>& positions) : mPositions(positions) {}
+
+		bool operator()(U32 a, U32 b) const
+		{
+			const LLVector3& pa = mPositions[a];
+			const LLVector3& pb = mPositions[b];
+			if (pa.mV[VX] != pb.mV[VX]) return pa.mV[VX] < pb.mV[VX];
+			if (pa.mV[VY] != pb.mV[VY]) return pa.mV[VY] < pb.mV[VY];
+			return pa.mV[VZ] < pb.mV[VZ];
+		}
+
+		const std::vector<LLVector3>& mPositions;
+	};
+
+	// An edge of a triangle, from corner mCorner to the next one
+	struct Edge
+	{
+		U32 mFrom;
+		U32 mTo;
+		U32 mTriangle;
+		S32 mCorner;
+
+		bool operator<(const Edge& rhs) const
+		{
+			U32 a = llmin(mFrom, mTo);
+			U32 b = llmin(rhs.mFrom, rhs.mTo);
+			if (a != b) return a < b;
+			a = llmax(mFrom, mTo);
+			b = llmax(rhs.mFrom, rhs.mTo);
+			return a < b;
+		}
+
+		bool sameEdge(const Edge& rhs) const
+		{
+			return !(*this < rhs) && !(rhs < *this);
+		}
+	};
+
+	LLVector3 to_vector3(const LLVector4a& v)
+	{
+		return LLVector3(v.getF32ptr());
+	}
+}
+
+LLMeshSimplifier::LLMeshSimplifier(const std::vector<LLVolumeFace>& faces, bool lock_borders)
+:	mFaces(faces),
+	mLockBorders(lock_borders),
+	mMaxError(-1.f),
+	mScale(1.f),
+	mNumTriangles(0),
+	mQueueBuilt(false)
+{
+	U32 num_wedges = 0;
+	mFaceStart.resize(faces.size() + 1);
+	for (U32 f = 0; f < faces.size(); ++f)
+	{
+		mFaceStart[f] = num_wedges;
+		num_wedges += faces[f].mNumVertices;
+	}
+	mFaceStart[faces.size()] = num_wedges;
+
+	// Weld the vertices sharing a position into points
+	std::vector<LLVector3> positions;
+	positions.reserve(num_wedges);
+	for (U32 f = 0; f < faces.size(); ++f)
+	{
+		for (S32 i = 0; i < faces[f].mNumVertices; ++i)
+		{
+			positions.push_back(to_vector3(faces[f].mPositions[i]));
+		}
+	}
+
+	std::vector<U32> order(num_wedges);
+	for (U32 i = 0; i < num_wedges; ++i)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), ComparePositions(positions));
+
+	mWedgeFace.resize(num_wedges);
+	for (U32 f = 0; f < faces.size(); ++f)
+	{
+		std::fill(mWedgeFace.begin() + mFaceStart[f], mWedgeFace.begin() + mFaceStart[f + 1], f);
+	}
+
+	mWedgePoint.resize(num_wedges);
+	for (U32 i = 0; i < num_wedges; ++i)
+	{
+		const LLVector3& pos = positions[order[i]];
+		if (mPointPos.empty() || pos != mPointPos.back())
+		{
+			mPointPos.push_back(pos);
+		}
+		mWedgePoint[order[i]] = mPointPos.size() - 1;
+	}
+
+	const U32 num_points = mPointPos.size();
+	mQuadrics.resize(num_points);
+	mPointArea.resize(num_points, 0.0);
+	mPointTriangles.resize(num_points);
+	mPointFlags.resize(num_points, 0);
+	mPointVersion.resize(num_points, 0);
+	mPointTarget.resize(num_points, -1);
+
+	if (num_points)
+	{
+		LLVector3 min = mPointPos[0];
+		LLVector3 max = mPointPos[0];
+		for (U32 i = 1; i < num_points; ++i)
+		{
+			update_min_max(min, max, mPointPos[i]);
+		}
+		mScale = llmax((max - min).length(), F_APPROXIMATELY_ZERO);
+	}
+
+	// Gather the triangles, dropping the ones with two corners at the same place
+	for (U32 f = 0; f < faces.size(); ++f)
+	{
+		const LLVolumeFace& face = faces[f];
+		for (S32 i = 0; i + 2 < face.mNumIndices; i += 3)
+		{
+			U32 wedges[3];
+			bool valid = true;
+			for (S32 c = 0; c < 3; ++c)
+			{
+				U16 idx = face.mIndices[i + c];
+				valid = valid && idx < face.mNumVertices;
+				wedges[c] = mFaceStart[f] + idx;
+			}
+			if (!valid
+				|| mWedgePoint[wedges[0]] == mWedgePoint[wedges[1]]
+				|| mWedgePoint[wedges[1]] == mWedgePoint[wedges[2]]
+				|| mWedgePoint[wedges[2]] == mWedgePoint[wedges[0]])
+			{
+				continue;
+			}
+			mTriangles.insert(mTriangles.end(), wedges, wedges + 3);
+			mTriangleFace.push_back(f);
+		}
+	}
+
+	const U32 num_triangles = mTriangleFace.size();
+	mNumTriangles = num_triangles;
+	mTriangleLive.resize(num_triangles, true);
+
+	// Planes of the triangles, weighted by their area
+	for (U32 t = 0; t < num_triangles; ++t)
+	{
+		const LLVector3& p0 = mPointPos[getPoint(t, 0)];
+		LLVector3 normal = (mPointPos[getPoint(t, 1)] - p0) % (mPointPos[getPoint(t, 2)] - p0);
+		F32 area = normal.normalize() * 0.5f;
+		for (S32 c = 0; c < 3; ++c)
+		{
+			U32 point = getPoint(t, c);
+			mPointTriangles[point].push_back(t);
+			if (area > 0.f)
+			{
+				mQuadrics[point].addPlane(normal, -(normal * p0), area);
+				mPointArea[point] += area;
+			}
+		}
+	}
+
+	// Find the open borders, the seams and the non-manifold edges
+	std::vector<Edge> edges;
+	edges.reserve(num_triangles * 3);
+	for (U32 t = 0; t < num_triangles; ++t)
+	{
+		for (S32 c = 0; c < 3; ++c)
+		{
+			Edge edge;
+			edge.mFrom = getPoint(t, c);
+			edge.mTo = getPoint(t, (c + 1) % 3);
+			edge.mTriangle = t;
+			edge.mCorner = c;
+			edges.push_back(edge);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	for (U32 i = 0; i < edges.size(); )
+	{
+		U32 count = 1;
+		while (i + count < edges.size() && edges[i].sameEdge(edges[i + count]))
+		{
+			++count;
+		}
+
+		const Edge& e0 = edges[i];
+		if (count == 1)
+		{
+			mPointFlags[e0.mFrom] |= POINT_BORDER;
+			mPointFlags[e0.mTo] |= POINT_BORDER;
+			addEdgeQuadric(e0.mTriangle, e0.mCorner, EDGE_WEIGHT);
+		}
+		else if (count == 2 && e0.mFrom == edges[i + 1].mTo)
+		{
+			// A seam if the two triangles do not use the same vertices along the edge
+			const Edge& e1 = edges[i + 1];
+			U32 a0 = mTriangles[e0.mTriangle * 3 + e0.mCorner];
+			U32 b0 = mTriangles[e0.mTriangle * 3 + (e0.mCorner + 1) % 3];
+			U32 a1 = mTriangles[e1.mTriangle * 3 + (e1.mCorner + 1) % 3];
+			U32 b1 = mTriangles[e1.mTriangle * 3 + e1.mCorner];
+			if (a0 != a1 || b0 != b1)
+			{
+				addEdgeQuadric(e0.mTriangle, e0.mCorner, EDGE_WEIGHT);
+				addEdgeQuadric(e1.mTriangle, e1.mCorner, EDGE_WEIGHT);
+			}
+		}
+		else
+		{
+			// More than two triangles, or two facing opposite ways
+			mPointFlags[e0.mFrom] |= POINT_LOCKED;
+			mPointFlags[e0.mTo] |= POINT_LOCKED;
+		}
+
+		i += count;
+	}
+}
+
+void LLMeshSimplifier::addEdgeQuadric(U32 tri, S32 corner, F64 weight)
+{
+	const LLVector3& p0 = mPointPos[getPoint(tri, 0)];
+	const LLVector3& from = mPointPos[getPoint(tri, corner)];
+	LLVector3 edge = mPointPos[getPoint(tri, (corner + 1) % 3)] - from;
+	LLVector3 tri_normal = (mPointPos[getPoint(tri, 1)] - p0) % (mPointPos[getPoint(tri, 2)] - p0);
+
+	// Plane through the edge, perpendicular to the triangle
+	LLVector3 normal = edge % tri_normal;
+	if (normal.normalize() > 0.f)
+	{
+		F64 weight_len = weight * edge.lengthSquared();
+		mQuadrics[getPoint(tri, corner)].addPlane(normal, -(normal * from), weight_len);
+		mQuadrics[getPoint(tri, (corner + 1) % 3)].addPlane(normal, -(normal * from), weight_len);
+	}
+}
+
+const std::vector<U32>& LLMeshSimplifier::getLiveTriangles(U32 point)
+{
+	std::vector<U32>& list = mPointTriangles[point];
+	U32 live = 0;
+	for (U32 i = 0; i < list.size(); ++i)
+	{
+		if (mTriangleLive[list[i]])
+		{
+			list[live++] = list[i];
+		}
+	}
+	list.resize(live);
+	return list;
+}
+
+F64 LLMeshSimplifier::getCollapseCost(U32 p, U32 q, wedge_map_t& wedges, F64& distance) const
+{
+	// What each vertex of p becomes, from the triangles along the edge
+	wedges.clear();
+	U32 shared = 0;
+	for (U32 i = 0; i < mRing.size(); ++i)
+	{
+		const RingTriangle& tri = mRing[i];
+		U32 wq;
+		if (tri.mPoints[0] == q)
+		{
+			wq = tri.mWedges[0];
+		}
+		else if (tri.mPoints[1] == q)
+		{
+			wq = tri.mWedges[1];
+		}
+		else
+		{
+			continue;
+		}
+		++shared;
+
+		wedge_map_t::iterator iter = wedges.begin();
+		while (iter != wedges.end() && iter->first != tri.mWedgeP)
+		{
+			++iter;
+		}
+		if (iter == wedges.end())
+		{
+			wedges.push_back(std::make_pair(tri.mWedgeP, wq));
+		}
+		else if (iter->second != wq)
+		{	// would merge two sides of a seam
+			return -1.0;
+		}
+	}
+
+	if (shared == 0 || shared > 2)
+	{
+		return -1.0;
+	}
+	if (mPointFlags[p] & POINT_BORDER)
+	{	// border points only move along the border
+		if (mLockBorders || shared != 1)
+		{
+			return -1.0;
+		}
+	}
+
+	// Every vertex of p must have a counterpart on q
+	if (wedges.size() != mWedgesP.size())
+	{
+		return -1.0;
+	}
+
+	const F64 error = llmax(mQuadrics[p].eval(mPointPos[q]), 0.0);
+	distance = mPointArea[p] > 0.0 ? sqrt(error / mPointArea[p]) : 0.0;
+
+	F64 attributes = 0.0;
+	for (U32 i = 0; i < wedges.size(); ++i)
+	{
+		const LLVolumeFace& face_p = mFaces[mWedgeFace[wedges[i].first]];
+		const LLVolumeFace& face_q = mFaces[mWedgeFace[wedges[i].second]];
+		U32 wp = wedges[i].first - mFaceStart[mWedgeFace[wedges[i].first]];
+		U32 wq = wedges[i].second - mFaceStart[mWedgeFace[wedges[i].second]];
+
+		if (face_p.mNormals && face_q.mNormals)
+		{
+			attributes += 1.0 - face_p.mNormals[wp].dot3(face_q.mNormals[wq]).getF32();
+		}
+		if (face_p.mTexCoords && face_q.mTexCoords)
+		{
+			attributes += dist_vec_squared(face_p.mTexCoords[wp], face_q.mTexCoords[wq]);
+		}
+	}
+
+	return error + mPointArea[p] * ATTRIBUTE_WEIGHT * mScale * mScale * attributes;
+}
+
+bool LLMeshSimplifier::isCollapseValid(U32 p, U32 q)
+{
+	// The triangles left must not flip over
+	const LLVector3& pos_p = mPointPos[p];
+	const LLVector3& pos_q = mPointPos[q];
+	U32 shared = 0;
+	for (U32 i = 0; i < mRing.size(); ++i)
+	{
+		const RingTriangle& tri = mRing[i];
+		if (tri.mPoints[0] == q || tri.mPoints[1] == q)
+		{
+			++shared;
+			continue;
+		}
+
+		const LLVector3& a = mPointPos[tri.mPoints[0]];
+		const LLVector3& b = mPointPos[tri.mPoints[1]];
+		LLVector3 old_normal = (a - pos_p) % (b - pos_p);
+		LLVector3 new_normal = (a - pos_q) % (b - pos_q);
+		if (!old_normal.isExactlyZero() && old_normal * new_normal <= 0.f)
+		{
+			return false;
+		}
+	}
+
+	// Link condition: p and q must have no common neighbour besides the
+	// corners across the edge, or the collapse would pinch the surface
+	const std::vector<U32>& q_tris = getLiveTriangles(q);
+	mCommon.clear();
+	for (U32 i = 0; i < q_tris.size(); ++i)
+	{
+		for (S32 c = 0; c < 3; ++c)
+		{
+			U32 point = getPoint(q_tris[i], c);
+			if (point != p && point != q
+				&& std::binary_search(mNeighbours.begin(), mNeighbours.end(), point)
+				&& std::find(mCommon.begin(), mCommon.end(), point) == mCommon.end())
+			{
+				mCommon.push_back(point);
+			}
+		}
+	}
+	return mCommon.size() == shared;
+}
+
+S32 LLMeshSimplifier::findCollapse(U32 p, F64& cost, wedge_map_t& wedges)
+{
+	if (mPointFlags[p] & (POINT_LOCKED | POINT_DEAD))
+	{
+		return -1;
+	}
+
+	// Gather the triangles around p, its vertices and its neighbours
+	const std::vector<U32>& p_tris = getLiveTriangles(p);
+	mRing.resize(p_tris.size());
+	mWedgesP.clear();
+	mNeighbours.clear();
+	for (U32 i = 0; i < p_tris.size(); ++i)
+	{
+		U32 t = p_tris[i];
+		S32 cp = getPoint(t, 0) == p ? 0 : (getPoint(t, 1) == p ? 1 : 2);
+		RingTriangle& tri = mRing[i];
+		tri.mWedgeP = mTriangles[t * 3 + cp];
+		for (S32 c = 0; c < 2; ++c)
+		{
+			tri.mWedges[c] = mTriangles[t * 3 + (cp + c + 1) % 3];
+			tri.mPoints[c] = mWedgePoint[tri.mWedges[c]];
+			mNeighbours.push_back(tri.mPoints[c]);
+		}
+		if (std::find(mWedgesP.begin(), mWedgesP.end(), tri.mWedgeP) == mWedgesP.end())
+		{
+			mWedgesP.push_back(tri.mWedgeP);
+		}
+	}
+	std::sort(mNeighbours.begin(), mNeighbours.end());
+	mNeighbours.erase(std::unique(mNeighbours.begin(), mNeighbours.end()), mNeighbours.end());
+
+	// The distances are compared with some slack, for collapses on flat areas
+	const F64 max_error = mMaxError >= 0.f ? mMaxError + mScale * 1e-6 : -1.0;
+
+	// Cost every neighbour, then check the cheapest ones until one keeps the mesh valid
+	mCosts.clear();
+	for (U32 i = 0; i < mNeighbours.size(); ++i)
+	{
+		F64 distance = 0.0;
+		F64 c = getCollapseCost(p, mNeighbours[i], mWedges, distance);
+		if (c >= 0.0 && (max_error < 0.0 || distance <= max_error))
+		{
+			mCosts.push_back(std::make_pair(c, mNeighbours[i]));
+		}
+	}
+	std::sort(mCosts.begin(), mCosts.end());
+
+	for (U32 i = 0; i < mCosts.size(); ++i)
+	{
+		U32 q = mCosts[i].second;
+		if (isCollapseValid(p, q))
+		{
+			F64 distance;
+			cost = getCollapseCost(p, q, wedges, distance);
+			return q;
+		}
+	}
+	return -1;
+}
+
+void LLMeshSimplifier::collapse(U32 p, U32 q, const wedge_map_t& wedges)
+{
+	const std::vector<U32>& p_tris = getLiveTriangles(p);
+	for (U32 i = 0; i < p_tris.size(); ++i)
+	{
+		U32 t = p_tris[i];
+		S32 cp = 0;
+		bool has_q = false;
+		for (S32 c = 0; c < 3; ++c)
+		{
+			U32 point = getPoint(t, c);
+			if (point == p) cp = c;
+			else if (point == q) has_q = true;
+		}
+
+		if (has_q)
+		{
+			mTriangleLive[t] = false;
+			--mNumTriangles;
+			continue;
+		}
+
+		U32& wp = mTriangles[t * 3 + cp];
+		for (U32 j = 0; j < wedges.size(); ++j)
+		{
+			if (wedges[j].first == wp)
+			{
+				wp = wedges[j].second;
+				break;
+			}
+		}
+		mPointTriangles[q].push_back(t);
+	}
+
+	mPointTriangles[p].clear();
+	mPointFlags[p] |= POINT_DEAD;
+	mQuadrics[q].add(mQuadrics[p]);
+	mPointArea[q] += mPointArea[p];
+}
+
+void LLMeshSimplifier::pushCandidate(U32 p)
+{
+	F64 cost = 0.0;
+	S32 q = findCollapse(p, cost, mBestWedges);
+	++mPointVersion[p];
+	mPointTarget[p] = q;
+	if (q >= 0)
+	{
+		Candidate candidate;
+		candidate.mCost = (F32)cost;
+		candidate.mPoint = p;
+		candidate.mVersion = mPointVersion[p];
+		mQueue.push_back(candidate);
+		std::push_heap(mQueue.begin(), mQueue.end());
+	}
+}
+
+S32 LLMeshSimplifier::simplify(S32 target_triangles, F32 max_error)
+{
+	if (mNumTriangles <= target_triangles)
+	{
+		return mNumTriangles;
+	}
+
+	// Carrying on with the same error limit, the queue is still good
+	if (!mQueueBuilt || max_error != mMaxError)
+	{
+		mMaxError = max_error;
+		mQueue.clear();
+		for (U32 p = 0; p < mPointPos.size(); ++p)
+		{
+			pushCandidate(p);
+		}
+		mQueueBuilt = true;
+	}
+
+	std::vector<U32> ring;
+	while (mNumTriangles > target_triangles && !mQueue.empty())
+	{
+		Candidate top = mQueue.front();
+		std::pop_heap(mQueue.begin(), mQueue.end());
+		mQueue.pop_back();
+
+		U32 p = top.mPoint;
+		if ((mPointFlags[p] & POINT_DEAD) || top.mVersion != mPointVersion[p])
+		{	// stale
+			continue;
+		}
+
+		// The neighbourhood may have changed since, making the collapse dearer or invalid
+		F64 cost = 0.0;
+		S32 q = findCollapse(p, cost, mBestWedges);
+		if (q < 0)
+		{
+			continue;
+		}
+		if ((F32)cost > top.mCost)
+		{
+			top.mCost = (F32)cost;
+			mQueue.push_back(top);
+			std::push_heap(mQueue.begin(), mQueue.end());
+			continue;
+		}
+
+		collapse(p, q, mBestWedges);
+
+		// The points that were to collapse onto p need another target, and q and the
+		// points next to it may have new, cheaper ones.  The other collapses around
+		// may have become dearer or invalid, which is checked when they come up.
+		ring = getLiveTriangles(q);
+		const U32 num_tris = ring.size();
+		for (U32 i = 0; i < num_tris; ++i)
+		{
+			U32 t = ring[i];
+			ring[i] = getPoint(t, 0);
+			ring.push_back(getPoint(t, 1));
+			ring.push_back(getPoint(t, 2));
+		}
+		std::sort(ring.begin(), ring.end());
+		ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+		for (U32 i = 0; i < ring.size(); ++i)
+		{
+			U32 r = ring[i];
+			if (r == q || mPointTarget[r] == (S32)p || mPointTarget[r] < 0)
+			{
+				pushCandidate(r);
+			}
+		}
+	}
+
+	return mNumTriangles;
+}
+
+void LLMeshSimplifier::getFace(S32 f, LLVolumeFace& dst) const
+{
+	const LLVolumeFace& src = mFaces[f];
+	const U32 start = mFaceStart[f];
+
+	// Keep the vertices in use, in their order
+	std::vector<S32> remap(src.mNumVertices, -1);
+	U32 num_indices = 0;
+	for (U32 t = 0; t < mTriangleFace.size(); ++t)
+	{
+		if (mTriangleLive[t] && mTriangleFace[t] == f)
+		{
+			for (S32 c = 0; c < 3; ++c)
+			{
+				remap[mTriangles[t * 3 + c] - start] = 0;
+			}
+			num_indices += 3;
+		}
+	}
+
+	S32 num_vertices = 0;
+	for (S32 i = 0; i < src.mNumVertices; ++i)
+	{
+		if (remap[i] == 0)
+		{
+			remap[i] = num_vertices++;
+		}
+	}
+
+	dst.resizeVertices(num_vertices);
+	dst.resizeIndices(num_indices);
+	dst.allocateWeights(src.mWeights ? num_vertices : 0);
+
+	for (S32 i = 0; i < src.mNumVertices; ++i)
+	{
+		S32 v = remap[i];
+		if (v < 0)
+		{
+			continue;
+		}
+		dst.mPositions[v] = src.mPositions[i];
+		if (src.mNormals)
+		{
+			dst.mNormals[v] = src.mNormals[i];
+		}
+		else
+		{
+			dst.mNormals[v].clear();
+		}
+		if (src.mTexCoords)
+		{
+			dst.mTexCoords[v] = src.mTexCoords[i];
+		}
+		else
+		{
+			dst.mTexCoords[v].clear();
+		}
+		if (src.mWeights)
+		{
+			dst.mWeights[v] = src.mWeights[i];
+		}
+	}
+
+	U16* index = dst.mIndices;
+	for (U32 t = 0; t < mTriangleFace.size(); ++t)
+	{
+		if (mTriangleLive[t] && mTriangleFace[t] == f)
+		{
+			for (S32 c = 0; c < 3; ++c)
+			{
+				*index++ = (U16)remap[mTriangles[t * 3 + c] - start];
+			}
+		}
+	}
+
+	if (num_vertices)
+	{
+		dst.mExtents[0] = dst.mExtents[1] = dst.mPositions[0];
+		for (S32 i = 1; i < num_vertices; ++i)
+		{
+			update_min_max(dst.mExtents[0], dst.mExtents[1], dst.mPositions[i]);
+		}
+	}
+}
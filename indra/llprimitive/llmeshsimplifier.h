@@ -0,0 +1,154 @@
+/**
+ * @file llmeshsimplifier.h
+ * @brief Quadric error simplification of the faces of a model, for generating levels of detail.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHSIMPLIFIER_H
+#define LL_LLMESHSIMPLIFIER_H
+
+#include "llvolume.h"
+
+#include <vector>
+
+//
+// Reduces the triangle count of the faces of a model by collapsing edges, cheapest
+// first, the cost of a collapse being the distance it moves the surface by (Garland
+// and Heckbert quadrics) plus a penalty for the change of normal and texture
+// coordinates it makes.
+//
+// An edge collapse moves one vertex onto a neighbour, so the remaining vertices are
+// all vertices of the source faces, with their normals, texture coordinates and skin
+// weights untouched.  Vertices sharing a position are welded for the collapses; the
+// edges between faces and along texture or normal seams stay in place, only their
+// own vertices moving along them.  The open borders of the mesh are kept the same
+// way, or not moved at all when locked, and non-manifold edges never collapse.
+//
+// Does not touch any GL state nor global data, so several models can be simplified
+// at once, one per thread.
+//
+class LLMeshSimplifier
+{
+public:
+	// The faces must stay unchanged for the life of the simplifier
+	LLMeshSimplifier(const std::vector<LLVolumeFace>& faces, bool lock_borders = false);
+
+	// Collapse edges until at most target_triangles are left, or until no collapse is
+	// left that would move the surface by at most max_error (unless negative).  Can be
+	// called again with a lower target to carry on, for the next level of detail.
+	// Returns the number of triangles left.
+	S32 simplify(S32 target_triangles, F32 max_error = -1.f);
+
+	S32 getNumTriangles() const		{ return mNumTriangles; }
+
+	// Copy the triangles left in face f, and the vertices they use, to dst; dst has no
+	// indices if all the triangles of the face are gone.
+	void getFace(S32 f, LLVolumeFace& dst) const;
+
+private:
+	// Squared distance to a set of planes, (x y z 1) A (x y z 1)t with A symmetric
+	struct Quadric
+	{
+		F64 mA[10];
+
+		Quadric();
+		void addPlane(const LLVector3& normal, F32 d, F64 weight);
+		void add(const Quadric& rhs);
+		F64 eval(const LLVector3& p) const;
+	};
+
+	struct Candidate
+	{
+		F32 mCost;
+		U32 mPoint;
+		U32 mVersion;
+
+		bool operator<(const Candidate& rhs) const	{ return mCost > rhs.mCost; }	// cheapest on top
+	};
+
+	typedef std::vector<std::pair<U32, U32> > wedge_map_t;
+
+	// Triangle around a point: the vertex of the point, then the other two corners in order
+	struct RingTriangle
+	{
+		U32 mWedgeP;
+		U32 mWedges[2];
+		U32 mPoints[2];
+	};
+
+	U32 getPoint(U32 tri, S32 corner) const		{ return mWedgePoint[mTriangles[tri * 3 + corner]]; }
+	// Triangles of point, dropping the collapsed ones from its list
+	const std::vector<U32>& getLiveTriangles(U32 point);
+	// Cost of collapsing point p onto q, and the vertex each vertex of p becomes;
+	// negative if the collapse would cross a seam or leave the border.  distance
+	// is how far the collapse moves the surface.  Uses mRing and mWedgesP.
+	F64 getCollapseCost(U32 p, U32 q, wedge_map_t& wedges, F64& distance) const;
+	// Check that the collapse of p onto q does not flip triangles or pinch the
+	// surface.  Uses mRing and mNeighbours.
+	bool isCollapseValid(U32 p, U32 q);
+	// Best collapse of p, returns the point to collapse it onto or -1 if none
+	S32 findCollapse(U32 p, F64& cost, wedge_map_t& wedges);
+	void collapse(U32 p, U32 q, const wedge_map_t& wedges);
+	void pushCandidate(U32 p);
+	void addEdgeQuadric(U32 tri, S32 corner, F64 weight);
+
+private:
+	const std::vector<LLVolumeFace>& mFaces;
+	bool mLockBorders;
+	F32 mMaxError;
+	F32 mScale;					// size of the bounding box, for the attribute penalty
+
+	// Vertices of all the faces, face after face
+	std::vector<U32> mFaceStart;
+	std::vector<U32> mWedgePoint;	// point (welded vertex) of each vertex
+	std::vector<U8> mWedgeFace;
+
+	// Triangles of all the faces, three vertices each
+	std::vector<U32> mTriangles;
+	std::vector<U8> mTriangleFace;
+	std::vector<bool> mTriangleLive;
+	S32 mNumTriangles;
+
+	// Welded vertices
+	std::vector<LLVector3> mPointPos;
+	std::vector<Quadric> mQuadrics;
+	std::vector<F64> mPointArea;	// area of the triangles summed in the quadric
+	std::vector<std::vector<U32> > mPointTriangles;
+	std::vector<U8> mPointFlags;
+	std::vector<U32> mPointVersion;	// of the candidate in the queue
+	std::vector<S32> mPointTarget;	// point the candidate collapses onto, or -1
+
+	std::vector<Candidate> mQueue;	// heap
+	bool mQueueBuilt;
+
+	// Scratch space, about the point findCollapse() looks at
+	std::vector<RingTriangle> mRing;
+	std::vector<U32> mWedgesP;
+	std::vector<U32> mNeighbours;	// sorted
+	std::vector<U32> mCommon;
+	std::vector<std::pair<F64, U32> > mCosts;
+	wedge_map_t mWedges;
+	wedge_map_t mBestWedges;
+};
+
+#endif // LL_LLMESHSIMPLIFIER_H
@@ -32,6 +32,7 @@
 #include "llsdserialize.h"
 #include "llvector4a.h"
 #include "llmatrix4a.h"
+#include "llthread.h"
 
 #ifdef LL_STANDALONE
 # include <zlib.h>
@@ -1362,6 +1363,44 @@ bool LLModel::loadDecomposition(LLSD& header, std::istream& is)
 	return true;
 }
 
+static LLGlobalMutex sJointNameMutex;		// protects sJointNames
+static LLStdStringTable sJointNames(1024);
+
+//static
+LLStdStringHandle LLMeshJointName::intern(const std::string& name)
+{
+	LLMutexLock lock(sJointNameMutex);
+	return sJointNames.insert(name);
+}
+
+//static
+LLStdStringHandle LLMeshJointName::getEmptyName()
+{
+	//default constructed names fill whole vectors when skins are resized, don't lock for each
+	static const LLStdStringHandle empty_name = intern(LLStringUtil::null);
+	return empty_name;
+}
+
+LLMeshJointName::LLMeshJointName()
+:	mName(getEmptyName())
+{
+}
+
+LLMeshJointName::LLMeshJointName(const std::string& name)
+:	mName(intern(name))
+{
+}
+
+LLMeshJointName::LLMeshJointName(const char* name)
+:	mName(intern(name))
+{
+}
+
+std::ostream& operator<<(std::ostream& s, const LLMeshJointName& name)
+{
+	return s << name.str();
+}
+
 LLMeshSkinInfo::LLMeshSkinInfo():
     mPelvisOffset(0.0),
     mLockScaleIfJointPosition(false),
@@ -1386,7 +1425,7 @@ void LLMeshSkinInfo::fromLLSD(LLSD& skin)
 		const U32 joint_count = skin["joint_names"].size();
 		for (U32 i = 0; i < joint_count; ++i)
 		{
-			mJointNames.push_back(skin["joint_names"][i]);
+			mJointNames.push_back(LLMeshJointName(skin["joint_names"][i].asString()));
 			mJointNums.push_back(-1);
 		}
 	}
@@ -1457,7 +1496,7 @@ LLSD LLMeshSkinInfo::asLLSD(bool include_joints, bool lock_scale_if_joint_positi
 
 	for (U32 i = 0; i < mJointNames.size(); ++i)
 	{
-		ret["joint_names"][i] = mJointNames[i];
+		ret["joint_names"][i] = mJointNames[i].str();
 
 		for (U32 j = 0; j < 4; j++)
 		{
@@ -28,6 +28,7 @@
 #define LL_LLMODEL_H
 
 #include "llpointer.h"
+#include "llstringtable.h"
 #include "llvolume.h"
 #include "v4math.h"
 #include "m4math.h"
@@ -39,6 +40,34 @@ class domMesh;
 #define MAX_MODEL_FACES 8
 
 
+// Name of a joint of LLMeshSkinInfo. There are a few hundred joint names for all
+// the rigged meshes of a session, so each one is kept once, for good, and a skin
+// only holds pointers to them. Thread safe, skins are parsed by the mesh threads.
+// Making one takes a global lock, so it is never done implicitly: names used in
+// code should be made once and kept, like LLSkinningUtil's "mPelvis".
+class LLMeshJointName
+{
+public:
+	LLMeshJointName();
+	explicit LLMeshJointName(const std::string& name);
+	explicit LLMeshJointName(const char* name);
+
+	const std::string& str() const		{ return *mName; }
+	const char* c_str() const			{ return mName->c_str(); }
+	operator const std::string&() const	{ return *mName; }
+
+	bool operator==(const LLMeshJointName& rhs) const	{ return mName == rhs.mName; }
+	bool operator!=(const LLMeshJointName& rhs) const	{ return mName != rhs.mName; }
+
+private:
+	static LLStdStringHandle intern(const std::string& name);
+	static LLStdStringHandle getEmptyName();
+
+	LLStdStringHandle mName;
+};
+
+std::ostream& operator<<(std::ostream& s, const LLMeshJointName& name);
+
 class LLMeshSkinInfo 
 {
 public:
@@ -48,7 +77,7 @@ public:
 	LLSD asLLSD(bool include_joints, bool lock_scale_if_joint_position) const;
 
 	LLUUID mMeshID;
-	std::vector<std::string> mJointNames;
+	std::vector<LLMeshJointName> mJointNames;
 	mutable std::vector<S32> mJointNums;
 	std::vector<LLMatrix4> mInvBindMatrix;
 	std::vector<LLMatrix4> mAlternateBindMatrix;
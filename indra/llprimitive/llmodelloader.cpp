@@ -380,7 +380,7 @@ void LLModelLoader::loadModelCallback()
 //-----------------------------------------------------------------------------
 // critiqueRigForUploadApplicability()
 //-----------------------------------------------------------------------------
-void LLModelLoader::critiqueRigForUploadApplicability( const std::vector<std::string> &jointListFromAsset )
+void LLModelLoader::critiqueRigForUploadApplicability( const std::vector<LLMeshJointName> &jointListFromAsset )
 {
 	//Determines the following use cases for a rig:
 	//1. It is suitable for upload with skin weights & joint positions, or
@@ -413,7 +413,7 @@ void LLModelLoader::critiqueRigForUploadApplicability( const std::vector<std::st
 //-----------------------------------------------------------------------------
 // isRigLegacy()
 //-----------------------------------------------------------------------------
-bool LLModelLoader::isRigLegacy( const std::vector<std::string> &jointListFromAsset )
+bool LLModelLoader::isRigLegacy( const std::vector<LLMeshJointName> &jointListFromAsset )
 {
 	//No joints in asset
 	if ( jointListFromAsset.size() == 0 )
@@ -431,7 +431,7 @@ bool LLModelLoader::isRigLegacy( const std::vector<std::string> &jointListFromAs
 
     // Unknown joints in asset
     S32 unknown_joint_count = 0;
-    for (std::vector<std::string>::const_iterator it = jointListFromAsset.begin();
+    for (std::vector<LLMeshJointName>::const_iterator it = jointListFromAsset.begin();
          it != jointListFromAsset.end(); ++it)
     {
         if (mJointMap.find(*it)==mJointMap.end())
@@ -451,7 +451,7 @@ bool LLModelLoader::isRigLegacy( const std::vector<std::string> &jointListFromAs
 //-----------------------------------------------------------------------------
 // isRigSuitableForJointPositionUpload()
 //-----------------------------------------------------------------------------
-bool LLModelLoader::isRigSuitableForJointPositionUpload( const std::vector<std::string> &jointListFromAsset )
+bool LLModelLoader::isRigSuitableForJointPositionUpload( const std::vector<LLMeshJointName> &jointListFromAsset )
 {
     return true;
 }
@@ -163,13 +163,13 @@ public:
 	bool verifyCount( int expected, int result );
 
 	//Determines the viability of an asset to be used as an avatar rig (w or w/o joint upload caps)
-	void critiqueRigForUploadApplicability( const std::vector<std::string> &jointListFromAsset );
+	void critiqueRigForUploadApplicability( const std::vector<LLMeshJointName> &jointListFromAsset );
 
 	//Determines if a rig is a legacy from the joint list
-	bool isRigLegacy( const std::vector<std::string> &jointListFromAsset );
+	bool isRigLegacy( const std::vector<LLMeshJointName> &jointListFromAsset );
 
 	//Determines if a rig is suitable for upload
-	bool isRigSuitableForJointPositionUpload( const std::vector<std::string> &jointListFromAsset );
+	bool isRigSuitableForJointPositionUpload( const std::vector<LLMeshJointName> &jointListFromAsset );
 
 	const bool isRigValidForJointPositionUpload( void ) const { return mRigValidJointUpload; }
 	void setRigValidForJointPositionUpload( bool rigValid ) { mRigValidJointUpload = rigValid; }
@@ -313,6 +313,11 @@ PFNGLISVERTEXARRAYPROC glIsVertexArray = NULL;
 PFNGLMAPBUFFERRANGEPROC			glMapBufferRange = NULL;
 PFNGLFLUSHMAPPEDBUFFERRANGEPROC	glFlushMappedBufferRange = NULL;
 
+#ifdef GL_ARB_buffer_storage
+// GL_ARB_buffer_storage
+PFNGLBUFFERSTORAGEPROC			glBufferStorage = NULL;
+#endif
+
 // GL_ARB_texture_compression
 PFNGLCOMPRESSEDTEXIMAGE3DARBPROC glCompressedTexImage3DARB = NULL;
 PFNGLCOMPRESSEDTEXIMAGE2DARBPROC glCompressedTexImage2DARB = NULL;
@@ -520,6 +525,7 @@ LLGLManager::LLGLManager() :
 	mNumTextureUnits(1),
 	mHasMipMapGeneration(FALSE),
 	mHasCompressedTextures(FALSE),
+	mHasTextureCompressionS3TC(FALSE),
 	mHasFramebufferObject(FALSE),
 	mMaxSamples(0),
 	mHasFramebufferMultisample(FALSE),
@@ -548,6 +554,7 @@ LLGLManager::LLGLManager() :
 	mHasGpuShader5(FALSE),
 	mHasAdaptiveVsync(FALSE),
 	mHasTextureSwizzle(FALSE),
+	mHasBufferStorage(FALSE),
 
 	mIsATI(FALSE),
 	mIsNVIDIA(FALSE),
@@ -831,6 +838,10 @@ bool LLGLManager::initGL()
 	{ //GL version is < 3.0, always disable texture compression
 		LLImageGL::sCompressTextures = false;
 	}
+	if (!mHasTextureCompressionS3TC)
+	{ //decode threads compress to DXT1/DXT5
+		LLImageGL::sCompressTexturesOnDecode = false;
+	}
 
 	S32 old_vram = mVRAM;
 
@@ -1037,6 +1048,11 @@ void LLGLManager::initExtensions()
 # else
 	mHasCompressedTextures = FALSE;
 # endif // GL_ARB_texture_compression
+# ifdef GL_EXT_texture_compression_s3tc
+	mHasTextureCompressionS3TC = mHasCompressedTextures;
+# else
+	mHasTextureCompressionS3TC = FALSE;
+# endif // GL_EXT_texture_compression_s3tc
 # ifdef GL_ARB_vertex_buffer_object
 	mHasVertexBufferObject = TRUE;
 # else
@@ -1083,6 +1099,7 @@ void LLGLManager::initExtensions()
 	mHasATIMemInfo = ExtensionExists("GL_ATI_meminfo");
 	mHasNVXMemInfo = ExtensionExists("GL_NVX_gpu_memory_info");
 	mHasCompressedTextures = mGLVersion >= 1.3 || ExtensionExists("GL_ARB_texture_compression");
+	mHasTextureCompressionS3TC = mHasCompressedTextures && ExtensionExists("GL_EXT_texture_compression_s3tc");
 	mHasAnisotropic = mGLVersion >= 4.6f || ExtensionExists("GL_EXT_texture_filter_anisotropic");
 	mHasCubeMap = mGLVersion >= 1.3f || ExtensionExists("GL_ARB_texture_cube_map");
 	mHasARBEnvCombine = mGLVersion >= 2.1f || ExtensionExists("GL_ARB_texture_env_combine");
@@ -1131,6 +1148,9 @@ void LLGLManager::initExtensions()
 #ifdef GL_ARB_texture_swizzle
 	mHasTextureSwizzle = mGLVersion >= 3.3f || ExtensionExists("GL_ARB_texture_swizzle");
 #endif
+#ifdef GL_ARB_buffer_storage
+	mHasBufferStorage = mHasSync && mHasMapBufferRange && (mGLVersion >= 4.4f || ExtensionExists("GL_ARB_buffer_storage"));
+#endif
 
 #if LL_LINUX || LL_SOLARIS
 	LL_INFOS() << "initExtensions() checking shell variables to adjust features..." << LL_ENDL;
@@ -1142,6 +1162,7 @@ void LLGLManager::initExtensions()
 		mHasDepthClamp = FALSE;
 		mHasARBEnvCombine = FALSE;
 		mHasCompressedTextures = FALSE;
+		mHasTextureCompressionS3TC = FALSE;
 		mHasVertexBufferObject = FALSE;
 		mHasFramebufferObject = FALSE;
 		mHasFramebufferMultisample = FALSE;
@@ -1157,6 +1178,7 @@ void LLGLManager::initExtensions()
 		mHasFragmentShader = FALSE;
 		mHasAdaptiveVsync = FALSE;
 		mHasTextureSwizzle = FALSE;
+		mHasBufferStorage = FALSE;
 		LL_WARNS("RenderInit") << "GL extension support DISABLED via LL_GL_NOEXT" << LL_ENDL;
 	}
 	else if (getenv("LL_GL_BASICEXT"))	/* Flawfinder: ignore */
@@ -1183,7 +1205,7 @@ void LLGLManager::initExtensions()
 		const char *const blacklist = getenv("LL_GL_BLACKLIST");	/* Flawfinder: ignore */
 		LL_WARNS("RenderInit") << "GL extension support partially disabled via LL_GL_BLACKLIST: " << blacklist << LL_ENDL;
 		if (strchr(blacklist,'a')) mHasARBEnvCombine = FALSE;
-		if (strchr(blacklist,'b')) mHasCompressedTextures = FALSE;
+		if (strchr(blacklist,'b')) mHasCompressedTextures = mHasTextureCompressionS3TC = FALSE;
 		if (strchr(blacklist,'c')) mHasVertexBufferObject = FALSE;
 		if (strchr(blacklist,'d')) mHasMipMapGeneration = FALSE;//S
 // 		if (strchr(blacklist,'f')) mHasNVVertexArrayRange = FALSE;//S
@@ -1370,6 +1392,16 @@ void LLGLManager::initExtensions()
 		glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC) GLH_EXT_GET_PROC_ADDRESS("glMapBufferRange");
 		glFlushMappedBufferRange = (PFNGLFLUSHMAPPEDBUFFERRANGEPROC) GLH_EXT_GET_PROC_ADDRESS("glFlushMappedBufferRange");
 	}
+#ifdef GL_ARB_buffer_storage
+	if (mHasBufferStorage)
+	{
+		glBufferStorage = (PFNGLBUFFERSTORAGEPROC) GLH_EXT_GET_PROC_ADDRESS("glBufferStorage");
+		if (!glBufferStorage)
+		{
+			mHasBufferStorage = FALSE;
+		}
+	}
+#endif
 	if (mHasFramebufferObject)
 	{
 		LL_INFOS() << "initExtensions() FramebufferObject-related procs..." << LL_ENDL;
@@ -83,6 +83,7 @@ public:
 	S32	 mNumTextureUnits;
 	BOOL mHasMipMapGeneration;
 	BOOL mHasCompressedTextures;
+	BOOL mHasTextureCompressionS3TC;
 	BOOL mHasFramebufferObject;
 	S32 mMaxSamples;
 	BOOL mHasFramebufferMultisample;
@@ -114,6 +115,7 @@ public:
 	BOOL mHasGpuShader5;
 	BOOL mHasAdaptiveVsync;
 	BOOL mHasTextureSwizzle;
+	BOOL mHasBufferStorage;
 
 	bool mHasTextureCompression;
 
@@ -189,6 +189,11 @@ extern PFNGLFLUSHMAPPEDBUFFERRANGEAPPLEPROC glFlushMappedBufferRangeAPPLE;
 extern PFNGLMAPBUFFERRANGEPROC			glMapBufferRange;
 extern PFNGLFLUSHMAPPEDBUFFERRANGEPROC	glFlushMappedBufferRange;
 
+#ifdef GL_ARB_buffer_storage
+// GL_ARB_buffer_storage
+extern PFNGLBUFFERSTORAGEPROC			glBufferStorage;
+#endif
+
 // GL_ARB_occlusion_query
 extern PFNGLGENQUERIESARBPROC glGenQueriesARB;
 extern PFNGLDELETEQUERIESARBPROC glDeleteQueriesARB;
@@ -33,11 +33,13 @@
 
 #include "llerror.h"
 #include "llimage.h"
+#include "llimagedxt.h"
 
 #include "llmath.h"
 #include "llgl.h"
 #include "llglslshader.h"
 #include "llrender.h"
+#include "lltextureuploadstream.h"
 
 //----------------------------------------------------------------------------
 const F32 MIN_TEXTURE_LIFETIME = 10.f;
@@ -60,6 +62,10 @@ F32 LLImageGL::sLastFrameTime			= 0.f;
 BOOL LLImageGL::sAllowReadBackRaw       = FALSE ;
 LLImageGL* LLImageGL::sDefaultGLTexture = NULL ;
 bool LLImageGL::sCompressTextures = false;
+bool LLImageGL::sCompressTexturesOnDecode = false;
+U32 LLImageGL::sCompressedUploadCount = 0;
+S64Bytes LLImageGL::sCompressedBytesSaved(0);
+F64 LLImageGL::sCompressedPSNRSum = 0.0;
 
 std::set<LLImageGL*> LLImageGL::sImageList;
 
@@ -775,11 +781,14 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 					}
 						
 					mIsCompressed = LLImageGL::setManualImage(mTarget, gl_level, mFormatInternal, w, h, mFormatPrimary, GL_UNSIGNED_BYTE, (GLvoid*)data_in, mAllowCompression);
-					if (gl_level == 0)
+					if (!mUploadFromPixelBuffer)
 					{
-						analyzeAlpha(data_in, w, h);
+						if (gl_level == 0)
+						{
+							analyzeAlpha(data_in, w, h);
+						}
+						updatePickMask(w, h, data_in);
 					}
-					updatePickMask(w, h, data_in);
 
 					if(mFormatSwapBytes)
 					{
@@ -851,6 +860,9 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 				S32 w = width, h = height;
 				const U8* prev_mip_data = 0;
 				const U8* cur_mip_data = 0;
+				// The mips are staged in pooled buffers, most textures come in a few sizes only
+				S32 prev_mip_capacity = 0;
+				S32 cur_mip_capacity = 0;
 #ifdef SHOW_ASSERT
 				S32 cur_mip_size = 0;
 #endif
@@ -873,7 +885,7 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 						llassert(prev_mip_data);
 						llassert(cur_mip_size == bytes*4);
 #endif
-						U8* new_data = new U8[bytes];
+						U8* new_data = LLImageBufferPool::allocate(bytes, cur_mip_capacity);
 						llassert_always(new_data);
 						LLImageBase::generateMip(prev_mip_data, new_data, w, h, mComponents);
 						cur_mip_data = new_data;
@@ -909,15 +921,16 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 					}
 					if (prev_mip_data && prev_mip_data != data_in)
 					{
-						delete[] prev_mip_data;
+						LLImageBufferPool::release((U8*)prev_mip_data, prev_mip_capacity);
 					}
 					prev_mip_data = cur_mip_data;
+					prev_mip_capacity = cur_mip_capacity;
 					w >>= 1;
 					h >>= 1;
 				}
 				if (prev_mip_data && prev_mip_data != data_in)
 				{
-					delete[] prev_mip_data;
+					LLImageBufferPool::release((U8*)prev_mip_data, prev_mip_capacity);
 					prev_mip_data = NULL;
 				}
 			}
@@ -1444,6 +1457,45 @@ BOOL LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, G
 	}
 
 	setCategory(category);
+
+	LLImageDXT* compressed = sCompressTexturesOnDecode ? imageraw->getCompressedMips() : NULL;
+	if (compressed && !mHasExplicitFormat && mUseMipMaps &&
+		LLImageDXT::calcNumMips(raw_w, raw_h) > mMaxDiscardLevel - discard_level)
+	{
+		// The compressed mips skip the alpha analysis in setImage(), do it on the pixels
+		analyzeAlpha(imageraw->getData(), raw_w, raw_h);
+		updatePickMask(raw_w, raw_h, imageraw->getData());
+
+		mFormatPrimary = mFormatInternal = (mComponents == 4) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		BOOL res = createGLTexture(discard_level, compressed->getData() + compressed->getMipOffset(0), TRUE, usename);
+		if (res)
+		{
+			sCompressedUploadCount++;
+			sCompressedBytesSaved += S64Bytes(raw_w * raw_h * mComponents - dataFormatBytes(mFormatPrimary, raw_w, raw_h));
+			sCompressedPSNRSum += compressed->getCompressionPSNR();
+		}
+		return res;
+	}
+
+	LLImageStagedUpload* staged = imageraw->getStagedUpload();
+	if (staged && !mHasExplicitFormat && mUseMipMaps && !mFormatSwapBytes &&
+		staged->getLevels() > mMaxDiscardLevel - discard_level)
+	{
+		const U8* offset = LLTextureUploadStream::bindForUpload(staged);
+		if (offset)
+		{
+			// The pixel buffer can't be read back, analyze the alpha on the pixels
+			analyzeAlpha(imageraw->getData(), raw_w, raw_h);
+			updatePickMask(raw_w, raw_h, imageraw->getData());
+
+			mUploadFromPixelBuffer = true;
+			BOOL res = createGLTexture(discard_level, offset, TRUE, usename);
+			mUploadFromPixelBuffer = false;
+			LLTextureUploadStream::uploadDone(staged);
+			return res;
+		}
+	}
+
  	const U8* rawdata = imageraw->getData();
 	return createGLTexture(discard_level, rawdata, FALSE, usename);
 }
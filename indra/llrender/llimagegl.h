@@ -258,6 +258,7 @@ private:
 	
 	bool mAllowCompression;
 	bool mIsCompressed = false;
+	bool mUploadFromPixelBuffer = false;	// setImage() data is an offset into LLTextureUploadStream, not readable
 
 protected:
 	LLGLenum mTarget;		// Normally GL_TEXTURE2D, sometimes something else (ex. cube maps)
@@ -296,6 +297,10 @@ public:
 	static BOOL sGlobalUseAnisotropic;
 	static LLImageGL* sDefaultGLTexture ;	
  	static bool sCompressTextures;			//use GL texture compression
+	static bool sCompressTexturesOnDecode;	//upload the DXT1/DXT5 mips made by the decode threads
+	static U32 sCompressedUploadCount;		//textures uploaded from those mips
+	static S64Bytes sCompressedBytesSaved;	//texture memory saved by them, against uncompressed RGB(A)
+	static F64 sCompressedPSNRSum;			//summed PSNR of those textures, in dB
 
 #if DEBUG_MISS
 	BOOL mMissed; // Missed on last bind?
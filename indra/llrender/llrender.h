@@ -593,6 +593,9 @@ public:
 
 	bool verifyTexUnitActive(U32 unitToVerify);
 
+	// Anisotropic filtering ratio textures are set up with, 0 until the first one is
+	F32 getMaxAnisotropy() const { return mMaxAnisotropy; }
+
 	void debugTexUnits(void);
 
 	void clearErrors();
@@ -0,0 +1,448 @@
+/**
+ * @file lltextureuploadstream.cpp
+ * @brief Streams decoded textures to GL through a persistently mapped pixel buffer.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltextureuploadstream.h"
+
+#include "llgl.h"
+#include "llglheaders.h"
+#include "lltimer.h"
+
+#include <deque>
+
+// Staged textures start on this boundary in the ring
+static const U32 RING_ALIGNMENT = 64;
+
+// Ring entry states, other values are the serial of the fence to wait for
+static const U32 ENTRY_STAGED = 0;		// held by an LLImageRaw
+static const U32 ENTRY_FREE = U32_MAX;
+
+struct LLRingEntry
+{
+	U32 mOffset;
+	U32 mSize;
+	U32 mFence;
+};
+
+// Allocation order: the ring is used from the back and freed from the front
+static std::deque<LLRingEntry> sEntries;
+static U32 sFrontID = 0;				// ID of sEntries.front()
+static U32 sGeneration = 0;				// bumped by cleanupClass(), staged textures of an older one are stale
+static U32 sStaging = 0;				// stage() calls copying into the ring right now
+static U8* sMapped = NULL;
+static U32 sStagedCount = 0;
+static U32 sUploadCount = 0;
+static U32 sFullCount = 0;
+static LLGlobalMutex sStreamMutex;		// protects all of the above
+
+// Main thread only
+static GLuint sBuffer = 0;
+#ifdef GL_ARB_buffer_storage
+typedef std::deque<std::pair<GLsync, U32> > fence_list_t;
+static fence_list_t sFences;
+#endif
+static U32 sNextFence = 1;
+static bool sUploadedSinceFence = false;
+
+bool LLTextureUploadStream::sEnabled = false;
+U32 LLTextureUploadStream::sSize = 0;
+
+class LLStagedTexture : public LLImageStagedUpload
+{
+protected:
+	/*virtual*/ ~LLStagedTexture()
+	{
+		LLTextureUploadStream::release(mID, mGeneration, mUploaded);
+	}
+
+public:
+	LLStagedTexture(const LLImageRaw* raw, S32 levels, U32 id, U32 generation, U32 base_offset)
+	:	LLImageStagedUpload(raw->getWidth(), raw->getHeight(), raw->getComponents(), levels),
+		mID(id),
+		mGeneration(generation),
+		mBaseOffset(base_offset),
+		mUploaded(false)
+	{
+	}
+
+	U32 mID;
+	U32 mGeneration;
+	U32 mBaseOffset;		// of the full size level
+	bool mUploaded;
+};
+
+// Frees the entries at the front of the ring that are done with. Call with sStreamMutex locked.
+static void pop_free_entries()
+{
+	while (!sEntries.empty() && sEntries.front().mFence == ENTRY_FREE)
+	{
+		sEntries.pop_front();
+		++sFrontID;
+	}
+}
+
+// Finds room for size bytes. Call with sStreamMutex locked.
+static bool ring_allocate(U32 size, U32& offset)
+{
+	U32 ring_size = LLTextureUploadStream::getSize();
+	if (sEntries.empty())
+	{
+		offset = 0;
+		return size <= ring_size;
+	}
+	U32 head = sEntries.back().mOffset + sEntries.back().mSize;
+	U32 tail = sEntries.front().mOffset;
+	if (head > tail)
+	{
+		// Used space is [tail, head): try the end of the ring, then wrap around
+		if (ring_size - head >= size)
+		{
+			offset = head;
+			return true;
+		}
+		if (tail >= size)
+		{
+			offset = 0;
+			return true;
+		}
+		return false;
+	}
+	// Wrapped around: the free space is [head, tail)
+	if (tail - head >= size)
+	{
+		offset = head;
+		return true;
+	}
+	return false;
+}
+
+//static
+bool LLTextureUploadStream::initClass(U32 size)
+{
+	llassert(!sEnabled);
+#ifdef GL_ARB_buffer_storage
+	if (!gGLManager.mHasBufferStorage || !size)
+	{
+		return false;
+	}
+
+	size = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffersARB(1, &sBuffer);
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER, sBuffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+	U8* mapped = (U8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!mapped)
+	{
+		LL_WARNS("RenderInit") << "Could not map a " << size / 1024 << " KB texture upload buffer, uploading synchronously" << LL_ENDL;
+		glDeleteBuffersARB(1, &sBuffer);
+		sBuffer = 0;
+		stop_glerror();
+		return false;
+	}
+
+	{
+		LLMutexLock lock(&sStreamMutex);
+		sMapped = mapped;
+		sSize = size;
+		sEntries.clear();
+		sFrontID = 0;
+		sEnabled = true;
+	}
+	LL_INFOS("RenderInit") << "Streaming texture uploads through a " << size / (1024 * 1024) << " MB pixel buffer" << LL_ENDL;
+	return true;
+#else
+	return false;
+#endif
+}
+
+//static
+void LLTextureUploadStream::cleanupClass()
+{
+	if (!sBuffer)
+	{
+		return;
+	}
+
+	// Stop new staging, and let the decode threads finish copying into the buffer
+	while (true)
+	{
+		{
+			LLMutexLock lock(&sStreamMutex);
+			sEnabled = false;
+			if (!sStaging)
+			{
+				sMapped = NULL;
+				sEntries.clear();
+				++sGeneration;
+				break;
+			}
+		}
+		ms_sleep(1);
+	}
+
+#ifdef GL_ARB_buffer_storage
+	// The textures still in flight must be done reading before the buffer goes
+	for (fence_list_t::iterator iter = sFences.begin(); iter != sFences.end(); ++iter)
+	{
+		glClientWaitSync(iter->first, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(iter->first);
+	}
+	sFences.clear();
+	sUploadedSinceFence = false;
+
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER, sBuffer);
+	glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER);
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffersARB(1, &sBuffer);
+	sBuffer = 0;
+	stop_glerror();
+#endif
+}
+
+//static
+LLPointer<LLImageStagedUpload> LLTextureUploadStream::stage(const LLImageRaw* raw)
+{
+	S32 components = raw->getComponents();
+	if (!sEnabled || !raw->getData() || (components != 3 && components != 4))
+	{
+		// LLImageGL::setManualImage() converts one and two channel images on the CPU
+		return NULL;
+	}
+
+	// The mips LLImageGL::setImage() would make: halve until one side is down to 1, at most MAX_DISCARD_LEVEL times.
+	// Each level takes LLImageGL::dataFormatBytes(), which pads it to 4 bytes.
+	S32 level_sizes[MAX_DISCARD_LEVEL + 1];
+	S32 levels = 0;
+	U32 total = 0;
+	for (S32 w = raw->getWidth(), h = raw->getHeight(); levels <= MAX_DISCARD_LEVEL; w >>= 1, h >>= 1)
+	{
+		level_sizes[levels] = w * h * components;
+		total += (level_sizes[levels++] + 3) & ~3;
+		if (w <= 1 || h <= 1)
+		{
+			break;
+		}
+	}
+	if (levels < 2)
+	{
+		// Nothing to gain, and the full size level would sit at offset 0, which reads as NULL
+		return NULL;
+	}
+	U32 size = (total + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+
+	U32 offset, id, generation;
+	U8* mapped;
+	{
+		LLMutexLock lock(&sStreamMutex);
+		if (!sEnabled)
+		{
+			return NULL;
+		}
+		pop_free_entries();
+		if (!ring_allocate(size, offset))
+		{
+			++sFullCount;
+			return NULL;
+		}
+		LLRingEntry entry;
+		entry.mOffset = offset;
+		entry.mSize = size;
+		entry.mFence = ENTRY_STAGED;
+		sEntries.push_back(entry);
+		id = sFrontID + sEntries.size() - 1;
+		generation = sGeneration;
+		mapped = sMapped;
+		++sStaging;
+	}
+
+	// Smallest mip first, the full size level last. The mips are made in system memory
+	// and only copied into the buffer: it is write combined, and slow to read back from.
+	U8* dst = mapped + offset + total;
+	dst -= (level_sizes[0] + 3) & ~3;
+	U32 base_offset = dst - mapped;
+	memcpy(dst, raw->getData(), level_sizes[0]);		/* Flawfinder: ignore */
+	const U8* prev = raw->getData();
+	S32 prev_capacity = 0;
+	for (S32 level = 1, w = raw->getWidth() >> 1, h = raw->getHeight() >> 1; level < levels; ++level, w >>= 1, h >>= 1)
+	{
+		S32 capacity;
+		U8* mip = LLImageBufferPool::allocate(level_sizes[level], capacity);
+		LLImageBase::generateMip(prev, mip, w, h, components);
+		dst -= (level_sizes[level] + 3) & ~3;
+		memcpy(dst, mip, level_sizes[level]);		/* Flawfinder: ignore */
+		if (prev != raw->getData())
+		{
+			LLImageBufferPool::release((U8*)prev, prev_capacity);
+		}
+		prev = mip;
+		prev_capacity = capacity;
+	}
+	if (prev != raw->getData())
+	{
+		LLImageBufferPool::release((U8*)prev, prev_capacity);
+	}
+
+	{
+		LLMutexLock lock(&sStreamMutex);
+		--sStaging;
+		++sStagedCount;
+	}
+	return new LLStagedTexture(raw, levels, id, generation, base_offset);
+}
+
+//static
+const U8* LLTextureUploadStream::bindForUpload(LLImageStagedUpload* staged)
+{
+	LLStagedTexture* texture = dynamic_cast<LLStagedTexture*>(staged);
+	if (!texture || texture->mUploaded || texture->mGeneration != sGeneration || !sBuffer)
+	{
+		return NULL;
+	}
+#ifdef GL_ARB_buffer_storage
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER, sBuffer);
+#endif
+	return (const U8*)NULL + texture->mBaseOffset;
+}
+
+//static
+void LLTextureUploadStream::uploadDone(LLImageStagedUpload* staged)
+{
+#ifdef GL_ARB_buffer_storage
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+
+	LLStagedTexture* texture = dynamic_cast<LLStagedTexture*>(staged);
+	if (!texture)
+	{
+		return;
+	}
+	texture->mUploaded = true;
+	sUploadedSinceFence = true;
+
+	LLMutexLock lock(&sStreamMutex);
+	if (texture->mGeneration == sGeneration)
+	{
+		// Reusable once this frame's fence has signaled
+		sEntries[texture->mID - sFrontID].mFence = sNextFence;
+		++sUploadCount;
+	}
+}
+
+//static
+void LLTextureUploadStream::release(U32 id, U32 generation, bool uploaded)
+{
+	if (uploaded)
+	{
+		// update() frees it
+		return;
+	}
+	LLMutexLock lock(&sStreamMutex);
+	if (generation == sGeneration)
+	{
+		sEntries[id - sFrontID].mFence = ENTRY_FREE;
+		pop_free_entries();
+	}
+}
+
+//static
+void LLTextureUploadStream::update()
+{
+	if (!sBuffer)
+	{
+		return;
+	}
+
+#ifdef GL_ARB_buffer_storage
+	if (sUploadedSinceFence)
+	{
+		sFences.push_back(std::make_pair(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), sNextFence));
+		++sNextFence;
+		sUploadedSinceFence = false;
+	}
+
+	U32 completed = 0;
+	while (!sFences.empty())
+	{
+		// Don't wait, whatever is not done yet will be by one of the next frames
+		GLenum status = glClientWaitSync(sFences.front().first, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+		completed = sFences.front().second;
+		glDeleteSync(sFences.front().first);
+		sFences.pop_front();
+	}
+	if (!completed)
+	{
+		return;
+	}
+
+	LLMutexLock lock(&sStreamMutex);
+	for (std::deque<LLRingEntry>::iterator iter = sEntries.begin(); iter != sEntries.end(); ++iter)
+	{
+		if (iter->mFence != ENTRY_STAGED && iter->mFence <= completed)
+		{
+			iter->mFence = ENTRY_FREE;
+		}
+	}
+	pop_free_entries();
+#endif
+}
+
+//static
+U32 LLTextureUploadStream::getStagedCount()
+{
+	LLMutexLock lock(&sStreamMutex);
+	return sStagedCount;
+}
+
+//static
+U32 LLTextureUploadStream::getUploadCount()
+{
+	LLMutexLock lock(&sStreamMutex);
+	return sUploadCount;
+}
+
+//static
+U32 LLTextureUploadStream::getFullCount()
+{
+	LLMutexLock lock(&sStreamMutex);
+	return sFullCount;
+}
+
+//static
+U32 LLTextureUploadStream::getUsedBytes()
+{
+	LLMutexLock lock(&sStreamMutex);
+	if (sEntries.empty())
+	{
+		return 0;
+	}
+	U32 head = sEntries.back().mOffset + sEntries.back().mSize;
+	U32 tail = sEntries.front().mOffset;
+	return head > tail ? head - tail : sSize - tail + head;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file lltextureuploadstream.h
+ * @brief Streams decoded textures to GL through a persistently mapped pixel buffer.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREUPLOADSTREAM_H
+#define LL_LLTEXTUREUPLOADSTREAM_H
+
+#include "llimage.h"
+
+//
+// One GL_PIXEL_UNPACK_BUFFER, created with ARB_buffer_storage and kept mapped
+// (persistent and coherent) for as long as GL is up, used as a ring.
+//
+// The decode threads stage() each decoded texture: they copy its pixels and
+// generate its mips straight into the ring, so that LLImageGL::createGLTexture()
+// only has to issue glTexImage2D from buffer offsets on the main thread. That is
+// a copy the driver can schedule as it likes instead of one it has to finish
+// before returning, and the mips are no longer made on the main thread.
+//
+// update() places one fence a frame behind that frame's uploads; the ring space
+// of an upload is reused once its fence has signaled. A staged texture that is
+// never uploaded gives its space back when its LLImageRaw lets go of it.
+// When the ring is full stage() returns NULL and the texture is uploaded the
+// usual way.
+//
+class LLTextureUploadStream
+{
+public:
+	// Main thread, GL context current. Returns false if the driver can't do it.
+	static bool initClass(U32 size);
+	// Main thread. Waits for the decode threads to finish staging, and for the GPU.
+	static void cleanupClass();
+	static bool isEnabled()					{ return sEnabled; }
+
+	// Any thread: copy raw and its mips into the ring, see LLImageStagedUpload.
+	// Returns NULL if the ring is full or the image can't be streamed.
+	static LLPointer<LLImageStagedUpload> stage(const LLImageRaw* raw);
+
+	// Main thread: bind the buffer for glTexImage2D and return the offset of the
+	// full size level, as a pointer. Smaller mips are stored before it, as
+	// LLImageGL::setImage() expects with data_hasmips. NULL if staged is stale.
+	static const U8* bindForUpload(LLImageStagedUpload* staged);
+	// Main thread: unbind the buffer; the staged data is released once the GPU is done with it
+	static void uploadDone(LLImageStagedUpload* staged);
+
+	// Main thread, once a frame: fence the uploads of this frame and recycle the ring
+	// space of the ones the GPU has finished
+	static void update();
+
+	// Textures staged, uploaded from the ring, and not staged because the ring was full
+	static U32 getStagedCount();
+	static U32 getUploadCount();
+	static U32 getFullCount();
+	// Bytes of the ring in use, staged or waiting for the GPU
+	static U32 getUsedBytes();
+	static U32 getSize()					{ return sSize; }
+
+private:
+	friend class LLStagedTexture;
+	static void release(U32 id, U32 generation, bool uploaded);
+
+	static bool sEnabled;
+	static U32 sSize;
+};
+
+#endif // LL_LLTEXTUREUPLOADSTREAM_H
@@ -29,6 +29,248 @@
 #include "llstl.h"
 #include "llapr.h"
 
+#if LL_IO_URING
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include "lltimer.h"	// ms_sleep()
+#endif
+
+//============================================================================
+
+#if LL_IO_URING
+// Minimal io_uring wrapper on top of the raw syscalls, so we don't need liburing.
+// Only used by the thread that processes LLLFSThread requests.
+class LLIOURing
+{
+public:
+	LLIOURing();
+	~LLIOURing();
+
+	bool init(U32 entries);
+
+	// Queue a positional read or write. Returns false when the ring is full.
+	bool queue(U8 opcode, int fd, U8* buffer, U32 nbytes, U64 offset, void* user_data);
+	// Hand queued operations to the kernel, optionally blocking until at least one completes
+	void submit(bool wait);
+	// Pop one completion. Returns false when there are none.
+	bool popCompletion(void*& user_data, S32& result);
+
+private:
+	int mRingFD;
+	void* mSQRing;
+	size_t mSQRingSize;
+	void* mCQRing;
+	size_t mCQRingSize;
+	io_uring_sqe* mSQEs;
+	size_t mSQEsSize;
+
+	U32* mSQHead;
+	U32* mSQTail;
+	U32* mSQArray;
+	U32 mSQMask;
+	U32 mSQEntries;
+
+	U32* mCQHead;
+	U32* mCQTail;
+	io_uring_cqe* mCQEs;
+	U32 mCQMask;
+
+	U32 mToSubmit;
+	U32 mInFlight;
+};
+
+static const U32 IO_URING_ENTRIES = 64;
+
+LLIOURing::LLIOURing() :
+	mRingFD(-1),
+	mSQRing(NULL), mSQRingSize(0),
+	mCQRing(NULL), mCQRingSize(0),
+	mSQEs(NULL), mSQEsSize(0),
+	mSQHead(NULL), mSQTail(NULL), mSQArray(NULL), mSQMask(0), mSQEntries(0),
+	mCQHead(NULL), mCQTail(NULL), mCQEs(NULL), mCQMask(0),
+	mToSubmit(0),
+	mInFlight(0)
+{
+}
+
+LLIOURing::~LLIOURing()
+{
+	llassert(mInFlight == 0);
+	if (mSQEs)
+	{
+		munmap(mSQEs, mSQEsSize);
+	}
+	if (mCQRing && mCQRing != mSQRing)
+	{
+		munmap(mCQRing, mCQRingSize);
+	}
+	if (mSQRing)
+	{
+		munmap(mSQRing, mSQRingSize);
+	}
+	if (mRingFD >= 0)
+	{
+		close(mRingFD);
+	}
+}
+
+bool LLIOURing::init(U32 entries)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	mRingFD = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (mRingFD < 0)
+	{
+		LL_INFOS() << "io_uring not available (errno " << errno << "), using synchronous file I/O" << LL_ENDL;
+		return false;
+	}
+	// IORING_OP_READ and IORING_OP_WRITE appeared in the same kernel (5.6) as this feature bit
+	if (!(params.features & IORING_FEAT_RW_CUR_POS))
+	{
+		LL_INFOS() << "io_uring too old, using synchronous file I/O" << LL_ENDL;
+		return false;
+	}
+
+	mSQRingSize = params.sq_off.array + params.sq_entries * sizeof(U32);
+	mCQRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap)
+	{
+		mSQRingSize = mCQRingSize = llmax(mSQRingSize, mCQRingSize);
+	}
+
+	void* ring = mmap(NULL, mSQRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, mRingFD, IORING_OFF_SQ_RING);
+	if (ring == MAP_FAILED)
+	{
+		LL_WARNS() << "Unable to map io_uring submission queue, using synchronous file I/O" << LL_ENDL;
+		return false;
+	}
+	mSQRing = ring;
+
+	if (single_mmap)
+	{
+		mCQRing = mSQRing;
+	}
+	else
+	{
+		ring = mmap(NULL, mCQRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, mRingFD, IORING_OFF_CQ_RING);
+		if (ring == MAP_FAILED)
+		{
+			LL_WARNS() << "Unable to map io_uring completion queue, using synchronous file I/O" << LL_ENDL;
+			return false;
+		}
+		mCQRing = ring;
+	}
+
+	mSQEsSize = params.sq_entries * sizeof(io_uring_sqe);
+	ring = mmap(NULL, mSQEsSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, mRingFD, IORING_OFF_SQES);
+	if (ring == MAP_FAILED)
+	{
+		LL_WARNS() << "Unable to map io_uring submission entries, using synchronous file I/O" << LL_ENDL;
+		return false;
+	}
+	mSQEs = (io_uring_sqe*)ring;
+
+	U8* sq = (U8*)mSQRing;
+	mSQHead = (U32*)(sq + params.sq_off.head);
+	mSQTail = (U32*)(sq + params.sq_off.tail);
+	mSQArray = (U32*)(sq + params.sq_off.array);
+	mSQMask = *(U32*)(sq + params.sq_off.ring_mask);
+	mSQEntries = params.sq_entries;
+
+	U8* cq = (U8*)mCQRing;
+	mCQHead = (U32*)(cq + params.cq_off.head);
+	mCQTail = (U32*)(cq + params.cq_off.tail);
+	mCQEs = (io_uring_cqe*)(cq + params.cq_off.cqes);
+	mCQMask = *(U32*)(cq + params.cq_off.ring_mask);
+
+	LL_INFOS() << "Using io_uring for local file I/O, " << mSQEntries << " entries" << LL_ENDL;
+	return true;
+}
+
+bool LLIOURing::queue(U8 opcode, int fd, U8* buffer, U32 nbytes, U64 offset, void* user_data)
+{
+	// The completion queue is at least as large as the submission queue,
+	// so capping the number in flight means completions can never overflow.
+	if (mInFlight >= mSQEntries)
+	{
+		return false;
+	}
+
+	U32 tail = *mSQTail;
+	U32 index = tail & mSQMask;
+	io_uring_sqe* sqe = &mSQEs[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (U64)(uintptr_t)buffer;
+	sqe->len = nbytes;
+	sqe->off = offset;
+	sqe->user_data = (U64)(uintptr_t)user_data;
+	mSQArray[index] = index;
+
+	// publish the entry before the new tail
+	__atomic_store_n(mSQTail, tail + 1, __ATOMIC_RELEASE);
+
+	++mToSubmit;
+	++mInFlight;
+	return true;
+}
+
+void LLIOURing::submit(bool wait)
+{
+	wait = wait && mInFlight > 0; // never block on an empty ring
+	if (!mToSubmit && !wait)
+	{
+		return;
+	}
+
+	while (1)
+	{
+		int res = (int)syscall(__NR_io_uring_enter, mRingFD, mToSubmit, wait ? 1 : 0,
+							   wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (res >= 0)
+		{
+			mToSubmit -= llmin((U32)res, mToSubmit);
+			return;
+		}
+		if (errno == EAGAIN || errno == EBUSY)
+		{
+			ms_sleep(1); // kernel is short on resources, give it a moment
+		}
+		else if (errno != EINTR)
+		{
+			// The kernel may own buffers at this point, there is no safe way to continue
+			LL_ERRS() << "io_uring_enter failed, errno " << errno << LL_ENDL;
+		}
+	}
+}
+
+bool LLIOURing::popCompletion(void*& user_data, S32& result)
+{
+	U32 head = *mCQHead;
+	if (head == __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE))
+	{
+		return false;
+	}
+
+	const io_uring_cqe& cqe = mCQEs[head & mCQMask];
+	user_data = (void*)(uintptr_t)cqe.user_data;
+	result = cqe.res;
+
+	// hand the slot back to the kernel once we're done reading it
+	__atomic_store_n(mCQHead, head + 1, __ATOMIC_RELEASE);
+
+	--mInFlight;
+	return true;
+}
+#endif // LL_IO_URING
+
 //============================================================================
 
 /*static*/ LLLFSThread* LLLFSThread::sLocal = NULL;
@@ -36,10 +278,10 @@
 //============================================================================
 // Run on MAIN thread
 //static
-void LLLFSThread::initClass(bool local_is_threaded)
+void LLLFSThread::initClass(bool local_is_threaded, bool use_io_uring)
 {
 	llassert(sLocal == NULL);
-	sLocal = new LLLFSThread(local_is_threaded);
+	sLocal = new LLLFSThread(local_is_threaded, use_io_uring);
 }
 
 //static
@@ -63,17 +305,90 @@ void LLLFSThread::cleanupClass()
 
 //----------------------------------------------------------------------------
 
-LLLFSThread::LLLFSThread(bool threaded) :
+LLLFSThread::LLLFSThread(bool threaded, bool use_io_uring) :
 	LLQueuedThread("LFS", threaded),
-	mPriorityCounter(PRIORITY_LOWBITS)
+	mPriorityCounter(PRIORITY_LOWBITS),
+	mRing(NULL),
+	mRingChecked(!use_io_uring),
+	mSubmitCounter(PRIORITY_LOWBITS),
+	mWritesInFlight(0),
+	mWaiting(false)
 {
 }
 
 LLLFSThread::~LLLFSThread()
 {
+	// Abort remaining requests while the ring still exists to wait on them
+	shutdown();
+#if LL_IO_URING
+	delete mRing;
+#endif
 	// ~LLQueuedThread() will be called here
 }
 
+// Created lazily so that it's set up by the thread that processes requests.
+LLIOURing* LLLFSThread::getRing()
+{
+#if LL_IO_URING
+	if (!mRingChecked)
+	{
+		mRingChecked = true;
+		LLIOURing* ring = new LLIOURing;
+		if (ring->init(IO_URING_ENTRIES))
+		{
+			mRing = ring;
+		}
+		else
+		{
+			delete ring;
+		}
+	}
+#endif
+	return mRing;
+}
+
+// Submit any queued operations and pass finished ones back to their requests.
+void LLLFSThread::reapCompletions(bool wait)
+{
+#if LL_IO_URING
+	mRing->submit(wait);
+
+	void* user_data;
+	S32 result;
+	while (mRing->popCompletion(user_data, result))
+	{
+		Request* req = (Request*)user_data;
+		if (result > 0)
+		{
+			req->mIODone += result;
+			// The completion just freed a slot
+			if (req->mIODone < req->mBytes && req->queueIO())
+			{
+				continue; // short transfer, go on with the rest
+			}
+		}
+		req->mIOResult = result < 0 ? result : req->mIODone;
+		req->mIOState = Request::IO_DONE;
+		if (req->mOperation == FILE_WRITE)
+		{
+			--mWritesInFlight;
+		}
+	}
+	// Completions may have queued more
+	mRing->submit(false);
+#endif
+}
+
+// virtual
+// Tells the update() of the main thread that the request it just put back is
+// still with the kernel; asking again in the same frame would only spin.
+bool LLLFSThread::isWaiting()
+{
+	bool waiting = mWaiting;
+	mWaiting = false;
+	return waiting;
+}
+
 //----------------------------------------------------------------------------
 
 LLLFSThread::handle_t LLLFSThread::read(const std::string& filename,	/* Flawfinder: ignore */ 
@@ -106,6 +421,7 @@ LLLFSThread::handle_t LLLFSThread::write(const std::string& filename,
 	handle_t handle = generateHandle();
 
 	if (priority == 0) priority = PRIORITY_LOW | priorityCounter();
+	else if (priority < PRIORITY_LOW) priority |= PRIORITY_LOW; // below PRIORITY_LOW is for requests in flight
 	
 	Request* req = new Request(this, handle, priority,
 							   FILE_WRITE, filename,
@@ -136,6 +452,10 @@ LLLFSThread::Request::Request(LLLFSThread* thread,
 	mOffset(offset),
 	mBytes(numbytes),
 	mBytesRead(0),
+	mIOState(IO_NONE),
+	mIODone(0),
+	mIOResult(0),
+	mFileDesc(-1),
 	mResponder(responder)
 {
 	if (numbytes <= 0)
@@ -151,6 +471,7 @@ LLLFSThread::Request::~Request()
 // virtual, called from own thread
 void LLLFSThread::Request::finishRequest(bool completed)
 {
+	finishIO(); // aborted requests may still be in flight
 	if (mResponder.notNull())
 	{
 		mResponder->completed(completed ? mBytesRead : 0);
@@ -164,6 +485,7 @@ void LLLFSThread::Request::deleteRequest()
 	{
 		LL_ERRS() << "Attempt to delete a queued LLLFSThread::Request!" << LL_ENDL;
 	}	
+	finishIO();
 	if (mResponder.notNull())
 	{
 		mResponder->completed(0);
@@ -174,6 +496,12 @@ void LLLFSThread::Request::deleteRequest()
 
 bool LLLFSThread::Request::processRequest()
 {
+	if (mIOState != IO_NONE ||
+		((mOperation == FILE_READ || mOperation == FILE_WRITE) && mOffset >= 0 && mBytes > 0 && mThread->getRing()))
+	{
+		return processRequestAsync();
+	}
+
 	bool complete = false;
 	if (mOperation ==  FILE_READ)
 	{
@@ -228,6 +556,123 @@ bool LLLFSThread::Request::processRequest()
 	return complete;
 }
 
+// Positional reads and writes go through io_uring when it's available.
+// The first call opens the file, queues the operation and puts the request back
+// behind everything that hasn't been queued yet, so a burst of requests reaches
+// the kernel in one submission. When it comes up again, its completion is collected.
+// Requests complete in the order they were handed to the kernel, and a write is
+// only handed over once the previous one is done, so callers can rely on the
+// FIFO order of the synchronous path: a file written after another one is never
+// written first.
+bool LLLFSThread::Request::processRequestAsync()
+{
+#if LL_IO_URING
+	bool is_read = (mOperation == FILE_READ);
+	bool threaded = mThread->getThreaded();
+	if (mIOState == IO_NONE)
+	{
+		if (!is_read && mThread->mWritesInFlight)
+		{
+			if (threaded)
+			{
+				while (mThread->mWritesInFlight)
+				{
+					mThread->reapCompletions(true);
+				}
+			}
+			else
+			{
+				// Don't block the main thread; try again at the next update()
+				mThread->reapCompletions(false);
+				if (mThread->mWritesInFlight)
+				{
+					mThread->mWaiting = true;
+					return false;
+				}
+			}
+		}
+
+		mFileDesc = open(mFileName.c_str(), is_read ? (O_RDONLY|O_CLOEXEC) : (O_WRONLY|O_CREAT|O_CLOEXEC), 0666);
+		if (mFileDesc < 0)
+		{
+			LL_WARNS() << "LLLFS: Unable to " << (is_read ? "read" : "write") << " file: " << mFileName << LL_ENDL;
+			mBytesRead = 0; // fail
+			return true;
+		}
+
+		while (!queueIO())
+		{
+			mThread->reapCompletions(true); // ring is full, wait for a slot
+		}
+		mIOState = IO_PENDING;
+		if (!is_read)
+		{
+			++mThread->mWritesInFlight;
+		}
+
+		// Drop below every request that is still waiting (all are at least PRIORITY_LOW)
+		// so they get queued before we come back, and after the requests handed over
+		// before us. Safe, we're not in the queue right now.
+		setPriority(mThread->mSubmitCounter-- & PRIORITY_LOWBITS);
+		return false;
+	}
+
+	if (threaded)
+	{
+		finishIO();
+	}
+	else
+	{
+		// We are the oldest request with the kernel. Don't block the main
+		// thread; the ones behind us wait for us until the next update().
+		mThread->reapCompletions(false);
+		if (mIOState == IO_PENDING)
+		{
+			mThread->mWaiting = true;
+			return false;
+		}
+		finishIO();
+	}
+
+	if (mIOResult < 0)
+	{
+		LL_WARNS() << "LLLFS: " << (is_read ? "Read" : "Write") << " failed (errno " << -mIOResult << "): " << mFileName << LL_ENDL;
+		mBytesRead = 0; // fail
+	}
+	else
+	{
+		mBytesRead = mIOResult;
+	}
+#endif
+	return true;
+}
+
+bool LLLFSThread::Request::queueIO()
+{
+#if LL_IO_URING
+	return mThread->mRing->queue(mOperation == FILE_READ ? IORING_OP_READ : IORING_OP_WRITE, mFileDesc,
+								 mBuffer + mIODone, mBytes - mIODone, mOffset + mIODone, this);
+#else
+	return false;
+#endif
+}
+
+// Wait until the kernel is done with our buffer, then release the file.
+void LLLFSThread::Request::finishIO()
+{
+#if LL_IO_URING
+	while (mIOState == IO_PENDING)
+	{
+		mThread->reapCompletions(true);
+	}
+	if (mFileDesc >= 0)
+	{
+		close(mFileDesc);
+		mFileDesc = -1;
+	}
+#endif
+}
+
 //============================================================================
 
 LLLFSThread::Responder::~Responder()
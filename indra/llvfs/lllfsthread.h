@@ -42,6 +42,8 @@
 #include "llpointer.h"
 #include "llqueuedthread.h"
 
+class LLIOURing;
+
 //============================================================================
 // Threaded Local File System
 //============================================================================
@@ -106,6 +108,19 @@ public:
 		/*virtual*/ void deleteRequest();
 		
 	private:
+		friend class LLLFSThread;
+
+		enum io_state_t {
+			IO_NONE,	// not handed to the kernel
+			IO_PENDING,	// queued on the io_uring, buffer owned by the kernel
+			IO_DONE		// completion received, mIOResult is valid
+		};
+
+		bool processRequestAsync();
+		// Queue what is left of the read or write on the io_uring, false when it is full
+		bool queueIO();
+		void finishIO();
+
 		LLLFSThread* mThread;
 		operation_t mOperation;
 		
@@ -116,12 +131,17 @@ public:
 		S32 mBytes;		// bytes to read from file, -1 = all
 		S32 mBytesRead;	// bytes read from file
 
+		io_state_t mIOState;
+		S32 mIODone;	// bytes transferred so far, short transfers are queued again for the rest
+		S32 mIOResult;	// bytes transferred or -errno, once IO_DONE
+		S32 mFileDesc;
+
 		LLPointer<Responder> mResponder;
 	};
 
 	//------------------------------------------------------------------------
 public:
-	LLLFSThread(bool threaded = TRUE);
+	LLLFSThread(bool threaded = TRUE, bool use_io_uring = false);
 	~LLLFSThread();	
 
 	// Return a Request handle
@@ -136,13 +156,27 @@ public:
 	U32 priorityCounter() { return mPriorityCounter-- & PRIORITY_LOWBITS; } // Use to order IO operations
 	
 	// static initializers
-	static void initClass(bool local_is_threaded = TRUE); // Setup sLocal
+	static void initClass(bool local_is_threaded = TRUE, bool use_io_uring = false); // Setup sLocal
 	static S32 updateClass(U32 ms_elapsed);
 	static void cleanupClass();		// Delete sLocal
 
 	
+protected:
+	/*virtual*/ bool isWaiting();
+
+private:
+	LLIOURing* getRing();
+	void reapCompletions(bool wait);
+
 private:
 	U32 mPriorityCounter;
+	LLIOURing* mRing;	// NULL when io_uring is unavailable, see getRing()
+	bool mRingChecked;
+	// Requests handed to the kernel are put back at the priority of this counter, so
+	// they complete in the order they were handed over
+	U32 mSubmitCounter;
+	U32 mWritesInFlight;	// at most one, see processRequestAsync()
+	bool mWaiting;			// see isWaiting()
 	
 public:
 	static LLLFSThread* sLocal;		// Default local file thread
@@ -61,6 +61,7 @@
 #include "llrendersphere.h"
 #include "llsdmessage.h"
 #include "llsdutil.h"
+#include "llsessionaccesslog.h"
 #include "llsky.h"
 #include "llslurl.h"
 #include "llsmoothstep.h"
@@ -970,6 +971,8 @@ void LLAgent::setRegion(LLViewerRegion *regionp)
 
 		// Pass new region along to metrics components that care about this level of detail.
 		LLAppViewer::metricsUpdateRegion(regionp->getHandle());
+
+		LLSessionAccessLog::getInstance()->setRegion(regionp->getHandle());
 	}
 
 	mRegionp = regionp;
@@ -52,6 +52,7 @@
 #include "llviewerstats.h"
 #include "llmarketplacefunctions.h"
 #include "llmarketplacenotifications.h"
+#include "llmeshcache.h"
 #include "llmeshrepository.h"
 #include "llmodaldialog.h"
 #include "llpumpio.h"
@@ -123,7 +124,10 @@
 #include "llworkerthread.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltexturefetchbench.h"
+#include "lltextureuploadconverter.h"
 #include "llimageworker.h"
+#include "llthreadpool.h"
 
 // <edit>
 #include "aicurleasyrequeststatemachine.h"
@@ -138,6 +142,7 @@
 #include "llpolymesh.h"
 #include "llaudioengine.h"
 #include "llselectmgr.h"
+#include "llsessionaccesslog.h"
 #include "lltrans.h"
 #include "lltracker.h"
 #include "llviewerparcelmgr.h"
@@ -491,6 +496,7 @@ static void settings_to_globals()
 
 	LLImageGL::sGlobalUseAnisotropic	= gSavedSettings.getBOOL("RenderAnisotropic");
 	LLImageGL::sCompressTextures		= gSavedSettings.getBOOL("RenderCompressTextures");
+	LLImageGL::sCompressTexturesOnDecode = gSavedSettings.getBOOL("RenderCompressTexturesOnDecode");
 	LLVOVolume::sLODFactor				= gSavedSettings.getF32("RenderVolumeLODFactor");
 	LLVOVolume::sDistanceFactor			= 1.f-LLVOVolume::sLODFactor * 0.1f;
 	LLVolumeImplFlexible::sUpdateFactor = gSavedSettings.getF32("RenderFlexTimeFactor");
@@ -1676,8 +1682,12 @@ bool LLAppViewer::cleanup()
 
 	LL_INFOS() << "Cleaning Up" << LL_ENDL;
 
+	// write out what this session used while the texture list still knows about it
+	LLSessionAccessLog::getInstance()->flush();
+
 	// shut down mesh streamer
 	gMeshRepo.shutdown();
+	LLMeshCache::getInstance()->shutdown();
 
 	// Must clean up texture references before viewer window is destroyed.
 	if(LLHUDManager::instanceExists())
@@ -1940,8 +1950,15 @@ bool LLAppViewer::cleanup()
 		}
 	}
 	
+	// Its stand-in server may still be answering the fetcher
+	LLTextureFetchBench::cleanupClass();
+
 	// Delete workers first
 	// shotdown all worker threads before deleting them in case of co-dependencies
+	if (LLTextureUploadConverter::instanceExists())
+	{
+		LLTextureUploadConverter::getInstance()->shutdown();
+	}
 	sTextureFetch->shutdown();
 	sTextureCache->shutdown();
 	sImageDecodeThread->shutdown();
@@ -1968,7 +1985,10 @@ bool LLAppViewer::cleanup()
 	LLUIImageList::getInstance()->cleanUp();
 	
 	// This should eventually be done in LLAppViewer
+	LLImageJ2C::stopDecodeThreads();
 	LLImage::cleanupClass();
+	// Everything posting to the shared pool has been stopped by now
+	LLThreadPool::stopShared();
 	LLVFSThread::cleanupClass();
 	LLLFSThread::cleanupClass();
 
@@ -2083,13 +2103,15 @@ bool LLAppViewer::initThreads()
 
 	AICurlInterface::startCurlThread(&gSavedSettings);
 
+	LLThreadPool::startShared(enable_threads ? gSavedSettings.getS32("SharedWorkerThreads") : 0);
 	LLImage::initClass();
+	LLImageJ2C::startDecodeThreads(gSavedSettings.getS32("JPEG2000DecodeThreads"));
 	
 	LLVFSThread::initClass(enable_threads && false);
-	LLLFSThread::initClass(enable_threads && false);
+	LLLFSThread::initClass(enable_threads && false, gSavedSettings.getBOOL("LFSUseIOUring"));
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, gSavedSettings.getS32("ImageDecodeThreads"));
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -3561,7 +3583,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 14;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 15;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -3662,6 +3684,7 @@ bool LLAppViewer::initCache()
 	texture_cache_size -= extra;
 
 	LLVOCache::getInstance()->initCache(LL_PATH_CACHE, gSavedSettings.getU32("CacheNumberOfRegionsForObjects"), getObjectCacheVersion()) ;
+	LLMeshCache::getInstance()->initCache(LL_PATH_CACHE, U64Bytes(U32Megabytes(gSavedSettings.getU32("MeshCacheSize"))).value());
 
 	LLSplashScreen::update(LLTrans::getString("StartupInitializingVFS"));
 	
@@ -3826,6 +3849,8 @@ void LLAppViewer::purgeCache()
 	LL_INFOS("AppCache") << "Purging Cache and Texture Cache..." << LL_ENDL;
 	LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
 	LLVOCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLMeshCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLSessionAccessLog::removeCache();
 	std::string mask = "*.*";
 	gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, ""), mask);
 }
@@ -129,6 +129,7 @@ void LLFace::init(LLDrawable* drawablep, LLViewerObject* objp)
 	mLastSkinTime = gFrameTimeSeconds;
 	mVSize = 0.f;
 	mPixelArea = 16.f;
+	mTexRepeats.setVec(1.f, 1.f);
 	mState      = GLOBAL;
 	mDrawPoolp  = NULL;
 	mPoolType = 0;
@@ -2036,6 +2037,8 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		mTexExtents[1][0] *= es ;
 		mTexExtents[0][1] *= et ;
 		mTexExtents[1][1] *= et ;
+
+		mTexRepeats.setVec(fabsf(ms * es), fabsf(mt * et));
 	}
 
 
@@ -2068,9 +2071,12 @@ void LLFace::resetVirtualSize()
 
 F32 LLFace::getTextureVirtualSize()
 {
+	static LLCachedControl<bool> use_texel_density(gSavedSettings, "TextureTexelDensity");
+
 	F32 radius;
 	F32 cos_angle_to_view_dir;
-	BOOL in_frustum = calcPixelArea(cos_angle_to_view_dir, radius);
+	F32 foreshortening;
+	BOOL in_frustum = calcPixelArea(cos_angle_to_view_dir, radius, foreshortening);
 
 	if (mPixelArea < F_ALMOST_ZERO || !in_frustum)
 	{
@@ -2078,26 +2084,49 @@ F32 LLFace::getTextureVirtualSize()
 		return 0.f;
 	}
 
-	//get area of circle in texture space
-	LLVector2 tdim = mTexExtents[1] - mTexExtents[0];
-	F32 texel_area = (tdim * 0.5f).lengthSquared() * 3.14159f;
-	if (texel_area <= 0)
-	{
-		// Probably animated, use default
-		texel_area = 1.f;
-	}
-
 	F32 face_area;
-	if (mVObjp->isSculpted() && texel_area > 1.f)
+	if (use_texel_density)
 	{
-		//sculpts can break assumptions about texel area
-		face_area = mPixelArea;
+		F32 repeats_s = mTexRepeats.mV[0];
+		F32 repeats_t = mTexRepeats.mV[1];
+		if (repeats_s <= 0.f || repeats_t <= 0.f)
+		{
+			// Probably animated, use default
+			repeats_s = repeats_t = 1.f;
+		}
+
+		if (mVObjp->isSculpted() && repeats_s * repeats_t > 1.f)
+		{
+			//sculpts can break assumptions about texel area
+			face_area = mPixelArea;
+		}
+		else
+		{
+			face_area = calcTexelDensity(mPixelArea, repeats_s, repeats_t, foreshortening);
+		}
 	}
 	else
 	{
-		//apply texel area to face area to get accurate ratio
-		//face_area /= llclamp(texel_area, 1.f/64.f, 16.f);
-		face_area =  mPixelArea / llclamp(texel_area, 0.015625f, 128.f);
+		//get area of circle in texture space
+		LLVector2 tdim = mTexExtents[1] - mTexExtents[0];
+		F32 texel_area = (tdim * 0.5f).lengthSquared() * 3.14159f;
+		if (texel_area <= 0)
+		{
+			// Probably animated, use default
+			texel_area = 1.f;
+		}
+
+		if (mVObjp->isSculpted() && texel_area > 1.f)
+		{
+			//sculpts can break assumptions about texel area
+			face_area = mPixelArea;
+		}
+		else
+		{
+			//apply texel area to face area to get accurate ratio
+			//face_area /= llclamp(texel_area, 1.f/64.f, 16.f);
+			face_area =  mPixelArea / llclamp(texel_area, 0.015625f, 128.f);
+		}
 	}
 
 	face_area = LLFace::adjustPixelArea(mImportanceToCamera, face_area);
@@ -2114,7 +2143,7 @@ F32 LLFace::getTextureVirtualSize()
 	return face_area;
 }
 
-BOOL LLFace::calcPixelArea(F32& cos_angle_to_view_dir, F32& radius)
+BOOL LLFace::calcPixelArea(F32& cos_angle_to_view_dir, F32& radius, F32& foreshortening)
 {
 	//VECTORIZE THIS
 	//get area of circle around face
@@ -2148,6 +2177,15 @@ BOOL LLFace::calcPixelArea(F32& cos_angle_to_view_dir, F32& radius)
 	F32 app_angle = atanf((F32) sqrt(size_squared) / dist);
 	radius = app_angle*LLDrawable::sCurPixelAngle;
 	mPixelArea = radius*radius * 3.14159f;
+
+	// Area of the box around the face seen from the camera, against its largest side seen
+	// head-on: about 1 for anything but flat faces, the cosine of the view angle for those
+	LLVector4a abs_dir;
+	abs_dir.setAbs(lookAt);
+	LLVector4a side_areas(size[1] * size[2], size[0] * size[2], size[0] * size[1]);
+	F32 max_side_area = llmax(side_areas[0], llmax(side_areas[1], side_areas[2]));
+	foreshortening = max_side_area > 0.f ? llmin(abs_dir.dot3(side_areas).getF32() / max_side_area, 1.f) : 1.f;
+
 	LLVector4a x_axis;
 	x_axis.load3(camera->getXAxis().mV);
 	cos_angle_to_view_dir = lookAt.dot3(x_axis).getF32();
@@ -2189,6 +2227,29 @@ BOOL LLFace::calcPixelArea(F32& cos_angle_to_view_dir, F32& radius)
 	return true;
 }
 
+//static
+F32 LLFace::calcTexelDensity(F32 pixel_area, F32 repeats_s, F32 repeats_t, F32 foreshortening)
+{
+	// Side in pixels of the face seen head-on: the square inscribed in the circle of pixel_area
+	F32 side = sqrtf(pixel_area * (2.f / 3.14159f));
+
+	// Texture side needed along each texture axis for one texel a pixel; don't magnify
+	// a small part of the texture by more than 8 times a side
+	F32 need_fine = side / llmax(llmin(repeats_s, repeats_t), 0.125f);
+	F32 need_coarse = side / llmax(llmax(repeats_s, repeats_t), 0.125f);
+
+	// The GPU picks the mip from the axis that needs the fewest texels, or up to the
+	// anisotropic filtering ratio more. Which axis is foreshortened is unknown, take the
+	// one that needs the larger mip.
+	F32 max_anisotropy = LLImageGL::sGlobalUseAnisotropic ? llmax(gGL.getMaxAnisotropy(), 1.f) : 1.f;
+	F32 a = foreshortening * need_fine;
+	F32 sampled = llmin(llmax(a, need_coarse), max_anisotropy * llmin(a, need_coarse));
+	F32 b = foreshortening * need_coarse;
+	sampled = llmax(sampled, llmin(llmax(need_fine, b), max_anisotropy * llmin(need_fine, b)));
+
+	return sampled * sampled;
+}
+
 //the projection of the face partially overlaps with the screen
 F32 LLFace::adjustPartialOverlapPixelArea(F32 cos_angle_to_view_dir, F32 radius )
 {
@@ -245,10 +245,13 @@ public: //aligned members
 
 private:	
 	F32         adjustPartialOverlapPixelArea(F32 cos_angle_to_view_dir, F32 radius );
-	BOOL        calcPixelArea(F32& cos_angle_to_view_dir, F32& radius);
+	BOOL        calcPixelArea(F32& cos_angle_to_view_dir, F32& radius, F32& foreshortening);
 public:
 	static F32  calcImportanceToCamera(F32 to_view_dir, F32 dist);
 	static F32  adjustPixelArea(F32 importance, F32 pixel_area);
+	// Texels of the mip sampled for a face covering pixel_area (the circle around it), its
+	// texture repeated repeats_s by repeats_t times and seen at foreshortening (1 is head-on)
+	static F32  calcTexelDensity(F32 pixel_area, F32 repeats_s, F32 repeats_t, F32 foreshortening);
 
 public:
 	
@@ -256,6 +259,7 @@ public:
 	LLVector3		mCenterAgent;
 	
 	LLVector2		mTexExtents[2];
+	LLVector2		mTexRepeats;	// texture repeats across the face in S and T, ignoring rotation
 	F32				mDistance;
 	F32			mLastUpdateTime;
 	F32			mLastSkinTime;
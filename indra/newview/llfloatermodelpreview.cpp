@@ -75,8 +75,10 @@
 #include "llanimationstates.h"
 #include "llviewernetwork.h"
 #include "llviewershadermgr.h"
-#include "glod/glod.h"
+#include "llmeshsimplifier.h"
+#include "llthreadpool.h"
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 
 #include "hippogridmanager.h"
 #include "hippolimits.h"
@@ -165,17 +167,160 @@ std::string lod_label_name[NUM_LOD+1] =
 	"I went off the end of the lod_label_name array.  Me so smart."
 };
 
-BOOL stop_gloderror()
+// Models simplified at once for genLODs(); each holds a copy of the mesh it
+// works on, don't go overboard
+static const S32 MAX_LOD_THREADS = 8;
+
+struct LLLODGenerator::Batch
 {
-	GLuint error = glodGetError();
+	U32				mID;
+	job_list_t		mJobs;
+	bool			mLockBorders;
+	done_callback_t	mDone;
+	LLAtomicS32		mRemaining;	// jobs not done
+	LLAtomicS32		mCancelled;
+	LLTimer			mTimer;
+};
 
-	if (error != GLOD_NO_ERROR)
+LLLODGenerator::LLLODGenerator()
+:	mLastID(0)
+{
+	S32 count = gSavedSettings.getS32("ImporterLODThreads");
+	if (count < 0)
 	{
-		LL_WARNS() << "GLOD error detected, cannot generate LOD: " << std::hex << error << LL_ENDL;
-		return TRUE;
+		count = MAX_LOD_THREADS;
 	}
+	count = llclamp(count, 0, MAX_LOD_THREADS);
+	mQueue = new LLThreadPool::Queue(LLThreadPool::getShared(), count);
+	gIdleCallbacks.addFunction(idle, this);
+	LL_INFOS("Mesh") << "LoD generation threads: " << (mQueue->isThreaded() ? count : 0) << LL_ENDL;
+}
 
-	return FALSE;
+LLLODGenerator::~LLLODGenerator()
+{
+	gIdleCallbacks.deleteFunction(idle, this);
+	for (std::list<batch_ptr_t>::iterator iter = mBatches.begin(); iter != mBatches.end(); ++iter)
+	{
+		(*iter)->mCancelled = 1;
+	}
+	delete mQueue;
+}
+
+U32 LLLODGenerator::start(job_list_t& jobs, bool lock_borders, const done_callback_t& done)
+{
+	batch_ptr_t batch(new Batch);
+	batch->mID = ++mLastID;
+	batch->mJobs.swap(jobs);
+	batch->mLockBorders = lock_borders;
+	batch->mDone = done;
+	batch->mRemaining = batch->mJobs.size();
+	batch->mCancelled = 0;
+	mBatches.push_back(batch);
+
+	for (U32 i = 0; i < batch->mJobs.size(); ++i)
+	{
+		mQueue->post(boost::bind(&LLLODGenerator::runJob, batch.get(), i));
+	}
+	return batch->mID;
+}
+
+void LLLODGenerator::cancel(U32 batch_id)
+{
+	for (std::list<batch_ptr_t>::iterator iter = mBatches.begin(); iter != mBatches.end(); ++iter)
+	{
+		if ((*iter)->mID == batch_id)
+		{
+			// Kept until its running jobs are done with it
+			(*iter)->mCancelled = 1;
+			break;
+		}
+	}
+}
+
+bool LLLODGenerator::isBusy() const
+{
+	for (std::list<batch_ptr_t>::const_iterator iter = mBatches.begin(); iter != mBatches.end(); ++iter)
+	{
+		if (!(*iter)->mCancelled)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//static
+void LLLODGenerator::idle(void* user_data)
+{
+	((LLLODGenerator*)user_data)->dispatchDone();
+}
+
+void LLLODGenerator::dispatchDone()
+{
+	// The callbacks may start or cancel batches
+	std::vector<batch_ptr_t> done;
+	for (std::list<batch_ptr_t>::iterator iter = mBatches.begin(); iter != mBatches.end(); )
+	{
+		if ((*iter)->mRemaining == 0)
+		{
+			if (!(*iter)->mCancelled)
+			{
+				done.push_back(*iter);
+			}
+			iter = mBatches.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	for (std::vector<batch_ptr_t>::iterator iter = done.begin(); iter != done.end(); ++iter)
+	{
+		Batch& batch = **iter;
+		LL_INFOS("Mesh") << "Generated LoDs of " << batch.mJobs.size() << " models in " << batch.mTimer.getElapsedTimeF32() << " seconds" << LL_ENDL;
+		batch.mDone(batch.mID, batch.mJobs);
+	}
+}
+
+//static
+void LLLODGenerator::runJob(Batch* batch, U32 index)
+{
+	if (!batch->mCancelled)
+	{
+		doJob(batch->mJobs[index], batch->mLockBorders);
+	}
+	--batch->mRemaining;
+}
+
+//static
+void LLLODGenerator::doJob(Job& job, bool lock_borders)
+{
+	LLMeshSimplifier simplifier(job.mBaseFaces, lock_borders);
+
+	for (std::vector<Step>::iterator step = job.mSteps.begin(); step != job.mSteps.end(); ++step)
+	{
+		simplifier.simplify(step->mTriangles, step->mMaxError);
+
+		for (S32 i = 0; i < step->mTarget->getNumVolumeFaces(); ++i)
+		{
+			LLVolumeFace& face = step->mTarget->getVolumeFace(i);
+			simplifier.getFace(i, face);
+
+			if (!face.mNumIndices)
+			{	//this face was eliminated, create a dummy triangle (one vertex, 3 indices, all 0)
+				face.resizeVertices(1);
+				face.resizeIndices(3);
+				face.allocateWeights(0);
+				face.mPositions[0].clear();
+				face.mNormals[0].clear();
+				face.mTexCoords[0].clear();
+				memset(face.mIndices, 0, 3 * sizeof(U16));
+				face.mExtents[0].clear();
+				face.mExtents[1].clear();
+			}
+		}
+	}
 }
 
 LLViewerFetchedTexture* bindMaterialDiffuseTexture(const LLImportMaterial& material)
@@ -1218,12 +1363,8 @@ LLModelPreview::LLModelPreview(S32 width, S32 height, LLFloater* fmp)
 	mGenLOD = false;
 	mLoading = false;
 	mLoadState = LLModelLoader::STARTING;
-	mGroup = 0;
+	mLODGenerator = NULL;
 	mLODFrozen = false;
-	mBuildShareTolerance = 0.f;
-	mBuildQueueMode = GLOD_QUEUE_GREEDY;
-	mBuildBorderMode = GLOD_BORDER_UNLOCK;
-	mBuildOperator = GLOD_OPERATOR_EDGE_COLLAPSE;
 
 	for (U32 i = 0; i < LLModel::NUM_LODS; ++i)
 	{
@@ -1231,10 +1372,7 @@ LLModelPreview::LLModelPreview(S32 width, S32 height, LLFloater* fmp)
 		mRequestedCreaseAngle[i] = -1.f;
 		mRequestedLoDMode[i] = 0;
 		mRequestedErrorThreshold[i] = 0.f;
-		mRequestedBuildOperator[i] = 0;
-		mRequestedQueueMode[i] = 0;
-		mRequestedBorderMode[i] = 0;
-		mRequestedShareTolerance[i] = 0.f;
+		mLODBatch[i] = 0;
 	}
 
 	mViewOption["show_textures"] = false;
@@ -1244,23 +1382,12 @@ LLModelPreview::LLModelPreview(S32 width, S32 height, LLFloater* fmp)
 	mHasPivot = false;
 	mModelPivot = LLVector3(0.0f, 0.0f, 0.0f);
 
-	glodInit();
-
 	createPreviewAvatar();
 }
 
 LLModelPreview::~LLModelPreview()
 {
-	// glod apparently has internal mem alignment issues that are angering
-	// the heap-check code in windows, these should be hunted down in that
-	// TP code, if possible
-	//
-	// kernel32.dll!HeapFree()  + 0x14 bytes	
-	// msvcr100.dll!free(void * pBlock)  Line 51	C
-	// glod.dll!glodGetGroupParameteriv()  + 0x119 bytes	
-	// glod.dll!glodShutdown()  + 0x77 bytes	
-	//
-	//glodShutdown();
+	delete mLODGenerator;
 	if(mModelLoader)
 	{
 		mModelLoader->shutdown();
@@ -1762,6 +1889,7 @@ void LLModelPreview::clearModel(S32 lod)
 		return;
 	}
 
+	cancelGenLOD(lod);
 	mVertexBuffer[lod].clear();
 	mModel[lod].clear();
 	mScene[lod].clear();
@@ -1827,11 +1955,6 @@ void LLModelPreview::loadModel(std::string filename, S32 lod, bool force_disable
 
 	mLODFile[lod] = filename;
 
-	if (lod == LLModel::LOD_HIGH)
-	{
-		clearGLODGroup();
-	}
-
 	std::map<std::string, std::string> joint_alias_map;
 	getJointAliases(joint_alias_map);
 
@@ -1919,14 +2042,19 @@ void LLModelPreview::clearIncompatible(S32 lod)
 		{
 			if (countRootModels(mModel[i]) != lod_size)
 			{
+				cancelGenLOD(i);
 				mModel[i].clear();
 				mScene[i].clear();
 				mVertexBuffer[i].clear();
 
 				if (i == LLModel::LOD_HIGH)
 				{
+					// The LoDs being generated come from the old base
+					for (S32 j = 0; j < LLModel::NUM_LODS; ++j)
+					{
+						cancelGenLOD(j);
+					}
 					mBaseModel = mModel[lod];
-					clearGLODGroup();
 					mBaseScene = mScene[lod];
 					mVertexBuffer[5].clear();
 				}
@@ -1935,23 +2063,6 @@ void LLModelPreview::clearIncompatible(S32 lod)
 	}
 }
 
-void LLModelPreview::clearGLODGroup()
-{
-	if (mGroup)
-	{
-		for (std::map<LLPointer<LLModel>, U32>::iterator iter = mObject.begin(); iter != mObject.end(); ++iter)
-		{
-			glodDeleteObject(iter->second);
-			stop_gloderror();
-		}
-		mObject.clear();
-
-		glodDeleteGroup(mGroup);
-		stop_gloderror();
-		mGroup = 0;
-	}
-}
-
 void LLModelPreview::loadModelCallback(S32 loaded_lod)
 {
 	assert_main_thread();
@@ -1971,6 +2082,11 @@ void LLModelPreview::loadModelCallback(S32 loaded_lod)
 	}
 
 	mLodsWithParsingError.erase(std::remove(mLodsWithParsingError.begin(), mLodsWithParsingError.end(), loaded_lod), mLodsWithParsingError.end());
+	// Whatever gets loaded replaces or invalidates the LoDs being generated
+	for (S32 lod = 0; lod < LLModel::NUM_LODS; ++lod)
+	{
+		cancelGenLOD(lod);
+	}
 	if(mLodsWithParsingError.empty())
 	{
 		mFMP->childEnable( "calculate_btn" );
@@ -2085,7 +2201,6 @@ void LLModelPreview::loadModelCallback(S32 loaded_lod)
 			}
 
 			mBaseModel = mModel[loaded_lod];
-			clearGLODGroup();
 
 			mBaseScene = mScene[loaded_lod];
 			mVertexBuffer[5].clear();
@@ -2321,20 +2436,6 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 		return;
 	}
 
-	LLVertexBuffer::unbind();
-
-	bool no_ff = LLGLSLShader::sNoFixedFunction;
-	LLGLSLShader* shader = LLGLSLShader::sCurBoundShaderPtr;
-	LLGLSLShader::sNoFixedFunction = false;
-
-	if (shader)
-	{
-		shader->unbind();
-	}
-
-	stop_gloderror();
-	static U32 cur_name = 1;
-
 	S32 limit = -1;
 
 	U32 triangle_count = 0;
@@ -2355,9 +2456,11 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 	}
 
 	//get the triangle count for the non-instanced set of models
+	std::vector<U32> model_triangle_count(mBaseModel.size());
 	for (U32 i = 0; i < mBaseModel.size(); ++i)
 	{
-		triangle_count += mBaseModel[i]->getNumTriangles();
+		model_triangle_count[i] = mBaseModel[i]->getNumTriangles();
+		triangle_count += model_triangle_count[i];
 	}
 	
 	//get ratio of uninstanced triangles to instanced triangles
@@ -2365,8 +2468,6 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 
 	U32 base_triangle_count = triangle_count;
 
-	U32 type_mask = LLVertexBuffer::MAP_VERTEX | LLVertexBuffer::MAP_NORMAL | LLVertexBuffer::MAP_TEXCOORD0;
-
 	U32 lod_mode = 0;
 
 	F32 lod_error_threshold = 0;
@@ -2388,10 +2489,9 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 		mRequestedLoDMode[which_lod] = lod_mode;
 	}
 
+	//lod_mode 0 is a triangle budget, 1 an error threshold
 	if (lod_mode == 0)
 	{
-		lod_mode = GLOD_TRIANGLE_BUDGET;
-
 		// The LoD should be in range from Lowest to High
 		if (which_lod > -1 && which_lod < NUM_LOD)
 		{
@@ -2400,65 +2500,6 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 			limit = (S32) ( (F32) limit*triangle_ratio );
 		}
 	}
-	else
-	{
-		lod_mode = GLOD_ERROR_THRESHOLD;
-	}
-
-	bool object_dirty = false;
-
-	if (mGroup == 0)
-	{
-		object_dirty = true;
-		mGroup = cur_name++;
-		glodNewGroup(mGroup);
-	}
-
-	if (object_dirty)
-	{
-		for (LLModelLoader::model_list::iterator iter = mBaseModel.begin(); iter != mBaseModel.end(); ++iter)
-		{	//build GLOD objects for each model in base model list
-			LLModel* mdl = *iter;
-
-			if (mObject[mdl] != 0)
-			{
-				glodDeleteObject(mObject[mdl]);
-			}
-
-			mObject[mdl] = cur_name++;
-
-			glodNewObject(mObject[mdl], mGroup, GLOD_DISCRETE);
-			stop_gloderror();
-
-			if (iter == mBaseModel.begin() && !mdl->mSkinWeights.empty())
-			{	//regenerate vertex buffer for skinned models to prevent animation feedback during LOD generation
-				mVertexBuffer[5].clear();
-			}
-
-			if (mVertexBuffer[5].empty())
-			{
-				genBuffers(5, false);
-			}
-
-			U32 tri_count = 0;
-			for (U32 i = 0; i < mVertexBuffer[5][mdl].size(); ++i)
-			{
-				LLVertexBuffer* buff = mVertexBuffer[5][mdl][i];
-				buff->setBuffer(type_mask & buff->getTypeMask());
-
-				U32 num_indices = mVertexBuffer[5][mdl][i]->getNumIndices();
-				if (num_indices > 2)
-				{
-					glodInsertElements(mObject[mdl], i, GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, (U8*) mVertexBuffer[5][mdl][i]->getIndicesPointer(), 0, 0.f);
-				}
-				tri_count += num_indices/3;
-				stop_gloderror();
-			}
-
-			glodBuildObject(mObject[mdl]);
-			stop_gloderror();
-		}
-	}
 
 	S32 start = LLModel::LOD_HIGH;
 	S32 end = 0;
@@ -2470,6 +2511,14 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 
 	mMaxTriangleLimit = base_triangle_count;
 
+	//one job per base model, simplifying it for every level of detail in turn
+	LLLODGenerator::job_list_t jobs(mBaseModel.size());
+	for (U32 mdl_idx = 0; mdl_idx < mBaseModel.size(); ++mdl_idx)
+	{
+		jobs[mdl_idx].mBase = mBaseModel[mdl_idx];
+		jobs[mdl_idx].mBaseFaces = mBaseModel[mdl_idx]->getVolumeFaces();
+	}
+
 	for (S32 lod = start; lod >= end; --lod)
 	{
 		if (which_lod == -1)
@@ -2494,51 +2543,19 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 			}
 		}
 
-		mModel[lod].clear();
-		mModel[lod].resize(mBaseModel.size());
-		mVertexBuffer[lod].clear();
-
-		U32 actual_tris = 0;
-		U32 actual_verts = 0;
-		U32 submeshes = 0;
+		// The models generated for this LoD so far are stale now
+		cancelGenLOD(lod);
 
 		mRequestedTriangleCount[lod] = (S32) ( (F32) triangle_count / triangle_ratio );
 		mRequestedErrorThreshold[lod] = lod_error_threshold;
 
-		glodGroupParameteri(mGroup, GLOD_ADAPT_MODE, lod_mode);
-		stop_gloderror();
-
-		glodGroupParameteri(mGroup, GLOD_ERROR_MODE, GLOD_OBJECT_SPACE_ERROR);
-		stop_gloderror();
-
-		glodGroupParameterf(mGroup, GLOD_OBJECT_SPACE_ERROR_THRESHOLD, lod_error_threshold);
-		stop_gloderror();
-
-		if (lod_mode != GLOD_TRIANGLE_BUDGET)
-		{ 
-			glodGroupParameteri(mGroup, GLOD_MAX_TRIANGLES, 0);
-		}
-		else
-		{
-			//SH-632: always add 1 to desired amount to avoid decimating below desired amount
-			glodGroupParameteri(mGroup, GLOD_MAX_TRIANGLES, triangle_count + 1);
-		}
-
-		stop_gloderror();
-		glodAdaptGroup(mGroup);
-		stop_gloderror();
-
 		for (U32 mdl_idx = 0; mdl_idx < mBaseModel.size(); ++mdl_idx)
 		{
 			LLModel* base = mBaseModel[mdl_idx];
 
-			GLint patch_count = 0;
-			glodGetObjectParameteriv(mObject[base], GLOD_NUM_PATCHES, &patch_count);
-			stop_gloderror();
-
 			LLVolumeParams volume_params;
 			volume_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
-			mModel[lod][mdl_idx] = new LLModel(volume_params, 0.f);
+			LLModel* target = new LLModel(volume_params, 0.f);
 
             std::string name = base->mLabel;
 
@@ -2551,74 +2568,101 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
                 case LLModel::LOD_HIGH:                      break;
             }
 
-            mModel[lod][mdl_idx]->mLabel = name;
-			mModel[lod][mdl_idx]->mSubmodelID = base->mSubmodelID;
-            
-			GLint* sizes = new GLint[patch_count*2];
-			glodGetObjectParameteriv(mObject[base], GLOD_PATCH_SIZES, sizes);
-			stop_gloderror();
-
-			GLint* names = new GLint[patch_count];
-			glodGetObjectParameteriv(mObject[base], GLOD_PATCH_NAMES, names);
-			stop_gloderror();
-
-			mModel[lod][mdl_idx]->setNumVolumeFaces(patch_count);
-
-			LLModel* target_model = mModel[lod][mdl_idx];
-
-			for (GLint i = 0; i < patch_count; ++i)
+            target->mLabel = name;
+			target->mSubmodelID = base->mSubmodelID;
+			target->setNumVolumeFaces(base->getNumVolumeFaces());
+
+			LLLODGenerator::Step step;
+			step.mLOD = lod;
+			step.mTarget = target;
+			if (lod_mode == 0)
+			{	//share the triangle budget between the models by their size
+				step.mTriangles = (S32) llmin((F64) triangle_count * model_triangle_count[mdl_idx] / llmax(base_triangle_count, 1U), (F64) S32_MAX);
+				step.mMaxError = -1.f;
+			}
+			else
 			{
-				type_mask = mVertexBuffer[5][base][i]->getTypeMask();
+				step.mTriangles = 0;
+				step.mMaxError = lod_error_threshold;
+			}
+			jobs[mdl_idx].mSteps.push_back(step);
+		}
+	}
 
-				LLPointer<LLVertexBuffer> buff = new LLVertexBuffer(type_mask, 0);
+	if (!mLODGenerator)
+	{
+		mLODGenerator = new LLLODGenerator;
+	}
+	U32 batch_id = mLODGenerator->start(jobs, gSavedSettings.getBOOL("ImporterLODLockBorders"),
+										boost::bind(&LLModelPreview::applyGeneratedLODs, this, _1, _2));
+	for (S32 lod = start; lod >= end; --lod)
+	{
+		mLODBatch[lod] = batch_id;
+	}
+}
 
-				if (sizes[i*2 + 1] > 0 && sizes[i*2] > 0)
-				{
-					buff->allocateBuffer(sizes[i*2 + 1], sizes[i*2], true);
-					buff->setBuffer(type_mask);
-					glodFillElements(mObject[base], names[i], GL_UNSIGNED_SHORT, (U8*) buff->getIndicesPointer());
-					stop_gloderror();
-				}
-				else
-				{	//this face was eliminated, create a dummy triangle (one vertex, 3 indices, all 0)
-					buff->allocateBuffer(1, 3, true);
-					memset((U8*) buff->getMappedData(), 0, buff->getSize());
-					memset((U8*) buff->getIndicesPointer(), 0, buff->getIndicesSize());
-				}
+void LLModelPreview::cancelGenLOD(S32 lod)
+{
+	U32 batch_id = mLODBatch[lod];
+	if (!batch_id)
+	{
+		return;
+	}
+	mLODBatch[lod] = 0;
+
+	// A batch generating all the LoDs goes on as long as one of them still waits for it
+	for (S32 i = 0; i < LLModel::NUM_LODS; ++i)
+	{
+		if (mLODBatch[i] == batch_id)
+		{
+			return;
+		}
+	}
+	mLODGenerator->cancel(batch_id);
+}
 
-				buff->validateRange(0, buff->getNumVerts() - 1, buff->getNumIndices(), 0);
+bool LLModelPreview::isGeneratingLODs() const
+{
+	return mLODGenerator && mLODGenerator->isBusy();
+}
 
-				LLStrider<LLVector3> pos;
-				LLStrider<LLVector3> norm;
-				LLStrider<LLVector2> tc;
-				LLStrider<U16> index;
+void LLModelPreview::applyGeneratedLODs(U32 batch_id, const LLLODGenerator::job_list_t& jobs)
+{
+	assert_main_thread();
 
-				buff->getVertexStrider(pos);
-				if (type_mask & LLVertexBuffer::MAP_NORMAL)
-				{
-					buff->getNormalStrider(norm);
-				}
-				if (type_mask & LLVertexBuffer::MAP_TEXCOORD0)
-				{
-					buff->getTexCoord0Strider(tc);
-				}
+	bool applied = false;
+	for (U32 step_idx = 0; !jobs.empty() && step_idx < jobs[0].mSteps.size(); ++step_idx)
+	{
+		S32 lod = jobs[0].mSteps[step_idx].mLOD;
+		if (mLODBatch[lod] != batch_id)
+		{	//generated again, or replaced by a model from a file, since
+			continue;
+		}
+		mLODBatch[lod] = 0;
+		applied = true;
 
-				buff->getIndexStrider(index);
+		U32 actual_tris = 0;
+		mModel[lod].clear();
+		mModel[lod].resize(jobs.size());
+		mVertexBuffer[lod].clear();
 
-				target_model->setVolumeFaceData(names[i], pos, norm, tc, index, buff->getNumVerts(), buff->getNumIndices());
-				actual_tris += buff->getNumIndices()/3;
-				actual_verts += buff->getNumVerts();
-				++submeshes;
+		for (U32 mdl_idx = 0; mdl_idx < jobs.size(); ++mdl_idx)
+		{
+			LLModel* base = jobs[mdl_idx].mBase;
+			LLModel* target_model = jobs[mdl_idx].mSteps[step_idx].mTarget;
+			mModel[lod][mdl_idx] = target_model;
 
-				if (!validate_face(target_model->getVolumeFace(names[i])))
+			for (S32 i = 0; i < target_model->getNumVolumeFaces(); ++i)
+			{
+				if (!validate_face(target_model->getVolumeFace(i)))
 				{
 					LL_ERRS() << "Invalid face generated during LOD generation." << LL_ENDL;
 				}
+				actual_tris += target_model->getVolumeFace(i).mNumIndices / 3;
 			}
 
-			//blind copy skin weights and just take closest skin weight to point on
-			//decimated mesh for now (auto-generating LODs with skin weights is still a bit
-			//of an open problem).
+			//the simplified faces keep vertices of the base model, so its skin
+			//weights, looked up by position, still hold
 			target_model->mPosition = base->mPosition;
 			target_model->mSkinWeights = base->mSkinWeights;
 			target_model->mSkinInfo = base->mSkinInfo;
@@ -2629,18 +2673,17 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 			{
 				LL_ERRS() << "Invalid model generated when creating LODs" << LL_ENDL;
 			}
-
-			delete [] sizes;
-			delete [] names;
 		}
 
+		LL_DEBUGS("Mesh") << "LoD " << lod << ": " << actual_tris << " triangles, requested " << mRequestedTriangleCount[lod] << LL_ENDL;
+
 		//rebuild scene based on mBaseScene
 		mScene[lod].clear();
 		mScene[lod] = mBaseScene;
 
-		for (U32 i = 0; i < mBaseModel.size(); ++i)
+		for (U32 i = 0; i < jobs.size(); ++i)
 		{
-			LLModel* mdl = mBaseModel[i];
+			LLModel* mdl = jobs[i].mBase;
 			LLModel* target = mModel[lod][i];
 			if (target)
 			{
@@ -2658,15 +2701,12 @@ void LLModelPreview::genLODs(S32 which_lod, U32 decimation, bool enforce_tri_lim
 		}
 	}
 
-	mResourceCost = calcResourceCost();
-
-	LLVertexBuffer::unbind();
-	LLGLSLShader::sNoFixedFunction = no_ff;
-	if (shader)
-	{
-		shader->bind();
+	if (applied)
+	{	//update() recomputes the cost and refreshes the floater
+		mDirty = true;
 	}
 }
+
 void LLModelPreview::genModelBBox()
 {
 	LLVector3 min, max;
@@ -3305,6 +3345,7 @@ void LLModelPreview::updateLodControls(S32 lod)
 
 		if (lod < LLModel::LOD_HIGH)
 		{
+			cancelGenLOD(lod);
 			mModel[lod] = mModel[lod + 1];
 			mScene[lod] = mScene[lod + 1];
 			mVertexBuffer[lod].clear();
@@ -4419,6 +4460,11 @@ bool LLModelPreview::lodQueryCallback()
 				// return false to continue cycle
 				return false;
 			}
+			if (preview->isGeneratingLODs())
+			{
+				// the generated LoDs are applied from the idle loop, wait for them
+				return false;
+			}
 		}
 
 		for (U32 lod = 0; lod < NUM_LOD; ++lod)
@@ -33,11 +33,16 @@
 #include "llmeshrepository.h"
 #include "llmodel.h"
 #include "llthread.h"
+#include "llthreadpool.h"
 #include "llviewermenufile.h"
 #include "llfloatermodeluploadbase.h"
 
 #include "lldaeloader.h"
 
+#include <list>
+
+#include <boost/shared_ptr.hpp>
+
 class LLComboBox;
 class LLJoint;
 class LLViewerJointMesh;
@@ -210,6 +215,65 @@ private:
 	LLButton* mCalculateBtn;
 };
 
+//
+// Simplifies the base models for LLModelPreview::genLODs() on the shared
+// worker pool, one model per job, while the frame loop goes on.  Each call to
+// start() is a batch; the callback of a batch is called on the main thread,
+// from the idle loop, once all its models are done.  The LoDs are generated
+// again each time a LoD control changes, so a batch that is superseded before
+// it is done can be cancelled.
+//
+class LLLODGenerator
+{
+public:
+	struct Step
+	{
+		S32					mLOD;			// level of detail, for the caller
+		LLPointer<LLModel>	mTarget;		// gets the faces of the base model, simplified
+		S32					mTriangles;		// at most that many triangles,
+		F32					mMaxError;		// or no collapse moving the surface further than this, if not negative
+	};
+
+	struct Job
+	{
+		LLPointer<LLModel>	mBase;
+		// Copy of the faces of mBase, taken on the main thread: the preview may
+		// regenerate the normals of mBase while the job runs
+		LLVolume::face_list_t	mBaseFaces;
+		std::vector<Step>	mSteps;	// from the most detailed level, each carrying on from the previous one
+	};
+	typedef std::vector<Job> job_list_t;
+	typedef boost::function<void (U32 batch_id, const job_list_t& jobs)> done_callback_t;
+
+	LLLODGenerator();
+	// Cancels every batch and waits for the models being simplified
+	~LLLODGenerator();
+
+	// Takes the contents of jobs. Returns the id of the new batch, never 0
+	U32 start(job_list_t& jobs, bool lock_borders, const done_callback_t& done);
+	// The models of the batch not started yet are skipped and its callback is not called
+	void cancel(U32 batch_id);
+	// Some batch not cancelled is not reported yet
+	bool isBusy() const;
+
+	static void idle(void* user_data);
+
+private:
+	struct Batch;
+	typedef boost::shared_ptr<Batch> batch_ptr_t;
+
+	// Runs on the pool.  The batch belongs to mBatches, which keeps it until
+	// mRemaining drops to 0, so the models are only released on the main thread.
+	static void runJob(Batch* batch, U32 index);
+	static void doJob(Job& job, bool lock_borders);
+	void dispatchDone();
+
+private:
+	LLThreadPool::Queue*	mQueue;
+	std::list<batch_ptr_t>	mBatches;	// not reported or not finished yet, main thread only
+	U32						mLastID;
+};
+
 class LLModelPreview : public LLViewerDynamicTexture, public LLMutex
 {
 	typedef boost::signals2::signal<void (F32 x, F32 y, F32 z, F32 streaming_cost, F32 physics_cost)> details_signal_t;
@@ -258,9 +322,14 @@ public:
 	void getJointAliases(JointMap& joint_map);
 	void loadModel(std::string filename, S32 lod, bool force_disable_slm = false);
 	void loadModelCallback(S32 lod);
-    bool lodsReady() { return !mGenLOD && mLodsQuery.empty(); }
+    bool lodsReady() { return !mGenLOD && mLodsQuery.empty() && !isGeneratingLODs(); }
     void queryLODs() { mGenLOD = true; };
+	// Starts generating the LoDs on the shared worker pool, they replace mModel[lod] once done
 	void genLODs(S32 which_lod = -1, U32 decimation = 3, bool enforce_tri_limit = false);
+	// Forget the LoD being generated for lod, it is out of date
+	void cancelGenLOD(S32 lod);
+	bool isGeneratingLODs() const;
+	void applyGeneratedLODs(U32 batch_id, const LLLODGenerator::job_list_t& jobs);
 	void genModelBBox(); // Generate just a model BBox if we can't generate proper LOD
 	void generateNormals();
 	void restoreNormals();
@@ -271,7 +340,6 @@ public:
 	void clearIncompatible(S32 lod);
 	void updateStatusMessages();
 	void updateLodControls(S32 lod);
-	void clearGLODGroup();
 	void onLODParamCommit(S32 lod, bool enforce_tri_limit);
 	void addEmptyFace(LLModel* pTarget);
 
@@ -355,20 +423,14 @@ private:
 
 	std::map<std::string, bool> mViewOption;
 
-	//GLOD object parameters (must rebuild object if these change)
+	//LoD generation parameters
 	bool mLODFrozen;
-	F32 mBuildShareTolerance;
-	U32 mBuildQueueMode;
-	U32 mBuildOperator;
-	U32 mBuildBorderMode;
 	U32 mRequestedLoDMode[LLModel::NUM_LODS];
 	S32 mRequestedTriangleCount[LLModel::NUM_LODS];
 	F32 mRequestedErrorThreshold[LLModel::NUM_LODS];
-	U32 mRequestedBuildOperator[LLModel::NUM_LODS];
-	U32 mRequestedQueueMode[LLModel::NUM_LODS];
-	U32 mRequestedBorderMode[LLModel::NUM_LODS];
-	F32 mRequestedShareTolerance[LLModel::NUM_LODS];
 	F32 mRequestedCreaseAngle[LLModel::NUM_LODS];
+	LLLODGenerator* mLODGenerator;
+	U32 mLODBatch[LLModel::NUM_LODS];	// LoD generator batch generating each LoD, 0 if none
 
 	LLModelLoader* mModelLoader;
 
@@ -384,8 +446,6 @@ private:
 	vv_LLVolumeFace_t mModelFacesCopy[LLModel::NUM_LODS];
 	vv_LLVolumeFace_t mBaseModelFacesCopy;
 
-	U32 mGroup;
-	std::map<LLPointer<LLModel>, U32> mObject;
 	U32 mMaxTriangleLimit;
 
 	LLMeshUploadThread::instance_list mUploadData;
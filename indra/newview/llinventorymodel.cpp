@@ -57,6 +57,9 @@
 #include "llsdutil.h"
 #include "statemachine/aievent.h"
 
+#include <boost/unordered_map.hpp>
+#include <zlib.h>
+
 // [RLVa:KB] - Checked: 2011-05-22 (RLVa-1.3.1a)
 #include "rlvhandler.h"
 #include "rlvlocks.h"
@@ -78,6 +81,7 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
 static const char CACHE_FORMAT_STRING[] = "%s.inv"; 
+static const char BINARY_CACHE_FORMAT_STRING[] = "%s.invb";
 static const char * const LOG_INV("Inventory");
 
 struct InventoryIDPtrLess
@@ -1764,9 +1768,15 @@ void LLInventoryModel::cache(
 	agent_id.toString(agent_id_str);
 	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
 	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
-	saveToFile(inventory_filename, categories, items);
 	std::string gzip_filename(inventory_filename);
 	gzip_filename.append(".gz");
+	if (saveToBinaryFile(llformat(BINARY_CACHE_FORMAT_STRING, path.c_str()), categories, items))
+	{
+		// Don't leave an outdated text cache around to fall back to.
+		LLFile::remove(gzip_filename);
+		return;
+	}
+	saveToFile(inventory_filename, categories, items);
 	if(gzip_file(inventory_filename, gzip_filename))
 	{
 		LL_DEBUGS(LOG_INV) << "Successfully compressed " << inventory_filename << LL_ENDL;
@@ -2084,26 +2094,39 @@ bool LLInventoryModel::loadSkeleton(
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
 		std::string gzip_filename(inventory_filename);
 		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
 		bool remove_inventory_file = false;
-		if(fp)
-		{
-			fclose(fp);
-			fp = nullptr;
-			if(gunzip_file(gzip_filename, inventory_filename))
-			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
-			}
-			else
+		bool is_cache_obsolete = false;
+		LLTimer load_timer;
+		bool loaded = loadFromBinaryFile(llformat(BINARY_CACHE_FORMAT_STRING, path.c_str()),
+										 categories, items, categories_to_update, is_cache_obsolete);
+		if (!loaded)
+		{
+			// Fall back to the text cache written by older viewers.
+			categories.clear();
+			items.clear();
+			categories_to_update.clear();
+			LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+			if(fp)
 			{
-				LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
+				fclose(fp);
+				fp = nullptr;
+				if(gunzip_file(gzip_filename, inventory_filename))
+				{
+					// we only want to remove the inventory file if it was
+					// gzipped before we loaded, and we successfully
+					// gunziped it.
+					remove_inventory_file = true;
+				}
+				else
+				{
+					LL_INFOS(LOG_INV) << "Unable to gunzip " << gzip_filename << LL_ENDL;
+				}
 			}
+			loaded = loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete);
 		}
-		bool is_cache_obsolete = false;
-		if (loadFromFile(inventory_filename, categories, items, categories_to_update, is_cache_obsolete))
+		LL_INFOS(LOG_INV) << "Read " << categories.size() << " categories and " << items.size()
+						  << " items from the inventory cache in " << load_timer.getElapsedTimeF32() << " seconds" << LL_ENDL;
+		if (loaded)
 		{
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
@@ -2748,6 +2771,360 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 	return true;
 }
 
+//----------------------------------------------------------------------------
+// Binary inventory cache
+//
+// Layout: an LLInvCacheHeader, followed by the zlib compressed body made of
+// the UUID table, the category records, the item records and the string
+// pool. Records refer to UUIDs by index in the table and to strings by
+// offset in the pool, so the whole body is parsed straight out of memory.
+//----------------------------------------------------------------------------
+
+static const U32 BINARY_CACHE_MAGIC = 0x42564E49; // "INVB"
+
+struct LLInvCacheHeader
+{
+	U32 mMagic;
+	S32 mVersion;
+	U32 mUUIDCount;
+	U32 mCategoryCount;
+	U32 mItemCount;
+	U32 mStringPoolSize;
+	U32 mBodySize;			// Size of the inflated body
+	U32 mCompressedSize;	// Size of the body on disk
+};
+
+struct LLInvCacheCategory
+{
+	U32 mID;
+	U32 mParentID;
+	U32 mOwnerID;
+	S32 mType;
+	S32 mPreferredType;
+	S32 mVersion;
+	U32 mName;
+};
+
+struct LLInvCacheItem
+{
+	U32 mID;
+	U32 mParentID;
+	U32 mAssetID;
+	U32 mCreatorID;
+	U32 mOwnerID;
+	U32 mLastOwnerID;
+	U32 mGroupID;
+	U32 mGroupOwned;
+	U32 mMaskBase;
+	U32 mMaskOwner;
+	U32 mMaskGroup;
+	U32 mMaskEveryone;
+	U32 mMaskNextOwner;
+	S32 mType;
+	S32 mInventoryType;
+	U32 mFlags;
+	S32 mSaleType;
+	S32 mSalePrice;
+	S32 mCreationDate;
+	U32 mName;
+	U32 mDescription;
+};
+
+// Collects the UUIDs and strings referenced by the records while saving.
+class LLInvCachePools
+{
+public:
+	U32 addUUID(const LLUUID& id)
+	{
+		std::pair<uuid_index_map_t::iterator, bool> result = mUUIDIndices.insert(std::make_pair(id, (U32)mUUIDs.size()));
+		if (result.second)
+		{
+			mUUIDs.push_back(id);
+		}
+		return result.first->second;
+	}
+
+	U32 addString(const std::string& str)
+	{
+		U32 offset = mStrings.size();
+		mStrings.insert(mStrings.end(), str.begin(), str.end());
+		mStrings.push_back('\0');
+		return offset;
+	}
+
+	const uuid_vec_t& getUUIDs() const				{ return mUUIDs; }
+	const std::vector<char>& getStrings() const		{ return mStrings; }
+
+private:
+	typedef boost::unordered_map<LLUUID, U32> uuid_index_map_t;
+	uuid_index_map_t mUUIDIndices;
+	uuid_vec_t mUUIDs;
+	std::vector<char> mStrings;
+};
+
+// static
+bool LLInventoryModel::loadFromBinaryFile(const std::string& filename,
+										  LLInventoryModel::cat_array_t& categories,
+										  LLInventoryModel::item_array_t& items,
+										  LLInventoryModel::changed_items_t& cats_to_update,
+										  bool& is_cache_obsolete)
+{
+	LLFILE* file = LLFile::fopen(filename, "rb");		/*Flawfinder: ignore*/
+	if(!file)
+	{
+		LL_INFOS(LOG_INV) << "unable to load inventory from: " << filename << LL_ENDL;
+		return false;
+	}
+
+	LLInvCacheHeader header;
+	std::vector<U8> compressed;
+	bool success = fread(&header, sizeof(LLInvCacheHeader), 1, file) == 1 && header.mMagic == BINARY_CACHE_MAGIC;
+	if (success && header.mVersion != sCurrentInvCacheVersion)
+	{
+		LL_WARNS(LOG_INV) << "Inv cache out of date, removing" << LL_ENDL;
+		fclose(file);
+		LLFile::remove(filename);
+		is_cache_obsolete = true;
+		return false;
+	}
+	if (success)
+	{
+		compressed.resize(header.mCompressedSize);
+		success = header.mCompressedSize > 0
+			&& fread(&compressed[0], 1, header.mCompressedSize, file) == header.mCompressedSize;
+	}
+	fclose(file);
+
+	// Validate the sizes before trusting any offset in the body.
+	const U64 uuid_bytes = (U64)header.mUUIDCount * UUID_BYTES;
+	const U64 category_bytes = (U64)header.mCategoryCount * sizeof(LLInvCacheCategory);
+	const U64 item_bytes = (U64)header.mItemCount * sizeof(LLInvCacheItem);
+	success = success
+		&& header.mStringPoolSize > 0
+		&& uuid_bytes + category_bytes + item_bytes + header.mStringPoolSize == header.mBodySize;
+
+	std::vector<U8> body;
+	if (success)
+	{
+		body.resize(header.mBodySize);
+		uLongf body_size = header.mBodySize;
+		success = uncompress(&body[0], &body_size, &compressed[0], header.mCompressedSize) == Z_OK
+			&& body_size == header.mBodySize;
+		compressed.clear();
+	}
+	if (!success)
+	{
+		LL_WARNS(LOG_INV) << "Invalid inventory cache " << filename << LL_ENDL;
+		return false;
+	}
+
+	const LLUUID* uuids = reinterpret_cast<const LLUUID*>(&body[0]);
+	const LLInvCacheCategory* cat_records = reinterpret_cast<const LLInvCacheCategory*>(&body[uuid_bytes]);
+	const LLInvCacheItem* item_records = reinterpret_cast<const LLInvCacheItem*>(&body[uuid_bytes + category_bytes]);
+	const char* strings = reinterpret_cast<const char*>(&body[uuid_bytes + category_bytes + item_bytes]);
+	if (strings[header.mStringPoolSize - 1] != '\0')
+	{
+		LL_WARNS(LOG_INV) << "Invalid string pool in inventory cache " << filename << LL_ENDL;
+		return false;
+	}
+
+	categories.reserve(categories.size() + header.mCategoryCount);
+	for (U32 i = 0; i < header.mCategoryCount; ++i)
+	{
+		const LLInvCacheCategory& record = cat_records[i];
+		if (llmax(record.mID, llmax(record.mParentID, record.mOwnerID)) >= header.mUUIDCount
+			|| record.mName >= header.mStringPoolSize)
+		{
+			LL_WARNS(LOG_INV) << "Invalid category record in inventory cache " << filename << LL_ENDL;
+			return false;
+		}
+		LLPointer<LLViewerInventoryCategory> inv_cat = new LLViewerInventoryCategory(uuids[record.mOwnerID]);
+		inv_cat->setUUID(uuids[record.mID]);
+		inv_cat->setParent(uuids[record.mParentID]);
+		inv_cat->setType((LLAssetType::EType)record.mType);
+		inv_cat->setPreferredType((LLFolderType::EType)record.mPreferredType);
+		inv_cat->rename(strings + record.mName);
+		inv_cat->setVersion(record.mVersion);
+		categories.push_back(inv_cat);
+	}
+
+	items.reserve(items.size() + header.mItemCount);
+	for (U32 i = 0; i < header.mItemCount; ++i)
+	{
+		const LLInvCacheItem& record = item_records[i];
+		const U32 max_uuid = llmax(llmax(llmax(record.mID, record.mParentID), llmax(record.mAssetID, record.mCreatorID)),
+								   llmax(llmax(record.mOwnerID, record.mLastOwnerID), record.mGroupID));
+		if (max_uuid >= header.mUUIDCount
+			|| record.mName >= header.mStringPoolSize
+			|| record.mDescription >= header.mStringPoolSize)
+		{
+			LL_WARNS(LOG_INV) << "Invalid item record in inventory cache " << filename << LL_ENDL;
+			return false;
+		}
+
+		if (uuids[record.mID].isNull())
+		{
+			LL_WARNS(LOG_INV) << "Ignoring inventory with null item id: " << (strings + record.mName) << LL_ENDL;
+			continue;
+		}
+		if (record.mType == LLAssetType::AT_UNKNOWN)
+		{
+			cats_to_update.insert(uuids[record.mParentID]);
+			continue;
+		}
+
+		LLPermissions perm;
+		perm.init(uuids[record.mCreatorID], uuids[record.mOwnerID], uuids[record.mLastOwnerID], uuids[record.mGroupID]);
+		perm.initMasks(record.mMaskBase, record.mMaskOwner, record.mMaskEveryone, record.mMaskGroup, record.mMaskNextOwner);
+		perm.yesReallySetOwner(uuids[record.mOwnerID], record.mGroupOwned != 0);
+
+		LLPointer<LLViewerInventoryItem> inv_item = new LLViewerInventoryItem(
+			uuids[record.mID],
+			uuids[record.mParentID],
+			perm,
+			uuids[record.mAssetID],
+			(LLAssetType::EType)record.mType,
+			(LLInventoryType::EType)record.mInventoryType,
+			strings + record.mName,
+			strings + record.mDescription,
+			LLSaleInfo((LLSaleInfo::EForSale)record.mSaleType, record.mSalePrice),
+			record.mFlags,
+			(time_t)record.mCreationDate);
+		// Same as the text cache: the item still needs to be fetched before use.
+		inv_item->setComplete(FALSE);
+		items.push_back(inv_item);
+	}
+
+	is_cache_obsolete = false;
+	return true;
+}
+
+// static
+bool LLInventoryModel::saveToBinaryFile(const std::string& filename,
+										const cat_array_t& categories,
+										const item_array_t& items)
+{
+	if(filename.empty())
+	{
+		LL_ERRS(LOG_INV) << "Filename is Null!" << LL_ENDL;
+		return false;
+	}
+	LL_INFOS(LOG_INV) << "LLInventoryModel::saveToBinaryFile(" << filename << ")" << LL_ENDL;
+
+	LLInvCachePools pools;
+
+	std::vector<LLInvCacheCategory> cat_records;
+	cat_records.reserve(categories.size());
+	for (cat_array_t::const_iterator it = categories.begin(); it != categories.end(); ++it)
+	{
+		const LLViewerInventoryCategory* cat = *it;
+		if (cat->getVersion() == LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			continue;
+		}
+		LLInvCacheCategory record;
+		record.mID = pools.addUUID(cat->getUUID());
+		record.mParentID = pools.addUUID(cat->getParentUUID());
+		record.mOwnerID = pools.addUUID(cat->getOwnerID());
+		record.mType = cat->getType();
+		record.mPreferredType = cat->getPreferredType();
+		record.mVersion = cat->getVersion();
+		record.mName = pools.addString(cat->getName());
+		cat_records.push_back(record);
+	}
+
+	std::vector<LLInvCacheItem> item_records;
+	item_records.reserve(items.size());
+	for (item_array_t::const_iterator it = items.begin(); it != items.end(); ++it)
+	{
+		// Use the item's own fields, not the ones of what it links to.
+		const LLViewerInventoryItem* item = *it;
+		const LLPermissions& perm = item->LLInventoryItem::getPermissions();
+		const LLSaleInfo& sale_info = item->LLInventoryItem::getSaleInfo();
+		LLInvCacheItem record;
+		record.mID = pools.addUUID(item->getUUID());
+		record.mParentID = pools.addUUID(item->getParentUUID());
+		record.mAssetID = pools.addUUID(item->LLInventoryItem::getAssetUUID());
+		record.mCreatorID = pools.addUUID(perm.getCreator());
+		record.mOwnerID = pools.addUUID(perm.getOwner());
+		record.mLastOwnerID = pools.addUUID(perm.getLastOwner());
+		record.mGroupID = pools.addUUID(perm.getGroup());
+		record.mGroupOwned = perm.isGroupOwned();
+		record.mMaskBase = perm.getMaskBase();
+		record.mMaskOwner = perm.getMaskOwner();
+		record.mMaskGroup = perm.getMaskGroup();
+		record.mMaskEveryone = perm.getMaskEveryone();
+		record.mMaskNextOwner = perm.getMaskNextOwner();
+		record.mType = item->getActualType();
+		record.mInventoryType = item->LLInventoryItem::getInventoryType();
+		record.mFlags = item->LLInventoryItem::getFlags();
+		record.mSaleType = sale_info.getSaleType();
+		record.mSalePrice = sale_info.getSalePrice();
+		record.mCreationDate = (S32)item->LLInventoryItem::getCreationDate();
+		record.mName = pools.addString(item->LLInventoryObject::getName());
+		record.mDescription = pools.addString(item->getActualDescription());
+		item_records.push_back(record);
+	}
+
+	const uuid_vec_t& uuids = pools.getUUIDs();
+	const std::vector<char>& strings = pools.getStrings();
+	const size_t uuid_bytes = uuids.size() * UUID_BYTES;
+	const size_t category_bytes = cat_records.size() * sizeof(LLInvCacheCategory);
+	const size_t item_bytes = item_records.size() * sizeof(LLInvCacheItem);
+
+	std::vector<U8> body(uuid_bytes + category_bytes + item_bytes + strings.size());
+	U8* dst = &body[0];
+	for (uuid_vec_t::const_iterator it = uuids.begin(); it != uuids.end(); ++it, dst += UUID_BYTES)
+	{
+		memcpy(dst, it->mData, UUID_BYTES);		/* Flawfinder: ignore */
+	}
+	if (category_bytes)
+	{
+		memcpy(dst, &cat_records[0], category_bytes);		/* Flawfinder: ignore */
+		dst += category_bytes;
+	}
+	if (item_bytes)
+	{
+		memcpy(dst, &item_records[0], item_bytes);		/* Flawfinder: ignore */
+		dst += item_bytes;
+	}
+	memcpy(dst, &strings[0], strings.size());		/* Flawfinder: ignore */
+
+	uLongf compressed_size = compressBound(body.size());
+	std::vector<U8> compressed(compressed_size);
+	if (compress2(&compressed[0], &compressed_size, &body[0], body.size(), Z_BEST_SPEED) != Z_OK)
+	{
+		LL_WARNS(LOG_INV) << "Unable to compress inventory cache" << LL_ENDL;
+		return false;
+	}
+
+	LLInvCacheHeader header;
+	header.mMagic = BINARY_CACHE_MAGIC;
+	header.mVersion = sCurrentInvCacheVersion;
+	header.mUUIDCount = uuids.size();
+	header.mCategoryCount = cat_records.size();
+	header.mItemCount = item_records.size();
+	header.mStringPoolSize = strings.size();
+	header.mBodySize = body.size();
+	header.mCompressedSize = compressed_size;
+
+	LLFILE* file = LLFile::fopen(filename, "wb");		/*Flawfinder: ignore*/
+	if(!file)
+	{
+		LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(LLInvCacheHeader), 1, file) == 1
+		&& fwrite(&compressed[0], 1, compressed_size, file) == compressed_size;
+	fclose(file);
+	if (!success)
+	{
+		LL_WARNS(LOG_INV) << "unable to save inventory to: " << filename << LL_ENDL;
+		LLFile::remove(filename);
+	}
+	return success;
+}
+
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
@@ -0,0 +1,621 @@
+/**
+ * @file llmeshcache.cpp
+ * @brief On-disk cache of mesh assets, independent of the VFS.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshcache.h"
+
+#include "llapr.h"
+#include "llfile.h"
+
+static const U32 MESH_CACHE_INDEX_MAGIC = 0x49534d53; // "SMSI"
+static const U32 MESH_CACHE_INDEX_VERSION = 1;
+// once over budget, evict down to this fraction of it so we don't purge on every write
+static const F32 PURGE_TARGET_FRACTION = 0.9f;
+
+struct LLMeshCacheIndexHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mNumEntries;
+};
+
+struct LLMeshCacheIndexRecord
+{
+	LLUUID mID;
+	S32 mHeaderSize;
+	U32 mLastAccess;
+	U32 mNumRanges;
+};
+
+U32 LLMeshCache::sCacheHits = 0;
+U32 LLMeshCache::sCacheMisses = 0;
+U64 LLMeshCache::sBytesSaved = 0;
+
+//---------------------------------------------------------------------------
+// LLMeshCache::Entry
+//---------------------------------------------------------------------------
+
+bool LLMeshCache::Entry::hasRange(S32 begin, S32 end) const
+{
+	for (range_vec_t::const_iterator iter = mRanges.begin(); iter != mRanges.end(); ++iter)
+	{
+		if (iter->first <= begin)
+		{
+			if (iter->second >= end)
+			{
+				return true;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+	return false;
+}
+
+void LLMeshCache::Entry::addRange(S32 begin, S32 end)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	range_vec_t merged;
+	merged.reserve(mRanges.size() + 1);
+
+	bool inserted = false;
+	for (range_vec_t::const_iterator iter = mRanges.begin(); iter != mRanges.end(); ++iter)
+	{
+		if (iter->second < begin)
+		{ //entirely before the new range
+			merged.push_back(*iter);
+		}
+		else if (iter->first > end)
+		{ //entirely after the new range
+			if (!inserted)
+			{
+				merged.push_back(range_t(begin, end));
+				inserted = true;
+			}
+			merged.push_back(*iter);
+		}
+		else
+		{ //overlapping or adjacent, grow the new range
+			begin = llmin(begin, iter->first);
+			end = llmax(end, iter->second);
+		}
+	}
+
+	if (!inserted)
+	{
+		merged.push_back(range_t(begin, end));
+	}
+
+	mRanges.swap(merged);
+}
+
+//---------------------------------------------------------------------------
+// LLMeshCache
+//---------------------------------------------------------------------------
+
+LLMeshCache::LLMeshCache()
+:	mInitialized(false),
+	mMaxSize(0),
+	mUsage(0),
+	mAccessCounter(0),
+	mGenerationCounter(0)
+{
+}
+
+LLMeshCache::~LLMeshCache()
+{
+}
+
+void LLMeshCache::initCache(ELLPath location, U64 max_size)
+{
+	std::string cache_dir = gDirUtilp->getExpandedFilename(location, "meshcache");
+	{
+		LLMutexLock lock(&mMutex);
+
+		if (mInitialized)
+		{
+			LL_WARNS("MeshCache") << "Mesh cache already initialized." << LL_ENDL;
+			return;
+		}
+
+		mCacheDirName = cache_dir;
+		mMaxSize = max_size;
+	}
+
+	LLFile::mkdir(cache_dir);
+
+	std::vector<U8> buffer;
+	std::string index_filename = getIndexFilename();
+	S32 file_size = LLAPRFile::size(index_filename);
+	if (file_size > 0)
+	{
+		buffer.resize(file_size);
+		if (LLAPRFile::readEx(index_filename, &buffer[0], 0, file_size) != file_size)
+		{
+			buffer.clear();
+		}
+	}
+
+	//the index is only valid until we start modifying the cache
+	//if we crash before shutdown() writes it back, the cache is discarded on the next run
+	LLAPRFile::remove(index_filename);
+
+	entry_map_t entries;
+	U64 usage = 0;
+	U32 access_counter = 0;
+	if (!parseIndex(buffer, entries, usage, access_counter))
+	{ //no index (first run, or last session did not shut down cleanly) or a bad one
+		entries.clear();
+		usage = 0;
+		access_counter = 0;
+		std::string mask = "*.slm";
+		gDirUtilp->deleteFilesInDir(cache_dir, mask);
+	}
+
+	file_list_t doomed;
+	{
+		LLMutexLock lock(&mMutex);
+
+		mEntries.swap(entries);
+		for (entry_map_t::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+		{
+			iter->second.mGeneration = ++mGenerationCounter;
+		}
+		mUsage = usage;
+		mAccessCounter = access_counter;
+		mInitialized = true;
+
+		if (mUsage > mMaxSize)
+		{
+			purgeEntries(doomed);
+		}
+
+		LL_INFOS("MeshCache") << "Mesh cache: " << mEntries.size() << " meshes, "
+			<< (mUsage >> 20) << "/" << (mMaxSize >> 20) << " MB" << LL_ENDL;
+	}
+	deleteFiles(doomed);
+}
+
+void LLMeshCache::removeCache(ELLPath location)
+{
+	std::string cache_dir = gDirUtilp->getExpandedFilename(location, "meshcache");
+	LL_INFOS("MeshCache") << "Removing mesh cache at " << cache_dir << LL_ENDL;
+
+	{
+		LLMutexLock lock(&mMutex);
+		mEntries.clear();
+		mUsage = 0;
+	}
+
+	std::string mask = "*";
+	gDirUtilp->deleteFilesInDir(cache_dir, mask);
+}
+
+void LLMeshCache::shutdown()
+{
+	std::vector<U8> buffer;
+	U32 num_entries = 0;
+	U64 usage = 0;
+	{
+		LLMutexLock lock(&mMutex);
+
+		if (!mInitialized)
+		{
+			return;
+		}
+
+		buildIndex(buffer);
+		num_entries = mEntries.size();
+		usage = mUsage;
+		mEntries.clear();
+		mUsage = 0;
+		mInitialized = false;
+	}
+
+	S32 size = buffer.size();
+	if (LLAPRFile::writeEx(getIndexFilename(), &buffer[0], 0, size) != size)
+	{
+		LL_WARNS("MeshCache") << "Failed to write mesh cache index, cache will be discarded on next run." << LL_ENDL;
+		LLAPRFile::remove(getIndexFilename());
+	}
+	else
+	{
+		LL_INFOS("MeshCache") << "Wrote mesh cache index: " << num_entries << " meshes, " << (usage >> 20) << " MB" << LL_ENDL;
+	}
+}
+
+S32 LLMeshCache::getHeaderSize(const LLUUID& mesh_id)
+{
+	LLMutexLock lock(&mMutex);
+
+	entry_map_t::const_iterator iter = mEntries.find(mesh_id);
+	if (iter == mEntries.end())
+	{
+		++sCacheMisses;
+		return 0;
+	}
+	return iter->second.mHeaderSize;
+}
+
+bool LLMeshCache::read(const LLUUID& mesh_id, S32 offset, U8* buffer, S32 size)
+{
+	if (offset < 0 || size <= 0 || offset > S32_MAX - size)
+	{
+		return false;
+	}
+
+	U32 generation = 0;
+	{
+		LLMutexLock lock(&mMutex);
+
+		entry_map_t::const_iterator iter = mEntries.find(mesh_id);
+		if (iter == mEntries.end() || !iter->second.hasRange(offset, offset + size))
+		{
+			++sCacheMisses;
+			return false;
+		}
+		generation = iter->second.mGeneration;
+	}
+
+	bool read = LLAPRFile::readEx(getFilename(mesh_id), buffer, offset, size) == size;
+
+	file_list_t doomed;
+	{
+		LLMutexLock lock(&mMutex);
+
+		entry_map_t::iterator iter = mEntries.find(mesh_id);
+		if (iter == mEntries.end() || iter->second.mGeneration != generation)
+		{ //dropped or replaced while we were reading, what we got may be anything
+			++sCacheMisses;
+			return false;
+		}
+
+		if (!read)
+		{ //file went missing or was truncated behind our back
+			LL_WARNS("MeshCache") << "Failed to read cached mesh " << mesh_id << ", dropping it from the cache." << LL_ENDL;
+			removeEntry(iter, doomed);
+			++sCacheMisses;
+		}
+		else
+		{
+			iter->second.mLastAccess = ++mAccessCounter;
+			++sCacheHits;
+			sBytesSaved += size;
+		}
+	}
+	deleteFiles(doomed);
+	return read;
+}
+
+bool LLMeshCache::touch(const LLUUID& mesh_id, S32 offset, S32 size)
+{
+	if (offset < 0 || size <= 0 || offset > S32_MAX - size)
+	{
+		return false;
+	}
+
+	LLMutexLock lock(&mMutex);
+
+	entry_map_t::iterator iter = mEntries.find(mesh_id);
+	if (iter == mEntries.end() || !iter->second.hasRange(offset, offset + size))
+	{
+		return false;
+	}
+	iter->second.mLastAccess = ++mAccessCounter;
+	return true;
+}
+
+void LLMeshCache::writeHeader(const LLUUID& mesh_id, S32 header_size, const U8* data, S32 data_size)
+{
+	if (header_size <= 0 || data_size < header_size)
+	{
+		return;
+	}
+
+	std::string filename = getFilename(mesh_id);
+	{
+		LLMutexLock lock(&mMutex);
+
+		if (!mInitialized)
+		{
+			return;
+		}
+
+		//a new header invalidates everything we had for this mesh
+		entry_map_t::iterator iter = mEntries.find(mesh_id);
+		if (iter != mEntries.end())
+		{
+			mUsage -= llmin(mUsage, (U64)iter->second.getFileSize());
+			mEntries.erase(iter);
+		}
+	}
+
+	LLAPRFile::remove(filename);
+	if (LLAPRFile::writeEx(filename, (void*)data, 0, data_size) != data_size)
+	{
+		LLAPRFile::remove(filename);
+		return;
+	}
+
+	file_list_t doomed;
+	{
+		LLMutexLock lock(&mMutex);
+
+		if (!mInitialized || mEntries.find(mesh_id) != mEntries.end())
+		{ //shut down, or another thread cached this header meanwhile; its entry covers the same bytes
+			return;
+		}
+
+		Entry& entry = mEntries[mesh_id];
+		entry.mHeaderSize = header_size;
+		entry.mLastAccess = ++mAccessCounter;
+		entry.mGeneration = ++mGenerationCounter;
+		entry.addRange(0, data_size);
+		mUsage += data_size;
+
+		if (mUsage > mMaxSize)
+		{
+			purgeEntries(doomed);
+		}
+	}
+	deleteFiles(doomed);
+}
+
+bool LLMeshCache::write(const LLUUID& mesh_id, S32 offset, const U8* data, S32 size)
+{
+	if (offset < 0 || size <= 0 || offset > S32_MAX - size)
+	{
+		return false;
+	}
+
+	U32 generation = 0;
+	{
+		LLMutexLock lock(&mMutex);
+
+		entry_map_t::const_iterator iter = mEntries.find(mesh_id);
+		if (!mInitialized || iter == mEntries.end())
+		{
+			return false;
+		}
+
+		if (iter->second.hasRange(offset, offset + size))
+		{ //already have it
+			return true;
+		}
+		generation = iter->second.mGeneration;
+	}
+
+	bool written = LLAPRFile::writeEx(getFilename(mesh_id), (void*)data, offset, size) == size;
+
+	file_list_t doomed;
+	{
+		LLMutexLock lock(&mMutex);
+
+		entry_map_t::iterator iter = mEntries.find(mesh_id);
+		if (iter == mEntries.end() || iter->second.mGeneration != generation)
+		{ //dropped or replaced while we were writing, the range is not ours to record
+			return false;
+		}
+
+		Entry& entry = iter->second;
+		if (!written)
+		{
+			removeEntry(iter, doomed);
+		}
+		else
+		{
+			S32 old_size = entry.getFileSize();
+			entry.addRange(offset, offset + size);
+			entry.mLastAccess = ++mAccessCounter;
+			mUsage += entry.getFileSize() - old_size;
+
+			if (mUsage > mMaxSize)
+			{
+				purgeEntries(doomed);
+			}
+		}
+	}
+	deleteFiles(doomed);
+	return written;
+}
+
+void LLMeshCache::remove(const LLUUID& mesh_id)
+{
+	file_list_t doomed;
+	{
+		LLMutexLock lock(&mMutex);
+
+		entry_map_t::iterator iter = mEntries.find(mesh_id);
+		if (iter != mEntries.end())
+		{
+			removeEntry(iter, doomed);
+		}
+	}
+	deleteFiles(doomed);
+}
+
+std::string LLMeshCache::getFilename(const LLUUID& mesh_id) const
+{
+	return mCacheDirName + gDirUtilp->getDirDelimiter() + mesh_id.asString() + ".slm";
+}
+
+std::string LLMeshCache::getIndexFilename() const
+{
+	return mCacheDirName + gDirUtilp->getDirDelimiter() + "index.slmi";
+}
+
+void LLMeshCache::removeEntry(entry_map_t::iterator iter, file_list_t& doomed)
+{
+	mUsage -= llmin(mUsage, (U64)iter->second.getFileSize());
+	doomed.push_back(getFilename(iter->first));
+	mEntries.erase(iter);
+}
+
+void LLMeshCache::purgeEntries(file_list_t& doomed)
+{
+	//evict least recently used meshes until we are comfortably under budget
+	std::vector<std::pair<U32, LLUUID> > lru;
+	lru.reserve(mEntries.size());
+	for (entry_map_t::const_iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		lru.push_back(std::make_pair(iter->second.mLastAccess, iter->first));
+	}
+	std::sort(lru.begin(), lru.end());
+
+	const U64 target = (U64)(mMaxSize * PURGE_TARGET_FRACTION);
+	U32 purged = 0;
+	for (std::vector<std::pair<U32, LLUUID> >::const_iterator iter = lru.begin(); iter != lru.end() && mUsage > target; ++iter)
+	{
+		removeEntry(mEntries.find(iter->second), doomed);
+		++purged;
+	}
+
+	LL_DEBUGS("MeshCache") << "Purged " << purged << " meshes, " << (mUsage >> 20) << " MB in use" << LL_ENDL;
+}
+
+//static
+void LLMeshCache::deleteFiles(const file_list_t& files)
+{
+	//a mesh written again between its removal and here loses its new file too;
+	//the next read of it fails and drops the entry, so it is only fetched again
+	for (file_list_t::const_iterator iter = files.begin(); iter != files.end(); ++iter)
+	{
+		LLAPRFile::remove(*iter);
+	}
+}
+
+//static
+bool LLMeshCache::parseIndex(const std::vector<U8>& buffer, entry_map_t& entries, U64& usage, U32& access_counter)
+{
+	if (buffer.size() < sizeof(LLMeshCacheIndexHeader))
+	{
+		return false;
+	}
+
+	const U8* cur = &buffer[0];
+	const U8* end = cur + buffer.size();
+
+	LLMeshCacheIndexHeader header;
+	memcpy(&header, cur, sizeof(header));		/* Flawfinder: ignore */
+	cur += sizeof(header);
+	if (header.mMagic != MESH_CACHE_INDEX_MAGIC || header.mVersion != MESH_CACHE_INDEX_VERSION)
+	{
+		LL_INFOS("MeshCache") << "Mesh cache index format changed, discarding cache." << LL_ENDL;
+		return false;
+	}
+
+	//every record takes at least its own size, don't trust the count beyond that
+	if (header.mNumEntries > (size_t)(end - cur) / sizeof(LLMeshCacheIndexRecord))
+	{
+		LL_WARNS("MeshCache") << "Mesh cache index is truncated, discarding cache." << LL_ENDL;
+		return false;
+	}
+
+	for (U32 i = 0; i < header.mNumEntries; ++i)
+	{
+		LLMeshCacheIndexRecord record;
+		if ((size_t)(end - cur) < sizeof(record))
+		{
+			LL_WARNS("MeshCache") << "Mesh cache index is truncated, discarding cache." << LL_ENDL;
+			return false;
+		}
+		memcpy(&record, cur, sizeof(record));		/* Flawfinder: ignore */
+		cur += sizeof(record);
+
+		if (record.mNumRanges == 0 || record.mNumRanges > (size_t)(end - cur) / sizeof(range_t) || record.mHeaderSize <= 0)
+		{
+			LL_WARNS("MeshCache") << "Mesh cache index is corrupt, discarding cache." << LL_ENDL;
+			return false;
+		}
+
+		Entry& entry = entries[record.mID];
+		if (!entry.mRanges.empty())
+		{ //the same mesh twice
+			LL_WARNS("MeshCache") << "Mesh cache index is corrupt, discarding cache." << LL_ENDL;
+			return false;
+		}
+		entry.mHeaderSize = record.mHeaderSize;
+		entry.mLastAccess = record.mLastAccess;
+		entry.mRanges.resize(record.mNumRanges);
+		memcpy(&entry.mRanges[0], cur, record.mNumRanges * sizeof(range_t));		/* Flawfinder: ignore */
+		cur += record.mNumRanges * sizeof(range_t);
+
+		//ranges must be as addRange() leaves them, and start with the header
+		S32 prev_end = -1;
+		for (range_vec_t::const_iterator iter = entry.mRanges.begin(); iter != entry.mRanges.end(); ++iter)
+		{
+			if (iter->first <= prev_end || iter->first >= iter->second)
+			{
+				LL_WARNS("MeshCache") << "Mesh cache index is corrupt, discarding cache." << LL_ENDL;
+				return false;
+			}
+			prev_end = iter->second;
+		}
+		if (!entry.hasRange(0, entry.mHeaderSize))
+		{
+			LL_WARNS("MeshCache") << "Mesh cache index is corrupt, discarding cache." << LL_ENDL;
+			return false;
+		}
+
+		usage += entry.getFileSize();
+		access_counter = llmax(access_counter, entry.mLastAccess);
+	}
+
+	return true;
+}
+
+void LLMeshCache::buildIndex(std::vector<U8>& buffer) const
+{
+	buffer.reserve(sizeof(LLMeshCacheIndexHeader) + mEntries.size() * (sizeof(LLMeshCacheIndexRecord) + sizeof(range_t)));
+
+	LLMeshCacheIndexHeader header;
+	header.mMagic = MESH_CACHE_INDEX_MAGIC;
+	header.mVersion = MESH_CACHE_INDEX_VERSION;
+	header.mNumEntries = mEntries.size();
+	buffer.insert(buffer.end(), (const U8*)&header, (const U8*)&header + sizeof(header));
+
+	for (entry_map_t::const_iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		const Entry& entry = iter->second;
+
+		LLMeshCacheIndexRecord record;
+		record.mID = iter->first;
+		record.mHeaderSize = entry.mHeaderSize;
+		record.mLastAccess = entry.mLastAccess;
+		record.mNumRanges = entry.mRanges.size();
+		buffer.insert(buffer.end(), (const U8*)&record, (const U8*)&record + sizeof(record));
+
+		if (!entry.mRanges.empty())
+		{
+			const U8* ranges = (const U8*)&entry.mRanges[0];
+			buffer.insert(buffer.end(), ranges, ranges + entry.mRanges.size() * sizeof(range_t));
+		}
+	}
+}
@@ -0,0 +1,127 @@
+/**
+ * @file llmeshcache.h
+ * @brief On-disk cache of mesh assets, independent of the VFS.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHCACHE_H
+#define LL_LLMESHCACHE_H
+
+#include "lldir.h"
+#include "llsingleton.h"
+#include "llthread.h"
+#include "lluuid.h"
+
+#include <boost/unordered_map.hpp>
+
+//
+// Each mesh asset is stored in its own file under <cache>/meshcache, at the
+// same byte offsets as in the asset on the simulator, so the header and any
+// LOD/skin/physics block can be cached independently of the others.  The
+// index records which byte ranges of each file hold valid data; it is kept
+// in memory and only written to disk at shutdown.  The on-disk index is
+// removed once it has been loaded, so a viewer that does not shut down
+// cleanly starts over with an empty cache instead of trusting stale ranges.
+//
+// Safe to call from the main thread, the mesh repository thread and the mesh parse threads.
+// The mutex only guards the index; files are read, written and deleted with it
+// released, and a read or write only counts if the entry it started from is still
+// in the index afterwards.  Mesh assets never change for a given id, so two
+// threads writing the same range of a file write the same bytes.
+//
+class LLMeshCache : public LLSingleton<LLMeshCache>
+{
+	friend class LLSingleton<LLMeshCache>;
+	LLMeshCache();
+
+public:
+	~LLMeshCache();
+
+	void initCache(ELLPath location, U64 max_size);
+	void removeCache(ELLPath location);
+	// Write the index to disk; the cache is unusable afterwards
+	void shutdown();
+
+	// Size of the cached header of mesh_id, or 0 if the header is not cached
+	S32 getHeaderSize(const LLUUID& mesh_id);
+
+	// Copy [offset, offset+size) of the asset into buffer.  Fails unless the whole range is cached.
+	bool read(const LLUUID& mesh_id, S32 offset, U8* buffer, S32 size);
+	// Whether all of [offset, offset+size) is cached, without reading it; keeps it from being purged soon
+	bool touch(const LLUUID& mesh_id, S32 offset, S32 size);
+
+	// Start a new cache entry for mesh_id from the first data_size bytes of the asset,
+	// of which the first header_size bytes are the header
+	void writeHeader(const LLUUID& mesh_id, S32 header_size, const U8* data, S32 data_size);
+
+	// Store [offset, offset+size) of an asset whose header is already cached
+	bool write(const LLUUID& mesh_id, S32 offset, const U8* data, S32 size);
+
+	// Drop mesh_id from the cache, e.g. when its cached data failed to parse
+	void remove(const LLUUID& mesh_id);
+
+	U64 getUsage() const	{ return mUsage; }
+
+	static U32 sCacheHits;
+	static U32 sCacheMisses;
+	static U64 sBytesSaved;	// bytes served from the cache instead of over HTTP
+
+private:
+	typedef std::pair<S32, S32> range_t;	// [begin, end)
+	typedef std::vector<range_t> range_vec_t;
+
+	struct Entry
+	{
+		Entry() : mHeaderSize(0), mLastAccess(0), mGeneration(0) {}
+
+		S32 getFileSize() const	{ return mRanges.empty() ? 0 : mRanges.back().second; }
+		bool hasRange(S32 begin, S32 end) const;
+		void addRange(S32 begin, S32 end);
+
+		S32			mHeaderSize;
+		U32			mLastAccess;
+		U32			mGeneration;	// tells a dropped and re-added entry from the one a read or write started with
+		range_vec_t	mRanges;	// sorted and disjoint
+	};
+	typedef boost::unordered_map<LLUUID, Entry> entry_map_t;
+	typedef std::vector<std::string> file_list_t;
+
+	std::string getFilename(const LLUUID& mesh_id) const;
+	std::string getIndexFilename() const;
+	// Fill entries from the on-disk index, false if it is missing, corrupt or from another version
+	static bool parseIndex(const std::vector<U8>& buffer, entry_map_t& entries, U64& usage, U32& access_counter);
+	void buildIndex(std::vector<U8>& buffer) const;
+	// These take the index out of mEntries and return the files to delete once mMutex is released
+	void removeEntry(entry_map_t::iterator iter, file_list_t& doomed);
+	void purgeEntries(file_list_t& doomed);
+	static void deleteFiles(const file_list_t& files);
+
+private:
+	LLMutex		mMutex;
+	bool		mInitialized;
+	std::string	mCacheDirName;
+	U64			mMaxSize;
+	U64			mUsage;
+	U32			mAccessCounter;
+	U32			mGenerationCounter;
+	entry_map_t	mEntries;
+};
+
+#endif // LL_LLMESHCACHE_H
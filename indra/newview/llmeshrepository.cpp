@@ -36,16 +36,19 @@
 #include "llbufferstream.h"
 #include "llcallbacklist.h"
 #include "lldatapacker.h"
+#include "lldrawable.h"
 #include "llfasttimer.h"
 #include "llfloaterperms.h"
 #include "llimagej2c.h"
 #include "llhost.h"
+#include "llmeshcache.h"
 #include "llnotificationsutil.h"
 #include "llsd.h"
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
+#include "llsessionaccesslog.h"
 #include "llthread.h"
-#include "llvfile.h"
+#include "llviewercamera.h"
 #include "llviewercontrol.h"
 #include "llviewerinventory.h"
 #include "llviewermenufile.h"
@@ -72,6 +75,7 @@
 #endif
 
 #include <queue>
+#include <boost/thread/thread.hpp>
 
 class AIHTTPTimeoutPolicy;
 extern AIHTTPTimeoutPolicy meshHeaderResponder_timeout;
@@ -103,6 +107,15 @@ U32 LLMeshRepository::sLODPending = 0;
 U32 LLMeshRepository::sCacheBytesRead = 0;
 U32 LLMeshRepository::sCacheBytesWritten = 0;
 U32 LLMeshRepository::sPeakKbps = 0;
+U32 LLMeshRepository::sOnScreenLODLoads = 0;
+F32 LLMeshRepository::sOnScreenLODLoadTime = 0.f;
+F32 LLMeshRepository::sOnScreenLODLoadTimeMax = 0.f;
+U32 LLMeshRepository::sSkinInfoBytes = 0;
+U32 LLMeshRepository::sDecompositionBytes = 0;
+U32 LLMeshRepository::sMeshInfoEvictions = 0;
+
+// Skin info and decompositions asked for in this many seconds are not dropped
+const F32 MESH_INFO_PIN_TIME = 30.f;
 
 const U32 MAX_TEXTURE_UPLOAD_RETRIES = 5;
 
@@ -593,60 +606,270 @@ bool LLMeshRepoThread::HeaderRequest::fetch(U32& count)
 
 void LLMeshRepoThread::LODRequest::preFetch()
 {
-	--LLMeshRepository::sLODProcessing;
+	if (!mPrefetch)
+	{
+		--LLMeshRepository::sLODProcessing;
+	}
 }
 
 bool LLMeshRepoThread::LODRequest::fetch(U32& count)
 {
+	if (mPrefetch && gMeshRepo.mThread->isLODCached(this->mMeshParams.getSculptID(), this->mLOD))
+	{	//already there for when an object asks for it
+		return true;
+	}
 	if (!gMeshRepo.mThread->fetchMeshLOD(this->mMeshParams, this->mLOD, count))
 	{
-		gMeshRepo.mThread->mMutex->lock();
-		++LLMeshRepository::sLODProcessing;
-		gMeshRepo.mThread->mMutex->unlock();
+		if (!mPrefetch)
+		{
+			gMeshRepo.mThread->mMutex->lock();
+			++LLMeshRepository::sLODProcessing;
+			gMeshRepo.mThread->mMutex->unlock();
+		}
 		return false;
 	}
 	return true;
 }
 
-void LLMeshRepoThread::runQueue(std::deque<std::pair<std::shared_ptr<MeshRequest>, F32> >& query, U32& count, S32& active_requests)
+// Every LOD being unpacked holds its data and what it unpacks to, don't go overboard
+static const S32 MAX_PARSE_THREADS = 4;
+
+LLMeshParseQueue::LLMeshParseQueue()
+:	mQueue(NULL),
+	mBytes(0),
+	mBudget(0)
+{
+}
+
+LLMeshParseQueue::~LLMeshParseQueue()
 {
-	std::queue<std::pair<std::shared_ptr<MeshRequest>, F32> > incomplete;
-	while (!query.empty() && count < MAX_MESH_REQUESTS_PER_SECOND && active_requests < (S32)sMaxConcurrentRequests)
+	shutdown();
+}
+
+void LLMeshParseQueue::start(S32 threads, U32 budget_bytes)
+{
+	if (threads < 0)
+	{
+		threads = MAX_PARSE_THREADS;
+	}
+	threads = llclamp(threads, 0, MAX_PARSE_THREADS);
+	mBudget = budget_bytes;
+	LLThreadPool* pool = LLThreadPool::getShared();
+	if (pool && threads > 0)
 	{
-		if (mMutex)
+		mQueue = new LLThreadPool::Queue(pool, threads);
+	}
+	else
+	{
+		threads = 0;
+	}
+	LL_INFOS(LOG_MESH) << "Mesh LODs unpacked at once: " << threads << LL_ENDL;
+}
+
+void LLMeshParseQueue::shutdown()
+{
+	if (!mQueue)
+	{
+		return;
+	}
+
+	// Frees the data of the jobs that never ran
+	delete mQueue;
+	mQueue = NULL;
+
+	mMutex.lock();
+	mBytes = 0;
+	mMutex.unlock();
+}
+
+void LLMeshParseQueue::parseLOD(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size, S32 offset, S32 cache_bytes)
+{
+	job_ptr_t job(new Job);
+	job->mMeshParams = mesh_params;
+	job->mLOD = lod;
+	job->mData = data;
+	job->mSize = data_size;
+	job->mOffset = offset;
+	job->mCacheBytes = cache_bytes;
+
+	if (!mQueue)
+	{
+		parse(*job);
+		return;
+	}
+
+	mMutex.lock();
+	mBytes += data_size;
+	mMutex.unlock();
+	mQueue->post(boost::bind(&LLMeshParseQueue::runJob, this, job));
+}
+
+bool LLMeshParseQueue::isOverBudget()
+{
+	mMutex.lock();
+	bool over = mBytes > mBudget;
+	mMutex.unlock();
+	return over;
+}
+
+S32 LLMeshParseQueue::getPending()
+{
+	return mQueue ? mQueue->getPending() : 0;
+}
+
+void LLMeshParseQueue::runJob(job_ptr_t job)
+{
+	parse(*job);
+
+	mMutex.lock();
+	mBytes -= job->mSize;
+	mMutex.unlock();
+}
+
+//static
+void LLMeshParseQueue::parse(const Job& job)
+{
+	AIStateMachine::StateTimer timer("parseLOD");
+	LLMeshRepoThread* thread = gMeshRepo.mThread;
+	bool success = thread->lodReceived(job.mMeshParams, job.mLOD, job.mData, job.mSize);
+	const LLUUID& mesh_id = job.mMeshParams.getSculptID();
+	if (job.mCacheBytes)
+	{
+		//good fetch from sim, write to mesh cache
+		if (success && LLMeshCache::getInstance()->write(mesh_id, job.mOffset, job.mData, job.mCacheBytes))
 		{
-			mMutex->lock();
-			auto req = query.front().first;
-			F32 delay = query.front().second;
-			query.pop_front();
-			req->preFetch();
-			mMutex->unlock();
-			F32 remainder = delay - req->mTimer.getElapsedTimeF32();
-			if (remainder > 0.f)
-			{
-				//LL_INFOS() << req->mMeshParams.getSculptID() << " skipped. " << remainder << "s remaining" << LL_ENDL;
-				incomplete.push(std::make_pair(req, delay));
-			}
-			else if (!req->fetch(count))//failed, resubmit
+			LLMeshRepository::sCacheBytesWritten += job.mCacheBytes;
+		}
+	}
+	else if (!success)
+	{	//cached data is bad, fetch it again
+		LLMeshCache::getInstance()->remove(mesh_id);
+		thread->lockAndLoadMeshLOD(job.mMeshParams, job.mLOD);
+	}
+}
+
+LLMeshRepoThread::RequestQueue::~RequestQueue()
+{
+	for (request_map_t::iterator iter = mRequests.begin(); iter != mRequests.end(); ++iter)
+	{
+		delete iter->second;
+	}
+}
+
+void LLMeshRepoThread::RequestQueue::push(MeshRequest* request, F32 delay)
+{
+	std::pair<request_map_t::iterator, bool> inserted =
+		mRequests.insert(std::make_pair(std::make_pair(request->mMeshParams, request->getLOD()), request));
+	if (!inserted.second)
+	{	//already waiting
+		MeshRequest* waiting = inserted.first->second;
+		waiting->mPrefetch = waiting->mPrefetch && request->mPrefetch;
+		if (request->mPriority > waiting->mPriority)
+		{
+			waiting->mPriority = request->mPriority;
+			if (mReady.contains(waiting))
 			{
-				LL_INFOS() << req->mMeshParams.getSculptID() << " fetch failed outright. Delaying for " << (delay ? delay : 15) << "s" << LL_ENDL;
-				req->mTimer.reset();
-				incomplete.push(std::make_pair(req, delay ? delay : 15));
-			}
-			else {
-				//LL_INFOS() << req->mMeshParams.getSculptID() << " fetch request created. " << std::hex << &(req->mMeshParams) << std::dec << LL_ENDL;
+				mReady.update(waiting);
 			}
 		}
+		delete request;
+		return;
 	}
-	if (!incomplete.empty())
+
+	request->mDelay = delay;
+	if (delay > 0.f)
 	{
-		mMutex->lock();
-		while (!incomplete.empty())
+		mDelayed.push_back(request);
+	}
+	else
+	{
+		mReady.push(request);
+	}
+}
+
+LLMeshRepoThread::MeshRequest* LLMeshRepoThread::RequestQueue::pop()
+{
+	for (U32 i = 0; i < mDelayed.size(); )
+	{
+		if (mDelayed[i]->mTimer.getElapsedTimeF32() >= mDelayed[i]->mDelay)
 		{
-			query.push_back(incomplete.front());
-			incomplete.pop();
+			mReady.push(mDelayed[i]);
+			mDelayed[i] = mDelayed.back();
+			mDelayed.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+	if (mReady.empty())
+	{
+		return NULL;
+	}
+
+	MeshRequest* request = mReady.top();
+	mReady.pop();
+	mRequests.erase(std::make_pair(request->mMeshParams, request->getLOD()));
+	return request;
+}
+
+void LLMeshRepoThread::RequestQueue::setPriority(const LLVolumeParams& mesh_params, S32 lod, F32 priority)
+{
+	request_map_t::iterator iter = mRequests.find(std::make_pair(mesh_params, lod));
+	if (iter != mRequests.end() && iter->second->mPriority != priority)
+	{
+		MeshRequest* request = iter->second;
+		request->mPriority = priority;
+		if (mReady.contains(request))
+		{
+			mReady.update(request);
+		}
+	}
+}
+
+bool LLMeshRepoThread::RequestQueue::cancel(const LLVolumeParams& mesh_params, S32 lod)
+{
+	request_map_t::iterator iter = mRequests.find(std::make_pair(mesh_params, lod));
+	if (iter == mRequests.end())
+	{
+		return false;
+	}
+	MeshRequest* request = iter->second;
+	if (!mReady.erase(request))
+	{
+		vector_replace_with_last(mDelayed, request);
+	}
+	mRequests.erase(iter);
+	delete request;
+	return true;
+}
+
+void LLMeshRepoThread::runQueue(RequestQueue& queue, U32& count, S32& active_requests)
+{
+	while (count < MAX_MESH_REQUESTS_PER_SECOND && active_requests < (S32)sMaxConcurrentRequests)
+	{
+		MeshRequest* req;
+		{
+			LLMutexLock lock(mMutex);
+			req = queue.pop();
+			if (!req)
+			{
+				break;
+			}
+			req->preFetch();
+		}
+		if (!req->fetch(count))//failed, resubmit
+		{
+			F32 delay = req->mDelay ? req->mDelay : 15.f;
+			LL_INFOS() << req->mMeshParams.getSculptID() << " fetch failed outright. Delaying for " << delay << "s" << LL_ENDL;
+			req->mTimer.reset();
+			LLMutexLock lock(mMutex);
+			queue.push(req, delay);
+		}
+		else
+		{
+			delete req;
 		}
-		mMutex->unlock();
 	}
 }
 
@@ -684,7 +907,10 @@ void LLMeshRepoThread::run()
 			}
 
 			// NOTE: throttling intentionally favors LOD requests over header requests
-			runQueue(mLODReqQ, count, sActiveLODRequests);
+			if (!mParseQueue.isOverBudget())
+			{	//the parse workers are behind, don't add to what they have to chew
+				runQueue(mLODReqQ, count, sActiveLODRequests);
+			}
 			runQueue(mHeaderReqQ, count, sActiveHeaderRequests);
 
 			// Protected by mSignal
@@ -739,7 +965,7 @@ void LLMeshRepoThread::lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32
 
 
 
-void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
+void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod, F32 priority)
 { //could be called from any thread
 	std::unique_lock<LLMutex> header_lock(*mHeaderMutex);
 	bool exists = mMeshHeader.find(mesh_params.getSculptID()) != mMeshHeader.end();
@@ -748,7 +974,7 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 	if (exists)
 	{
 		//if we have the header, request LOD byte range
-		gMeshRepo.mThread->pushLODRequest(mesh_params, lod, 0.f);
+		gMeshRepo.mThread->pushLODRequest(mesh_params, lod, 0.f, priority);
 		LLMeshRepository::sLODProcessing++;
 	}
 	else
@@ -762,12 +988,72 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 		}
 		else
 		{	//if no header request is pending, fetch header
-			gMeshRepo.mThread->pushHeaderRequest(mesh_params, 0.f);
+			gMeshRepo.mThread->pushHeaderRequest(mesh_params, 0.f, priority);
 			mPendingLOD[mesh_params].push_back(lod);
 		}
+		LLMeshRepository::sLODPending++;
 	}
 }
 
+void LLMeshRepoThread::prefetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
+{
+	std::unique_lock<LLMutex> header_lock(*mHeaderMutex);
+	bool exists = mMeshHeader.find(mesh_params.getSculptID()) != mMeshHeader.end();
+	header_lock.unlock();
+	LLMutexLock lock(mMutex);
+	//priority 0 keeps them behind the requests of objects, which updateLoadingPriorities() ranks by screen area
+	if (exists)
+	{
+		pushLODRequest(mesh_params, lod, 0.f, 0.f, true);
+	}
+	else
+	{
+		std::vector<S32>& lods = mPrefetchLOD[mesh_params];
+		if (std::find(lods.begin(), lods.end(), lod) == lods.end())
+		{
+			lods.push_back(lod);
+		}
+		pushHeaderRequest(mesh_params, 0.f);
+	}
+}
+
+void LLMeshRepoThread::setRequestPriority(const LLVolumeParams& mesh_params, S32 lod, F32 priority, F32 header_priority)
+{
+	mLODReqQ.setPriority(mesh_params, lod, priority);
+	mHeaderReqQ.setPriority(mesh_params, -1, header_priority);
+}
+
+bool LLMeshRepoThread::cancelMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
+{ //called from main thread
+	LLMutexLock lock(mMutex);
+	if (mLODReqQ.cancel(mesh_params, lod))
+	{
+		LLMeshRepository::sLODProcessing--;
+		return true;
+	}
+
+	pending_lod_map::iterator pending = mPendingLOD.find(mesh_params);
+	if (pending != mPendingLOD.end())
+	{
+		std::vector<S32>::iterator iter = std::find(pending->second.begin(), pending->second.end(), lod);
+		if (iter != pending->second.end())
+		{	//still waiting for the header
+			pending->second.erase(iter);
+			LLMeshRepository::sLODPending--;
+			if (pending->second.empty())
+			{	//nothing else wants the header
+				if (mPrefetchLOD.find(mesh_params) == mPrefetchLOD.end())
+				{
+					mHeaderReqQ.cancel(mesh_params, -1);
+				}
+				mPendingLOD.erase(pending);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
 //static 
 std::string LLMeshRepoThread::constructUrl(LLUUID mesh_id)
 {
@@ -817,37 +1103,25 @@ bool LLMeshRepoThread::getMeshHeaderInfo(const LLUUID& mesh_id, const char* bloc
 	return true;
 }
 
-bool LLMeshRepoThread::loadInfoFromVFS(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn)
+bool LLMeshRepoThread::loadInfoFromCache(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn)
 {
-	//check VFS for mesh skin info
-	LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
-	if (file.getSize() >= info.mOffset + info.mSize)
+	//check mesh cache for the requested block
+	U8* buffer = new U8[info.mSize];
+	bool success = LLMeshCache::getInstance()->read(mesh_id, info.mOffset, buffer, info.mSize);
+	if (success)
 	{
 		LLMeshRepository::sCacheBytesRead += info.mSize;
 
-		file.seek(info.mOffset);
-		U8* buffer = new U8[info.mSize];
-		file.read(buffer, info.mSize);
-
-		//make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
-		bool zero = true;
-		for (S32 i = 0; i < llmin(info.mSize, S32(1024)) && zero; ++i)
-		{
-			zero = buffer[i] > 0 ? false : true;
-		}
-
-		if (!zero)
-		{	//attempt to parse
-			if (fn(mesh_id, buffer, info.mSize))
-			{
-				delete[] buffer;
-				return true;
-			}
+		//attempt to parse
+		success = fn(mesh_id, buffer, info.mSize);
+		if (!success)
+		{ //cached data is bad, fetch it again
+			LLMeshCache::getInstance()->remove(mesh_id);
 		}
-
-		delete[] buffer;
 	}
-	return false;
+
+	delete[] buffer;
+	return success;
 }
 
 bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
@@ -860,11 +1134,11 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
 
 	if (info.mHeaderSize > 0 && info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 	{
-		//check VFS for mesh skin info
-		if (loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::skinInfoReceived, this, _1, _2, _3 )))
+		//check mesh cache for mesh skin info
+		if (loadInfoFromCache(mesh_id, info, boost::bind(&LLMeshRepoThread::skinInfoReceived, this, _1, _2, _3 )))
 			return true;
 
-		//reading from VFS failed for whatever reason, fetch from sim
+		//reading from cache failed for whatever reason, fetch from sim
 		AIHTTPHeaders headers("Accept", "application/octet-stream");
 
 		std::string http_url = constructUrl(mesh_id);
@@ -891,10 +1165,10 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 
 	if (info.mHeaderSize > 0 && info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 	{
-		if (loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::decompositionReceived, this, _1, _2, _3 )))
+		if (loadInfoFromCache(mesh_id, info, boost::bind(&LLMeshRepoThread::decompositionReceived, this, _1, _2, _3 )))
 			return true;
 
-		//reading from VFS failed for whatever reason, fetch from sim
+		//reading from cache failed for whatever reason, fetch from sim
 		AIHTTPHeaders headers("Accept", "application/octet-stream");
 
 		std::string http_url = constructUrl(mesh_id);
@@ -923,10 +1197,10 @@ bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
 	{
 		if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 		{
-			if (loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::physicsShapeReceived, this, _1, _2, _3 )))
+			if (loadInfoFromCache(mesh_id, info, boost::bind(&LLMeshRepoThread::physicsShapeReceived, this, _1, _2, _3 )))
 				return true;
 
-			//reading from VFS failed for whatever reason, fetch from sim
+			//reading from cache failed for whatever reason, fetch from sim
 			AIHTTPHeaders headers("Accept", "application/octet-stream");
 
 			std::string http_url = constructUrl(mesh_id);
@@ -980,20 +1254,20 @@ void LLMeshRepoThread::decActiveHeaderRequests()
 bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, U32& count)
 {
 	{
-		//look for mesh in asset in vfs
-		LLVFile file(gVFS, mesh_params.getSculptID(), LLAssetType::AT_MESH);
-			
-		S32 size = file.getSize();
-
-		if (size > 0)
-		{ //NOTE -- if the header size is ever more than 4KB, this will break
-			U8 buffer[4096];
-			S32 bytes = llmin(size, 4096);
-			LLMeshRepository::sCacheBytesRead += bytes;	
-			file.read(buffer, bytes);
-			if (headerReceived(mesh_params, buffer, bytes))
-			{ //did not do an HTTP request, return false
-				return true;
+		//look for mesh header in the mesh cache, reading exactly as much as the header needs
+		const LLUUID& mesh_id = mesh_params.getSculptID();
+		S32 header_size = LLMeshCache::getInstance()->getHeaderSize(mesh_id);
+		if (header_size > 0)
+		{
+			std::vector<U8> buffer(header_size);
+			if (LLMeshCache::getInstance()->read(mesh_id, 0, &buffer[0], header_size))
+			{
+				LLMeshRepository::sCacheBytesRead += header_size;
+				if (headerReceived(mesh_params, &buffer[0], header_size))
+				{ //did not do an HTTP request, return false
+					return true;
+				}
+				LLMeshCache::getInstance()->remove(mesh_id);
 			}
 		}
 	}
@@ -1019,6 +1293,13 @@ bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, U32& c
 	return retval;
 }
 
+bool LLMeshRepoThread::isLODCached(const LLUUID& mesh_id, S32 lod)
+{
+	MeshHeaderInfo info;
+	return getMeshHeaderInfo(mesh_id, header_lod[lod].c_str(), info) && info.mHeaderSize > 0 &&
+		   info.mSize > 0 && LLMeshCache::getInstance()->touch(mesh_id, info.mOffset, info.mSize);
+}
+
 //return false if failed to get mesh lod.
 bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, U32& count)
 { 
@@ -1034,10 +1315,19 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 	{
 		if(info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 		{
-			if (loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::lodReceived, this, mesh_params, lod, _2, _3 )))
-				return true;
+			{
+				U8* buffer = new U8[info.mSize];
+				if (LLMeshCache::getInstance()->read(mesh_id, info.mOffset, buffer, info.mSize))
+				{
+					LLMeshRepository::sCacheBytesRead += info.mSize;
+					//a bad cache entry gets fetched again once it failed to unpack
+					mParseQueue.parseLOD(mesh_params, lod, buffer, info.mSize, info.mOffset, 0);
+					return true;
+				}
+				delete[] buffer;
+			}
 
-			//reading from VFS failed for whatever reason, fetch from sim
+			//reading from cache failed for whatever reason, fetch from sim
 			AIHTTPHeaders headers("Accept", "application/octet-stream");
 
 			std::string http_url = constructUrl(mesh_id);
@@ -1106,6 +1396,7 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 			LLMutexLock lock(mHeaderMutex);
 			mMeshHeaderSize[mesh_id] = header_size;
 			mMeshHeader[mesh_id] = header;
+			gMeshRepo.mCostData.erase(mesh_id);
 		}
 
 		LLMutexLock lock(mMutex); // make sure only one thread access mPendingLOD at the same time.
@@ -1116,11 +1407,23 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 		{
 			for (U32 i = 0; i < iter->second.size(); ++i)
 			{
+				LLMeshRepository::sLODPending--;
 				LLMeshRepository::sLODProcessing++;
+				//the main thread gives it its priority on its next update
 				gMeshRepo.mThread->pushLODRequest(mesh_params, iter->second[i], 0.f);
 			}
 			mPendingLOD.erase(iter);
 		}
+
+		iter = mPrefetchLOD.find(mesh_params);
+		if (iter != mPrefetchLOD.end())
+		{
+			for (U32 i = 0; i < iter->second.size(); ++i)
+			{
+				pushLODRequest(mesh_params, iter->second[i], 0.f, 0.f, true);
+			}
+			mPrefetchLOD.erase(iter);
+		}
 	}
 
 	return true;
@@ -1952,7 +2255,11 @@ S32 LLMeshRepository::getActualMeshLOD(LLSD& header, S32 lod)
 
 void LLMeshRepository::cacheOutgoingMesh(LLMeshUploadData& data, LLSD& header)
 {
-	mThread->mMeshHeader[data.mUUID] = header;
+	{
+		LLMutexLock lock(mThread->mHeaderMutex);
+		mThread->mMeshHeader[data.mUUID] = header;
+		mCostData.erase(data.mUUID);
+	}
 
 	// we cache the mesh for default parameters
 	LLVolumeParams volume_params;
@@ -2022,25 +2329,8 @@ void LLMeshLODResponder::completedRaw(LLChannelDescriptors const& channels,
 		buffer->readAfter(channels.in(), NULL, data, data_size);
 	}
 
-	if (gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size))
-	{
-		AIStateMachine::StateTimer timer("FileOpen");
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			AIStateMachine::StateTimer timer("WriteData");
-			file.seek(offset);
-			file.write(data, size);
-			LLMeshRepository::sCacheBytesWritten += size;
-		}
-	}
-
-	delete [] data;
+	//unpacked and written to the mesh cache by the parse workers, which own data from here
+	gMeshRepo.mThread->mParseQueue.parseLOD(mMeshParams, mLOD, data, data_size, mOffset, mRequestedBytes);
 }
 
 void LLMeshSkinInfoResponder::retry()
@@ -2094,17 +2384,10 @@ void LLMeshSkinInfoResponder::completedRaw(LLChannelDescriptors const& channels,
 
 	if (gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size))
 	{
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
+		//good fetch from sim, write to mesh cache
+		if (LLMeshCache::getInstance()->write(mMeshID, mOffset, data, mRequestedBytes))
 		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			file.seek(offset);
-			file.write(data, size);
+			LLMeshRepository::sCacheBytesWritten += mRequestedBytes;
 		}
 	}
 
@@ -2161,17 +2444,10 @@ void LLMeshDecompositionResponder::completedRaw(LLChannelDescriptors const& chan
 
 	if (gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size))
 	{
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
+		//good fetch from sim, write to mesh cache
+		if (LLMeshCache::getInstance()->write(mMeshID, mOffset, data, mRequestedBytes))
 		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			file.seek(offset);
-			file.write(data, size);
+			LLMeshRepository::sCacheBytesWritten += mRequestedBytes;
 		}
 	}
 
@@ -2228,17 +2504,10 @@ void LLMeshPhysicsShapeResponder::completedRaw(LLChannelDescriptors const& chann
 
 	if (gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size))
 	{
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
+		//good fetch from sim, write to mesh cache
+		if (LLMeshCache::getInstance()->write(mMeshID, mOffset, data, mRequestedBytes))
 		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			file.seek(offset);
-			file.write(data, size);
+			LLMeshRepository::sCacheBytesWritten += mRequestedBytes;
 		}
 	}
 
@@ -2322,7 +2591,7 @@ void LLMeshHeaderResponder::completedRaw(LLChannelDescriptors const& channels,
 	}
 	else if (data_size > 0)
 	{
-		//header was successfully retrieved from sim, cache in vfs
+		//header was successfully retrieved from sim, cache it
 		LLUUID mesh_id = mMeshParams.getSculptID();
 		LLSD header = gMeshRepo.mThread->mMeshHeader[mesh_id];
 
@@ -2349,28 +2618,12 @@ void LLMeshHeaderResponder::completedRaw(LLChannelDescriptors const& channels,
 
 		
 			//it's possible for the remote asset to have more data than is needed for the local cache
-			//only allocate as much space in the VFS as is needed for the local cache
+			//only cache as much as is needed locally
 			data_size = llmin(data_size, bytes);
 
-			AIStateMachine::StateTimer timer("FileOpen");
-			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH, LLVFile::WRITE);
-			if (file.getMaxSize() >= bytes || file.setMaxSize(bytes))
-			{
-				LLMeshRepository::sCacheBytesWritten += data_size;
-
-				AIStateMachine::StateTimer timer("WriteData");
-				S32 bytes_remaining = bytes;
-				while (bytes_remaining > 0)
-				{
-					const S32 bytes_to_write = llmin(bytes_remaining, data_size);
-					file.write(&data[0], bytes_to_write);
-					if (bytes_remaining == bytes && bytes_to_write < bytes_remaining)
-					{
-						memset(&data[0], 0, data.size());
-					}
-					bytes_remaining -= llmin(bytes_remaining, bytes_to_write);
-				}
-			}
+			AIStateMachine::StateTimer timer("WriteData");
+			LLMeshCache::getInstance()->writeHeader(mesh_id, header_bytes, &data[0], data_size);
+			LLMeshRepository::sCacheBytesWritten += data_size;
 		}
 	}
 
@@ -2408,6 +2661,7 @@ void LLMeshRepository::init()
 	
 	
 	mThread = new LLMeshRepoThread();
+	mThread->mParseQueue.start(gSavedSettings.getS32("MeshParseThreads"), gSavedSettings.getU32("MeshParseMemoryBudget") << 20);
 	mThread->start();
 }
 
@@ -2415,6 +2669,7 @@ void LLMeshRepository::shutdown()
 {
 	LL_INFOS(LOG_MESH) << "Shutting down mesh repository." << LL_ENDL;
 
+	mThread->mParseQueue.shutdown();
 	mThread->mSignal->signal();
 	
 	while (!mThread->isStopped())
@@ -2437,19 +2692,56 @@ void LLMeshRepository::shutdown()
 	}
 
 	LLConvexDecomposition::quitSystem();
+
+	for (decomposition_map::iterator iter = mDecompositionMap.begin(); iter != mDecompositionMap.end(); ++iter)
+	{
+		delete iter->second.mDecomp;
+	}
+	mDecompositionMap.clear();
+	mSkinMap.clear();
+	sSkinInfoBytes = sDecompositionBytes = 0;
 }
 
 void LLMeshRepository::unregisterMesh(LLVOVolume* vobj)
 {
-	for (auto& lod : mLoadingMeshes)
+	LLMutexLock lock(mMeshMutex);
+	for (S32 lod = 0; lod < 4; ++lod)
 	{
-		for (auto& param : lod)
+		for (mesh_load_map::iterator iter = mLoadingMeshes[lod].begin(); iter != mLoadingMeshes[lod].end(); )
 		{
-			vector_replace_with_last(param.second, vobj);
+			if (vector_replace_with_last(iter->second.mObjects, vobj) && iter->second.mObjects.empty() &&
+				mThread && mThread->cancelMeshLOD(iter->first, lod))
+			{	//nobody else wants it and it was not sent yet
+				iter = mLoadingMeshes[lod].erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
 		}
 	}
 }
 
+// Projected screen area of the object in pixels, scaled down when it is out of view.
+// Lower LODs come first for the same area: they are smaller and show something where
+// there was nothing.
+static F32 get_mesh_request_priority(LLVOVolume* vobj, S32 lod, bool& on_screen)
+{
+	static const F32 OFF_SCREEN_PRIORITY_SCALE = 0.1f;
+	static const F32 LOD_PRIORITY_SCALE[] = { 2.f, 1.5f, 1.25f, 1.f };
+
+	on_screen = false;
+	LLDrawable* drawable = vobj->mDrawable;
+	if (!drawable)
+	{
+		return 0.f;
+	}
+	F32 radius = drawable->getRadius() * LLViewerCamera::getInstance()->getPixelMeterRatio() / llmax(drawable->mDistanceWRTCamera, 1.f);
+	F32 priority = F_PI * radius * radius * LOD_PRIORITY_SCALE[llclamp(lod, 0, 3)];
+	on_screen = drawable->isVisible();
+	return on_screen ? priority : priority * OFF_SCREEN_PRIORITY_SCALE;
+}
+
 S32 LLMeshRepository::loadMesh(LLVOVolume* vobj, const LLVolumeParams& mesh_params, S32 detail, S32 last_lod)
 {
 	if (detail < 0 || detail > 4)
@@ -2463,17 +2755,20 @@ S32 LLMeshRepository::loadMesh(LLVOVolume* vobj, const LLVolumeParams& mesh_para
 		mesh_load_map::iterator iter = mLoadingMeshes[detail].find(mesh_params);
 		if (iter != mLoadingMeshes[detail].end())
 		{	//request pending for this mesh, append volume id to list
-			auto it = std::find(iter->second.begin(), iter->second.end(), vobj);
-			if (it == iter->second.end()) {
-				iter->second.push_back(vobj);
+			auto it = std::find(iter->second.mObjects.begin(), iter->second.mObjects.end(), vobj);
+			if (it == iter->second.mObjects.end()) {
+				iter->second.mObjects.push_back(vobj);
 			}
 		}
 		else
 		{
-			//first request for this mesh
-			mLoadingMeshes[detail][mesh_params].push_back(vobj);
-			mPendingRequests.push_back(LLMeshRepoThread::LODRequest(mesh_params, detail));
-			LLMeshRepository::sLODPending++;
+			//first request for this mesh, straight to the queues of the thread where
+			//updateLoadingPriorities() keeps it in its place
+			LLSessionAccessLog::getInstance()->recordMesh(mesh_params.getSculptID(), detail);
+			LoadingMesh& loading = mLoadingMeshes[detail][mesh_params];
+			loading.mObjects.push_back(vobj);
+			loading.mPriority = get_mesh_request_priority(vobj, detail, loading.mOnScreen);
+			mThread->loadMeshLOD(mesh_params, detail, loading.mPriority);
 		}
 	}
 
@@ -2630,54 +2925,7 @@ void LLMeshRepository::notifyLoadedMeshes()
 			mUploadErrorQ.pop();
 		}
 
-		S32 push_count = LLMeshRepoThread::sMaxConcurrentRequests-(LLMeshRepoThread::sActiveHeaderRequests+LLMeshRepoThread::sActiveLODRequests);
-
-		push_count = llmin(push_count, (S32)mPendingRequests.size());
-
-		if (push_count > 0)
-		{
-			//calculate "score" for pending requests
-
-			//create score map
-			boost::unordered_map<LLUUID, F32> score_map;
-
-			for (auto& lod : mLoadingMeshes)
-			{
-				for (auto& param : lod)
-				{
-					F32 max_score = 0.f;
-					for (auto& vobj : param.second)
-					{
-						if (LLDrawable* drawable = vobj->mDrawable)
-						{
-							F32 cur_score = drawable->getRadius() / llmax(drawable->mDistanceWRTCamera, 1.f);
-							max_score = llmax(max_score, cur_score);
-						}
-					}
-				
-					score_map[param.first.getSculptID()] = max_score;
-				}
-			}
-
-			//set "score" for pending requests
-			for (std::vector<LLMeshRepoThread::LODRequest>::iterator iter = mPendingRequests.begin(); iter != mPendingRequests.end(); ++iter)
-			{
-				iter->mScore = score_map[iter->mMeshParams.getSculptID()];
-			}
-
-			//sort by "score"
-			std::partial_sort(mPendingRequests.begin(), mPendingRequests.begin() + push_count,
-							  mPendingRequests.end(), LLMeshRepoThread::CompareScoreGreater());
-
-			while (!mPendingRequests.empty() && push_count > 0)
-			{
-				LLMeshRepoThread::LODRequest& request = mPendingRequests.front();
-				mThread->loadMeshLOD(request.mMeshParams, request.mLOD);
-				mPendingRequests.erase(mPendingRequests.begin());
-				LLMeshRepository::sLODPending--;
-				push_count--;
-			}
-		}
+		updateLoadingPriorities();
 
 		//send skin info requests
 		while (!mPendingSkinRequests.empty())
@@ -2703,12 +2951,91 @@ void LLMeshRepository::notifyLoadedMeshes()
 		mThread->notifyLoadedMeshes();
 	}
 
+	trimMeshInfo();
+
 	mThread->mSignal->signal();
 }
 
+void LLMeshRepository::updateLoadingPriorities()
+{ //called from main thread with mMeshMutex and mThread->mMutex locked
+	typedef std::map<LLVolumeParams, F32> header_priority_map;
+	header_priority_map header_priority;
+
+	for (S32 lod = 0; lod < 4; ++lod)
+	{
+		for (mesh_load_map::iterator iter = mLoadingMeshes[lod].begin(); iter != mLoadingMeshes[lod].end(); ++iter)
+		{
+			LoadingMesh& loading = iter->second;
+			loading.mPriority = 0.f;
+			for (std::vector<LLVOVolume*>::iterator obj_iter = loading.mObjects.begin(); obj_iter != loading.mObjects.end(); ++obj_iter)
+			{
+				bool on_screen;
+				loading.mPriority = llmax(loading.mPriority, get_mesh_request_priority(*obj_iter, lod, on_screen));
+				loading.mOnScreen |= on_screen;
+			}
+			F32& priority = header_priority[iter->first];
+			priority = llmax(priority, loading.mPriority);
+		}
+	}
+
+	for (S32 lod = 0; lod < 4; ++lod)
+	{
+		for (mesh_load_map::iterator iter = mLoadingMeshes[lod].begin(); iter != mLoadingMeshes[lod].end(); ++iter)
+		{
+			mThread->setRequestPriority(iter->first, lod, iter->second.mPriority, header_priority[iter->first]);
+		}
+	}
+}
+
+static U32 get_skin_info_bytes(const LLMeshSkinInfo& info)
+{
+	return sizeof(LLMeshSkinInfo) +
+		info.mJointNames.capacity() * sizeof(LLMeshJointName) +
+		info.mJointNums.capacity() * sizeof(S32) +
+		(info.mInvBindMatrix.capacity() + info.mAlternateBindMatrix.capacity()) * sizeof(LLMatrix4);
+}
+
+static U32 get_physics_mesh_bytes(const LLModel::PhysicsMesh& mesh)
+{
+	return (mesh.mPositions.capacity() + mesh.mNormals.capacity()) * sizeof(LLVector3);
+}
+
+static U32 get_decomposition_bytes(const LLModel::Decomposition& decomp)
+{
+	U32 bytes = sizeof(LLModel::Decomposition) +
+		decomp.mHull.capacity() * sizeof(LLModel::hull) +
+		decomp.mBaseHull.capacity() * sizeof(LLVector3) +
+		decomp.mMesh.capacity() * sizeof(LLModel::PhysicsMesh) +
+		get_physics_mesh_bytes(decomp.mBaseHullMesh) +
+		get_physics_mesh_bytes(decomp.mPhysicsShapeMesh);
+	for (U32 i = 0; i < decomp.mHull.size(); ++i)
+	{
+		bytes += decomp.mHull[i].capacity() * sizeof(LLVector3);
+	}
+	for (U32 i = 0; i < decomp.mMesh.size(); ++i)
+	{
+		bytes += get_physics_mesh_bytes(decomp.mMesh[i]);
+	}
+	return bytes;
+}
+
+LLMeshRepository::SkinInfoEntry::SkinInfoEntry(const LLMeshSkinInfo& info)
+:	mInfo(info),
+	mLastUsed(gFrameTimeSeconds),
+	mBytes(get_skin_info_bytes(info))
+{
+}
+
 void LLMeshRepository::notifySkinInfoReceived(LLMeshSkinInfo& info)
 {
-	mSkinMap.insert_or_assign(info.mMeshID, info);
+	skin_map::iterator entry = mSkinMap.find(info.mMeshID);
+	if (entry != mSkinMap.end())
+	{
+		sSkinInfoBytes -= entry->second.mBytes;
+		mSkinMap.erase(entry);
+	}
+	entry = mSkinMap.emplace(info.mMeshID, SkinInfoEntry(info)).first;
+	sSkinInfoBytes += entry->second.mBytes;
 
 	skin_load_map::iterator iter = mLoadingSkins.find(info.mMeshID);
 	if (iter != mLoadingSkins.end())
@@ -2727,18 +3054,110 @@ void LLMeshRepository::notifySkinInfoReceived(LLMeshSkinInfo& info)
 
 void LLMeshRepository::notifyDecompositionReceived(LLModel::Decomposition* decomp)
 {
-	decomposition_map::iterator iter = mDecompositionMap.find(decomp->mMeshID);
-	if (iter == mDecompositionMap.end())
+	DecompositionEntry& entry = mDecompositionMap[decomp->mMeshID];
+	if (!entry.mDecomp)
 	{	//just insert decomp into map
-		mDecompositionMap[decomp->mMeshID] = decomp;
+		entry.mDecomp = decomp;
+		entry.mLastUsed = gFrameTimeSeconds;
 		mLoadingDecompositions.erase(decomp->mMeshID);
 	}
 	else
 	{ //merge decomp with existing entry
-		iter->second->merge(decomp);
+		entry.mDecomp->merge(decomp);
 		mLoadingDecompositions.erase(decomp->mMeshID);
 		delete decomp;
 	}
+	if (!entry.mDecomp->mPhysicsShapeMesh.empty())
+	{ //a mesh without a physics shape stays marked as loading, so it is not asked for again and again
+		mLoadingPhysicsShapes.erase(entry.mDecomp->mMeshID);
+	}
+	sDecompositionBytes -= entry.mBytes;
+	entry.mBytes = get_decomposition_bytes(*entry.mDecomp);
+	sDecompositionBytes += entry.mBytes;
+}
+
+void LLMeshRepository::trimMeshInfo()
+{ //called from main thread
+	static const LLCachedControl<U32> budget("MeshInfoCacheBudget");
+	static F32 last_trim = 0.f;
+
+	const U32 max_bytes = llmin((U32)budget, 4095U) << 20;
+	if (sSkinInfoBytes + sDecompositionBytes <= max_bytes || gFrameTimeSeconds - last_trim < 1.f)
+	{
+		return;
+	}
+	last_trim = gFrameTimeSeconds;
+
+	// Entries that can go, oldest first. Everything used lately stays, even over budget.
+	typedef std::pair<F32, std::pair<LLUUID, bool> > candidate_t;
+	std::vector<candidate_t> candidates;
+	const F32 pinned_since = gFrameTimeSeconds - MESH_INFO_PIN_TIME;
+	for (skin_map::iterator iter = mSkinMap.begin(); iter != mSkinMap.end(); ++iter)
+	{
+		if (iter->second.mLastUsed < pinned_since)
+		{
+			LLViewerObject* objectp = gObjectList.findObject(iter->second.mLastObjectID);
+			if (!objectp || objectp->isDead())
+			{
+				candidates.push_back(std::make_pair(iter->second.mLastUsed, std::make_pair(iter->first, true)));
+			}
+		}
+	}
+	for (decomposition_map::iterator iter = mDecompositionMap.begin(); iter != mDecompositionMap.end(); ++iter)
+	{
+		if (iter->second.mLastUsed < pinned_since)
+		{
+			candidates.push_back(std::make_pair(iter->second.mLastUsed, std::make_pair(iter->first, false)));
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	U32 evicted = 0;
+	for (U32 i = 0; i < candidates.size() && sSkinInfoBytes + sDecompositionBytes > max_bytes; ++i)
+	{
+		const LLUUID& mesh_id = candidates[i].second.first;
+		if (candidates[i].second.second)
+		{
+			skin_map::iterator iter = mSkinMap.find(mesh_id);
+			sSkinInfoBytes -= iter->second.mBytes;
+			mSkinMap.erase(iter);
+		}
+		else
+		{
+			decomposition_map::iterator iter = mDecompositionMap.find(mesh_id);
+			sDecompositionBytes -= iter->second.mBytes;
+			delete iter->second.mDecomp;
+			mDecompositionMap.erase(iter);
+			//the physics shape went with it, let fetchPhysicsShape() ask for it again
+			mLoadingPhysicsShapes.erase(mesh_id);
+		}
+		++evicted;
+	}
+	sMeshInfoEvictions += evicted;
+
+	LL_DEBUGS(LOG_MESH) << "Dropped " << evicted << " skin info and decompositions, "
+						<< (sSkinInfoBytes + sDecompositionBytes) / 1024 << " KB held" << LL_ENDL;
+}
+
+void LLMeshRepository::prefetchMesh(const LLUUID& mesh_id, S32 lod)
+{ //called from main thread
+	if (!mThread || lod < 0 || lod >= LLModel::NUM_LODS)
+	{
+		return;
+	}
+
+	LLVolumeParams mesh_params;
+	mesh_params.setSculptID(mesh_id, LL_SCULPT_TYPE_MESH);
+
+	{
+		LLMutexLock lock(mMeshMutex);
+		if (mLoadingMeshes[lod].find(mesh_params) != mLoadingMeshes[lod].end())
+		{ //an object asked for it already
+			return;
+		}
+	}
+
+	mThread->prefetchMeshLOD(mesh_params, lod);
 }
 
 void LLMeshRepository::notifyMeshLoaded(const LLVolumeParams& mesh_params, LLVolume* volume)
@@ -2773,10 +3192,18 @@ void LLMeshRepository::notifyMeshLoaded(const LLVolumeParams& mesh_params, LLVol
 		}
 
 		//notify waiting LLVOVolume instances that their requested mesh is available
-		for (auto& vobj : obj_iter->second)
+		for (auto& vobj : obj_iter->second.mObjects)
 		{
 			vobj->notifyMeshLoaded();
 		}
+
+		if (obj_iter->second.mOnScreen)
+		{
+			F32 load_time = obj_iter->second.mTimer.getElapsedTimeF32();
+			++sOnScreenLODLoads;
+			sOnScreenLODLoadTime += load_time;
+			sOnScreenLODLoadTimeMax = llmax(sOnScreenLODLoadTimeMax, load_time);
+		}
 		
 		mLoadingMeshes[detail].erase(mesh_params);
 	}
@@ -2791,7 +3218,7 @@ void LLMeshRepository::notifyMeshUnavailable(const LLVolumeParams& mesh_params,
 
 	if (obj_iter != mLoadingMeshes[lod].end())
 	{
-		for (auto& vobj : obj_iter->second)
+		for (auto& vobj : obj_iter->second.mObjects)
 		{
 			LLVolume* obj_volume = vobj->getVolume();
 			if (obj_volume && 
@@ -2816,9 +3243,11 @@ const LLMeshSkinInfo* LLMeshRepository::getSkinInfo(const LLUUID& mesh_id, const
 	if (mesh_id.notNull())
 	{
 		const auto iter = mSkinMap.find(mesh_id);
-		if (iter != mSkinMap.cend())
+		if (iter != mSkinMap.end())
 		{
-			return &(iter->second);
+			iter->second.mLastUsed = gFrameTimeSeconds;
+			iter->second.mLastObjectID = requesting_obj->getID();
+			return &(iter->second.mInfo);
 		}
 		
 		//no skin info known about given mesh, try to fetch it
@@ -2845,7 +3274,8 @@ void LLMeshRepository::fetchPhysicsShape(const LLUUID& mesh_id)
 		decomposition_map::iterator iter = mDecompositionMap.find(mesh_id);
 		if (iter != mDecompositionMap.end())
 		{
-			decomp = iter->second;
+			decomp = iter->second.mDecomp;
+			iter->second.mLastUsed = gFrameTimeSeconds;
 		}
 		
 		//decomposition block hasn't been fetched yet
@@ -2873,7 +3303,8 @@ LLModel::Decomposition* LLMeshRepository::getDecomposition(const LLUUID& mesh_id
 		decomposition_map::iterator iter = mDecompositionMap.find(mesh_id);
 		if (iter != mDecompositionMap.end())
 		{
-			ret = iter->second;
+			ret = iter->second.mDecomp;
+			iter->second.mLastUsed = gFrameTimeSeconds;
 		}
 		
 		//decomposition block hasn't been fetched yet
@@ -3224,34 +3655,33 @@ F32 LLMeshRepository::getStreamingCostLegacy(LLSD& header, F32 radius, S32* byte
 }
 
 LLMeshCostData::LLMeshCostData()
+:	mEstTrisForStreamingCost(0.f)
 {
-    mSizeByLOD.resize(4);
-    mEstTrisByLOD.resize(4);
-
-    std::fill(mSizeByLOD.begin(), mSizeByLOD.end(), 0);
-    std::fill(mEstTrisByLOD.begin(), mEstTrisByLOD.end(), 0.f);
+    std::fill(mSizeByLOD, mSizeByLOD + 4, 0);
+    std::fill(mEstTrisByLOD, mEstTrisByLOD + 4, 0.f);
 }
 
 bool LLMeshCostData::init(const LLSD& header)
 {
-    mSizeByLOD.resize(4);
-    mEstTrisByLOD.resize(4);
+    init(header["lowest_lod"]["size"].asInteger(), header["low_lod"]["size"].asInteger(),
+         header["medium_lod"]["size"].asInteger(), header["high_lod"]["size"].asInteger());
+    return true;
+}
+
+void LLMeshCostData::init(S32 bytes_lowest, S32 bytes_low, S32 bytes_med, S32 bytes_high)
+{
+    static const LLCachedControl<U32> metadata_discount("MeshMetaDataDiscount");
+    static const LLCachedControl<U32> minimum_size("MeshMinimumByteSize");
+    static const LLCachedControl<U32> bytes_per_triangle("MeshBytesPerTriangle");
 
-    std::fill(mSizeByLOD.begin(), mSizeByLOD.end(), 0);
-    std::fill(mEstTrisByLOD.begin(), mEstTrisByLOD.end(), 0.f);
-    
-    S32 bytes_high = header["high_lod"]["size"].asInteger();
-    S32 bytes_med = header["medium_lod"]["size"].asInteger();
     if (bytes_med == 0)
     {
         bytes_med = bytes_high;
     }
-    S32 bytes_low = header["low_lod"]["size"].asInteger();
     if (bytes_low == 0)
     {
         bytes_low = bytes_med;
     }
-    S32 bytes_lowest = header["lowest_lod"]["size"].asInteger();
     if (bytes_lowest == 0)
     {
         bytes_lowest = bytes_low;
@@ -3261,16 +3691,37 @@ bool LLMeshCostData::init(const LLSD& header)
     mSizeByLOD[2] = bytes_med;
     mSizeByLOD[3] = bytes_high;
 
-    F32 METADATA_DISCOUNT = (F32) gSavedSettings.getU32("MeshMetaDataDiscount");  //discount 128 bytes to cover the cost of LLSD tags and compression domain overhead
-    F32 MINIMUM_SIZE = (F32) gSavedSettings.getU32("MeshMinimumByteSize"); //make sure nothing is "free"
-    F32 bytes_per_triangle = (F32) gSavedSettings.getU32("MeshBytesPerTriangle");
+    F32 METADATA_DISCOUNT = (F32) metadata_discount;  //discount 128 bytes to cover the cost of LLSD tags and compression domain overhead
+    F32 MINIMUM_SIZE = (F32) minimum_size; //make sure nothing is "free"
 
     for (S32 i=0; i<4; i++)
     {
-        mEstTrisByLOD[i] = llmax((F32) mSizeByLOD[i]-METADATA_DISCOUNT, MINIMUM_SIZE)/bytes_per_triangle; 
+        mEstTrisByLOD[i] = llmax((F32) mSizeByLOD[i]-METADATA_DISCOUNT, MINIMUM_SIZE)/(F32) bytes_per_triangle; 
     }
 
-    return true;
+    LL_DEBUGS("StreamingCost") << "tris_by_lod: "
+                               << mEstTrisByLOD[0] << ", "
+                               << mEstTrisByLOD[1] << ", "
+                               << mEstTrisByLOD[2] << ", "
+                               << mEstTrisByLOD[3] << LL_ENDL;
+
+    F32 charged_tris = mEstTrisByLOD[3];
+    F32 allowed_tris = mEstTrisByLOD[3];
+    const F32 ENFORCE_FLOOR = 64.0f;
+    for (S32 i=2; i>=0; i--)
+    {
+        // How many tris can we have in this LOD without affecting land impact?
+        // - normally an LOD should be at most half the size of the previous one.
+        // - once we reach a floor of ENFORCE_FLOOR, don't require LODs to get any smaller.
+        allowed_tris = llclamp(allowed_tris/2.0f,ENFORCE_FLOOR,mEstTrisByLOD[i]);
+        F32 excess_tris = mEstTrisByLOD[i]-allowed_tris;
+        if (excess_tris>0.f)
+        {
+            LL_DEBUGS("StreamingCost") << "excess tris in lod[" << i << "] " << excess_tris << " allowed " << allowed_tris <<  LL_ENDL;
+            charged_tris += excess_tris;
+        }
+    }
+    mEstTrisForStreamingCost = charged_tris;
 }
 
 
@@ -3348,34 +3799,13 @@ F32 LLMeshCostData::getRadiusWeightedTris(F32 radius)
 
 F32 LLMeshCostData::getEstTrisForStreamingCost()
 {
-    LL_DEBUGS("StreamingCost") << "tris_by_lod: "
-                               << mEstTrisByLOD[0] << ", "
-                               << mEstTrisByLOD[1] << ", "
-                               << mEstTrisByLOD[2] << ", "
-                               << mEstTrisByLOD[3] << LL_ENDL;
-
-    F32 charged_tris = mEstTrisByLOD[3];
-    F32 allowed_tris = mEstTrisByLOD[3];
-    const F32 ENFORCE_FLOOR = 64.0f;
-    for (S32 i=2; i>=0; i--)
-    {
-        // How many tris can we have in this LOD without affecting land impact?
-        // - normally an LOD should be at most half the size of the previous one.
-        // - once we reach a floor of ENFORCE_FLOOR, don't require LODs to get any smaller.
-        allowed_tris = llclamp(allowed_tris/2.0f,ENFORCE_FLOOR,mEstTrisByLOD[i]);
-        F32 excess_tris = mEstTrisByLOD[i]-allowed_tris;
-        if (excess_tris>0.f)
-        {
-            LL_DEBUGS("StreamingCost") << "excess tris in lod[" << i << "] " << excess_tris << " allowed " << allowed_tris <<  LL_ENDL;
-            charged_tris += excess_tris;
-        }
-    }
-    return charged_tris;
+    return mEstTrisForStreamingCost;
 }
 
 F32 LLMeshCostData::getRadiusBasedStreamingCost(F32 radius)
 {
-	return getRadiusWeightedTris(radius)/gSavedSettings.getU32("MeshTriangleBudget")*15000.f;
+	static const LLCachedControl<U32> mesh_triangle_budget("MeshTriangleBudget");
+	return getRadiusWeightedTris(radius)/mesh_triangle_budget*15000.f;
 }
 
 F32 LLMeshCostData::getTriangleBasedStreamingCost()
@@ -3385,31 +3815,91 @@ F32 LLMeshCostData::getTriangleBasedStreamingCost()
 }
 
 
-bool LLMeshRepository::getCostData(LLUUID mesh_id, LLMeshCostData& data)
+// True the first time it is called after one of the settings LLMeshCostData::init() uses changed
+static bool cost_settings_changed()
 {
-	data = LLMeshCostData();
+	static const LLCachedControl<U32> metadata_discount("MeshMetaDataDiscount");
+	static const LLCachedControl<U32> minimum_size("MeshMinimumByteSize");
+	static const LLCachedControl<U32> bytes_per_triangle("MeshBytesPerTriangle");
+	static U32 last[3] = { 0, 0, 0 };
 
+	if (last[0] == metadata_discount && last[1] == minimum_size && last[2] == bytes_per_triangle)
+	{
+		return false;
+	}
+	last[0] = metadata_discount;
+	last[1] = minimum_size;
+	last[2] = bytes_per_triangle;
+	return true;
+}
+
+// Called with mThread->mHeaderMutex locked
+const LLMeshCostData* LLMeshRepository::findCostData(const LLUUID& mesh_id)
+{
+	if (cost_settings_changed())
+	{
+		mCostData.clear();
+	}
+
+	cost_data_map::iterator cost_iter = mCostData.find(mesh_id);
+	if (cost_iter != mCostData.end())
+	{
+		return &cost_iter->second;
+	}
+
+	LLMeshRepoThread::mesh_header_map::iterator iter = mThread->mMeshHeader.find(mesh_id);
+	if (iter == mThread->mMeshHeader.end() || mThread->mMeshHeaderSize[mesh_id] == 0)
+	{
+		return NULL;
+	}
+
+	LLMeshCostData& data = mCostData[mesh_id];
+	const LLSD& header = iter->second;
+	bool header_invalid = (header.has("404")
+		|| !header.has("lowest_lod")
+		|| (header.has("version") && header["version"].asInteger() > MAX_MESH_VERSION));
+	if (!header_invalid)
+	{
+		data.init(header);
+	}
+	return &data;
+}
+
+bool LLMeshRepository::getCostData(LLUUID mesh_id, LLMeshCostData& data)
+{
 	if (mThread && mesh_id.notNull())
 	{
 		LLMutexLock lock(mThread->mHeaderMutex);
-		LLMeshRepoThread::mesh_header_map::iterator iter = mThread->mMeshHeader.find(mesh_id);
-		if (iter != mThread->mMeshHeader.end() && mThread->mMeshHeaderSize[mesh_id] > 0)
+		if (const LLMeshCostData* costs = findCostData(mesh_id))
 		{
-			const LLSD& header = iter->second;
-
-			bool header_invalid = (header.has("404")
-				|| !header.has("lowest_lod")
-				|| (header.has("version") && header["version"].asInteger() > MAX_MESH_VERSION));
-			if (!header_invalid)
-			{
-				return getCostData(header, data);
-			}
-
+			data = *costs;
 			return true;
 		}
 	}
+	data = LLMeshCostData();
 	return false;
 }
+
+void LLMeshRepository::getCostData(const uuid_vec_t& mesh_ids, std::vector<LLMeshCostData>& costs, std::vector<bool>& found)
+{
+	costs.assign(mesh_ids.size(), LLMeshCostData());
+	found.assign(mesh_ids.size(), false);
+	if (!mThread)
+	{
+		return;
+	}
+
+	LLMutexLock lock(mThread->mHeaderMutex);
+	for (U32 i = 0; i < mesh_ids.size(); ++i)
+	{
+		const LLMeshCostData* data = mesh_ids[i].notNull() ? findCostData(mesh_ids[i]) : NULL;
+		if (data)
+		{
+			costs[i] = *data;
+			found[i] = true;
+		}
+	}
+}
 	
 bool LLMeshRepository::getCostData(LLSD& header, LLMeshCostData& data)
 {
@@ -4032,6 +4522,14 @@ void LLMeshRepository::buildPhysicsMesh(LLModel::Decomposition& decomp)
 			get_vertex_buffer_from_mesh(mesh, decomp.mBaseHullMesh);
 		}
 	}
+
+	decomposition_map::iterator iter = mDecompositionMap.find(decomp.mMeshID);
+	if (iter != mDecompositionMap.end() && iter->second.mDecomp == &decomp)
+	{	//the meshes count against the budget
+		sDecompositionBytes -= iter->second.mBytes;
+		iter->second.mBytes = get_decomposition_bytes(decomp);
+		sDecompositionBytes += iter->second.mBytes;
+	}
 }
 
 
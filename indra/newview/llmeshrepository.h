@@ -38,13 +38,19 @@
 #include "llconvexdecomposition.h"
 #include "lluploadfloaterobservers.h"
 #include "aistatemachinethread.h"
+#include "llindexedheap.h"
+#include "llthreadpool.h"
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/node_hash_map.h>
 
+#include <deque>
+
 #ifndef BOOST_FUNCTION_HPP_INCLUDED
 #include <boost/function.hpp>
 #define BOOST_FUNCTION_HPP_INCLUDED
 #endif
+#include <boost/shared_ptr.hpp>
 
 class LLVOVolume;
 class LLMeshResponder;
@@ -171,6 +177,62 @@ public:
 
 };
 
+//
+// Unpacks received mesh LODs (zlib, LLSD, dequantization in
+// LLVolume::unpackVolumeFaces()) on a pool of worker threads, so that
+// LLMeshRepoThread and the HTTP completions only move bytes around.
+//
+// The data waiting here or being unpacked counts against a memory budget;
+// LLMeshRepoThread does not send new LOD requests while it is exceeded.
+// A LOD unpacked from the network is written to the mesh cache; a bad one
+// from the cache is removed from it and fetched again.
+//
+class LLMeshParseQueue
+{
+public:
+	LLMeshParseQueue();
+	~LLMeshParseQueue();
+
+	// Unpack up to threads LODs at once on the shared worker pool, threads < 0 picks the maximum.
+	// Without the pool or with threads 0, parseLOD() unpacks on the calling thread.
+	void start(S32 threads, U32 budget_bytes);
+	// Wait for the LODs being unpacked; those that have not started yet are dropped
+	void shutdown();
+	bool isRunning() const			{ return mQueue != NULL; }
+
+	// Takes ownership of data (new[]). cache_bytes is how much of it to write to the mesh cache at
+	// offset once unpacked, 0 if it was read from there.
+	void parseLOD(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size, S32 offset, S32 cache_bytes);
+
+	bool isOverBudget();
+	S32 getPending();
+
+private:
+	struct Job
+	{
+		Job() : mData(NULL) {}
+		~Job()	{ delete [] mData; }
+
+		LLVolumeParams mMeshParams;
+		S32 mLOD;
+		U8* mData;
+		S32 mSize;
+		S32 mOffset;
+		S32 mCacheBytes;
+	};
+	typedef boost::shared_ptr<Job> job_ptr_t;
+
+	static void parse(const Job& job);
+	// Runs on the pool
+	void runJob(job_ptr_t job);
+
+private:
+	LLThreadPool::Queue* mQueue;
+	LLMutex			mMutex;			// protects mBytes
+	U32				mBytes;			// queued and being unpacked
+	U32				mBudget;
+};
+
 class LLMeshRepoThread : public LLThread
 {
 public:
@@ -193,11 +255,16 @@ public:
 	{
 		LLTimer mTimer;
 		LLVolumeParams mMeshParams;
-		MeshRequest(const LLVolumeParams&  mesh_params) : mMeshParams(mesh_params)
+		F32 mPriority;		// projected screen area of the objects waiting for it, see LLMeshRepository::updateLoadingPriorities()
+		F32 mDelay;			// not sent before mTimer reaches it
+		S32 mQueueIndex;	// in RequestQueue, -1 while delayed
+		bool mPrefetch;		// no object waits for it, it only fills the mesh cache; not counted in sLODProcessing
+		MeshRequest(const LLVolumeParams&  mesh_params) : mMeshParams(mesh_params), mPriority(0.f), mDelay(0.f), mQueueIndex(-1), mPrefetch(false)
 		{
 			mTimer.start();
 		}
 		virtual ~MeshRequest() {}
+		virtual S32 getLOD() const { return -1; }
 		virtual void preFetch() {}
 		virtual bool fetch(U32& count) = 0;
 	};
@@ -208,33 +275,54 @@ public:
 			: MeshRequest(mesh_params)
 		{}
 		bool fetch(U32& count);
-		bool operator<(const HeaderRequest& rhs) const
-		{
-			return mMeshParams < rhs.mMeshParams;
-		}
 	};
 
 	class LODRequest : public MeshRequest
 	{
 	public:
 		S32 mLOD;
-		F32 mScore;
 
 		LODRequest(const LLVolumeParams&  mesh_params, S32 lod)
-			: MeshRequest(mesh_params), mLOD(lod), mScore(0.f)
+			: MeshRequest(mesh_params), mLOD(lod)
 		{}
+		S32 getLOD() const { return mLOD; }
 		void preFetch();
 		bool fetch(U32& count);
 	};
 
-	struct CompareScoreGreater
+	struct ComparePriorityGreater
 	{
-		bool operator()(const LODRequest& lhs, const LODRequest& rhs)
+		bool operator()(const MeshRequest* lhs, const MeshRequest* rhs) const
 		{
-			return lhs.mScore > rhs.mScore; // greatest = first
+			return lhs->mPriority > rhs->mPriority; // greatest = first
 		}
 	};
-	
+
+	// Requests waiting to be sent, highest priority first. A request can be found
+	// by mesh and LOD (-1 for a header) while it waits, to change its priority or
+	// to cancel it. Protected by mMutex.
+	class RequestQueue
+	{
+	public:
+		~RequestQueue();
+
+		bool empty() const		{ return mRequests.empty(); }
+		// Takes ownership of request, sent once delay seconds have passed. If a request for
+		// the same mesh and LOD is already waiting, that one is kept instead, and stops
+		// being a prefetch unless both are.
+		void push(MeshRequest* request, F32 delay);
+		// Highest priority request whose delay is over, NULL if none. The caller owns it.
+		MeshRequest* pop();
+		void setPriority(const LLVolumeParams& mesh_params, S32 lod, F32 priority);
+		// Returns false if the request is not waiting (not made, in flight or done)
+		bool cancel(const LLVolumeParams& mesh_params, S32 lod);
+
+	private:
+		typedef std::map<std::pair<LLVolumeParams, S32>, MeshRequest*> request_map_t;
+		request_map_t mRequests;
+		LLIndexedHeap<MeshRequest, ComparePriorityGreater, &MeshRequest::mQueueIndex> mReady;
+		std::vector<MeshRequest*> mDelayed;
+	};
 
 	class LoadedMesh
 	{
@@ -278,10 +366,10 @@ public:
 	LLMutex* mDecompositionQMutex;
 
 	//queue of requested headers
-	std::deque<std::pair<std::shared_ptr<MeshRequest>, F32> > mHeaderReqQ;
+	RequestQueue mHeaderReqQ;
 
 	//queue of requested LODs
-	std::deque<std::pair<std::shared_ptr<MeshRequest>, F32> > mLODReqQ;
+	RequestQueue mLODReqQ;
 
 	//queue of unavailable LODs (either asset doesn't exist or asset doesn't have desired LOD)
 	std::queue<LODRequest> mUnavailableQ;
@@ -289,33 +377,45 @@ public:
 	//queue of successfully loaded meshes
 	std::queue<LoadedMesh> mLoadedQ;
 
+	//unpacks received LODs
+	LLMeshParseQueue mParseQueue;
+
 	//map of pending header requests and currently desired LODs
 	typedef std::map<LLVolumeParams, std::vector<S32> > pending_lod_map;
 	pending_lod_map mPendingLOD;
+	//LODs to prefetch once the header is in, kept apart so that they don't hold back the real requests
+	pending_lod_map mPrefetchLOD;
 
 	static std::string constructUrl(LLUUID mesh_id);
 
 	LLMeshRepoThread();
 	~LLMeshRepoThread();
 
-	void runQueue(std::deque<std::pair<std::shared_ptr<MeshRequest>, F32> >& queue, U32& count, S32& active_requests);
+	void runQueue(RequestQueue& queue, U32& count, S32& active_requests);
 	void runSet(uuid_set_t& set, std::function<bool (const LLUUID& mesh_id)> fn);
-	void pushHeaderRequest(const LLVolumeParams& mesh_params, F32 delay = 0)
+	void pushHeaderRequest(const LLVolumeParams& mesh_params, F32 delay = 0, F32 priority = 0.f)
 	{
-		std::shared_ptr<LLMeshRepoThread::MeshRequest> req;
-		req.reset(new LLMeshRepoThread::HeaderRequest(mesh_params));
-		mHeaderReqQ.push_back(std::make_pair(req, delay));
+		LLMeshRepoThread::HeaderRequest* req = new LLMeshRepoThread::HeaderRequest(mesh_params);
+		req->mPriority = priority;
+		mHeaderReqQ.push(req, delay);
 	}
-	void pushLODRequest(const LLVolumeParams& mesh_params, S32 lod, F32 delay = 0)
+	void pushLODRequest(const LLVolumeParams& mesh_params, S32 lod, F32 delay = 0, F32 priority = 0.f, bool prefetch = false)
 	{
-		std::shared_ptr<LLMeshRepoThread::MeshRequest> req;
-		req.reset(new LLMeshRepoThread::LODRequest(mesh_params, lod));
-		mLODReqQ.push_back(std::make_pair(req, delay));
+		LLMeshRepoThread::LODRequest* req = new LLMeshRepoThread::LODRequest(mesh_params, lod);
+		req->mPriority = priority;
+		req->mPrefetch = prefetch;
+		mLODReqQ.push(req, delay);
 	}
 	virtual void run();
 
 	void lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
-	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
+	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod, F32 priority = 0.f);
+	// Fetch the header and lod into the mesh cache behind every real request (MAIN thread)
+	void prefetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
+	// Called from main thread with mMutex locked. The header of the mesh goes with its most important LOD.
+	void setRequestPriority(const LLVolumeParams& mesh_params, S32 lod, F32 priority, F32 header_priority);
+	// Forget a LOD request no object waits for anymore. Returns false if it was already sent.
+	bool cancelMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	bool fetchMeshHeader(const LLVolumeParams& mesh_params, U32& count);
 	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, U32& count);
 	bool headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
@@ -326,7 +426,9 @@ public:
 	LLSD& getMeshHeader(const LLUUID& mesh_id);
 
 	bool getMeshHeaderInfo(const LLUUID& mesh_id, const char* block_name, MeshHeaderInfo& info);
-	bool loadInfoFromVFS(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn);
+	// Whether the lod block is in the mesh cache already
+	bool isLODCached(const LLUUID& mesh_id, S32 lod);
+	bool loadInfoFromCache(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn);
 
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
@@ -463,6 +565,8 @@ public:
     LLMeshCostData();
 
     bool init(const LLSD& header);
+    // From the byte sizes of the LODs, lowest first. A missing LOD (0 bytes) costs as much as the next one up.
+    void init(S32 bytes_lowest, S32 bytes_low, S32 bytes_med, S32 bytes_high);
     
     // Size for given LOD
     S32 getSizeByLOD(S32 lod);
@@ -497,10 +601,13 @@ public:
 
 private:
     // From the "size" field of the mesh header. LOD 0=lowest, 3=highest.
-    std::vector<S32> mSizeByLOD;
+    S32 mSizeByLOD[4];
 
     // Estimated triangle counts derived from the LOD sizes. LOD 0=lowest, 3=highest.
-    std::vector<F32> mEstTrisByLOD;
+    F32 mEstTrisByLOD[4];
+
+    // getEstTrisForStreamingCost(), it only depends on the above
+    F32 mEstTrisForStreamingCost;
 };
 
 class LLMeshRepository
@@ -516,6 +623,14 @@ public:
 	static U32 sCacheBytesRead;
 	static U32 sCacheBytesWritten;
 	static U32 sPeakKbps;
+	// Time from the first request of a mesh LOD to its load, for those that were in view meanwhile
+	static U32 sOnScreenLODLoads;
+	static F32 sOnScreenLODLoadTime;
+	static F32 sOnScreenLODLoadTimeMax;
+	// Bytes held by mSkinMap and mDecompositionMap, entries dropped to stay within MeshInfoCacheBudget
+	static U32 sSkinInfoBytes;
+	static U32 sDecompositionBytes;
+	static U32 sMeshInfoEvictions;
 	
 	// Estimated triangle count of the largest LOD
 	F32 getEstTrianglesMax(LLUUID mesh_id);
@@ -523,7 +638,12 @@ public:
 	F32 getStreamingCostLegacy(LLUUID mesh_id, F32 radius, S32* bytes = NULL, S32* visible_bytes = NULL, S32 detail = -1, F32 *unscaled_value = NULL);
 	static F32 getStreamingCostLegacy(LLSD& header, F32 radius, S32* bytes = NULL, S32* visible_bytes = NULL, S32 detail = -1, F32 *unscaled_value = NULL);
 	bool getCostData(LLUUID mesh_id, LLMeshCostData& data);
+	// getCostData() of each of mesh_ids, with one lock of the headers for all of them.
+	// found[i] is false, and costs[i] empty, when the header of mesh_ids[i] has not come in.
+	void getCostData(const uuid_vec_t& mesh_ids, std::vector<LLMeshCostData>& costs, std::vector<bool>& found);
 	static bool getCostData(LLSD& header, LLMeshCostData& data);
+	// Entry of mCostData for mesh_id, computed if needed. NULL until the header comes in.
+	const LLMeshCostData* findCostData(const LLUUID& mesh_id);
 
 	LLMeshRepository();
 
@@ -533,12 +653,19 @@ public:
 	void unregisterMesh(LLVOVolume* volume);
 	//mesh management functions
 	S32 loadMesh(LLVOVolume* volume, const LLVolumeParams& mesh_params, S32 detail = 0, S32 last_lod = -1);
+	// Fetch the header and lod of a mesh no object has asked for yet into the mesh
+	// cache, after every request an object waits for
+	void prefetchMesh(const LLUUID& mesh_id, S32 lod);
 	
 	void notifyLoadedMeshes();
+	// Move the requests of the meshes that are loading to their place in the queues of mThread
+	void updateLoadingPriorities();
 	void notifyMeshLoaded(const LLVolumeParams& mesh_params, LLVolume* volume);
 	void notifyMeshUnavailable(const LLVolumeParams& mesh_params, S32 lod);
 	void notifySkinInfoReceived(LLMeshSkinInfo& info);
 	void notifyDecompositionReceived(LLModel::Decomposition* info);
+	// Drop the least recently used skin info and decompositions that are over budget
+	void trimMeshInfo();
 
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	static S32 getActualMeshLOD(LLSD& header, S32 lod);
@@ -562,19 +689,56 @@ public:
 
 	S32 getMeshSize(const LLUUID& mesh_id, S32 lod);
 
-	typedef std::map<LLVolumeParams, std::vector<LLVOVolume*> > mesh_load_map;
+	struct LoadingMesh
+	{
+		LoadingMesh() : mPriority(0.f), mOnScreen(false)
+		{
+			mTimer.start();
+		}
+		std::vector<LLVOVolume*> mObjects;	// waiting for this mesh and LOD
+		LLTimer mTimer;						// since the first request
+		F32 mPriority;
+		bool mOnScreen;						// one of mObjects was in view while it loaded
+	};
+	typedef std::map<LLVolumeParams, LoadingMesh> mesh_load_map;
 	mesh_load_map mLoadingMeshes[4];
 
-	typedef absl::node_hash_map<LLUUID, LLMeshSkinInfo> skin_map;
+	// Skin info and decompositions (physics shapes included) are kept within the
+	// MeshInfoCacheBudget setting. Past it, trimMeshInfo() drops the least recently
+	// used ones that were not asked for in the last MESH_INFO_PIN_TIME seconds and,
+	// for skin info, whose last object is gone. They are fetched again, from the mesh
+	// cache most of the time, when they are asked for next. The pointers returned by
+	// getSkinInfo() and getDecomposition() are good until the next notifyLoadedMeshes().
+	struct SkinInfoEntry
+	{
+		SkinInfoEntry(const LLMeshSkinInfo& info);
+
+		LLMeshSkinInfo mInfo;
+		LLUUID mLastObjectID;		// object that last asked for it
+		F32 mLastUsed;				// gFrameTimeSeconds
+		U32 mBytes;
+	};
+	typedef absl::node_hash_map<LLUUID, SkinInfoEntry> skin_map;
 	skin_map mSkinMap;
 
-	typedef std::map<LLUUID, LLModel::Decomposition*> decomposition_map;
+	struct DecompositionEntry
+	{
+		DecompositionEntry() : mDecomp(NULL), mLastUsed(0.f), mBytes(0) {}
+
+		LLModel::Decomposition* mDecomp;
+		F32 mLastUsed;
+		U32 mBytes;
+	};
+	typedef std::map<LLUUID, DecompositionEntry> decomposition_map;
 	decomposition_map mDecompositionMap;
 
+	// Cost data of the headers of mThread, computed the first time they are asked for and
+	// dropped when a header changes. Protected by mThread->mHeaderMutex.
+	typedef absl::flat_hash_map<LLUUID, LLMeshCostData> cost_data_map;
+	cost_data_map mCostData;
+
 	LLMutex*					mMeshMutex;
 	
-	std::vector<LLMeshRepoThread::LODRequest> mPendingRequests;
-	
 	//list of mesh ids awaiting skin info
 	typedef std::map<LLUUID, uuid_set_t > skin_load_map;
 	skin_load_map mLoadingSkins;
@@ -0,0 +1,300 @@
+/**
+ * @file llsessionaccesslog.cpp
+ * @brief Per-region log of the assets used in a session, replayed as prefetches at the next login.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llsessionaccesslog.h"
+
+#include "llapr.h"
+#include "llappviewer.h"
+#include "llcallbacklist.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "llmeshrepository.h"
+#include "lltexturefetch.h"
+#include "llviewercontrol.h"
+#include "llviewertexturelist.h"
+
+static const U32 ACCESS_LOG_MAGIC = 0x4c41534c; // "LSAL"
+static const U32 ACCESS_LOG_VERSION = 1;
+static const U32 MAX_ACCESS_LOG_RECORDS = 4096;
+// Loading has to stay quiet this long before we call the region rezzed
+static const F32 SETTLE_QUIET_TIME = 5.f;
+
+struct LLAccessLogHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mNumRecords;
+};
+
+struct record_time_less
+{
+	template<typename T>
+	bool operator()(const T& lhs, const T& rhs) const
+	{
+		return lhs.mTimeMS < rhs.mTimeMS;
+	}
+};
+
+LLSessionAccessLog::LLSessionAccessLog()
+:	mRegionHandle(0),
+	mSettled(true),
+	mLastBusyTime(0.f),
+	mPrefetchedTextures(0),
+	mPrefetchedMeshes(0)
+{
+	gIdleCallbacks.addFunction(idle, this);
+}
+
+LLSessionAccessLog::~LLSessionAccessLog()
+{
+	gIdleCallbacks.deleteFunction(idle, this);
+}
+
+//static
+std::string LLSessionAccessLog::getFilename(U64 handle)
+{
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "accesslog", llformat("%llu.sla", handle));
+}
+
+//static
+void LLSessionAccessLog::removeCache()
+{
+	std::string cache_dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "accesslog");
+	std::string mask = "*.sla";
+	gDirUtilp->deleteFilesInDir(cache_dir, mask);
+}
+
+void LLSessionAccessLog::setRegion(U64 handle)
+{
+	if (handle == mRegionHandle)
+	{
+		return;
+	}
+
+	flush();
+
+	mRegionHandle = handle;
+	mRegionTimer.reset();
+	mSettled = false;
+	mLastBusyTime = 0.f;
+}
+
+LLSessionAccessLog::Record& LLSessionAccessLog::getRecord(const LLUUID& id, EKind kind)
+{
+	std::pair<record_map_t::iterator, bool> result = mRecords.insert(std::make_pair(id, Record()));
+	Record& record = result.first->second;
+	if (result.second)
+	{
+		record.mID = id;
+		record.mKind = kind;
+		record.mTimeMS = (U32)(mRegionTimer.getElapsedTimeF32() * 1000.f);
+	}
+	return record;
+}
+
+void LLSessionAccessLog::recordTexture(const LLUUID& id, S32 texture_type)
+{
+	if (mRegionHandle && id.notNull())
+	{
+		getRecord(id, KIND_TEXTURE).mTextureType = (S8)texture_type;
+	}
+}
+
+void LLSessionAccessLog::recordMesh(const LLUUID& id, S32 lod)
+{
+	if (mRegionHandle && id.notNull())
+	{
+		Record& record = getRecord(id, KIND_MESH);
+		record.mLevel = llmax((S32)record.mLevel, lod);
+	}
+}
+
+void LLSessionAccessLog::flush()
+{
+	if (!mRegionHandle || mRecords.empty())
+	{
+		mRecords.clear();
+		return;
+	}
+
+	std::vector<Record> records;
+	records.reserve(mRecords.size());
+	for (record_map_t::iterator iter = mRecords.begin(); iter != mRecords.end(); ++iter)
+	{
+		Record& record = iter->second;
+		if (record.mKind == KIND_TEXTURE)
+		{
+			// Same filter as the texture list uses for its logout prefetch list:
+			// only keep textures that were actually displayed, at the level they were shown
+			LLViewerFetchedTexture* image = gTextureList.findImage(record.mID, TEX_LIST_STANDARD);
+			if (!image ||
+				!(image->getType() == LLViewerTexture::FETCHED_TEXTURE || image->getType() == LLViewerTexture::LOD_TEXTURE) ||
+				image->getFTType() != FTT_DEFAULT ||
+				!image->hasGLTexture() ||
+				!image->getUseDiscard() ||
+				image->needsAux() ||
+				!image->getBoundRecently())
+			{
+				continue;
+			}
+			S32 desired = image->getDesiredDiscardLevel();
+			if (desired < 0 || desired >= MAX_DISCARD_LEVEL)
+			{
+				continue;
+			}
+			record.mLevel = desired;
+			record.mPixelArea = image->getWidth(desired) * image->getHeight(desired);
+		}
+		records.push_back(record);
+	}
+	mRecords.clear();
+
+	// earliest first, both for prefetch order and so the cap drops the stragglers
+	std::sort(records.begin(), records.end(), record_time_less());
+	if (records.size() > MAX_ACCESS_LOG_RECORDS)
+	{
+		records.resize(MAX_ACCESS_LOG_RECORDS);
+	}
+
+	std::string filename = getFilename(mRegionHandle);
+	LLFile::mkdir(gDirUtilp->getDirName(filename));
+	LLFile::remove(filename);
+	if (records.empty())
+	{
+		return;
+	}
+
+	LLAccessLogHeader header;
+	header.mMagic = ACCESS_LOG_MAGIC;
+	header.mVersion = ACCESS_LOG_VERSION;
+	header.mNumRecords = records.size();
+
+	std::vector<U8> buffer(sizeof(header) + records.size() * sizeof(Record));
+	memcpy(&buffer[0], &header, sizeof(header));		/* Flawfinder: ignore */
+	memcpy(&buffer[sizeof(header)], &records[0], records.size() * sizeof(Record));		/* Flawfinder: ignore */
+
+	S32 size = buffer.size();
+	if (LLAPRFile::writeEx(filename, &buffer[0], 0, size) != size)
+	{
+		LL_WARNS("AccessLog") << "Failed to write access log " << filename << LL_ENDL;
+		LLFile::remove(filename);
+		return;
+	}
+	LL_DEBUGS("AccessLog") << "Wrote " << records.size() << " records to " << filename << LL_ENDL;
+}
+
+void LLSessionAccessLog::prefetch(U64 handle)
+{
+	// Start logging right away, textures created during login belong to this region too
+	setRegion(handle);
+
+	mPrefetchedTextures = 0;
+	mPrefetchedMeshes = 0;
+
+	if (!gSavedSettings.getBOOL("PrefetchFromAccessLog") || LLAppViewer::instance()->getPurgeCache())
+	{
+		return;
+	}
+
+	std::string filename = getFilename(handle);
+	S32 file_size = LLAPRFile::size(filename);
+	if (file_size < (S32)sizeof(LLAccessLogHeader))
+	{
+		return;
+	}
+
+	std::vector<U8> buffer(file_size);
+	if (LLAPRFile::readEx(filename, &buffer[0], 0, file_size) != file_size)
+	{
+		return;
+	}
+
+	LLAccessLogHeader header;
+	memcpy(&header, &buffer[0], sizeof(header));		/* Flawfinder: ignore */
+	if (header.mMagic != ACCESS_LOG_MAGIC || header.mVersion != ACCESS_LOG_VERSION ||
+		header.mNumRecords > MAX_ACCESS_LOG_RECORDS ||
+		sizeof(header) + header.mNumRecords * sizeof(Record) > (size_t)file_size)
+	{
+		LL_WARNS("AccessLog") << "Ignoring invalid access log " << filename << LL_ENDL;
+		LLFile::remove(filename);
+		return;
+	}
+
+	const Record* records = (const Record*)&buffer[sizeof(header)];
+	for (U32 i = 0; i < header.mNumRecords; ++i)
+	{
+		const Record& record = records[i];
+		if (record.mKind == KIND_TEXTURE)
+		{
+			LLViewerFetchedTexture* image = gTextureList.prefetchImage(record.mID, record.mTextureType, (F32)record.mPixelArea);
+			if (image)
+			{
+				// Log it with its original time. It may have existed already (from the
+				// logout texture list) and so not have been logged when it was created.
+				// flush() drops it again if it never gets displayed.
+				mRecords[record.mID] = record;
+				++mPrefetchedTextures;
+			}
+		}
+		else if (record.mKind == KIND_MESH)
+		{
+			gMeshRepo.prefetchMesh(record.mID, record.mLevel);
+			++mPrefetchedMeshes;
+		}
+	}
+
+	LL_INFOS("AccessLog") << "Prefetching " << mPrefetchedTextures << " textures and "
+		<< mPrefetchedMeshes << " meshes from the last visit to this region" << LL_ENDL;
+}
+
+void LLSessionAccessLog::updateSettled()
+{
+	if (mSettled || !mRegionHandle)
+	{
+		return;
+	}
+
+	F32 elapsed = mRegionTimer.getElapsedTimeF32();
+	bool busy = LLAppViewer::getTextureFetch()->getNumRequests() > 0 ||
+				LLMeshRepository::sLODPending > 0 || LLMeshRepository::sLODProcessing > 0;
+	if (busy || mRecords.empty())
+	{
+		mLastBusyTime = elapsed;
+	}
+	else if (elapsed - mLastBusyTime > SETTLE_QUIET_TIME)
+	{
+		mSettled = true;
+		LL_INFOS("AccessLog") << "Region loaded after " << mLastBusyTime << " seconds ("
+			<< mPrefetchedTextures << " textures, " << mPrefetchedMeshes << " meshes prefetched)" << LL_ENDL;
+		mPrefetchedTextures = 0;
+		mPrefetchedMeshes = 0;
+	}
+}
+
+//static
+void LLSessionAccessLog::idle(void* user_data)
+{
+	((LLSessionAccessLog*)user_data)->updateSettled();
+}
@@ -0,0 +1,108 @@
+/**
+ * @file llsessionaccesslog.h
+ * @brief Per-region log of the assets used in a session, replayed as prefetches at the next login.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSESSIONACCESSLOG_H
+#define LL_LLSESSIONACCESSLOG_H
+
+#include "llsingleton.h"
+#include "lltimer.h"
+#include "lluuid.h"
+
+#include <boost/unordered_map.hpp>
+
+//
+// While the agent is in a region, remembers which textures and meshes were first
+// requested and when. When the agent leaves the region (or logs out) the log is
+// written to <cache>/accesslog/<region handle>.sla, keeping only textures that were
+// actually displayed along with the discard level they ended up at.
+//
+// At the next login to that region, prefetch() replays the log ahead of the object
+// updates: textures go through the normal fetch pipeline (cache read and decode)
+// behind every texture in view, and meshes are fetched into the mesh cache at the
+// LOD they were shown at, behind every mesh request an object waits for.
+//
+// Main thread only.
+//
+class LLSessionAccessLog : public LLSingleton<LLSessionAccessLog>
+{
+	friend class LLSingleton<LLSessionAccessLog>;
+	LLSessionAccessLog();
+
+public:
+	~LLSessionAccessLog();
+
+	// The agent moved into a region; writes out the log for the previous one
+	void setRegion(U64 handle);
+
+	void recordTexture(const LLUUID& id, S32 texture_type);
+	void recordMesh(const LLUUID& id, S32 lod);
+
+	// Write out the log for the current region. Must happen before the texture list shuts down.
+	void flush();
+
+	// Queue loads for everything logged the last time we were in this region
+	void prefetch(U64 handle);
+
+	static void removeCache();
+
+	static void idle(void*);
+
+private:
+	enum EKind
+	{
+		KIND_TEXTURE = 0,
+		KIND_MESH = 1
+	};
+
+	// On-disk record, also used in memory while the session is running
+	struct Record
+	{
+		Record() : mKind(KIND_TEXTURE), mLevel(-1), mTextureType(0), mPad(0), mPixelArea(0), mTimeMS(0) {}
+
+		LLUUID	mID;
+		U8		mKind;
+		S8		mLevel;		// discard level for textures, LOD for meshes
+		S8		mTextureType;
+		U8		mPad;
+		U32		mPixelArea;	// textures only, area at mLevel
+		U32		mTimeMS;	// first request, ms after arriving in the region
+	};
+	typedef boost::unordered_map<LLUUID, Record> record_map_t;
+
+	static std::string getFilename(U64 handle);
+	Record& getRecord(const LLUUID& id, EKind kind);
+	void updateSettled();
+
+private:
+	U64				mRegionHandle;
+	LLTimer			mRegionTimer;
+	record_map_t	mRecords;
+
+	// Rough time-to-rezzed for the current region: when texture and mesh loading last went quiet
+	bool			mSettled;
+	F32				mLastBusyTime;
+	U32				mPrefetchedTextures;
+	U32				mPrefetchedMeshes;
+};
+
+#endif // LL_LLSESSIONACCESSLOG_H
@@ -54,6 +54,7 @@ void LLSkinningUtil::scrubInvalidJoints(LLVOAvatar *avatar, LLMeshSkinInfo* skin
     {
         return;
     }
+    static const LLMeshJointName pelvis_name("mPelvis");
     for (U32 j = 0; j < skin->mJointNames.size(); ++j)
     {
         // Fix invalid names to "mPelvis". Currently meshes with
@@ -63,7 +64,7 @@ void LLSkinningUtil::scrubInvalidJoints(LLVOAvatar *avatar, LLMeshSkinInfo* skin
         {
             LL_DEBUGS("Avatar") << avatar->getFullname() << " mesh rigged to invalid joint " << skin->mJointNames[j] << LL_ENDL;
             LL_WARNS_ONCE("Avatar") << avatar->getFullname() << " mesh rigged to invalid joint" << skin->mJointNames[j] << LL_ENDL;
-            skin->mJointNames[j] = "mPelvis";
+            skin->mJointNames[j] = pelvis_name;
             skin->mJointNumsInitialized = false; // force update after names change.
         }
     }
@@ -159,12 +159,14 @@
 #include "llremoteparcelrequest.h"
 #include "llsecondlifeurls.h"
 #include "llselectmgr.h"
+#include "llsessionaccesslog.h"
 #include "llsky.h"
 #include "llstatview.h"
 #include "llstatusbar.h"		// sendMoneyBalanceRequest(), owns L$ balance
 #include "llsurface.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltexturefetchbench.h"
 #include "lltoolmgr.h"
 #include "lltrans.h"
 #include "llui.h"
@@ -973,6 +975,8 @@ bool idle_startup()
 		// Don't do anything.  Wait for the login view to call the login_callback,
 		// which will push us to the next state.
 		display_startup();
+		// Unless we were started to benchmark the texture pipeline
+		LLTextureFetchBench::startIfRequested();
 		// Sleep so we don't spin the CPU
 		ms_sleep(1);
 		return FALSE;
@@ -1658,6 +1662,7 @@ bool idle_startup()
 		// Initialize classes w/graphics stuff.
 		//
 		gTextureList.doPrefetchImages();		
+		LLSessionAccessLog::getInstance()->prefetch(gFirstSimHandle);
 		display_startup();
 
 		LLSurface::initClasses();
@@ -322,6 +322,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 {
 	bool done = false;
 	S32 idx = -1;
+	S32 read_buffer_size = 0;
 
 	S32 local_size = 0;
 	std::string local_filename;
@@ -402,9 +403,9 @@ bool LLTextureCacheRemoteWorker::doRead()
 	}
 
 	// Second state / stage : identify the cache or not...
+	LLTextureCache::Entry entry;
 	if (!done && (mState == CACHE))
 	{
-		LLTextureCache::Entry entry;
 		idx = mCache->getHeaderCacheEntry(mID, entry);
 		if (idx < 0)
 		{
@@ -430,8 +431,14 @@ bool LLTextureCacheRemoteWorker::doRead()
 		// Compute the size we need to read (in bytes)
 		S32 size = TEXTURE_CACHE_ENTRY_SIZE - mOffset;
 		size = llmin(size, mDataSize);
-		// Allocate the read buffer
-		mReadData = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), size);
+		// Allocate the read buffer. If the body is going to be read as well, make room for it
+		// right away so that it lands behind the header data instead of both being copied over.
+		read_buffer_size = size;
+		if (mDataSize > size && entry.mBodySize > 0)
+		{
+			read_buffer_size = llmin(mDataSize, size + entry.mBodySize);
+		}
+		mReadData = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), read_buffer_size);
 		S32 bytes_read = LLAPRFile::readEx(mCache->mHeaderDataFileName, mReadData, offset, size);
 		if (bytes_read != size)
 		{
@@ -467,9 +474,6 @@ bool LLTextureCacheRemoteWorker::doRead()
 
 			S32 data_offset, file_size, file_offset;
 			
-			// Reserve the whole data buffer first
-			U8* data = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), mDataSize);
-
 			// Set the data file pointers taking the read offset into account. 2 cases:
 			if (mOffset < TEXTURE_CACHE_ENTRY_SIZE)
 			{
@@ -478,11 +482,16 @@ bool LLTextureCacheRemoteWorker::doRead()
 				data_offset = TEXTURE_CACHE_ENTRY_SIZE - mOffset;	// i.e. TEXTURE_CACHE_ENTRY_SIZE if mOffset nul (common case)
 				file_offset = 0;
 				file_size = mDataSize - data_offset;
-				// Copy the raw data we've been holding from the header cache into the new sized buffer
 				llassert_always(mReadData);
-				memcpy(data, mReadData, data_offset);
-				FREE_MEM(LLImageBase::getPrivatePool(), mReadData);
-				mReadData = NULL;
+				if (mDataSize > read_buffer_size)
+				{
+					// The body grew since the entry was written: copy the raw data we've been
+					// holding from the header cache into a new sized buffer
+					U8* data = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), mDataSize);
+					memcpy(data, mReadData, data_offset);
+					FREE_MEM(LLImageBase::getPrivatePool(), mReadData);
+					mReadData = data;
+				}
 			}
 			else
 			{
@@ -491,12 +500,10 @@ bool LLTextureCacheRemoteWorker::doRead()
 				file_offset = mOffset - TEXTURE_CACHE_ENTRY_SIZE;
 				file_size = mDataSize;
 				// No data from header cache to copy in that case, we skipped it all
+				llassert_always(mReadData == NULL);
+				mReadData = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), mDataSize);
 			}
 
-			// Now use that buffer as the object read buffer
-			llassert_always(mReadData == NULL);
-			mReadData = data;
-
 			// Read the data at last
 			S32 bytes_read = LLAPRFile::readEx(filename, 
 											 mReadData + data_offset,
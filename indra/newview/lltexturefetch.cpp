@@ -41,8 +41,11 @@
 #include "llhttpclient.h"
 #include "llhttpstatuscodes.h"
 #include "llimage.h"
+#include "llimagedxt.h"
+#include "llimagegl.h"
 #include "llimagej2c.h"
 #include "llimageworker.h"
+#include "lltextureuploadstream.h"
 #include "llworkerthread.h"
 #include "message.h"
 
@@ -128,12 +131,28 @@ private:
 	class DecodeResponder : public LLImageDecodeThread::Responder
 	{
 	public:
-		DecodeResponder(LLTextureFetch* fetcher, const LLUUID& id, LLTextureFetchWorker* worker)
-			: mFetcher(fetcher), mID(id), mWorker(worker)
+		DecodeResponder(LLTextureFetch* fetcher, const LLUUID& id, LLTextureFetchWorker* worker, bool compress, bool stream)
+			: mFetcher(fetcher), mID(id), mWorker(worker), mCompress(compress), mStream(stream)
 		{
 		}
 		virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
 		{
+			bool compressed_mips = false;
+			if (success && mCompress)
+			{
+				// Still on the decode thread, so the main thread only has to upload
+				LLPointer<LLImageDXT> compressed = new LLImageDXT();
+				if (compressed->encodeCompressed(raw))
+				{
+					raw->setCompressedMips(compressed);
+					compressed_mips = true;
+				}
+			}
+			if (success && mStream && !compressed_mips)
+			{
+				// Same idea: the pixels and their mips go to the upload buffer from here
+				raw->setStagedUpload(LLTextureUploadStream::stage(raw));
+			}
 			LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
 			if (worker)
 			{
@@ -144,6 +163,8 @@ private:
 		LLTextureFetch* mFetcher;
 		LLUUID mID;
 		LLTextureFetchWorker* mWorker; // debug only (may get deleted from under us, use mFetcher/mID)
+		bool mCompress;
+		bool mStream;
 	};
 
 	struct Compare
@@ -203,6 +224,8 @@ private:
 	/*virtual*/ void endWork(S32 param, bool aborted); // called from doWork() (MAIN THREAD)
 
 	void resetFormattedData();
+	void keepPartialData();
+	bool adoptPartialData();
 	
 	void setImagePriority(F32 priority);
 	void setDesiredDiscard(S32 discard, S32 size);
@@ -288,7 +311,8 @@ private:
 								mRequestedOffset,
 								mDesiredSize,
 								mFileSize,
-								mCachedSize;
+								mCachedSize;				// bytes of mFormattedImage that are in the cache
+	U32 mHttpSerial;				// of the request in flight, see LLTextureFetch::keepPartialData()
 	e_request_state mSentRequest;
 	handle_t mDecodeHandle;
 	BOOL mLoaded;
@@ -337,9 +361,10 @@ class HTTPGetResponder : public LLHTTPClient::ResponderWithCompleted
 {
 	LOG_CLASS(HTTPGetResponder);
 public:
-	HTTPGetResponder( FTType f_type, LLTextureFetch* fetcher, const LLUUID& id, U64 startTime, S32 requestedSize, U32 offset)
+	HTTPGetResponder( FTType f_type, LLTextureFetch* fetcher, const LLUUID& id, U32 serial, U64 startTime, S32 requestedSize, U32 offset)
 		: mFetcher(fetcher)
 		, mID(id)
+		, mSerial(serial)
 		, mMetricsStartTime(startTime)
 		, mRequestedSize(requestedSize)
 		, mRequestedOffset(offset)
@@ -415,6 +440,25 @@ public:
 		}
 
 		LL_DEBUGS("Texture") << "HTTP COMPLETE: " << mID << LL_ENDL;
+		if (mFetcher->isPartialDataPending(mID, mSerial))
+		{
+			// The worker that sent this request was deleted, keep what it brought for the next one
+			std::vector<U8> data;
+			bool success = HTTP_OK <= mStatus && mStatus < HTTP_MULTIPLE_CHOICES;
+			if (success)
+			{
+				S32 data_size = buffer->countAfter(channels.in(), NULL);
+				if (data_size > 0)
+				{
+					LLViewerStatsRecorder::instance().textureFetch(data_size);
+					data.resize(data_size);
+					buffer->readAfter(channels.in(), NULL, &data[0], data_size);
+				}
+			}
+			mFetcher->receivePartialData(mID, mSerial, mReplyOffset, mReplyLength, HTTP_PARTIAL_CONTENT == mStatus, success, data);
+			mFetcher->removeFromHTTPQueue(mID, (S32)data.size());
+			return;
+		}
 		LLTextureFetchWorker* worker = mFetcher->getWorker(mID);
 		if (worker)
 		{
@@ -490,6 +534,7 @@ private:
 
 	LLTextureFetch* mFetcher;
 	LLUUID mID;
+	U32 mSerial;
 	const FTType mFTType;
 	LLPointer<LLHTTPRetryPolicy> mFetchRetryPolicy;
 	U64 mMetricsStartTime;
@@ -849,6 +894,7 @@ LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
 	  mDesiredSize(TEXTURE_CACHE_ENTRY_SIZE),
 	  mFileSize(0),
 	  mCachedSize(0),
+	  mHttpSerial(0),
 	  mLoaded(FALSE),
 	  mSentRequest(UNSENT),
 	  mDecodeHandle(0),
@@ -1013,7 +1059,13 @@ void LLTextureFetchWorker::setImagePriority(F32 priority)
 		mImagePriority = priority;
 		calcWorkPriority();
 		U32 work_priority = mWorkPriority | (getPriority() & LLWorkerThread::PRIORITY_HIGHBITS);
-		setPriority(work_priority);
+		// Thousands of these a frame from the texture list, LLTextureFetch::update() applies them in one go
+		queuePriority(work_priority);
+		if (mDecodeHandle != 0)
+		{
+			// Keep a queued decode in step, the decode threads pick by priority too
+			mFetcher->mImageDecodeThread->setDecodePriority(mDecodeHandle, LLWorkerThread::PRIORITY_NORMAL | mWorkPriority);
+		}
 	}
 }
 
@@ -1029,6 +1081,68 @@ void LLTextureFetchWorker::resetFormattedData()
 	mHaveAllData = FALSE;
 }
 
+// mWorkMutex is locked, the worker is being deleted.
+// Deleting it drops any received bytes it did not write to the cache yet, and the reply
+// of a request in flight; hand them to the fetcher for the next request of this texture.
+void LLTextureFetchWorker::keepPartialData()
+{
+	if (mFTType != FTT_DEFAULT || mWriteToCacheState == NOT_WRITE || mInLocalCache)
+	{
+		return;
+	}
+	// Workers past SEND_HTTP_REQ finish their decode and cache write before they go
+	if (mState != SEND_HTTP_REQ && mState != WAIT_HTTP_REQ)
+	{
+		return;
+	}
+	S32 data_size = mFormattedImage.notNull() ? mFormattedImage->getDataSize() : 0;
+	bool in_flight = mState == WAIT_HTTP_REQ && !mLoaded;
+	bool uncached = mWriteToCacheState == SHOULD_WRITE && data_size > mCachedSize;
+	if (in_flight || uncached)
+	{
+		mFetcher->keepPartialData(mID, data_size > 0 ? mFormattedImage.get() : NULL, mFileSize,
+								  in_flight ? mHttpSerial : 0, mRequestedOffset, mRequestedSize);
+	}
+}
+
+// mWorkMutex is locked
+// Take over what a deleted worker for this texture left if it has more of the codestream
+// than we do. Returns false while its request is still in flight: asking for the same
+// bytes again would only fetch them twice.
+bool LLTextureFetchWorker::adoptPartialData()
+{
+	if (mFTType != FTT_DEFAULT || mHaveAllData)
+	{
+		return true;
+	}
+	S32 cur_size = mFormattedImage.notNull() ? mFormattedImage->getDataSize() : 0;
+	LLPointer<LLImageFormatted> image;
+	S32 file_size = 0;
+	LLTextureFetch::e_partial_data res = mFetcher->adoptPartialData(mID, cur_size, image, file_size);
+	if (res == LLTextureFetch::PARTIAL_PENDING)
+	{
+		return false;
+	}
+	if (res == LLTextureFetch::PARTIAL_ADOPTED)
+	{
+		if (mFormattedImage.isNull() || mFormattedImage->getCodec() != image->getCodec())
+		{
+			mFormattedImage = LLImageFormatted::createFromType(image->getCodec());
+		}
+		// The kept image may be being written to the cache, copy it
+		S32 data_size = image->getDataSize();
+		U8* buffer = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), data_size);
+		memcpy(buffer, image->getData(), data_size);
+		// NOTE: setData releases current data and owns new data (buffer)
+		mFormattedImage->setData(buffer, data_size);
+		mFileSize = file_size;
+		mHaveAllData = data_size >= file_size;
+		mWriteToCacheState = SHOULD_WRITE;
+		LL_DEBUGS(LOG_TXT) << mID << ": reusing " << data_size - cur_size << " bytes of a deleted request" << LL_ENDL;
+	}
+	return true;
+}
+
 // Called from MAIN thread
 void LLTextureFetchWorker::startWork(S32 param)
 {
@@ -1239,7 +1353,14 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		bool is_sl = gHippoGridManager->getConnectedGrid()->isSecondLife();
 
 // 		if (mHost != LLHost::invalid) use_http = false;
-		if ((is_sl || use_http) && mCanUseHTTP && mUrl.empty())	// get http url.
+		if (mCanUseHTTP && mUrl.empty() && !mFetcher->mTextureServerURL.empty())
+		{
+			// Benchmark run, no region
+			mUrl = mFetcher->mTextureServerURL + "/?texture_id=" + mID.asString();
+			mWriteToCacheState = CAN_WRITE;
+			mPerServicePtr = AIPerService::instance(AIPerService::extract_canonical_servicename(mFetcher->mTextureServerURL));
+		}
+		else if ((is_sl || use_http) && mCanUseHTTP && mUrl.empty())	// get http url.
 		{
 			LLViewerRegion* region = NULL;
 			if (mHost == LLHost::invalid)
@@ -1399,10 +1520,23 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			LL_WARNS(LOG_TXT) << mID << " abort: SEND_HTTP_REQ but !mCanUseHTTP" << LL_ENDL;
 			return true ; //abort
 		}
+		if (!adoptPartialData())
+		{
+			return false; // wait for the request of the deleted worker
+		}
 		S32 cur_size = 0;
 		if (mFormattedImage.notNull())
 		{
 			cur_size = mFormattedImage->getDataSize(); // amount of data we already have
+			if (mWriteToCacheState == SHOULD_WRITE && cur_size > mCachedSize && (mHaveAllData || cur_size >= mDesiredSize))
+			{
+				// What a deleted worker left is enough, decode it (and write it to the cache)
+				mFetcher->removeFromNetworkQueue(this, false);
+				mLoadedDiscard = mDesiredDiscard;
+				setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
+				setState(DECODE_IMAGE);
+				return false;
+			}
 			if (mFormattedImage->getDiscardLevel() == 0)
 			{
 				// Already have all data.
@@ -1470,6 +1604,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		
 		mRequestedTimer.reset();
 		mLoaded = FALSE;
+		mHttpSerial = mFetcher->getNextHTTPSerial();
 		mGetStatus = 0;
 		mGetReason.clear();
 		LL_DEBUGS(LOG_TXT) << "HTTP GET: " << mID << " Offset: " << mRequestedOffset
@@ -1485,7 +1620,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			headers.addHeader("Range", llformat(range_format, mRequestedOffset, range_end));
 		}
 		LLHTTPClient::request(mUrl, LLHTTPClient::HTTP_GET, NULL,
-			new HTTPGetResponder( mFTType, mFetcher, mID, LLTimer::getTotalTime(), mRequestedSize, mRequestedOffset),
+			new HTTPGetResponder( mFTType, mFetcher, mID, mHttpSerial, LLTimer::getTotalTime(), mRequestedSize, mRequestedOffset),
 			headers, approved/*,*/ DEBUG_CURLIO_PARAM(debug_off), keep_alive, no_does_authentication, allow_compressed_reply, NULL, 0, NULL);
 
 		mFetcher->addToHTTPQueue(mID);
@@ -1685,10 +1820,17 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				}
 			}
 
+			// A discard level upgrade that came in while this request was in flight is sent on
+			// right away for the bytes still missing, instead of after decoding and caching
+			// what we have and reading it back from the cache. Not for the first bytes of a
+			// texture, those are shown as soon as they can be.
+			bool coalesce = !mHaveAllData && cur_size > 0 && mFTType == FTT_DEFAULT && mWriteToCacheState != NOT_WRITE
+							&& mDesiredDiscard < mRequestedDiscard && mDesiredSize > (S32)mHttpReplyOffset + mRequestedSize;
+
 			// Clear the url since we're done with the fetch
 			// Note: mUrl is used to check is fetching is required so failure to clear it will force an http fetch
 			// next time the texture is requested, even if the data have already been fetched.
-			if(mWriteToCacheState != NOT_WRITE && mFTType != FTT_SERVER_BAKE)
+			if(mWriteToCacheState != NOT_WRITE && mFTType != FTT_SERVER_BAKE && !coalesce)
 			{
 				// Why do we want to keep url if NOT_WRITE - is this a proxy for map tiles?
 				mUrl.clear();
@@ -1768,12 +1910,24 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				LL_WARNS(LOG_TXT) << mID << " mLoadedDiscard is " << mLoadedDiscard
 									<< ", should be >=0" << LL_ENDL;
 			}
-			setState(DECODE_IMAGE);
 			if(mWriteToCacheState != NOT_WRITE)
 			{
 				mWriteToCacheState = SHOULD_WRITE ;
 			}
 			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
+			if (coalesce && mDesiredSize > total_size)
+			{
+				LL_DEBUGS(LOG_TXT) << mID << ": upgraded to discard " << mDesiredDiscard << " in flight, requesting "
+								   << mDesiredSize - total_size << " more bytes" << LL_ENDL;
+				mFetcher->addCoalescedHTTPRequest();
+				setState(SEND_HTTP_REQ);
+				return false;
+			}
+			if (coalesce)
+			{
+				mUrl.clear();
+			}
+			setState(DECODE_IMAGE);
 			return false;
 		}
 		else
@@ -1832,8 +1986,15 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		setState(DECODE_IMAGE_UPDATE);
 		LL_DEBUGS(LOG_TXT) << mID << ": Decoding. Bytes: " << mFormattedImage->getDataSize() << " Discard: " << discard
 				<< " All Data: " << mHaveAllData << LL_ENDL;
+		if (mFormattedImage->getCodec() == IMG_CODEC_J2C)
+		{
+			// The next decode of this texture will most likely have more data, let it pick up from this one
+			((LLImageJ2C*)mFormattedImage.get())->setIncrementalDecode(true);
+		}
+		bool compress = LLImageGL::sCompressTexturesOnDecode && mFTType == FTT_DEFAULT && !mNeedsAux;
+		bool stream = LLTextureUploadStream::isEnabled() && mFTType == FTT_DEFAULT && !mNeedsAux;
 		mDecodeHandle = mFetcher->mImageDecodeThread->decodeImage(mFormattedImage, image_priority, discard, mNeedsAux,
-																  new DecodeResponder(mFetcher, mID, this));
+																  new DecodeResponder(mFetcher, mID, this, compress, stream));
 		// fall though
 	}
 	
@@ -1915,6 +2076,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 	{
 		if (writeToCacheComplete())
 		{
+			mCachedSize = mFormattedImage.notNull() ? mFormattedImage->getDataSize() : 0;
 			setState(DONE);
 			// fall through
 		}
@@ -1958,7 +2120,7 @@ void LLTextureFetchWorker::endWork(S32 param, bool aborted)
 {
 	if (mDecodeHandle != 0)
 	{
-		mFetcher->mImageDecodeThread->abortRequest(mDecodeHandle, false);
+		mFetcher->mImageDecodeThread->cancelDecode(mDecodeHandle);
 		mDecodeHandle = 0;
 	}
 	mFormattedImage = NULL;
@@ -2342,6 +2504,12 @@ LLTextureFetch::LLTextureFetch(LLTextureCache* cache, LLImageDecodeThread* image
 	  mTextureCache(cache),
 	  mImageDecodeThread(imagedecodethread),
 	  mTotalHTTPRequests(0),
+	  mTotalHTTPBytes(0),
+	  mReusedHTTPBytes(0),
+	  mCoalescedHTTPRequests(0),
+	  mHTTPSerial(0),
+	  mPartialDataBytes(0),
+	  mPartialDataAge(0),
 	  mQAMode(qa_mode),
 	  mTotalCacheReadCount(0U),
 	  mTotalCacheWriteCount(0U)
@@ -2515,6 +2683,7 @@ void LLTextureFetch::removeFromHTTPQueue(const LLUUID& id, S32 received_size)
 {
 	LLMutexLock lock(&mNetworkQueueMutex);
 	mHTTPTextureQueue.erase(id);
+	mTotalHTTPBytes += received_size;
 }
 
 void LLTextureFetch::deleteRequest(const LLUUID& id, bool cancel)
@@ -2543,6 +2712,9 @@ void LLTextureFetch::removeRequest(LLTextureFetchWorker* worker, bool cancel, bo
 	removeFromNetworkQueue(worker, cancel);
 	llassert_always(!(worker->getFlags(LLWorkerClass::WCF_DELETE_REQUESTED))) ;
 
+	worker->lockWorkMutex();
+	worker->keepPartialData();
+	worker->unlockWorkMutex();
 	worker->scheduleDelete();	
 }
 
@@ -2592,6 +2764,300 @@ U32 LLTextureFetch::getTotalNumHTTPRequests()
 	return size ;
 }
 
+// Threads:  T*
+U64 LLTextureFetch::getTotalHTTPBytes()
+{
+	LLMutexLock lock(&mNetworkQueueMutex);
+	return mTotalHTTPBytes;
+}
+
+// Threads:  T*
+U64 LLTextureFetch::getReusedHTTPBytes()
+{
+	LLMutexLock lock(&mNetworkQueueMutex);
+	return mReusedHTTPBytes;
+}
+
+// Threads:  T*
+U32 LLTextureFetch::getCoalescedHTTPRequests()
+{
+	LLMutexLock lock(&mNetworkQueueMutex);
+	return mCoalescedHTTPRequests;
+}
+
+// Threads:  Ttf
+void LLTextureFetch::addCoalescedHTTPRequest()
+{
+	LLMutexLock lock(&mNetworkQueueMutex);
+	++mCoalescedHTTPRequests;
+}
+
+// Threads:  Ttf
+U32 LLTextureFetch::getNextHTTPSerial()
+{
+	LLMutexLock lock(&mNetworkQueueMutex);
+	if (++mHTTPSerial == 0)
+	{
+		++mHTTPSerial; // 0 is no request
+	}
+	return mHTTPSerial;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// Partial data
+
+// Keeps a kept codestream alive until the cache is done writing it
+class PartialDataWriteResponder : public LLTextureCache::WriteResponder
+{
+public:
+	PartialDataWriteResponder(LLImageFormatted* image)
+		: mImage(image)
+	{
+	}
+	virtual void completed(bool success)
+	{
+	}
+private:
+	LLPointer<LLImageFormatted> mImage;
+};
+
+// How long the next request for a texture waits for the reply to a deleted one
+const F32 PARTIAL_DATA_PENDING_TIMEOUT = 15.f;
+
+// MAIN THREAD, from removeRequest()
+void LLTextureFetch::keepPartialData(const LLUUID& id, LLImageFormatted* image, S32 file_size,
+									 U32 pending_serial, S32 pending_offset, S32 pending_size)
+{
+	static LLCachedControl<U32> max_size(gSavedSettings, "TextureFetchPartialDataSize");
+	if (!max_size)
+	{
+		return;
+	}
+	LLMutexLock lock(&mPartialDataMutex);
+	PartialData& kept = mPartialData[id];
+	S32 kept_size = kept.mImage.notNull() ? kept.mImage->getDataSize() : 0;
+	if (image && image->getDataSize() > kept_size)
+	{
+		mPartialDataBytes += image->getDataSize() - kept_size;
+		kept.mImage = image;
+		kept.mFileSize = file_size;
+		kept.mNeedsWrite = true;
+	}
+	if (pending_serial)
+	{
+		kept.mPendingSerial = pending_serial;
+		kept.mPendingOffset = pending_offset;
+		kept.mPendingSize = pending_size;
+		kept.mPendingTimer.reset();
+	}
+	kept.mAge = ++mPartialDataAge;
+	trimPartialData((U32)max_size << 20);
+}
+
+// mPartialDataMutex is locked
+void LLTextureFetch::trimPartialData(U32 max_bytes)
+{
+	while (mPartialDataBytes > max_bytes)
+	{
+		// Drop the oldest codestream that no request is still adding to
+		partial_map_t::iterator oldest = mPartialData.end();
+		for (partial_map_t::iterator iter = mPartialData.begin(); iter != mPartialData.end(); ++iter)
+		{
+			if (!iter->second.mPendingSerial && (oldest == mPartialData.end() || iter->second.mAge < oldest->second.mAge))
+			{
+				oldest = iter;
+			}
+		}
+		if (oldest == mPartialData.end())
+		{
+			break;
+		}
+		mPartialDataBytes -= oldest->second.mImage.notNull() ? oldest->second.mImage->getDataSize() : 0;
+		mPartialData.erase(oldest);
+	}
+}
+
+// Threads:  T*
+bool LLTextureFetch::isPartialDataPending(const LLUUID& id, U32 serial)
+{
+	LLMutexLock lock(&mPartialDataMutex);
+	partial_map_t::iterator iter = mPartialData.find(id);
+	return serial && iter != mPartialData.end() && iter->second.mPendingSerial == serial;
+}
+
+// Threads:  T*
+// The reply to the request of a deleted worker, appended to what that worker had like
+// LLTextureFetchWorker::callbackHttpGet() and the WAIT_HTTP_REQ state would have
+void LLTextureFetch::receivePartialData(const LLUUID& id, U32 serial, U32 offset, U32 length, bool partial, bool success,
+										const std::vector<U8>& data)
+{
+	LLMutexLock lock(&mPartialDataMutex);
+	partial_map_t::iterator iter = mPartialData.find(id);
+	if (iter == mPartialData.end() || iter->second.mPendingSerial != serial)
+	{
+		return;
+	}
+	PartialData& kept = iter->second;
+	kept.mPendingSerial = 0;
+	S32 cur_size = kept.mImage.notNull() ? kept.mImage->getDataSize() : 0;
+	S32 data_size = (S32)data.size();
+	if (success && data_size > 0)
+	{
+		S32 reply_offset = (offset || length) ? (S32)offset : kept.mPendingOffset;
+		if (!partial || data_size > kept.mPendingSize)
+		{
+			// The entire asset
+			reply_offset = 0;
+		}
+		S32 total_size = reply_offset + data_size;
+		if (reply_offset <= cur_size && total_size > cur_size)
+		{
+			U8* buffer = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), total_size);
+			if (reply_offset > 0)
+			{
+				memcpy(buffer, kept.mImage->getData(), reply_offset);
+			}
+			memcpy(buffer + reply_offset, &data[0], data_size);
+			// The kept image is not modified, the cache may be writing it
+			LLPointer<LLImageFormatted> image;
+			if (kept.mImage.notNull())
+			{
+				image = LLImageFormatted::createFromType(kept.mImage->getCodec());
+			}
+			if (image.isNull())
+			{
+				image = new LLImageJ2C;
+			}
+			image->setData(buffer, total_size);
+			mPartialDataBytes += total_size - cur_size;
+			kept.mImage = image;
+			bool have_all = !partial || data_size != kept.mPendingSize;
+			kept.mFileSize = have_all ? total_size : total_size + 1;
+			kept.mNeedsWrite = true;
+			LL_DEBUGS(LOG_TXT) << id << ": kept " << total_size - cur_size << " bytes from a deleted request" << LL_ENDL;
+		}
+		else if (reply_offset > cur_size)
+		{
+			LL_WARNS(LOG_TXT) << "Partial HTTP response produces break in image data for texture " << id << LL_ENDL;
+		}
+	}
+	if (kept.mImage.isNull())
+	{
+		mPartialData.erase(iter);
+	}
+}
+
+// Threads:  Ttf
+LLTextureFetch::e_partial_data LLTextureFetch::adoptPartialData(const LLUUID& id, S32 cur_size,
+																LLPointer<LLImageFormatted>& image, S32& file_size)
+{
+	S32 reused = 0;
+	{
+		LLMutexLock lock(&mPartialDataMutex);
+		partial_map_t::iterator iter = mPartialData.find(id);
+		if (iter == mPartialData.end())
+		{
+			return PARTIAL_NONE;
+		}
+		PartialData& kept = iter->second;
+		if (kept.mPendingSerial)
+		{
+			if (kept.mPendingTimer.getElapsedTimeF32() < PARTIAL_DATA_PENDING_TIMEOUT)
+			{
+				return PARTIAL_PENDING;
+			}
+			// Stop waiting, its reply will be dropped
+			kept.mPendingSerial = 0;
+		}
+		S32 kept_size = kept.mImage.notNull() ? kept.mImage->getDataSize() : 0;
+		if (kept_size > cur_size)
+		{
+			image = kept.mImage;
+			file_size = kept.mFileSize;
+			reused = kept_size - cur_size;
+		}
+		mPartialDataBytes -= kept_size;
+		mPartialData.erase(iter);
+	}
+	if (!reused)
+	{
+		return PARTIAL_NONE;
+	}
+	LLMutexLock lock(&mNetworkQueueMutex);
+	mReusedHTTPBytes += reused;
+	return PARTIAL_ADOPTED;
+}
+
+// MAIN THREAD
+// Write the kept codestreams to the cache, unless a worker for the same texture
+// is going to adopt them and write them itself
+void LLTextureFetch::updatePartialData()
+{
+	if (!mTextureCache)
+	{
+		return;
+	}
+	for (U32 i = 0; i < mPartialDataWrites.size(); )
+	{
+		if (mTextureCache->writeComplete(mPartialDataWrites[i]))
+		{
+			mPartialDataWrites[i] = mPartialDataWrites.back();
+			mPartialDataWrites.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	std::vector<std::pair<LLUUID, PartialData> > writes;
+	{
+		LLMutexLock lock(&mPartialDataMutex);
+		for (partial_map_t::iterator iter = mPartialData.begin(); iter != mPartialData.end(); ++iter)
+		{
+			PartialData& kept = iter->second;
+			if (kept.mNeedsWrite && !kept.mPendingSerial && kept.mImage.notNull())
+			{
+				kept.mNeedsWrite = false;
+				writes.push_back(*iter);
+			}
+		}
+	}
+	std::vector<U32> skipped;
+	for (U32 i = 0; i < writes.size(); ++i)
+	{
+		const LLUUID& id = writes[i].first;
+		LLImageFormatted* image = writes[i].second.mImage;
+		if (getWorker(id))
+		{
+			skipped.push_back(i);
+			continue;
+		}
+		handle_t handle = mTextureCache->writeToCache(id, LLWorkerThread::PRIORITY_LOW,
+													  image->getData(), image->getDataSize(),
+													  writes[i].second.mFileSize, new PartialDataWriteResponder(image));
+		if (handle != LLTextureCache::nullHandle())
+		{
+			mPartialDataWrites.push_back(handle);
+		}
+	}
+
+	if (!skipped.empty())
+	{
+		// The worker may still finish without adopting them (served from the cache,
+		// or deleted); adopting them takes them out of mPartialData.
+		LLMutexLock lock(&mPartialDataMutex);
+		for (U32 i = 0; i < skipped.size(); ++i)
+		{
+			partial_map_t::iterator iter = mPartialData.find(writes[skipped[i]].first);
+			if (iter != mPartialData.end() && iter->second.mImage == writes[skipped[i]].second.mImage)
+			{
+				iter->second.mNeedsWrite = true;
+			}
+		}
+	}
+}
+
 // call lockQueue() first!
 LLTextureFetchWorker* LLTextureFetch::getWorkerAfterLock(const LLUUID& id)
 {
@@ -2757,6 +3223,8 @@ S32 LLTextureFetch::update(F32 max_time_ms)
 		commonUpdate();
 	}
 
+	updatePartialData();
+
 	return res;
 }
 
@@ -2766,6 +3234,7 @@ void LLTextureFetch::shutDownTextureCacheThread()
 	if(mTextureCache)
 	{
 		llassert_always(mTextureCache->isQuitting() || mTextureCache->isStopped()) ;
+		mPartialDataWrites.clear();
 		mTextureCache = NULL ;
 	}
 }
@@ -2791,6 +3260,9 @@ void LLTextureFetch::endThread()
 	LL_INFOS(LOG_TXT) << "CacheReads:  " << mTotalCacheReadCount
 					  << ", CacheWrites:  " << mTotalCacheWriteCount
 					  << ", TotalHTTPReq:  " << getTotalNumHTTPRequests()
+					  << ", TotalHTTPBytes:  " << getTotalHTTPBytes()
+					  << ", ReusedHTTPBytes:  " << getReusedHTTPBytes()
+					  << ", CoalescedHTTPReq:  " << getCoalescedHTTPRequests()
 					  << LL_ENDL;
 }
 
@@ -3282,7 +3754,7 @@ S32 LLTextureFetch::getFetchState(const LLUUID& id, F32& data_progress_p, F32& r
 void LLTextureFetch::dump()
 {
 	LL_INFOS(LOG_TXT) << "LLTextureFetch REQUESTS:" << LL_ENDL;
-	for (request_queue_t::iterator iter = mRequestQueue.begin();
+	for (request_queue_t::const_iterator iter = mRequestQueue.begin();
 		 iter != mRequestQueue.end(); ++iter)
 	{
 		LLQueuedThread::QueuedRequest* qreq = *iter;
@@ -37,6 +37,7 @@
 #include <map>
 
 #include "lldir.h"
+#include "llframetimer.h"
 #include "llimage.h"
 #include "lluuid.h"
 #include "llworkerthread.h"
@@ -93,6 +94,20 @@ public:
 
 	// Threads:  T*
 	U32 getTotalNumHTTPRequests();
+
+	// Threads:  T*
+	// Bytes of texture data received over HTTP, and bytes of it used again from a request
+	// that went away before its data made it to the cache instead of being fetched again
+	U64 getTotalHTTPBytes();
+	U64 getReusedHTTPBytes();
+	// Threads:  T*
+	// Discard level upgrades sent on with the request in flight instead of after decoding it
+	U32 getCoalescedHTTPRequests();
+
+	// Threads:  T0
+	// Fetch the textures that have no URL of their own from url instead of the region,
+	// see LLTextureFetchBench. Set it before the first request.
+	void setTextureServerURL(const std::string& url) { mTextureServerURL = url; }
 	
 	// Public for access by callbacks
     S32 getPending();
@@ -125,6 +140,24 @@ protected:
 	void removeFromHTTPQueue(const LLUUID& id, S32 received_size = 0);
 	void removeRequest(LLTextureFetchWorker* worker, bool cancel, bool bNeedsLock = true);
 
+	// Codestream bytes of requests that were deleted before writing them to the cache.
+	// They are written to the cache from update() and handed to the next request for
+	// the same texture. A request still in flight is kept too, its reply is appended
+	// when it comes in (see HTTPGetResponder::completedRaw).
+	enum e_partial_data
+	{
+		PARTIAL_NONE,		// nothing more than the caller has
+		PARTIAL_PENDING,	// a request for this texture is still in flight, wait for it
+		PARTIAL_ADOPTED		// image and file_size were filled
+	};
+	void keepPartialData(const LLUUID& id, LLImageFormatted* image, S32 file_size, U32 pending_serial, S32 pending_offset, S32 pending_size);
+	e_partial_data adoptPartialData(const LLUUID& id, S32 cur_size, LLPointer<LLImageFormatted>& image, S32& file_size);
+	bool isPartialDataPending(const LLUUID& id, U32 serial);
+	void receivePartialData(const LLUUID& id, U32 serial, U32 offset, U32 length, bool partial, bool success,
+							const std::vector<U8>& data);
+	U32 getNextHTTPSerial();
+	void addCoalescedHTTPRequest();
+
 	// Overrides from the LLThread tree
 	bool runCondition();
 
@@ -134,6 +167,8 @@ private:
 	/*virtual*/ void endThread(void);
 	/*virtual*/ void threadedUpdate(void);
 	void commonUpdate();
+	void updatePartialData();
+	void trimPartialData(U32 max_bytes);
 
 	void cmdEnqueue(TFRequest *);
 	TFRequest * cmdDequeue();
@@ -172,6 +207,34 @@ private:
 
 	//debug use
 	U32 mTotalHTTPRequests ;
+	U64 mTotalHTTPBytes;
+	U64 mReusedHTTPBytes;
+	U32 mCoalescedHTTPRequests;
+	U32 mHTTPSerial;
+
+	struct PartialData
+	{
+		PartialData()
+		:	mFileSize(0), mPendingSerial(0), mPendingOffset(0), mPendingSize(0), mAge(0), mNeedsWrite(false)
+		{}
+
+		LLPointer<LLImageFormatted> mImage;	// never modified once kept, the cache may be writing it
+		S32 mFileSize;						// data size + 1 while the size of the file is unknown
+		U32 mPendingSerial;					// request in flight, 0 if none
+		S32 mPendingOffset;
+		S32 mPendingSize;
+		LLFrameTimer mPendingTimer;
+		U32 mAge;
+		bool mNeedsWrite;
+	};
+	typedef std::map<LLUUID, PartialData> partial_map_t;
+	LLMutex mPartialDataMutex;	// to protect mPartialData, mPartialDataBytes and mPartialDataAge
+	partial_map_t mPartialData;
+	U32 mPartialDataBytes;
+	U32 mPartialDataAge;
+	std::vector<handle_t> mPartialDataWrites;	// main thread only
+
+	std::string mTextureServerURL;
 
 	// Out-of-band cross-thread command queue.  This command queue
 	// is logically tied to LLQueuedThread's list of
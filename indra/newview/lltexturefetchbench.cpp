@@ -0,0 +1,744 @@
+/**
+ * @file lltexturefetchbench.cpp
+ * @brief Texture pipeline benchmark against a local stand-in for the texture server.
+ *
+ * $LicenseInfo:firstyear=2012&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturefetchbench.h"
+
+#include "llappviewer.h"
+#include "llcallbacklist.h"
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llmemory.h"
+#include "llsdserialize.h"
+#include "lltexturefetch.h"
+#include "llviewercontrol.h"
+#include "llviewertexture.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const std::string SERVER_REQUEST_PREFIX = "/?texture_id=";
+
+// Largest request head we read before giving up on a connection
+static const S32 MAX_REQUEST_SIZE = 16384;
+// Bodies are sent in chunks of this size through the shared link
+static const S32 SEND_CHUNK_SIZE = 16384;
+// Socket timeout of the connection threads, so that they notice stopServing()
+static const S32 SOCKET_TIMEOUT_USEC = 100000;
+
+// Simple, seedable generator so that runs with the same seed make the same choices
+static F32 next_random(U32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (F32)(state >> 8) / (F32)(1 << 24);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LLTextureServerStandIn
+
+class LLTextureServerStandIn::Connection : public LLThread
+{
+public:
+	Connection(LLTextureServerStandIn* server, LLSocket::ptr_t socket)
+	:	LLThread("texture server connection"),
+		mServer(server),
+		mSocket(socket)
+	{
+	}
+
+	apr_socket_t* getSocket() const		{ return mSocket->getSocket(); }
+	void setBlocking(S32 timeout)		{ mSocket->setBlocking(timeout); }
+	void close()						{ mSocket.reset(); }
+
+protected:
+	/*virtual*/ void run()
+	{
+		mServer->serve(this);
+	}
+
+private:
+	LLTextureServerStandIn* mServer;
+	LLSocket::ptr_t mSocket;
+};
+
+LLTextureServerStandIn::LLTextureServerStandIn(U16 port, F32 latency, F32 bandwidth, F32 error_rate, U32 seed)
+:	LLThread("texture server stand-in"),
+	mPort(port),
+	mLatency(llmax(latency, 0.f)),
+	mBandwidth(llmax(bandwidth, 0.f)),
+	mErrorRate(llclamp(error_rate, 0.f, 1.f)),
+	mRandom(seed ? seed : 1),
+	mStopping(false),
+	mLinkFreeAt(0.0),
+	mBytesSent(0),
+	mRequestCount(0),
+	mErrorCount(0)
+{
+}
+
+LLTextureServerStandIn::~LLTextureServerStandIn()
+{
+	stopServing();
+}
+
+S32 LLTextureServerStandIn::loadCorpus(const std::string& directory)
+{
+	std::string name;
+	LLDirIterator iter(directory, "*.j2c");
+	while (iter.next(name))
+	{
+		std::string path = directory + gDirUtilp->getDirDelimiter() + name;
+		llifstream file(path.c_str(), std::ios::in | std::ios::binary);
+		if (!file.is_open())
+		{
+			LL_WARNS("TextureBenchmark") << "Can't read " << path << LL_ENDL;
+			continue;
+		}
+		std::vector<U8> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (data.empty())
+		{
+			continue;
+		}
+
+		std::string stem = gDirUtilp->getBaseFileName(name, true);
+		LLUUID id;
+		if (LLUUID::validate(stem))
+		{
+			id.set(stem);
+		}
+		else
+		{
+			id.generate(name);
+		}
+		if (mFiles.find(id) == mFiles.end())
+		{
+			mTextureIDs.push_back(id);
+		}
+		mFiles[id].swap(data);
+	}
+	// Directory order is not the same everywhere, the stream of requests should be
+	std::sort(mTextureIDs.begin(), mTextureIDs.end());
+	return (S32)mTextureIDs.size();
+}
+
+bool LLTextureServerStandIn::startServing()
+{
+	// Loopback only, the corpus is nobody else's business
+	mListenSocket = LLSocket::create(LLSocket::STREAM_TCP, mPort, "127.0.0.1");
+	if (!mListenSocket)
+	{
+		return false;
+	}
+	mLinkTimer.reset();
+	start();
+	return true;
+}
+
+void LLTextureServerStandIn::stopServing()
+{
+	mStopping = true;
+	shutdown();
+	mListenSocket.reset();
+}
+
+std::string LLTextureServerStandIn::getURL() const
+{
+	return llformat("http://127.0.0.1:%d", (S32)mPort);
+}
+
+U64 LLTextureServerStandIn::getBytesSent()
+{
+	LLMutexLock lock(&mMutex);
+	return mBytesSent;
+}
+
+U32 LLTextureServerStandIn::getRequestCount()
+{
+	LLMutexLock lock(&mMutex);
+	return mRequestCount;
+}
+
+U32 LLTextureServerStandIn::getErrorCount()
+{
+	LLMutexLock lock(&mMutex);
+	return mErrorCount;
+}
+
+F32 LLTextureServerStandIn::random()
+{
+	LLMutexLock lock(&mMutex);
+	return next_random(mRandom);
+}
+
+//virtual
+void LLTextureServerStandIn::run()
+{
+	while (!mStopping && !isQuitting())
+	{
+		apr_status_t status;
+		LLSocket::ptr_t socket = LLSocket::create(status, mListenSocket);
+		if (socket)
+		{
+			mConnections.push_back(new Connection(this, socket));
+			mConnections.back()->start();
+			continue;
+		}
+
+		// Connections the fetcher closed
+		for (U32 i = 0; i < mConnections.size(); )
+		{
+			if (mConnections[i]->isStopped())
+			{
+				delete mConnections[i];
+				mConnections[i] = mConnections.back();
+				mConnections.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+		ms_sleep(2);
+	}
+
+	mStopping = true;
+	for (U32 i = 0; i < mConnections.size(); ++i)
+	{
+		mConnections[i]->shutdown();
+		delete mConnections[i];
+	}
+	mConnections.clear();
+}
+
+// Connection thread: read requests until the fetcher closes the connection
+void LLTextureServerStandIn::serve(Connection* connection)
+{
+	connection->setBlocking(SOCKET_TIMEOUT_USEC);
+
+	std::string pending;
+	char buffer[4096];
+	while (!mStopping)
+	{
+		std::string::size_type end = pending.find("\r\n\r\n");
+		if (end != std::string::npos)
+		{
+			std::string request = pending.substr(0, end);
+			pending.erase(0, end + 4);
+			if (!reply(connection, request))
+			{
+				break;
+			}
+			continue;
+		}
+		if ((S32)pending.size() > MAX_REQUEST_SIZE)
+		{
+			break;
+		}
+
+		apr_size_t len = sizeof(buffer);
+		apr_status_t status = apr_socket_recv(connection->getSocket(), buffer, &len);
+		if (len > 0)
+		{
+			pending.append(buffer, len);
+		}
+		else if (!APR_STATUS_IS_TIMEUP(status) && !APR_STATUS_IS_EAGAIN(status))
+		{
+			break; // closed
+		}
+	}
+	connection->close();
+}
+
+// Connection thread: returns false if the connection should be closed
+bool LLTextureServerStandIn::reply(Connection* connection, const std::string& request)
+{
+	std::string::size_type line_end = request.find("\r\n");
+	std::string request_line = request.substr(0, line_end);
+	std::string headers = line_end == std::string::npos ? std::string() : request.substr(line_end + 2);
+	LLStringUtil::toLower(headers);
+
+	bool keep_alive = headers.find("connection: close") == std::string::npos;
+
+	{
+		LLMutexLock lock(&mMutex);
+		++mRequestCount;
+	}
+	if (mLatency > 0.f)
+	{
+		ms_sleep((U32)(mLatency * 1000.f));
+	}
+
+	std::map<LLUUID, std::vector<U8> >::const_iterator file = mFiles.end();
+	std::string::size_type id_pos = request_line.find(SERVER_REQUEST_PREFIX);
+	if (request_line.compare(0, 4, "GET ") == 0 && id_pos != std::string::npos)
+	{
+		std::string id = request_line.substr(id_pos + SERVER_REQUEST_PREFIX.size(), UUID_STR_LENGTH - 1);
+		if (LLUUID::validate(id))
+		{
+			file = mFiles.find(LLUUID(id));
+		}
+	}
+
+	S32 status = 200;
+	S32 first = 0;
+	S32 last = 0;
+	S32 file_size = 0;
+	if (file == mFiles.end())
+	{
+		status = 404;
+	}
+	else if (random() < mErrorRate)
+	{
+		status = 503;
+		LLMutexLock lock(&mMutex);
+		++mErrorCount;
+	}
+	else
+	{
+		file_size = (S32)file->second.size();
+		last = file_size - 1;
+		std::string::size_type range_pos = headers.find("range: bytes=");
+		if (range_pos != std::string::npos)
+		{
+			const char* range = headers.c_str() + range_pos + 13;
+			char* range_end = NULL;
+			first = (S32)strtol(range, &range_end, 10);
+			if (*range_end == '-' && isdigit((unsigned char)range_end[1]))
+			{
+				last = llmin(last, (S32)strtol(range_end + 1, NULL, 10));
+			}
+			status = first < file_size ? 206 : 416;
+		}
+	}
+
+	std::string head;
+	switch (status)
+	{
+	case 200:
+	case 206:
+		head = llformat("HTTP/1.1 %d %s\r\nContent-Type: image/x-j2c\r\nContent-Length: %d\r\n",
+						status, status == 200 ? "OK" : "Partial Content", last - first + 1);
+		if (status == 206)
+		{
+			head += llformat("Content-Range: bytes %d-%d/%d\r\n", first, last, file_size);
+		}
+		break;
+	case 416:
+		head = llformat("HTTP/1.1 416 Requested Range Not Satisfiable\r\nContent-Length: 0\r\nContent-Range: bytes */%d\r\n", file_size);
+		break;
+	case 503:
+		head = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n";
+		break;
+	default:
+		head = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n";
+		break;
+	}
+	if (!keep_alive)
+	{
+		head += "Connection: close\r\n";
+	}
+	head += "\r\n";
+
+	if (!send(connection, head.data(), (S32)head.size(), false))
+	{
+		return false;
+	}
+	if (status == 200 || status == 206)
+	{
+		if (!send(connection, (const char*)&file->second[first], last - first + 1, true))
+		{
+			return false;
+		}
+	}
+	return keep_alive;
+}
+
+// Connection thread. Bodies go through the link: a chunk is sent once the link
+// would be done with everything that was given to it before, plus the chunk.
+bool LLTextureServerStandIn::send(Connection* connection, const char* data, S32 size, bool throttle)
+{
+	while (size > 0 && !mStopping)
+	{
+		S32 chunk = throttle ? llmin(size, SEND_CHUNK_SIZE) : size;
+		if (throttle && mBandwidth > 0.f)
+		{
+			F64 wait;
+			{
+				LLMutexLock lock(&mMutex);
+				F64 now = mLinkTimer.getElapsedTimeF64();
+				mLinkFreeAt = llmax(mLinkFreeAt, now) + chunk / mBandwidth;
+				wait = mLinkFreeAt - now;
+			}
+			if (wait >= 0.001)
+			{
+				ms_sleep((U32)(wait * 1000.0));
+			}
+		}
+
+		apr_size_t len = chunk;
+		apr_status_t status = apr_socket_send(connection->getSocket(), data, &len);
+		if (status != APR_SUCCESS && !APR_STATUS_IS_TIMEUP(status) && !APR_STATUS_IS_EAGAIN(status))
+		{
+			return false;
+		}
+		if (throttle)
+		{
+			LLMutexLock lock(&mMutex);
+			mBytesSent += len;
+		}
+		data += len;
+		size -= (S32)len;
+	}
+	return size == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LLTextureFetchBench
+
+LLTextureFetchBench* LLTextureFetchBench::sInstance = NULL;
+bool LLTextureFetchBench::sStarted = false;
+
+// Pixel areas of the textures coming into view, and the most they grow to
+static const F32 MIN_PIXEL_AREA_LOG2 = 8.f;		// 16x16
+static const F32 MAX_PIXEL_AREA_LOG2 = 18.f;	// 512x512
+static const F32 MAX_PIXEL_AREA = 1024.f * 1024.f;
+// How long textures stay in view, in seconds
+static const F32 MIN_IN_VIEW = 2.f;
+static const F32 MAX_IN_VIEW = 20.f;
+
+//static
+void LLTextureFetchBench::startIfRequested()
+{
+	if (sStarted)
+	{
+		return;
+	}
+	sStarted = true;
+	if (gSavedSettings.getString("TextureBenchmarkCorpus").empty())
+	{
+		return;
+	}
+	sInstance = new LLTextureFetchBench;
+	if (!sInstance->start())
+	{
+		delete sInstance;
+		sInstance = NULL;
+	}
+}
+
+//static
+void LLTextureFetchBench::cleanupClass()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+LLTextureFetchBench::LLTextureFetchBench()
+:	mServer(NULL),
+	mDuration(0.0),
+	mRate(0.f),
+	mNextSample(0.0),
+	mRandom(1),
+	mPeakRawMemory(0),
+	mPeakFormattedMemory(0),
+	mPeakGLMemory(0),
+	mStartRSS(LLMemory::getCurrentRSS()),
+	mPeakRSS(mStartRSS)
+{
+}
+
+LLTextureFetchBench::~LLTextureFetchBench()
+{
+	gIdleCallbacks.deleteFunction(onIdle, this);
+	mActive.clear();
+	mFinished.clear();
+	delete mServer;
+}
+
+bool LLTextureFetchBench::start()
+{
+	std::string corpus = gSavedSettings.getString("TextureBenchmarkCorpus");
+	U32 seed = gSavedSettings.getU32("TextureBenchmarkSeed");
+	mRandom = seed ? seed : 1;
+	mDuration = llmax(gSavedSettings.getF32("TextureBenchmarkDuration"), 1.f);
+	mRate = llmax(gSavedSettings.getF32("TextureBenchmarkRate"), 0.1f);
+
+	mServer = new LLTextureServerStandIn((U16)gSavedSettings.getU32("TextureBenchmarkPort"),
+										 gSavedSettings.getF32("TextureBenchmarkLatency") * 0.001f,
+										 gSavedSettings.getF32("TextureBenchmarkBandwidth") * 1024.f,
+										 gSavedSettings.getF32("TextureBenchmarkErrorRate"),
+										 seed);
+	S32 count = mServer->loadCorpus(corpus);
+	if (!count)
+	{
+		LL_WARNS("TextureBenchmark") << "No .j2c files in " << corpus << ", not running the texture benchmark" << LL_ENDL;
+		return false;
+	}
+	if (!mServer->startServing())
+	{
+		LL_WARNS("TextureBenchmark") << "Can't listen on port " << gSavedSettings.getU32("TextureBenchmarkPort")
+									 << ", not running the texture benchmark" << LL_ENDL;
+		return false;
+	}
+	LLAppViewer::getTextureFetch()->setTextureServerURL(mServer->getURL());
+	LL_INFOS("TextureBenchmark") << "Serving " << count << " textures from " << corpus << " on " << mServer->getURL()
+								 << " for " << mDuration << " seconds" << LL_ENDL;
+
+	mTimer.reset();
+	gIdleCallbacks.addFunction(onIdle, this);
+	return true;
+}
+
+F32 LLTextureFetchBench::random()
+{
+	return next_random(mRandom);
+}
+
+//static
+void LLTextureFetchBench::onIdle(void* userdata)
+{
+	((LLTextureFetchBench*)userdata)->idle();
+}
+
+void LLTextureFetchBench::addSample(F64 now)
+{
+	const std::vector<LLUUID>& ids = mServer->getTextureIDs();
+	// Skewed towards the start of the corpus: some textures are seen much more
+	// often than others, like the ground and walls of a region
+	F32 pick = random();
+	U32 index = llmin((U32)(pick * pick * ids.size()), (U32)ids.size() - 1);
+
+	Sample sample;
+	sample.mTexture = LLViewerTextureManager::getFetchedTexture(ids[index], FTT_DEFAULT, TRUE, LLGLTexture::BOOST_NONE,
+																 LLViewerTexture::LOD_TEXTURE);
+	sample.mStart = now;
+	sample.mEnd = now + MIN_IN_VIEW + random() * (MAX_IN_VIEW - MIN_IN_VIEW);
+	sample.mPixelArea = powf(2.f, MIN_PIXEL_AREA_LOG2 + random() * (MAX_PIXEL_AREA_LOG2 - MIN_PIXEL_AREA_LOG2));
+	// Up to half again as large every second
+	sample.mGrowth = 1.f + random() * 0.5f;
+	sample.mBestDesired = MAX_DISCARD_LEVEL + 1;
+	for (S32 i = 0; i <= MAX_DISCARD_LEVEL; ++i)
+	{
+		sample.mReached[i] = -1.0;
+	}
+	sample.mDone = -1.0;
+	mActive.push_back(sample);
+}
+
+void LLTextureFetchBench::sampleMemory()
+{
+	mPeakRawMemory = llmax(mPeakRawMemory, *AIAccess<S64>(LLImageRaw::sGlobalRawMemory));
+	mPeakFormattedMemory = llmax(mPeakFormattedMemory, LLImageFormatted::sGlobalFormattedMemory);
+	mPeakGLMemory = llmax(mPeakGLMemory, (S64)LLViewerTexture::sTotalTextureMemory.value());
+	mPeakRSS = llmax(mPeakRSS, LLMemory::getCurrentRSS());
+}
+
+void LLTextureFetchBench::idle()
+{
+	F64 now = mTimer.getElapsedTimeF64();
+
+	// Textures coming into view, with exponential gaps between them
+	while (mNextSample <= now && mNextSample < mDuration)
+	{
+		addSample(mNextSample);
+		mNextSample -= log(1.0 - llmin(random(), 0.999f)) / mRate;
+	}
+
+	for (U32 i = 0; i < mActive.size(); )
+	{
+		Sample& sample = mActive[i];
+		if (now >= sample.mEnd || now >= mDuration)
+		{
+			// Out of view, the texture list can let go of it
+			sample.mTexture = NULL;
+			mFinished.push_back(sample);
+			mActive[i] = mActive.back();
+			mActive.pop_back();
+			continue;
+		}
+
+		F64 age = now - sample.mStart;
+		LLViewerFetchedTexture* texture = sample.mTexture;
+		texture->addTextureStats(llmin(sample.mPixelArea * powf(sample.mGrowth, (F32)age), MAX_PIXEL_AREA));
+
+		S32 desired = texture->getDesiredDiscardLevel();
+		if (desired >= 0)
+		{
+			sample.mBestDesired = llmin(sample.mBestDesired, desired);
+		}
+		S32 discard = texture->hasGLTexture() ? texture->getDiscardLevel() : -1;
+		if (discard >= 0)
+		{
+			for (S32 level = discard; level <= MAX_DISCARD_LEVEL; ++level)
+			{
+				if (sample.mReached[level] < 0.0)
+				{
+					sample.mReached[level] = age;
+				}
+			}
+			if (sample.mDone < 0.0 && desired >= 0 && discard <= desired)
+			{
+				sample.mDone = age;
+			}
+		}
+		++i;
+	}
+
+	sampleMemory();
+
+	if (now >= mDuration)
+	{
+		finish();
+	}
+}
+
+static LLSD percentiles(std::vector<F64>& values, U32 wanted)
+{
+	LLSD result;
+	result["wanted"] = (S32)wanted;
+	result["reached"] = (S32)values.size();
+	if (!values.empty())
+	{
+		std::sort(values.begin(), values.end());
+		F64 sum = 0.0;
+		for (U32 i = 0; i < values.size(); ++i)
+		{
+			sum += values[i];
+		}
+		result["mean"] = sum / values.size();
+		result["p50"] = values[values.size() / 2];
+		result["p90"] = values[llmin((U32)(values.size() * 0.9), (U32)values.size() - 1)];
+		result["p99"] = values[llmin((U32)(values.size() * 0.99), (U32)values.size() - 1)];
+		result["max"] = values.back();
+	}
+	return result;
+}
+
+void LLTextureFetchBench::finish()
+{
+	gIdleCallbacks.deleteFunction(onIdle, this);
+	F64 elapsed = mTimer.getElapsedTimeF64();
+
+	LLSD results;
+	LLSD& settings = results["settings"];
+	settings["corpus"] = gSavedSettings.getString("TextureBenchmarkCorpus");
+	settings["textures"] = (S32)mServer->getTextureIDs().size();
+	settings["latency_ms"] = gSavedSettings.getF32("TextureBenchmarkLatency");
+	settings["bandwidth_kbps"] = gSavedSettings.getF32("TextureBenchmarkBandwidth");
+	settings["error_rate"] = gSavedSettings.getF32("TextureBenchmarkErrorRate");
+	settings["duration"] = mDuration;
+	settings["rate"] = mRate;
+	settings["seed"] = (S32)gSavedSettings.getU32("TextureBenchmarkSeed");
+
+	U32 done = 0;
+	std::vector<F64> reached[MAX_DISCARD_LEVEL + 1];
+	U32 wanted[MAX_DISCARD_LEVEL + 1] = { 0 };
+	for (U32 i = 0; i < mFinished.size(); ++i)
+	{
+		const Sample& sample = mFinished[i];
+		if (sample.mDone >= 0.0)
+		{
+			++done;
+		}
+		for (S32 level = llmax(sample.mBestDesired, 0); level <= MAX_DISCARD_LEVEL; ++level)
+		{
+			++wanted[level];
+			if (sample.mReached[level] >= 0.0)
+			{
+				reached[level].push_back(sample.mReached[level]);
+			}
+		}
+	}
+
+	U64 bytes_sent = mServer->getBytesSent();
+	LLSD& throughput = results["throughput"];
+	throughput["seconds"] = elapsed;
+	throughput["bytes_served"] = (LLSD::Real)bytes_sent;
+	throughput["mb_per_second"] = bytes_sent / (1024.0 * 1024.0) / elapsed;
+	throughput["requests"] = (S32)mServer->getRequestCount();
+	throughput["busy_replies"] = (S32)mServer->getErrorCount();
+	throughput["textures_in_view"] = (S32)mFinished.size();
+	throughput["textures_done"] = (S32)done;
+	throughput["textures_done_per_second"] = done / elapsed;
+
+	LLSD& times = results["time_to_discard"];
+	for (S32 level = MAX_DISCARD_LEVEL; level >= 0; --level)
+	{
+		times[llformat("%d", level)] = percentiles(reached[level], wanted[level]);
+	}
+
+	LLSD& memory = results["memory_mb"];
+	memory["peak_raw"] = mPeakRawMemory / (1024.0 * 1024.0);
+	memory["peak_formatted"] = mPeakFormattedMemory / (1024.0 * 1024.0);
+	memory["peak_gl"] = mPeakGLMemory / (1024.0 * 1024.0);
+	memory["rss_growth"] = (mPeakRSS - mStartRSS) / (1024.0 * 1024.0);
+
+	LLTextureFetch* fetcher = LLAppViewer::getTextureFetch();
+	U32 cache_reads = 0;
+	U32 cache_writes = 0;
+	fetcher->getStateStats(&cache_reads, &cache_writes);
+	LLSD& fetch = results["fetch"];
+	fetch["http_requests"] = (S32)fetcher->getTotalNumHTTPRequests();
+	fetch["http_bytes"] = (LLSD::Real)fetcher->getTotalHTTPBytes();
+	fetch["reused_bytes"] = (LLSD::Real)fetcher->getReusedHTTPBytes();
+	fetch["coalesced_requests"] = (S32)fetcher->getCoalescedHTTPRequests();
+	fetch["cache_reads"] = (S32)cache_reads;
+	fetch["cache_writes"] = (S32)cache_writes;
+
+	std::string filename = gSavedSettings.getString("TextureBenchmarkResults");
+	if (filename.empty())
+	{
+		filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "texture_benchmark.xml");
+	}
+	llofstream out(filename.c_str());
+	if (out.is_open())
+	{
+		LLSDSerialize::toPrettyXML(results, out);
+	}
+	else
+	{
+		LL_WARNS("TextureBenchmark") << "Can't write " << filename << LL_ENDL;
+	}
+
+	LL_INFOS("TextureBenchmark") << "Served " << bytes_sent / 1024 << " KB in " << mServer->getRequestCount()
+								 << " requests (" << mServer->getErrorCount() << " busy), "
+								 << done << "/" << mFinished.size() << " textures reached their desired discard, "
+								 << llformat("%.1f", done / elapsed) << " a second" << LL_ENDL;
+	for (S32 level = MAX_DISCARD_LEVEL; level >= 0; --level)
+	{
+		const LLSD& time = times[llformat("%d", level)];
+		LL_INFOS("TextureBenchmark") << "Discard " << level << ": " << time["reached"].asInteger() << "/" << time["wanted"].asInteger()
+									 << llformat(" p50 %.3f p90 %.3f p99 %.3f s", time["p50"].asReal(), time["p90"].asReal(), time["p99"].asReal())
+									 << LL_ENDL;
+	}
+	LL_INFOS("TextureBenchmark") << llformat("Peak memory: raw %.1f MB, formatted %.1f MB, GL %.1f MB, RSS +%.1f MB",
+											 memory["peak_raw"].asReal(), memory["peak_formatted"].asReal(),
+											 memory["peak_gl"].asReal(), memory["rss_growth"].asReal())
+								 << LL_ENDL;
+	LL_INFOS("TextureBenchmark") << "Results written to " << filename << LL_ENDL;
+
+	LLAppViewer::instance()->forceQuit();
+}
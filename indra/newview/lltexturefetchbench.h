@@ -0,0 +1,183 @@
+/**
+ * @file lltexturefetchbench.h
+ * @brief Texture pipeline benchmark against a local stand-in for the texture server.
+ *
+ * $LicenseInfo:firstyear=2012&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREFETCHBENCH_H
+#define LL_LLTEXTUREFETCHBENCH_H
+
+#include <map>
+#include <vector>
+
+#include "llimage.h"
+#include "lliosocket.h"
+#include "llpointer.h"
+#include "llthread.h"
+#include "lltimer.h"
+#include "lluuid.h"
+
+class LLViewerFetchedTexture;
+
+//
+// A stand-in for the GetTexture capability: serves the J2C files of a
+// directory over HTTP on a local port, GET /?texture_id=<uuid> with byte
+// ranges, one thread per connection.
+//
+// Every request waits the latency before its reply. The bodies of all the
+// connections share one link of the given bandwidth. A share of the requests,
+// the error rate, gets a 503 (busy), which the fetcher retries.
+//
+// The id of a file is its name when that is a UUID, a hash of the name
+// otherwise. The files are read into memory up front, so the disk is not
+// part of what is measured.
+//
+class LLTextureServerStandIn : public LLThread
+{
+public:
+	// bandwidth in bytes per second, 0 for no limit
+	LLTextureServerStandIn(U16 port, F32 latency, F32 bandwidth, F32 error_rate, U32 seed);
+	~LLTextureServerStandIn();
+
+	// Returns the number of textures read from directory
+	S32 loadCorpus(const std::string& directory);
+	const std::vector<LLUUID>& getTextureIDs() const	{ return mTextureIDs; }
+
+	// Binds the port and starts serving. Returns false if the port can't be used.
+	bool startServing();
+	void stopServing();
+	std::string getURL() const;
+
+	U64 getBytesSent();
+	U32 getRequestCount();
+	U32 getErrorCount();
+
+protected:
+	/*virtual*/ void run();
+
+private:
+	class Connection;
+	friend class Connection;
+
+	// Connection threads
+	void serve(Connection* connection);
+	bool reply(Connection* connection, const std::string& request);
+	bool send(Connection* connection, const char* data, S32 size, bool throttle);
+	F32 random();
+
+private:
+	U16 mPort;
+	F32 mLatency;					// seconds
+	F32 mBandwidth;					// bytes per second
+	F32 mErrorRate;
+	U32 mRandom;
+	LLAtomic32<bool> mStopping;		// set by the main thread, polled by the server and connection threads
+
+	std::map<LLUUID, std::vector<U8> > mFiles;
+	std::vector<LLUUID> mTextureIDs;
+	std::vector<Connection*> mConnections;	// server thread only
+
+	LLSocket::ptr_t mListenSocket;
+
+	LLMutex mMutex;					// protects what is below
+	LLTimer mLinkTimer;
+	F64 mLinkFreeAt;				// mLinkTimer time at which the link is done with what it was given
+	U64 mBytesSent;
+	U32 mRequestCount;
+	U32 mErrorCount;
+};
+
+//
+// Runs the real texture pipeline (LLViewerTextureList, LLTextureFetch,
+// LLTextureCache, LLImageDecodeThread) at the login screen, without a grid,
+// against LLTextureServerStandIn, then quits.
+//
+// Textures of the corpus come into view and out of it at
+// TextureBenchmarkRate a second, from a seeded random stream, so that two
+// runs ask for the same things at the same times. While a texture is in view,
+// its pixel area grows as if it were getting closer. Some textures come back
+// later, which exercises the cache, discard upgrades and cancelled requests.
+//
+// The results are logged and written as LLSD to TextureBenchmarkResults
+// (texture_benchmark.xml in the log directory by default):
+// - throughput: bytes served, textures that reached their desired discard a second
+// - time to discard N: percentiles over the textures that wanted discard N or better,
+//   and how many of them got there while they were in view
+// - memory: peaks of raw and formatted image memory, GL texture memory and RSS
+// - the fetcher's HTTP and cache counters
+//
+// Start it with --texturebenchmark <corpus directory>. The other settings are
+// TextureBenchmark{Port,Latency,Bandwidth,ErrorRate,Duration,Rate,Seed,Results}.
+// Set PurgeCacheOnNextStartup too to start from an empty cache.
+//
+class LLTextureFetchBench
+{
+public:
+	// MAIN THREAD, every frame of the login screen: starts the run once if it was asked for
+	static void startIfRequested();
+	static bool isRunning()			{ return sInstance != NULL; }
+	static void cleanupClass();
+
+private:
+	LLTextureFetchBench();
+	~LLTextureFetchBench();
+
+	bool start();
+	static void onIdle(void* userdata);
+	void idle();
+	void addSample(F64 now);
+	void sampleMemory();
+	void finish();
+
+	F32 random();
+
+private:
+	struct Sample
+	{
+		LLPointer<LLViewerFetchedTexture> mTexture;
+		F64 mStart;				// seconds into the run
+		F64 mEnd;
+		F32 mPixelArea;
+		F32 mGrowth;			// pixel area multiplier per second
+		S32 mBestDesired;		// lowest desired discard seen while in view
+		F64 mReached[MAX_DISCARD_LEVEL + 1];	// seconds after mStart, negative if not reached
+		F64 mDone;				// reached the desired discard, negative if not
+	};
+
+	static LLTextureFetchBench* sInstance;
+	static bool sStarted;
+
+	LLTextureServerStandIn* mServer;
+	std::vector<Sample> mActive;
+	std::vector<Sample> mFinished;
+	LLTimer mTimer;
+	F64 mDuration;
+	F32 mRate;
+	F64 mNextSample;
+	U32 mRandom;
+
+	S64 mPeakRawMemory;
+	S32 mPeakFormattedMemory;
+	S64 mPeakGLMemory;
+	U64 mStartRSS;
+	U64 mPeakRSS;
+};
+
+#endif // LL_LLTEXTUREFETCHBENCH_H
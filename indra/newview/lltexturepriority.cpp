@@ -0,0 +1,323 @@
+/**
+ * @file lltexturepriority.cpp
+ * @brief Per frame estimate of the decode priority of every fetched texture.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturepriority.h"
+
+#include "llviewertexture.h"
+
+#include <algorithm>
+
+// Within 0.01 of log2(x) for normal x > 0, which is plenty to pick a discard level
+static inline F32 fast_log2(F32 x)
+{
+	U32 bits;
+	memcpy(&bits, &x, sizeof(bits));
+	F32 exponent = (F32)((S32)((bits >> 23) & 0xff) - 128);
+	bits = (bits & 0x007fffff) | 0x3f800000;
+	F32 mantissa;
+	memcpy(&mantissa, &bits, sizeof(mantissa));
+	return exponent + (-0.34484843f * mantissa + 2.02466578f) * mantissa - 0.67487759f;
+}
+
+struct changed_greater
+{
+	bool operator()(const std::pair<F32, LLViewerFetchedTexture*>& lhs, const std::pair<F32, LLViewerFetchedTexture*>& rhs) const
+	{
+		return lhs.first > rhs.first;
+	}
+};
+
+LLTexturePriorityTable::LLTexturePriorityTable()
+{
+}
+
+S32 LLTexturePriorityTable::add(LLViewerFetchedTexture* imagep)
+{
+	S32 slot;
+	if (!mFreeSlots.empty())
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		slot = (S32)mTexture.size();
+		U32 size = mTexture.size() + 1;
+		mVirtualSize.resize(size);
+		mAdditional.resize(size);
+		mLastBindTime.resize(size);
+		mTexelsLog2.resize(size);
+		mUpdatedEstimate.resize(size);
+		mFlags.resize(size);
+		mDirty.resize(size);
+		mJustBound.resize(size);
+		mBoost.resize(size);
+		mCurrentDiscard.resize(size);
+		mDesiredDiscard.resize(size);
+		mMinDesiredDiscard.resize(size);
+		mCachedRawDiscard.resize(size);
+		mMaxDiscard.resize(size);
+		mMinDiscard.resize(size);
+		mTexture.resize(size);
+	}
+	mVirtualSize[slot] = 0.f;
+	mAdditional[slot] = 0.f;
+	mLastBindTime[slot] = 0.f;
+	mBoost[slot] = 0;
+	// Nothing to estimate until the first setInputs()
+	mFlags[slot] = FLAG_FIXED;
+	mDirty[slot] = 0;
+	mJustBound[slot] = 0;
+	mUpdatedEstimate[slot] = -1.f;
+	mTexture[slot] = imagep;
+	return slot;
+}
+
+void LLTexturePriorityTable::remove(S32 slot)
+{
+	llassert(slot >= 0 && slot < (S32)mTexture.size() && mTexture[slot]);
+	mFlags[slot] = FLAG_FREE;
+	mDirty[slot] = 0;
+	mUpdatedEstimate[slot] = -1.f;
+	mTexture[slot] = NULL;
+	mFreeSlots.push_back(slot);
+}
+
+void LLTexturePriorityTable::clear()
+{
+	mVirtualSize.clear();
+	mAdditional.clear();
+	mLastBindTime.clear();
+	mTexelsLog2.clear();
+	mUpdatedEstimate.clear();
+	mFlags.clear();
+	mDirty.clear();
+	mJustBound.clear();
+	mBoost.clear();
+	mCurrentDiscard.clear();
+	mDesiredDiscard.clear();
+	mMinDesiredDiscard.clear();
+	mCachedRawDiscard.clear();
+	mMaxDiscard.clear();
+	mMinDiscard.clear();
+	mTexture.clear();
+	mFreeSlots.clear();
+	mChanged.clear();
+}
+
+void LLTexturePriorityTable::setInputs(S32 slot, const Inputs& inputs)
+{
+	mFlags[slot] = inputs.mFlags;
+	mCurrentDiscard[slot] = inputs.mCurrentDiscard;
+	mDesiredDiscard[slot] = inputs.mDesiredDiscard;
+	mMinDesiredDiscard[slot] = inputs.mMinDesiredDiscard;
+	mCachedRawDiscard[slot] = inputs.mCachedRawDiscard;
+	mMaxDiscard[slot] = inputs.mMaxDiscard;
+	mMinDiscard[slot] = inputs.mMinDiscard;
+	mTexelsLog2[slot] = inputs.mTexelsLog2;
+	mLastBindTime[slot] = llmax(mLastBindTime[slot], inputs.mLastBindTime);
+	mDirty[slot] = 1;
+}
+
+// LLViewerLODTexture::processTextureStats() and LLViewerFetchedTexture::calcDecodePriority()
+// on one row, without their side effects
+F32 LLTexturePriorityTable::estimate(U32 i, F32 now) const
+{
+	const U8 flags = mFlags[i];
+	if (flags & (FLAG_FREE | FLAG_FIXED))
+	{
+		return -1.f;
+	}
+	if (flags & FLAG_MISSING)
+	{
+		return 0.f;
+	}
+
+	const S32 boost = mBoost[i];
+	const S32 cur_discard = mCurrentDiscard[i];
+	const bool just_bound = now - mLastBindTime[i] < 0.5f;
+	const bool raw_ready = (flags & FLAG_RAW_READY) != 0;
+	F32 virtual_size = mVirtualSize[i];
+	F32 additional = mAdditional[i];
+
+	S32 desired_discard = mDesiredDiscard[i];
+	if (flags & FLAG_AUTO_DISCARD)
+	{
+		if (boost < LLGLTexture::BOOST_HIGH && virtual_size <= 10.f)
+		{
+			desired_discard = llmin((S32)mMinDesiredDiscard[i], MAX_DISCARD_LEVEL + 1);
+		}
+		else
+		{
+			if ((flags & FLAG_LARGE) && !just_bound && additional < 0.3f)
+			{
+				virtual_size = llmin(virtual_size, (F32)LLViewerTexture::sMinLargeImageSize);
+			}
+			// log4(texels / virtual size)
+			F32 discard = 0.5f * (mTexelsLog2[i] - fast_log2(llmax(virtual_size, 1.f)));
+			if (boost < LLGLTexture::BOOST_SCULPTED)
+			{
+				discard = (discard + LLViewerTexture::sDesiredDiscardBias) * LLViewerTexture::sDesiredDiscardScale
+						  + LLViewerTexture::sCameraMovingDiscardBias;
+			}
+			discard = llclamp(floorf(discard), (flags & FLAG_OVERSIZED) ? 1.f : 0.f, (F32)MAX_DISCARD_LEVEL);
+			desired_discard = llmin((S32)mMaxDiscard[i] + 1, (S32)discard);
+			desired_discard = llmin((S32)mMinDesiredDiscard[i], desired_discard);
+		}
+	}
+
+	if (desired_discard >= cur_discard && cur_discard > -1)
+	{
+		return -2.f;
+	}
+	if (mCachedRawDiscard[i] > -1 && desired_discard >= mCachedRawDiscard[i])
+	{
+		return -3.f;
+	}
+	if (desired_discard > mMaxDiscard[i])
+	{
+		return -4.f;
+	}
+
+	// Past this point the texture does not have all the data it wants
+	F32 pixel_priority = sqrtf(virtual_size);
+	F32 priority;
+	if (boost == LLGLTexture::BOOST_UI || boost == LLGLTexture::BOOST_ICON)
+	{
+		priority = 1.f;
+	}
+	else if (pixel_priority < 0.001f)
+	{
+		if (boost <= LLGLTexture::BOOST_HIGH)
+		{
+			return -5.f;
+		}
+		priority = 1.f;
+	}
+	else if (cur_discard < 0)
+	{
+		// log2(32 / pixel_priority)
+		S32 ddiscard = MAX_DISCARD_LEVEL - (S32)(5.f - fast_log2(pixel_priority));
+		ddiscard = llclamp(ddiscard, 0, MAX_DELTA_DISCARD_LEVEL_FOR_PRIORITY);
+		priority = (ddiscard + 1) * PRIORITY_DELTA_DISCARD_LEVEL_FACTOR;
+		additional = llmax(additional, 0.1f);
+	}
+	else if (mMinDiscard[i] > 0 && cur_discard <= mMinDiscard[i])
+	{
+		return -6.f;
+	}
+	else
+	{
+		if (!just_bound && raw_ready)
+		{
+			desired_discard = boost < LLGLTexture::BOOST_HIGH ? desired_discard + 2 : cur_discard;
+		}
+		S32 ddiscard = llclamp(cur_discard - desired_discard, -1, MAX_DELTA_DISCARD_LEVEL_FOR_PRIORITY);
+		priority = (ddiscard + 1) * PRIORITY_DELTA_DISCARD_LEVEL_FACTOR;
+	}
+
+	if (priority > 0.f)
+	{
+		const bool large_enough = raw_ready && (flags & FLAG_LARGE);
+		if (large_enough)
+		{
+			priority *= 0.5f;
+		}
+		priority += llclamp(pixel_priority, 0.f, MAX_PRIORITY_PIXEL) + PRIORITY_BOOST_LEVEL_FACTOR * boost;
+		if (boost > LLGLTexture::BOOST_HIGH)
+		{
+			if (boost > LLGLTexture::BOOST_SUPER_HIGH || !raw_ready)
+			{
+				priority += PRIORITY_BOOST_HIGH_FACTOR;
+			}
+			else
+			{
+				additional = llmax(additional, 0.5f);
+			}
+		}
+		if (additional > 0.f)
+		{
+			F32 additional_priority = PRIORITY_ADDITIONAL_FACTOR * (1.f + additional * MAX_ADDITIONAL_LEVEL_FOR_PRIORITY);
+			priority += large_enough ? additional_priority * 0.25f : additional_priority;
+		}
+		if (flags & FLAG_PREFETCH)
+		{
+			priority = llmin(priority, 1.f);
+		}
+	}
+	return priority;
+}
+
+void LLTexturePriorityTable::update(F32 now, U32 max_changed, std::vector<LLViewerFetchedTexture*>& changed)
+{
+	changed.clear();
+	mChanged.clear();
+
+	const U32 count = (U32)mTexture.size();
+	for (U32 i = 0; i < count; ++i)
+	{
+		// Most rows are as they were last frame, keep this test cheap
+		U8 just_bound = now - mLastBindTime[i] < 0.5f;
+		if (!mDirty[i] && mJustBound[i] == just_bound)
+		{
+			continue;
+		}
+		mJustBound[i] = just_bound;
+
+		F32 priority = estimate(i, now);
+		// Ignore < 20% difference, like updateImagesDecodePriorities()
+		F32 priority_test = llmax(priority, 0.f);
+		F32 updated_test = llmax(mUpdatedEstimate[i], 0.f);
+		if (priority_test < updated_test * .8f || priority_test > updated_test * 1.25f)
+		{
+			// Stays dirty until markUpdated()
+			mChanged.push_back(std::make_pair(priority, mTexture[i]));
+		}
+		else
+		{
+			mDirty[i] = 0;
+		}
+	}
+
+	if (mChanged.size() > max_changed)
+	{
+		// The rest stay changed and get their turn in the next frames
+		std::nth_element(mChanged.begin(), mChanged.begin() + max_changed, mChanged.end(), changed_greater());
+		mChanged.resize(max_changed);
+	}
+	std::sort(mChanged.begin(), mChanged.end(), changed_greater());
+	changed.reserve(mChanged.size());
+	for (U32 i = 0; i < mChanged.size(); ++i)
+	{
+		changed.push_back(mChanged[i].second);
+	}
+}
+
+void LLTexturePriorityTable::markUpdated(S32 slot, F32 now)
+{
+	mUpdatedEstimate[slot] = estimate(slot, now);
+	mJustBound[slot] = now - mLastBindTime[slot] < 0.5f;
+	mDirty[slot] = 0;
+}
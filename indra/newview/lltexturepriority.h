@@ -0,0 +1,156 @@
+/**
+ * @file lltexturepriority.h
+ * @brief Per frame estimate of the decode priority of every fetched texture.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREPRIORITY_H
+#define LL_LLTEXTUREPRIORITY_H
+
+#include <vector>
+
+class LLViewerFetchedTexture;
+
+// Decode priority formula, see LLViewerFetchedTexture::calcDecodePriority()
+const F32 MAX_PRIORITY_PIXEL                         = 999.f;     //pixel area
+const F32 PRIORITY_BOOST_LEVEL_FACTOR                = 1000.f;    //boost level
+const F32 PRIORITY_DELTA_DISCARD_LEVEL_FACTOR        = 100000.f;  //delta discard
+const S32 MAX_DELTA_DISCARD_LEVEL_FOR_PRIORITY       = 4;
+const F32 PRIORITY_ADDITIONAL_FACTOR                 = 1000000.f; //additional
+const S32 MAX_ADDITIONAL_LEVEL_FOR_PRIORITY          = 8;
+const F32 PRIORITY_BOOST_HIGH_FACTOR                 = 10000000.f;//boost high
+
+//
+// The inputs of the decode priority of every texture of LLViewerTextureList,
+// one column per input, one row per texture.
+//
+// The per frame inputs (virtual size from the faces, boost, additional priority,
+// bind time) are written through by LLViewerTexture as they change. The rest
+// (discard levels, cached raw image...) is a snapshot taken by
+// LLViewerFetchedTexture::updatePriorityInputs() when the texture is fetched,
+// created or gets its priority recomputed.
+//
+// update() goes over all the rows every frame, in one pass over packed arrays
+// with no virtual calls. It estimates the priority of the rows whose inputs
+// changed and returns the textures whose estimate moved by more than the 20% the
+// image list ignores since their priority was last recomputed. Only those are run through processTextureStats() and
+// calcDecodePriority() and re-sorted, instead of whatever the round robin of
+// updateImagesDecodePriorities() happens to reach.
+//
+class LLTexturePriorityTable
+{
+public:
+	enum
+	{
+		FLAG_FREE			= 1 << 0,	// no texture in this row
+		FLAG_FIXED			= 1 << 1,	// the priority does not move (loaded, or waiting to be created)
+		FLAG_MISSING		= 1 << 2,	// missing asset
+		FLAG_AUTO_DISCARD	= 1 << 3,	// desired discard follows the virtual size (LOD texture)
+		FLAG_RAW_READY		= 1 << 4,	// cached raw image ready
+		FLAG_LARGE			= 1 << 5,	// more texels than LLViewerTexture::sMinLargeImageSize
+		FLAG_OVERSIZED		= 1 << 6,	// wider or higher than MAX_IMAGE_SIZE_DEFAULT
+		FLAG_PREFETCH		= 1 << 7,	// only prefetched, see LLViewerFetchedTexture::setPrefetchArea()
+	};
+
+	// Snapshot of the slow changing inputs
+	struct Inputs
+	{
+		U8  mFlags;
+		S8  mCurrentDiscard;		// getCurrentDiscardLevelForFetching()
+		S8  mDesiredDiscard;		// used as is without FLAG_AUTO_DISCARD
+		S8  mMinDesiredDiscard;
+		S8  mCachedRawDiscard;
+		S8  mMaxDiscard;
+		S8  mMinDiscard;			// larger mips are corrupted
+		F32 mTexelsLog2;
+		F32 mLastBindTime;
+	};
+
+	LLTexturePriorityTable();
+
+	// Returns the row of imagep
+	S32 add(LLViewerFetchedTexture* imagep);
+	void remove(S32 slot);
+	void clear();
+
+	LLViewerFetchedTexture* getTexture(S32 slot) const	{ return mTexture[slot]; }
+	S32 getCount() const								{ return (S32)(mTexture.size() - mFreeSlots.size()); }
+
+	void setVirtualSize(S32 slot, F32 virtual_size)
+	{
+		if (mVirtualSize[slot] != virtual_size)
+		{
+			mVirtualSize[slot] = virtual_size;
+			mDirty[slot] = 1;
+		}
+	}
+	void setBoostLevel(S32 slot, S32 boost)
+	{
+		if (mBoost[slot] != (S8)boost)
+		{
+			mBoost[slot] = (S8)boost;
+			mDirty[slot] = 1;
+		}
+	}
+	void setAdditionalPriority(S32 slot, F32 priority)
+	{
+		if (mAdditional[slot] != priority)
+		{
+			mAdditional[slot] = priority;
+			mDirty[slot] = 1;
+		}
+	}
+	// update() notices on its own when a texture stops being just bound
+	void setLastBindTime(S32 slot, F32 time)			{ mLastBindTime[slot] = time; }
+	void setInputs(S32 slot, const Inputs& inputs);
+
+	// Estimate every row and fill changed with up to max_changed textures whose
+	// estimate moved, highest first. now is LLImageGL::sLastFrameTime.
+	void update(F32 now, U32 max_changed, std::vector<LLViewerFetchedTexture*>& changed);
+	// The priority of the texture in slot was just recomputed
+	void markUpdated(S32 slot, F32 now);
+
+private:
+	F32 estimate(U32 i, F32 now) const;
+
+private:
+	// One entry per row
+	std::vector<F32> mVirtualSize;
+	std::vector<F32> mAdditional;
+	std::vector<F32> mLastBindTime;
+	std::vector<F32> mTexelsLog2;
+	std::vector<F32> mUpdatedEstimate;		// estimate when the priority was last recomputed
+	std::vector<U8>  mFlags;
+	std::vector<U8>  mDirty;				// inputs changed since the last estimate
+	std::vector<U8>  mJustBound;			// bound in the last half second at the last estimate
+	std::vector<S8>  mBoost;
+	std::vector<S8>  mCurrentDiscard;
+	std::vector<S8>  mDesiredDiscard;
+	std::vector<S8>  mMinDesiredDiscard;
+	std::vector<S8>  mCachedRawDiscard;
+	std::vector<S8>  mMaxDiscard;
+	std::vector<S8>  mMinDiscard;
+	std::vector<LLViewerFetchedTexture*> mTexture;	// owned by the texture list
+
+	std::vector<S32> mFreeSlots;
+	std::vector<std::pair<F32, LLViewerFetchedTexture*> > mChanged;
+};
+
+#endif // LL_LLTEXTUREPRIORITY_H
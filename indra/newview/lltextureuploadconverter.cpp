@@ -0,0 +1,182 @@
+/**
+ * @file lltextureuploadconverter.cpp
+ * @brief Converts image files to JPEG2000 for upload on worker threads.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltextureuploadconverter.h"
+
+#include "llcallbacklist.h"
+#include "llfile.h"
+#include "llimage.h"
+#include "llviewercontrol.h"
+#include "llviewertexturelist.h"
+
+#include <boost/bind.hpp>
+
+// Every conversion holds a decoded image and an encoder, don't go overboard
+static const S32 MAX_CONVERSION_THREADS = 4;
+
+LLTextureUploadConverter::LLTextureUploadConverter()
+:	mQueue(NULL),
+	mQuitting(false),
+	mCompleted(0)
+{
+}
+
+LLTextureUploadConverter::~LLTextureUploadConverter()
+{
+	shutdown();
+}
+
+void LLTextureUploadConverter::start()
+{
+	S32 count = gSavedSettings.getS32("UploadConversionThreads");
+	if (count < 0)
+	{
+		count = MAX_CONVERSION_THREADS;
+	}
+	count = llclamp(count, 1, MAX_CONVERSION_THREADS);
+	mQueue = new LLThreadPool::Queue(LLThreadPool::getShared(), count);
+	gIdleCallbacks.addFunction(idle, this);
+	LL_INFOS("Upload") << "Texture upload conversions at once: " << (mQueue->isThreaded() ? count : 0) << LL_ENDL;
+}
+
+void LLTextureUploadConverter::shutdown()
+{
+	if (!mQueue)
+	{
+		return;
+	}
+	gIdleCallbacks.deleteFunction(idle, this);
+	mQuitting = true;
+
+	delete mQueue;
+	mQueue = NULL;
+
+	// Nothing is running any more, no need to lock
+	for (job_queue_t::iterator iter = mDone.begin(); iter != mDone.end(); ++iter)
+	{
+		LLFile::remove((*iter)->mOutFilename);
+	}
+	mDone.clear();
+	mRawImages.clear();
+}
+
+void LLTextureUploadConverter::convert(const std::string& src_filename, const std::string& out_filename, U8 codec, callback_t callback)
+{
+	if (!mQueue)
+	{
+		if (mQuitting)
+		{
+			return;
+		}
+		start();
+	}
+
+	job_ptr_t job(new Job);
+	job->mSrcFilename = src_filename;
+	job->mOutFilename = out_filename;
+	job->mCodec = codec;
+	// Settings are not thread safe, read them here
+	job->mAllowLossless = gSavedSettings.getBOOL("LosslessJ2CUpload");
+	job->mCallback = callback;
+	job->mSuccess = false;
+
+	mQueue->post(boost::bind(&LLTextureUploadConverter::convertFile, this, job));
+}
+
+S32 LLTextureUploadConverter::getPending()
+{
+	mMutex.lock();
+	S32 pending = mDone.size();
+	mMutex.unlock();
+	return pending + (mQueue ? mQueue->getPending() : 0);
+}
+
+void LLTextureUploadConverter::convertFile(job_ptr_t job)
+{
+	LLPointer<LLImageRaw> raw_image;
+	mMutex.lock();
+	if (!mRawImages.empty())
+	{
+		raw_image = mRawImages.back();
+		mRawImages.pop_back();
+	}
+	mMutex.unlock();
+	if (raw_image.isNull())
+	{
+		raw_image = new LLImageRaw;
+	}
+
+	job->mSuccess = LLViewerTextureList::createUploadFile(job->mSrcFilename, job->mOutFilename, job->mCodec,
+														  raw_image, job->mAllowLossless);
+	if (!job->mSuccess)
+	{
+		// The last error is per thread
+		job->mError = LLImage::getLastError();
+	}
+
+	mMutex.lock();
+	mRawImages.push_back(raw_image);
+	mDone.push_back(job);
+	mMutex.unlock();
+}
+
+void LLTextureUploadConverter::dispatchCompleted()
+{
+	job_queue_t done;
+	mMutex.lock();
+	done.swap(mDone);
+	mMutex.unlock();
+	S32 remaining = mQueue->getPending();
+
+	for (job_queue_t::iterator iter = done.begin(); iter != done.end(); ++iter)
+	{
+		const job_ptr_t& job = *iter;
+		++mCompleted;
+		if (job->mSuccess)
+		{
+			LL_INFOS("Upload") << "Converted " << job->mSrcFilename << " (" << mCompleted << " done, "
+				<< remaining + (done.end() - iter) - 1 << " to go)" << LL_ENDL;
+		}
+		else
+		{
+			LL_INFOS("Upload") << "Couldn't convert " << job->mSrcFilename << ": " << job->mError << LL_ENDL;
+		}
+		if (job->mCallback)
+		{
+			job->mCallback(job->mSrcFilename, job->mOutFilename, job->mSuccess, job->mError);
+		}
+	}
+
+	if (!done.empty() && !remaining)
+	{
+		mCompleted = 0;
+	}
+}
+
+//static
+void LLTextureUploadConverter::idle(void* user_data)
+{
+	((LLTextureUploadConverter*)user_data)->dispatchCompleted();
+}
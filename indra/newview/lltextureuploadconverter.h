@@ -0,0 +1,98 @@
+/**
+ * @file lltextureuploadconverter.h
+ * @brief Converts image files to JPEG2000 for upload on worker threads.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREUPLOADCONVERTER_H
+#define LL_LLTEXTUREUPLOADCONVERTER_H
+
+#include "llimage.h"
+#include "llsingleton.h"
+#include "llthreadpool.h"
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <deque>
+
+//
+// Runs LLViewerTextureList::createUploadFile() (load, decode, scale to a power
+// of two, encode to JPEG2000 and verify) for image files on the shared worker
+// pool, so that uploading a batch of images does not stall the frame loop.
+// Up to UploadConversionThreads files are converted at once; the code-blocks of
+// each encode are spread over other pool workers as well.
+//
+// The callbacks are called on the main thread, from the idle loop, in the order
+// the conversions finish.  Raw images are kept between files, so a batch of
+// images of the same size decodes without reallocating.
+//
+class LLTextureUploadConverter : public LLSingleton<LLTextureUploadConverter>
+{
+	friend class LLSingleton<LLTextureUploadConverter>;
+	LLTextureUploadConverter();
+
+public:
+	~LLTextureUploadConverter();
+
+	// Called with the source file, the converted file, and an error message if the conversion failed
+	typedef boost::function<void (const std::string& src_filename, const std::string& out_filename, bool success, const std::string& error)> callback_t;
+
+	// Convert src_filename (an image of the given codec) to a JPEG2000 file out_filename
+	void convert(const std::string& src_filename, const std::string& out_filename, U8 codec, callback_t callback);
+
+	// Conversions queued or running
+	S32 getPending();
+	// Conversions finished since the queue last ran empty, for progress reports
+	S32 getCompleted() const		{ return mCompleted; }
+
+	// Wait for the running conversions; those that have not started yet are dropped
+	void shutdown();
+
+	static void idle(void*);
+
+private:
+	struct Job
+	{
+		std::string	mSrcFilename;
+		std::string	mOutFilename;
+		U8			mCodec;
+		BOOL		mAllowLossless;
+		callback_t	mCallback;
+		bool		mSuccess;
+		std::string	mError;
+	};
+	typedef boost::shared_ptr<Job> job_ptr_t;
+	typedef std::deque<job_ptr_t> job_queue_t;
+
+	void start();
+	// Runs on the pool
+	void convertFile(job_ptr_t job);
+	void dispatchCompleted();
+
+private:
+	LLThreadPool::Queue* mQueue;
+	LLMutex			mMutex;			// protects mDone and mRawImages
+	job_queue_t		mDone;
+	std::vector<LLPointer<LLImageRaw> > mRawImages;	// not in use by a conversion
+	bool			mQuitting;
+	S32				mCompleted;		// main thread only
+};
+
+#endif // LL_LLTEXTUREUPLOADCONVERTER_H
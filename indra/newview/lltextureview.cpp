@@ -36,6 +36,7 @@
 #include "llui.h"
 #include "llimageworker.h"
 #include "llrender.h"
+#include "lltextureuploadstream.h"
 
 #include "aicurlperservice.h"
 #include "llappviewer.h"
@@ -576,6 +577,8 @@ void LLGLTexMemBar::draw()
 	F32Bytes total_texture_downloaded = gTotalTextureData;
 	F32Bytes total_object_downloaded = gTotalObjectData;
 	U32 total_http_requests = LLAppViewer::getTextureFetch()->getTotalNumHTTPRequests();
+	F32 total_http_mb = LLAppViewer::getTextureFetch()->getTotalHTTPBytes() / (1024.f * 1024.f);
+	F32 reused_http_mb = LLAppViewer::getTextureFetch()->getReusedHTTPBytes() / (1024.f * 1024.f);
 	//----------------------------------------------------------------------------
 	LLGLSUIDefault gls_ui;
 	LLColor4 text_color(1.f, 1.f, 1.f, 0.75f);
@@ -587,14 +590,15 @@ void LLGLTexMemBar::draw()
 	{
 		global_raw_memory = *AIAccess<S64>(LLImageRaw::sGlobalRawMemory);
 	}
-	text = llformat("GL Tot: %d/%d MB Bound: %d/%d MB FBO: %d MB Raw Tot: %lld MB Bias: %.2f Cache: %.1f/%.1f MB Net Tot Tex: %.1f MB Tot Obj: %.1f MB Tot Htp: %d",
+	text = llformat("GL Tot: %d/%d MB Bound: %d/%d MB FBO: %d MB Raw Tot: %lld MB Bias: %.2f Cache: %.1f/%.1f MB Net Tot Tex: %.1f MB Tot Obj: %.1f MB Tot Htp: %d (%.1f MB, %.1f MB reused)",
 					total_mem.value(),
 					max_total_mem.value(),
 					bound_mem.value(),
 					max_bound_mem.value(),
 					LLRenderTarget::sBytesAllocated/(1024*1024),
 					global_raw_memory >> 20,	discard_bias,
-					cache_usage, cache_max_usage, total_texture_downloaded.valueInUnits<LLUnits::Megabytes>(), total_object_downloaded.valueInUnits<LLUnits::Megabytes>(), total_http_requests);
+					cache_usage, cache_max_usage, total_texture_downloaded.valueInUnits<LLUnits::Megabytes>(), total_object_downloaded.valueInUnits<LLUnits::Megabytes>(), total_http_requests,
+					total_http_mb, reused_http_mb);
 	//, cache_entries, cache_max_entries
 
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*3,
@@ -663,7 +667,9 @@ void LLGLTexMemBar::draw()
 #endif
 	//----------------------------------------------------------------------------
 
-	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d(%d) HTTP:%d/%d/%d/%d DEC:%d CRE:%d ",
+	F32 decode_p50, decode_p90, decode_p99;
+	LLAppViewer::getImageDecodeThread()->getLatencyPercentiles(decode_p50, decode_p90, decode_p99);
+	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d(%d) HTTP:%d/%d/%d/%d DEC:%d(%d) %.0f/%.0f/%.0fms CRE:%d ",
 					gTextureList.getNumImages(),
 					LLAppViewer::getTextureFetch()->getNumRequests(), LLAppViewer::getTextureFetch()->getNumDeletes(),
 					LLAppViewer::getTextureFetch()->mPacketCount, LLAppViewer::getTextureFetch()->mBadPacketCount, 
@@ -675,7 +681,8 @@ void LLGLTexMemBar::draw()
 					AICurlInterface::getNumHTTPQueued(),
 					AICurlInterface::getNumHTTPAdded(),
 					AICurlInterface::getNumHTTPRunning(),
-					LLAppViewer::getImageDecodeThread()->getPending(), 
+					LLAppViewer::getImageDecodeThread()->getQueueDepth(), LLAppViewer::getImageDecodeThread()->getNumThreads(),
+					decode_p50, decode_p90, decode_p99,
 					gTextureList.mCreateTextureList.size());
 
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*2,
@@ -690,6 +697,26 @@ void LLGLTexMemBar::draw()
 	text = llformat("BW:%lu/%lu", bandwidth / 125, max_bandwidth / 125);
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, v_offset + line_height*2,
 											 color, LLFontGL::LEFT, LLFontGL::TOP);
+	if (LLImageGL::sCompressedUploadCount)
+	{
+		// Textures uploaded as DXT1/DXT5: count, texture memory saved and average quality
+		left += LLFontGL::getFontMonospace()->getWidth(text);
+		text = llformat(" DXT:%u -%dMB %.1fdB", LLImageGL::sCompressedUploadCount,
+						(S32)(LLImageGL::sCompressedBytesSaved.value() / (1024 * 1024)),
+						LLImageGL::sCompressedPSNRSum / LLImageGL::sCompressedUploadCount);
+		LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, v_offset + line_height*2,
+												 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+	}
+	if (LLTextureUploadStream::isEnabled())
+	{
+		// Upload stream: textures uploaded from it / staged, staging refused for lack of room, and buffer in use
+		left += LLFontGL::getFontMonospace()->getWidth(text);
+		text = llformat(" PBO:%u/%u full:%u %dMB/%dMB", LLTextureUploadStream::getUploadCount(), LLTextureUploadStream::getStagedCount(),
+						LLTextureUploadStream::getFullCount(), LLTextureUploadStream::getUsedBytes() / (1024 * 1024),
+						LLTextureUploadStream::getSize() / (1024 * 1024));
+		LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, v_offset + line_height*2,
+												 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+	}
 
 	S32 dx1 = 0;
 	if (LLAppViewer::getTextureFetch()->mDebugPause)
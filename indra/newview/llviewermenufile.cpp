@@ -51,6 +51,7 @@
 #include "llresourcedata.h"
 #include "llfloaterperms.h"
 #include "llstatusbar.h"
+#include "lltextureuploadconverter.h"
 #include "llviewercontrol.h"	// gSavedSettings
 #include "llviewertexturelist.h"
 #include "lluictrlfactory.h"
@@ -628,6 +629,7 @@ class LLFileQuit : public view_listener_t
 };
 
 static void handle_compress_image_continued(AIFilePicker* filepicker);
+static void on_compress_image_converted(const std::string& src_filename, const std::string& out_filename, bool success, const std::string& error);
 void handle_compress_image(void*)
 {
 	AIFilePicker* filepicker = AIFilePicker::create();
@@ -649,20 +651,75 @@ static void handle_compress_image_continued(AIFilePicker* filepicker)
 		LL_INFOS() << "Input:  " << infile << LL_ENDL;
 		LL_INFOS() << "Output: " << outfile << LL_ENDL;
 
-		BOOL success;
+		LLTextureUploadConverter::getInstance()->convert(infile, outfile, IMG_CODEC_TGA, &on_compress_image_converted);
+	}
+}
 
-		success = LLViewerTextureList::createUploadFile(infile, outfile, IMG_CODEC_TGA);
+static void on_compress_image_converted(const std::string& src_filename, const std::string& out_filename, bool success, const std::string& error)
+{
+	if (success)
+	{
+		LL_INFOS() << "Compression complete: " << out_filename << LL_ENDL;
+	}
+	else
+	{
+		LL_INFOS() << "Compression failed: " << error << LL_ENDL;
+	}
+}
 
-		if (success)
-		{
-			LL_INFOS() << "Compression complete" << LL_ENDL;
-		}
-		else
+// Copies the file to upload into the VFS and starts the upload
+static void upload_resource_file(const std::string& src_filename,
+			 const std::string& filename,
+			 bool created_temp_file,
+			 LLAssetType::EType asset_type,
+			 std::string name,
+			 std::string desc, S32 compression_info,
+			 LLFolderType::EType destination_folder_type,
+			 LLInventoryType::EType inv_type,
+			 U32 next_owner_perms,
+			 U32 group_perms,
+			 U32 everyone_perms,
+			 const std::string& display_name,
+			 LLAssetStorage::LLStoreAssetCallback callback,
+			 S32 expected_upload_cost,
+			 void *userdata,
+			 const std::string& error_message);
+
+// An image file waiting for its conversion to JPEG2000 on the upload conversion threads
+struct LLPendingImageUpload
+{
+	std::string mName;
+	std::string mDesc;
+	S32 mCompressionInfo;
+	LLFolderType::EType mDestinationFolderType;
+	LLInventoryType::EType mInvType;
+	U32 mNextOwnerPerms;
+	U32 mGroupPerms;
+	U32 mEveryonePerms;
+	std::string mDisplayName;
+	LLAssetStorage::LLStoreAssetCallback mCallback;
+	S32 mExpectedUploadCost;
+	void* mUserData;
+	BOOL mTemporary;	// TemporaryUpload at the time of the request
+
+	void operator()(const std::string& src_filename, const std::string& out_filename, bool success, const std::string& error) const
+	{
+		if (!success)
 		{
-			LL_INFOS() << "Compression failed: " << LLImage::getLastError() << LL_ENDL;
+			std::string error_message = llformat("Problem with file %s:\n\n%s\n", src_filename.c_str(), error.c_str());
+			LLSD args;
+			args["FILE"] = src_filename;
+			args["ERROR"] = error;
+			upload_error(error_message, "ProblemWithFile", out_filename, args);
+			return;
 		}
+		// Other uploads may have come and gone while this one was converting
+		gSavedSettings.setBOOL("TemporaryUpload", mTemporary);
+		upload_resource_file(src_filename, out_filename, true, LLAssetType::AT_TEXTURE, mName, mDesc, mCompressionInfo,
+							 mDestinationFolderType, mInvType, mNextOwnerPerms, mGroupPerms, mEveryonePerms,
+							 mDisplayName, mCallback, mExpectedUploadCost, mUserData, LLStringUtil::null);
 	}
-}
+};
 
 void upload_new_resource(const std::string& src_filename, std::string name,
 			 std::string desc, S32 compression_info,
@@ -679,8 +736,6 @@ void upload_new_resource(const std::string& src_filename, std::string name,
 	// Generate the temporary UUID.
 	std::string filename = gDirUtilp->getTempFilename();
 	bool created_temp_file = false;
-	LLTransactionID tid;
-	LLAssetID uuid;
 	
 	LLSD args;
 
@@ -688,8 +743,6 @@ void upload_new_resource(const std::string& src_filename, std::string name,
 	U32 codec = LLImageBase::getCodecFromExtension(exten);
 	LLAssetType::EType asset_type = LLAssetType::AT_NONE;
 	std::string error_message;
-
-	BOOL error = FALSE;
 	
 	if (exten.empty())
 	{
@@ -719,18 +772,27 @@ void upload_new_resource(const std::string& src_filename, std::string name,
 	}
 	else if (codec != IMG_CODEC_INVALID)
 	{
-		// It's an image file, the upload procedure is the same for all
-		asset_type = LLAssetType::AT_TEXTURE;
-		created_temp_file = true;
-		if (!LLViewerTextureList::createUploadFile(src_filename, filename, codec))
-		{
-			error_message = llformat( "Problem with file %s:\n\n%s\n",
-					src_filename.c_str(), LLImage::getLastError().c_str());
-			args["FILE"] = src_filename;
-			args["ERROR"] = LLImage::getLastError();
-			upload_error(error_message, "ProblemWithFile", filename, args);
-			return;
-		}
+		// It's an image file, the upload procedure is the same for all.
+		// Converting it takes a while, so the upload continues once the
+		// conversion threads are done with it.
+		LLPendingImageUpload upload;
+		upload.mName = name;
+		upload.mDesc = desc;
+		upload.mCompressionInfo = compression_info;
+		upload.mDestinationFolderType = destination_folder_type;
+		upload.mInvType = inv_type;
+		upload.mNextOwnerPerms = next_owner_perms;
+		upload.mGroupPerms = group_perms;
+		upload.mEveryonePerms = everyone_perms;
+		upload.mDisplayName = display_name;
+		upload.mCallback = callback;
+		upload.mExpectedUploadCost = expected_upload_cost;
+		upload.mUserData = userdata;
+		upload.mTemporary = gSavedSettings.getBOOL("TemporaryUpload");
+		// The upload would have consumed it right away
+		gSavedSettings.setBOOL("TemporaryUpload", FALSE);
+		LLTextureUploadConverter::getInstance()->convert(src_filename, filename, codec, upload);
+		return;
 	}
 	else if(exten == "wav")
 	{
@@ -908,9 +970,36 @@ void upload_new_resource(const std::string& src_filename, std::string name,
 	{
 		// Unknown extension
 		error_message = llformat(LLTrans::getString("UnknownFileExtension").c_str(), exten.c_str());
-		error = TRUE;;
 	}
 
+	upload_resource_file(src_filename, filename, created_temp_file, asset_type, name, desc, compression_info,
+						 destination_folder_type, inv_type, next_owner_perms, group_perms, everyone_perms,
+						 display_name, callback, expected_upload_cost, userdata, error_message);
+}
+
+static void upload_resource_file(const std::string& src_filename,
+			 const std::string& filename,
+			 bool created_temp_file,
+			 LLAssetType::EType asset_type,
+			 std::string name,
+			 std::string desc, S32 compression_info,
+			 LLFolderType::EType destination_folder_type,
+			 LLInventoryType::EType inv_type,
+			 U32 next_owner_perms,
+			 U32 group_perms,
+			 U32 everyone_perms,
+			 const std::string& display_name,
+			 LLAssetStorage::LLStoreAssetCallback callback,
+			 S32 expected_upload_cost,
+			 void *userdata,
+			 const std::string& error_message_in)
+{
+	std::string exten = gDirUtilp->getExtension(src_filename);
+	std::string error_message = error_message_in;
+	BOOL error = !error_message.empty();
+	LLTransactionID tid;
+	LLAssetID uuid;
+
 	// Now that we've determined the type, figure out the cost
 	if (!error) LLAgentBenefitsMgr::current().findUploadCost(asset_type, expected_upload_cost);
 
@@ -1666,12 +1666,15 @@ LLDataPacker *LLViewerRegion::getDP(U32 local_id, U32 crc, U8 &cache_miss_type)
 	if (entry)
 	{
 		// we've seen this object before
-		if (entry->getCRC() == crc)
+		// Payloads are loaded lazily, so a matching CRC can still miss when
+		// the data on disk turns out to be unreadable.
+		LLDataPacker* dp = entry->getCRC() == crc ? entry->getDP(crc) : NULL;
+		if (dp)
 		{
 			// Record a hit
 			entry->recordHit();
 		cache_miss_type = CACHE_MISS_TYPE_NONE;
-			return entry->getDP(crc);
+			return dp;
 		}
 		else
 		{
@@ -49,6 +49,7 @@
 #include "llimagegl.h"
 #include "lldrawpool.h"
 #include "lltexturefetch.h"
+#include "lltexturepriority.h"
 #include "llviewertexturelist.h"
 #include "llviewercontrol.h"
 #include "pipeline.h"
@@ -710,6 +711,10 @@ void LLViewerTexture::setBoostLevel(S32 level)
 	if(mBoostLevel != level)
 	{
 		mBoostLevel = level;
+		if (mPrioritySlot >= 0)
+		{
+			gTextureList.getPriorityTable().setBoostLevel(mPrioritySlot, level);
+		}
 		if(mBoostLevel != LLViewerTexture::BOOST_NONE && 
 			mBoostLevel != LLViewerTexture::BOOST_ALM && 
 			mBoostLevel != LLViewerTexture::BOOST_SELECTED && 
@@ -790,11 +795,26 @@ void LLViewerTexture::addTextureStats(F32 virtual_size, BOOL needs_gltexture) co
 		mMaxVirtualSize = virtual_size;		
 		mAdditionalDecodePriority = 0.f;	
 		mNeedsGLTexture = needs_gltexture;
+		if (mPrioritySlot >= 0)
+		{
+			gTextureList.getPriorityTable().setAdditionalPriority(mPrioritySlot, 0.f);
+		}
 	}
 	else if (virtual_size > mMaxVirtualSize)
 	{
 		mMaxVirtualSize = virtual_size;
 	}	
+
+	if (mPrioritySlot >= 0)
+	{
+		LLTexturePriorityTable& table = gTextureList.getPriorityTable();
+		table.setVirtualSize(mPrioritySlot, mMaxVirtualSize);
+		if (needs_gltexture)
+		{
+			// About to be drawn, so about to be bound
+			table.setLastBindTime(mPrioritySlot, LLImageGL::sLastFrameTime);
+		}
+	}
 }
 
 void LLViewerTexture::resetTextureStats()
@@ -802,6 +822,12 @@ void LLViewerTexture::resetTextureStats()
 	mMaxVirtualSize = 0.0f;
 	mAdditionalDecodePriority = 0.f;	
 	mMaxVirtualSizeResetCounter = 0;
+	if (mPrioritySlot >= 0)
+	{
+		LLTexturePriorityTable& table = gTextureList.getPriorityTable();
+		table.setVirtualSize(mPrioritySlot, 0.f);
+		table.setAdditionalPriority(mPrioritySlot, 0.f);
+	}
 }
 
 //virtual 
@@ -1061,6 +1087,7 @@ void LLViewerFetchedTexture::init(bool firstinit)
 	mCanUseHTTP = true;
 	mDesiredDiscardLevel = MAX_DISCARD_LEVEL + 1;
 	mMinDesiredDiscardLevel = MAX_DISCARD_LEVEL + 1;
+	mPrefetchArea = 0.f;
 	
 	mDecodingAux = FALSE;
 
@@ -1501,6 +1528,9 @@ BOOL LLViewerFetchedTexture::createTexture(LLImageGL::GLTextureName* usename)
 	}
 
 	res = mGLTexturep->createGLTexture(mRawDiscardLevel, mRawImage, usename, TRUE, mBoostLevel);
+	// Uploaded, don't keep the compressed copy or the staged one around with a saved raw image
+	mRawImage->setCompressedMips(NULL);
+	mRawImage->setStagedUpload(NULL);
 
 	notifyAboutCreatingTexture();
 
@@ -1610,13 +1640,6 @@ void LLViewerFetchedTexture::processTextureStats()
 	}
 }
 
-const F32 MAX_PRIORITY_PIXEL                         = 999.f;     //pixel area
-const F32 PRIORITY_BOOST_LEVEL_FACTOR                = 1000.f;    //boost level
-const F32 PRIORITY_DELTA_DISCARD_LEVEL_FACTOR        = 100000.f;  //delta discard
-const S32 MAX_DELTA_DISCARD_LEVEL_FOR_PRIORITY       = 4;
-const F32 PRIORITY_ADDITIONAL_FACTOR                 = 1000000.f; //additional 
-const S32 MAX_ADDITIONAL_LEVEL_FOR_PRIORITY          = 8;
-const F32 PRIORITY_BOOST_HIGH_FACTOR                 = 10000000.f;//boost high
 F32 LLViewerFetchedTexture::calcDecodePriority()
 {
 #ifndef LL_RELEASE_FOR_DOWNLOAD
@@ -1765,6 +1788,12 @@ F32 LLViewerFetchedTexture::calcDecodePriority()
 			}
 			priority += additional;
 		}
+
+		if (mPrefetchArea > 0.f)
+		{
+			// Nothing in view wants it yet; lowest band, same as LLTexturePriorityTable::estimate()
+			priority = llmin(priority, 1.f);
+		}
 	}
 	return priority;
 }
@@ -1781,6 +1810,67 @@ F32 LLViewerFetchedTexture::maxDecodePriority()
 	return max_priority;
 }
 
+void LLViewerFetchedTexture::updatePriorityInputs()
+{
+	if (mPrioritySlot < 0)
+	{
+		return;
+	}
+	static LLCachedControl<bool> textures_fullres(gSavedSettings, "TextureLoadFullRes", false);
+
+	LLTexturePriorityTable::Inputs inputs;
+	inputs.mFlags = 0;
+	if (mNeedsCreateTexture || (mFullyLoaded && !mForceToSaveRawImage))
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_FIXED;
+	}
+	if (mIsMissingAsset)
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_MISSING;
+	}
+	// The case where LLViewerLODTexture::processTextureStats() goes by the virtual size
+	if (getType() == LLViewerTexture::LOD_TEXTURE && !textures_fullres && mUseMipMaps && !mDontDiscard &&
+		(LLPipeline::sRenderDeferred || mBoostLevel != LLGLTexture::BOOST_ALM) &&
+		mFullWidth && mFullHeight && !(mKnownDrawWidth && mKnownDrawHeight))
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_AUTO_DISCARD;
+	}
+	if (mCachedRawImageReady)
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_RAW_READY;
+	}
+	if (isLargeImage())
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_LARGE;
+	}
+	if (mFullWidth > MAX_IMAGE_SIZE_DEFAULT || mFullHeight > MAX_IMAGE_SIZE_DEFAULT)
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_OVERSIZED;
+	}
+	if (mPrefetchArea > 0.f)
+	{
+		inputs.mFlags |= LLTexturePriorityTable::FLAG_PREFETCH;
+	}
+	inputs.mCurrentDiscard = (S8)getCurrentDiscardLevelForFetching();
+	inputs.mDesiredDiscard = mDesiredDiscardLevel;
+	inputs.mMinDesiredDiscard = mMinDesiredDiscardLevel;
+	if (mForceToSaveRawImage && mDesiredSavedRawDiscardLevel >= 0)
+	{
+		inputs.mMinDesiredDiscard = llmin(inputs.mMinDesiredDiscard, (S8)mDesiredSavedRawDiscardLevel);
+	}
+	inputs.mCachedRawDiscard = (S8)mCachedRawDiscardLevel;
+	inputs.mMaxDiscard = (S8)getMaxDiscardLevel();
+	inputs.mMinDiscard = (S8)mMinDiscardLevel;
+	inputs.mTexelsLog2 = mTexelsPerImage > 0.f ? log2f(mTexelsPerImage) : 0.f;
+	inputs.mLastBindTime = mGLTexturep.notNull() ? mGLTexturep->mLastBindTime : 0.f;
+
+	LLTexturePriorityTable& table = gTextureList.getPriorityTable();
+	table.setInputs(mPrioritySlot, inputs);
+	table.setVirtualSize(mPrioritySlot, mMaxVirtualSize);
+	table.setBoostLevel(mPrioritySlot, mBoostLevel);
+	table.setAdditionalPriority(mPrioritySlot, mAdditionalDecodePriority);
+}
+
 //============================================================================
 
 void LLViewerFetchedTexture::setDecodePriority(F32 priority)
@@ -1801,9 +1891,20 @@ void LLViewerFetchedTexture::setAdditionalDecodePriority(F32 priority)
 	if(mAdditionalDecodePriority < priority)
 	{
 		mAdditionalDecodePriority = priority;
+		if (mPrioritySlot >= 0)
+		{
+			gTextureList.getPriorityTable().setAdditionalPriority(mPrioritySlot, priority);
+		}
 	}
 }
 
+void LLViewerFetchedTexture::setPrefetchArea(F32 pixel_area)
+{
+	mPrefetchArea = llmax(mPrefetchArea, pixel_area);
+	addTextureStats(mPrefetchArea, FALSE);
+	updatePriorityInputs();
+}
+
 void LLViewerFetchedTexture::updateVirtualSize() 
 {	
 	if(!mMaxVirtualSizeResetCounter)
@@ -1811,6 +1912,8 @@ void LLViewerFetchedTexture::updateVirtualSize()
 		addTextureStats(0.f, FALSE);//reset
 	}
 
+	bool in_view = false;
+
 	for (U32 ch = 0; ch < LLRender::NUM_TEXTURE_CHANNELS; ++ch)
 	{
 		llassert(mNumFaces[ch] <= mFaceList[ch].size());
@@ -1833,11 +1936,27 @@ void LLViewerFetchedTexture::updateVirtualSize()
 						}
 						addTextureStats(facep->getVirtualSize());
 						setAdditionalDecodePriority(facep->getImportanceToCamera());
+						in_view = true;
 					}
 				}
 			}
 		}
 	}
+
+	if (mPrefetchArea > 0.f)
+	{
+		S32 cur_discard = getDiscardLevel();
+		if (in_view || mIsMissingAsset || mBoostLevel != LLGLTexture::BOOST_NONE ||
+			(cur_discard >= 0 && cur_discard <= mDesiredDiscardLevel))
+		{	//wanted for real now, or done
+			mPrefetchArea = 0.f;
+			updatePriorityInputs();
+		}
+		else
+		{	//keep it from decaying to nothing before it is fetched
+			addTextureStats(mPrefetchArea, FALSE);
+		}
+	}
 	//reset whether or not a face was selected after 10 seconds
 	const F32 SELECTION_RESET_TIME = 10.f;
 
@@ -147,6 +147,8 @@ public:
 	void setMaxVirtualSizeResetInterval(S32 interval)const {mMaxVirtualSizeResetInterval = interval;}
 	void resetMaxVirtualSizeResetCounter()const {mMaxVirtualSizeResetCounter = mMaxVirtualSizeResetInterval;}
 	S32 getMaxVirtualSizeResetCounter() const { return mMaxVirtualSizeResetCounter; }
+	S32 getPrioritySlot() const { return mPrioritySlot; }
+	void setPrioritySlot(S32 slot) { mPrioritySlot = slot; }
 
 	virtual F32  getMaxVirtualSize() ;
 
@@ -202,6 +204,7 @@ protected:
 	mutable S32  mMaxVirtualSizeResetCounter ;
 	mutable S32  mMaxVirtualSizeResetInterval;
 	mutable F32 mAdditionalDecodePriority;  // priority add to mDecodePriority.
+	S32 mPrioritySlot = -1;			// row in the LLTexturePriorityTable of gTextureList, -1 if none
 	LLFrameTimer mLastReferencedTimer;	
 
 	ll_face_list_t    mFaceList[LLRender::NUM_TEXTURE_CHANNELS]; //reverse pointer pointing to the faces using this image as texture
@@ -329,6 +332,8 @@ public:
 	
 	virtual void processTextureStats() ;
 	F32  calcDecodePriority() ;
+	// Copy what calcDecodePriority() looks at to the priority table
+	void updatePriorityInputs();
 
 	BOOL needsAux() const { return mNeedsAux; }
 
@@ -346,6 +351,9 @@ public:
 	void setAdditionalDecodePriority(F32 priority) ;
 	
 	void updateVirtualSize() ;
+	// Fetch at pixel_area, behind every texture in view, until a face in view or the data comes in
+	void setPrefetchArea(F32 pixel_area);
+	bool isPrefetching() const				{ return mPrefetchArea > 0.f; }
 
 	S32  getDesiredDiscardLevel()			 { return mDesiredDiscardLevel; }
 	void setMinDiscardLevel(S32 discard) 	{ mMinDesiredDiscardLevel = llmin(mMinDesiredDiscardLevel,(S8)discard); }
@@ -466,6 +474,7 @@ protected:
 	F32 mFetchDeltaTime;
 	F32 mRequestDeltaTime;
 	F32 mDecodePriority;			// The priority for decoding this image.
+	F32 mPrefetchArea;				// Pixel area asked for by setPrefetchArea(), 0 once it is done
 	S32	mMinDiscardLevel;
 	S8  mDesiredDiscardLevel;			// The discard level we'd LIKE to have - if we have it and there's space	
 	S8  mMinDesiredDiscardLevel;	// The minimum discard level we'd like to have
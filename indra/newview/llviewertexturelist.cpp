@@ -48,6 +48,7 @@
 #include "llimageworker.h"
 
 #include "llsdserialize.h"
+#include "llsessionaccesslog.h"
 #include "llsys.h"
 #include "llvfs.h"
 #include "llvfile.h"
@@ -57,6 +58,7 @@
 
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltextureuploadstream.h"
 #include "llviewercontrol.h"
 #include "llviewertexture.h"
 #include "llviewermedia.h"
@@ -271,6 +273,17 @@ void LLViewerTextureList::doPrefetchImages()
     LL_DEBUGS() << "fetched " << texture_count << " images from " << filename << LL_ENDL;
 }
 
+LLViewerFetchedTexture* LLViewerTextureList::prefetchImage(const LLUUID& image_id, S32 texture_type, F32 pixel_area)
+{
+	LLViewerFetchedTexture* image = LLViewerTextureManager::getFetchedTexture(image_id, FTT_DEFAULT, MIPMAP_TRUE,
+																			 LLGLTexture::BOOST_NONE, texture_type);
+	if (image && image->getNumFaces(LLRender::DIFFUSE_MAP) == 0)
+	{
+		image->setPrefetchArea(pixel_area);
+	}
+	return image;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 LLViewerTextureList::~LLViewerTextureList()
@@ -349,6 +362,13 @@ void LLViewerTextureList::shutdown()
 	mLoadingStreamList.clear();
 	mCreateTextureList.clear();
 	
+	for (uuid_map_t::iterator iter = mUUIDMap.begin(); iter != mUUIDMap.end(); ++iter)
+	{
+		iter->second->setPrioritySlot(-1);
+	}
+	mPriorityTable.clear();
+	mChangedPriorities.clear();
+
 	mUUIDMap.clear();
 	mUUIDDict.clear();
 	
@@ -755,10 +775,27 @@ void LLViewerTextureList::addImage(LLViewerFetchedTexture *new_image, ETexListTy
 	auto ret_pair = mUUIDMap.emplace(key, new_image);
 	if (!ret_pair.second)
 	{
+		LLViewerFetchedTexture* old_image = ret_pair.first->second;
+		if (old_image->getPrioritySlot() >= 0)
+		{
+			mPriorityTable.remove(old_image->getPrioritySlot());
+			old_image->setPrioritySlot(-1);
+		}
 		ret_pair.first->second = new_image;
 	}
 	mUUIDDict.insert_or_assign(key, new_image);
 	new_image->setTextureListType(tex_type);
+	if (new_image->getPrioritySlot() < 0)
+	{
+		new_image->setPrioritySlot(mPriorityTable.add(new_image));
+		new_image->updatePriorityInputs();
+		mPriorityTable.markUpdated(new_image->getPrioritySlot(), LLImageGL::sLastFrameTime);
+	}
+
+	if (tex_type == TEX_LIST_STANDARD)
+	{
+		LLSessionAccessLog::getInstance()->recordTexture(image_id, new_image->getType());
+	}
 }
 
 
@@ -771,6 +808,12 @@ void LLViewerTextureList::deleteImage(LLViewerFetchedTexture *image)
 			mCallbackList.erase(image);
 		}
 
+		if (image->getPrioritySlot() >= 0)
+		{
+			mPriorityTable.remove(image->getPrioritySlot());
+			image->setPrioritySlot(-1);
+		}
+
 		const LLTextureKey key(image->getID(), (ETexListType)image->getTextureListType());
 		llverify(mUUIDMap.erase(key) == 1);
 		llverify(mUUIDDict.erase(key) == 1);
@@ -792,6 +835,7 @@ void LLViewerTextureList::dirtyImage(LLViewerFetchedTexture *image)
 ////////////////////////////////////////////////////////////////////////////
 static LLTrace::BlockTimerStatHandle FTM_IMAGE_MARK_DIRTY("Dirty Images");
 static LLTrace::BlockTimerStatHandle FTM_IMAGE_UPDATE_PRIORITIES("Prioritize");
+static LLTrace::BlockTimerStatHandle FTM_PRIORITY_TABLE("Priority Table");
 static LLTrace::BlockTimerStatHandle FTM_IMAGE_CALLBACKS("Callbacks");
 static LLTrace::BlockTimerStatHandle FTM_IMAGE_FETCH("Fetch");
 static LLTrace::BlockTimerStatHandle FTM_IMAGE_CREATE("Create");
@@ -819,6 +863,7 @@ void LLViewerTextureList::updateImages(F32 max_time)
 			gPipeline.clearRebuildGroups();
 			gPipeline.resetVertexBuffers();
 			LLVolumeImplFlexible::resetTimers();
+			trimImageBufferPool(true);
 			cleared = TRUE;
 		}
 		return;
@@ -887,6 +932,39 @@ void LLViewerTextureList::updateImages(F32 max_time)
 		LL_RECORD_BLOCK_TIME(FTM_IMAGE_STATS);
 		updateImagesUpdateStats();
 	}
+
+	trimImageBufferPool(false);
+}
+
+// Frees the raw image buffers that have not been reused for a while. On teleport all
+// of them go: the textures of the next region will hardly come in the same sizes.
+void LLViewerTextureList::trimImageBufferPool(bool teleported)
+{
+	static LLFrameTimer trim_timer;
+	if (!teleported && trim_timer.getElapsedTimeF32() < 5.f)
+	{
+		return;
+	}
+	trim_timer.reset();
+
+	static LLCachedControl<U32> pool_size(gSavedSettings, "ImageBufferPoolSize");
+	static LLCachedControl<F32> max_age(gSavedSettings, "ImageBufferPoolMaxAge");
+	LLImageBufferPool::setMaxCachedBytes((S64)pool_size * 1024 * 1024);
+
+	if (teleported)
+	{
+		U32 hits = LLImageBufferPool::getHitCount();
+		U32 misses = LLImageBufferPool::getMissCount();
+		LL_INFOS("TextureBuffers") << "Teleport: freeing " << LLImageBufferPool::getCachedBytes() / 1024
+			<< " KB of pooled image buffers. Since startup " << hits << " buffers were reused and " << misses
+			<< " allocated (" << (hits + misses ? (U64)hits * 100 / (hits + misses) : 0) << "% reused), "
+			<< LLImageBufferPool::getTrimmedBytes() / (1024 * 1024) << " MB were freed unused." << LL_ENDL;
+		LLImageBufferPool::clear();
+	}
+	else
+	{
+		LLImageBufferPool::trim(max_age);
+	}
 }
 
 void LLViewerTextureList::clearFetchingRequests()
@@ -993,20 +1071,54 @@ void LLViewerTextureList::updateImagesDecodePriorities()
 			{
 				continue;
 			}
-			imagep->processTextureStats();
-			F32 old_priority = imagep->getDecodePriority();
-			F32 old_priority_test = llmax(old_priority, 0.0f);
-			F32 decode_priority = imagep->calcDecodePriority();
-			F32 decode_priority_test = llmax(decode_priority, 0.0f);
-			// Ignore < 20% difference
-			if ((decode_priority_test < old_priority_test * .8f) ||
-				(decode_priority_test > old_priority_test * 1.25f))
+			updateDecodePriority(imagep);
+		}
+	}
+
+	// Then every texture whose priority inputs moved enough since its last update,
+	// wherever the round robin is
+	static LLCachedControl<S32> max_changed(gSavedSettings, "TextureFetchUpdateChangedPriorities");
+	if (max_changed > 0)
+	{
+		{
+			LL_RECORD_BLOCK_TIME(FTM_PRIORITY_TABLE);
+			mPriorityTable.update(LLImageGL::sLastFrameTime, (U32)max_changed, mChangedPriorities);
+		}
+		for (std::vector<LLViewerFetchedTexture*>::iterator iter = mChangedPriorities.begin();
+			 iter != mChangedPriorities.end(); ++iter)
+		{
+			LLViewerFetchedTexture* imagep = *iter;
+			if (!imagep->isInImageList() || imagep->isDeleted() || imagep->isDeletionCandidate())
 			{
-				removeImageFromList(imagep);
-				imagep->setDecodePriority(decode_priority);
-				addImageToList(imagep);
+				// Left to the round robin
+				mPriorityTable.markUpdated(imagep->getPrioritySlot(), LLImageGL::sLastFrameTime);
+				continue;
 			}
+			updateDecodePriority(imagep);
 		}
+		mChangedPriorities.clear();
+	}
+}
+
+void LLViewerTextureList::updateDecodePriority(LLViewerFetchedTexture* imagep)
+{
+	imagep->processTextureStats();
+	F32 old_priority = imagep->getDecodePriority();
+	F32 old_priority_test = llmax(old_priority, 0.0f);
+	F32 decode_priority = imagep->calcDecodePriority();
+	F32 decode_priority_test = llmax(decode_priority, 0.0f);
+	// Ignore < 20% difference
+	if ((decode_priority_test < old_priority_test * .8f) ||
+		(decode_priority_test > old_priority_test * 1.25f))
+	{
+		removeImageFromList(imagep);
+		imagep->setDecodePriority(decode_priority);
+		addImageToList(imagep);
+	}
+	if (imagep->getPrioritySlot() >= 0)
+	{
+		imagep->updatePriorityInputs();
+		mPriorityTable.markUpdated(imagep->getPrioritySlot(), LLImageGL::sLastFrameTime);
 	}
 }
 
@@ -1056,12 +1168,15 @@ F32 LLViewerTextureList::updateImagesCreateTextures(F32 max_time)
 		enditer = iter;
 		LLViewerFetchedTexture *imagep = *curiter;
 		imagep->createTexture();
+		imagep->updatePriorityInputs();
 		if (create_timer.getElapsedTimeF32() > max_time)
 		{
 			break;
 		}
 	}
 	mCreateTextureList.erase(mCreateTextureList.begin(), enditer);
+	// Fence the uploads from the stream buffer, and recycle what the GPU is done with
+	LLTextureUploadStream::update();
 	return create_timer.getElapsedTimeF32();
 }
 
@@ -1147,6 +1262,7 @@ F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
 	{
 		LLViewerFetchedTexture* imagep = *iter3++;
 		fetch_count += (imagep->updateFetch() ? 1 : 0);
+		imagep->updatePriorityInputs();
 		if (min_count <= (S32)min_update_count)
 		{
 			mLastFetchKey = LLTextureKey(imagep->getID(), (ETexListType)imagep->getTextureListType());
@@ -1242,6 +1358,16 @@ void LLViewerTextureList::decodeAllImages(F32 max_time)
 BOOL LLViewerTextureList::createUploadFile(const std::string& filename,
 										 const std::string& out_filename,
 										 const U8 codec)
+{
+	LLPointer<LLImageRaw> raw_image = new LLImageRaw;
+	return createUploadFile(filename, out_filename, codec, raw_image, gSavedSettings.getBOOL("LosslessJ2CUpload"));
+}
+
+BOOL LLViewerTextureList::createUploadFile(const std::string& filename,
+										 const std::string& out_filename,
+										 const U8 codec,
+										 LLImageRaw* raw_image,
+										 BOOL allow_lossless)
 {
 	// Load the image
 	LLPointer<LLImageFormatted> image = LLImageFormatted::createFromType(codec);
@@ -1256,7 +1382,6 @@ BOOL LLViewerTextureList::createUploadFile(const std::string& filename,
 		return FALSE;
 	}
 	// Decompress or expand it in a raw image structure
-	LLPointer<LLImageRaw> raw_image = new LLImageRaw;
 	if (!image->decode(raw_image, 0.0f))
 	{
 		LLImage::setLastError("Couldn't decode the image to be uploaded.");
@@ -1269,7 +1394,7 @@ BOOL LLViewerTextureList::createUploadFile(const std::string& filename,
 		return FALSE;
 	}
 	// Convert to j2c (JPEG2000) and save the file locally
-	LLPointer<LLImageJ2C> compressedImage = convertToUploadFile(raw_image);	
+	LLPointer<LLImageJ2C> compressedImage = convertToUploadFile(raw_image, allow_lossless);
 	if (compressedImage.isNull())
 	{
 		LLImage::setLastError("Couldn't convert the image to jpeg2000.");
@@ -1319,12 +1444,18 @@ BOOL LLViewerTextureList::verifyUploadFile(const std::string& out_filename, cons
 
 // note: modifies the argument raw_image!!!!
 LLPointer<LLImageJ2C> LLViewerTextureList::convertToUploadFile(LLPointer<LLImageRaw> raw_image)
+{
+	return convertToUploadFile(raw_image, gSavedSettings.getBOOL("LosslessJ2CUpload"));
+}
+
+// note: modifies the argument raw_image!!!!
+LLPointer<LLImageJ2C> LLViewerTextureList::convertToUploadFile(LLPointer<LLImageRaw> raw_image, BOOL allow_lossless)
 {
 	raw_image->biasedScaleToPowerOfTwo(LLViewerFetchedTexture::MAX_IMAGE_SIZE_DEFAULT);
 	LLPointer<LLImageJ2C> compressedImage = new LLImageJ2C();
 	compressedImage->setRate(0.f);
 	
-	if (gSavedSettings.getBOOL("LosslessJ2CUpload") &&
+	if (allow_lossless &&
 		(raw_image->getWidth() * raw_image->getHeight() <= LL_IMAGE_REZ_LOSSLESS_CUTOFF * LL_IMAGE_REZ_LOSSLESS_CUTOFF))
 		compressedImage->setReversible(TRUE);
 	
@@ -32,6 +32,7 @@
 #include "llgl.h"
 #include "llstat.h"
 #include "llviewertexture.h"
+#include "lltexturepriority.h"
 #include "llui.h"
 #include <list>
 #include <set>
@@ -107,8 +108,12 @@ class LLViewerTextureList
 	
 public:
 	static BOOL createUploadFile(const std::string& filename, const std::string& out_filename, const U8 codec);
+	// Thread safe version: decodes into raw_image, which the caller may reuse for the next file
+	static BOOL createUploadFile(const std::string& filename, const std::string& out_filename, const U8 codec,
+								 LLImageRaw* raw_image, BOOL allow_lossless);
 	static BOOL verifyUploadFile(const std::string& out_filename, const U8 codec);
 	static LLPointer<LLImageJ2C> convertToUploadFile(LLPointer<LLImageRaw> raw_image);
+	static LLPointer<LLImageJ2C> convertToUploadFile(LLPointer<LLImageRaw> raw_image, BOOL allow_lossless);
 	static void processImageNotInDatabase( LLMessageSystem *msg, void **user_data );
 	static void receiveImageHeader(LLMessageSystem *msg, void **user_data);
 	static void receiveImagePacket(LLMessageSystem *msg, void **user_data);
@@ -149,17 +154,23 @@ public:
 	
 	void doPreloadImages();
 	void doPrefetchImages();
+	// Fetch a texture no object uses yet at pixel_area, after the ones in view
+	LLViewerFetchedTexture* prefetchImage(const LLUUID& image_id, S32 texture_type, F32 pixel_area);
 
 	void clearFetchingRequests();
 
+	LLTexturePriorityTable& getPriorityTable()	{ return mPriorityTable; }
+
 	static S32Megabytes getMinVideoRamSetting();
 	static S32Megabytes getMaxVideoRamSetting(bool get_recommended, float mem_multiplier);
 	
 private:
 	void updateImagesDecodePriorities();
+	void updateDecodePriority(LLViewerFetchedTexture* imagep);
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
+	void trimImageBufferPool(bool teleported);
 
 	void addImage(LLViewerFetchedTexture *image, ETexListType tex_type);
 	void deleteImage(LLViewerFetchedTexture *image);
@@ -234,6 +245,10 @@ private:
 	typedef std::set<LLPointer<LLViewerFetchedTexture>, LLViewerFetchedTexture::Compare> image_priority_list_t;	
 	image_priority_list_t mImageList;
 
+	// Priority inputs of the textures of mUUIDMap
+	LLTexturePriorityTable mPriorityTable;
+	std::vector<LLViewerFetchedTexture*> mChangedPriorities;
+
 	// simply holds on to LLViewerFetchedTexture references to stop them from being purged too soon
 	std::set<LLPointer<LLViewerFetchedTexture> > mImagePreloads;
 
@@ -41,6 +41,7 @@
 
 #include "llagent.h"
 #include "llagentcamera.h"
+#include "llmeshcache.h"
 #include "llmeshrepository.h"
 #include "llpanellogin.h"
 #include "llviewerkeyboard.h"
@@ -135,6 +136,7 @@
 #include "lltextbox.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltextureuploadstream.h"
 #include "lltextureview.h"
 #include "lltool.h"
 #include "lltoolbar.h"
@@ -689,9 +691,26 @@ public:
 				addText(xpos, ypos, llformat("%d/%d Mesh LOD Pending/Processing", LLMeshRepository::sLODPending, (U32)LLMeshRepository::sLODProcessing));
 				ypos += y_inc;
 
+				addText(xpos, ypos, llformat("%.2f/%.2f s Mesh On-screen LOD Load Avg/Max (%d)",
+					LLMeshRepository::sOnScreenLODLoads ? LLMeshRepository::sOnScreenLODLoadTime / LLMeshRepository::sOnScreenLODLoads : 0.f,
+					LLMeshRepository::sOnScreenLODLoadTimeMax, LLMeshRepository::sOnScreenLODLoads));
+				ypos += y_inc;
+
+				addText(xpos, ypos, llformat("%.3f/%.3f MB Mesh Skin Info/Decompositions Held (%d dropped)",
+					LLMeshRepository::sSkinInfoBytes/(1024.f*1024.f), LLMeshRepository::sDecompositionBytes/(1024.f*1024.f),
+					LLMeshRepository::sMeshInfoEvictions));
+				ypos += y_inc;
+
 				addText(xpos, ypos, llformat("%.3f/%.3f MB Mesh Cache Read/Write ", LLMeshRepository::sCacheBytesRead/(1024.f*1024.f), LLMeshRepository::sCacheBytesWritten/(1024.f*1024.f)));
 
 				ypos += y_inc;
+
+				U32 cache_lookups = LLMeshCache::sCacheHits + LLMeshCache::sCacheMisses;
+				addText(xpos, ypos, llformat("%.1f%% Mesh Cache Hit Rate, %.3f MB Saved, %.3f MB Used",
+					cache_lookups ? LLMeshCache::sCacheHits * 100.f / cache_lookups : 0.f,
+					LLMeshCache::sBytesSaved/(1024.f*1024.f), LLMeshCache::getInstance()->getUsage()/(1024.f*1024.f)));
+
+				ypos += y_inc;
 			}
 
 			addText(xpos, ypos, llformat("%d/%d bytes allocted to messages", sMsgDataAllocSize, sMsgdataAllocCount));
@@ -1652,6 +1671,15 @@ static const std::string font_dir()
 		;
 }
 
+// Needs the GL context, and again after it was recreated
+static void init_texture_upload_stream()
+{
+	if (gSavedSettings.getBOOL("RenderTextureUploadStream") && gGLManager.mHasBufferStorage)
+	{
+		LLTextureUploadStream::initClass(gSavedSettings.getU32("RenderTextureUploadStreamSize") * 1024 * 1024);
+	}
+}
+
 //
 // Classes
 //
@@ -1783,6 +1811,7 @@ LLViewerWindow::LLViewerWindow(
 	LLVertexBuffer::initClass(gSavedSettings.getBOOL("RenderVBOEnable"), gSavedSettings.getBOOL("RenderVBOMappingDisable"));
 	LL_INFOS("RenderInit") << "LLVertexBuffer initialization done." << LL_ENDL ;
 	LLImageGL::initClass(LLViewerTexture::MAX_GL_IMAGE_CATEGORY) ;
+	init_texture_upload_stream();
 
 	if (LLFeatureManager::getInstance()->isSafe()
 		|| (gSavedSettings.getS32("LastFeatureVersion") != LLFeatureManager::getInstance()->getVersion())
@@ -2325,6 +2354,7 @@ void LLViewerWindow::shutdownGL()
 
 	LLViewerTextureManager::cleanup() ;
 	LLImageGL::cleanupClass() ;
+	LLTextureUploadStream::cleanupClass();
 
 	LL_INFOS() << "All textures and llimagegl images are destroyed!" << LL_ENDL ;
 
@@ -5380,6 +5410,7 @@ void LLViewerWindow::stopGL(BOOL save_state)
 
 		gTextureList.destroyGL(save_state);
 		stop_glerror();
+		LLTextureUploadStream::cleanupClass();
 		gGL.destroyGL();
 		stop_glerror();
 
@@ -5426,6 +5457,7 @@ void LLViewerWindow::restoreGL(bool full_restore, const std::string& progress_me
 		gGLManager.mIsDisabled = FALSE;
 		
 		restoreGLState();
+		init_texture_upload_stream();
 
 		gTextureList.restoreGL();
 		stop_glerror();
@@ -10907,20 +10907,30 @@ void LLVOAvatar::accountRenderComplexityForObject(
 				{
 					attachment_volume_cost += animated_object_attachment_surcharge;
 				}
-				attachment_volume_cost += volume->getRenderCost(textures);
 
-				const_child_list_t children = volume->getChildren();
+				// Look up the cost data of the whole linkset at once
+				std::vector<const LLVOVolume*> volumes(1, volume);
+				std::vector<LLMeshCostData> costs;
+				std::vector<bool> found;
+				const_child_list_t& children = volume->getChildren();
 				for (const_child_list_t::const_iterator child_iter = children.begin();
 					child_iter != children.end();
 					++child_iter)
 				{
 					LLViewerObject* child_obj = *child_iter;
                     LLVOVolume *child = child_obj ? child_obj->asVolume() : nullptr;
-					if (child)
+					if (child && child->getVolume())
 					{
-						attachment_children_cost += child->getRenderCost(textures);
+						volumes.push_back(child);
 					}
 				}
+				LLVOVolume::getCostData(volumes, costs, found);
+
+				attachment_volume_cost += volume->getRenderCost(textures, found[0] ? &costs[0] : NULL);
+				for (U32 i = 1; i < volumes.size(); ++i)
+				{
+					attachment_children_cost += volumes[i]->getRenderCost(textures, found[i] ? &costs[i] : NULL);
+				}
 
 				for (LLVOVolume::texture_cost_t::iterator volume_texture = textures.begin();
 					volume_texture != textures.end();
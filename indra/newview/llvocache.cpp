@@ -38,6 +38,8 @@
 #include "llregionhandle.h"
 #include "llviewercontrol.h"
 
+#include <zlib.h>
+
 BOOL check_read(LLAPRFile* apr_file, void* src, S32 n_bytes) 
 {
 	return apr_file->read(src, n_bytes) == n_bytes ;
@@ -47,6 +49,63 @@ BOOL check_write(LLAPRFile* apr_file, void* src, S32 n_bytes)
 {
 	return apr_file->write(src, n_bytes) == n_bytes ;
 }
+
+static LLTrace::BlockTimerStatHandle FTM_READ_OBJECT_CACHE("Read Object Cache");
+static LLTrace::BlockTimerStatHandle FTM_WRITE_OBJECT_CACHE("Write Object Cache");
+
+// Largest object update we accept from the cache; anything bigger is corruption.
+const S32 MAX_PAYLOAD_SIZE = 10000;
+// Smaller payloads are stored uncompressed, deflate does not gain anything on them.
+const S32 MIN_COMPRESSED_PAYLOAD_SIZE = 64;
+
+//---------------------------------------------------------------------------
+// LLVOCacheFile
+//---------------------------------------------------------------------------
+
+LLVOCacheFile::LLVOCacheFile(const std::string& filename, U32 data_size)
+	:
+	mFilename(filename),
+	mDataSize(data_size)
+{
+}
+
+LLVOCacheFile::~LLVOCacheFile()
+{
+	close();
+}
+
+BOOL LLVOCacheFile::read(U8* buffer, U32 offset, S32 numbytes)
+{
+	if (numbytes <= 0 || offset + numbytes > mDataSize)
+	{
+		return FALSE;
+	}
+
+	if (!mFile.getFileHandle())
+	{
+		mFile.open(mFilename, APR_READ|APR_BINARY, LLAPRFile::long_lived);
+		if (!mFile.getFileHandle())
+		{
+			return FALSE;
+		}
+	}
+
+	if (mFile.seek(APR_SET, offset) != (S32)offset || !check_read(&mFile, buffer, numbytes))
+	{
+		return FALSE;
+	}
+	LLVOCache::sBytesRead += numbytes;
+	return TRUE;
+}
+
+void LLVOCacheFile::close()
+{
+	if (mFile.getFileHandle())
+	{
+		mFile.close();
+	}
+}
+
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
 //---------------------------------------------------------------------------
@@ -57,7 +116,10 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mCRC(crc),
 	mHitCount(0),
 	mDupeCount(0),
-	mCRCChangeCount(0)
+	mCRCChangeCount(0),
+	mOffset(0),
+	mStoredSize(0),
+	mRawSize(0)
 {
 	mBuffer = new U8[dp.getBufferSize()];
 	mDP.assignBuffer(mBuffer, dp.getBufferSize());
@@ -71,74 +133,29 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mHitCount(0),
 	mDupeCount(0),
 	mCRCChangeCount(0),
-	mBuffer(NULL)
+	mBuffer(NULL),
+	mOffset(0),
+	mStoredSize(0),
+	mRawSize(0)
 {
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
-	: mBuffer(NULL)
+// The payload stays on disk until the entry is probed with a matching CRC.
+LLVOCacheEntry::LLVOCacheEntry(const IndexRecord& record, LLVOCacheFile* file)
+	:
+	mLocalID(record.mLocalID),
+	mCRC(record.mCRC),
+	mHitCount(record.mHitCount),
+	mDupeCount(record.mDupeCount),
+	mCRCChangeCount(record.mCRCChangeCount),
+	mBuffer(NULL),
+	mFile(file),
+	mOffset(record.mOffset),
+	mStoredSize(record.mStoredSize),
+	mRawSize(record.mRawSize)
 {
-	S32 size = -1;
-	BOOL success;
-
 	mDP.assignBuffer(mBuffer, 0);
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
-
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
-	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = NULL ;
-		}
-	}
-
-	if(!success)
-	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = NULL;
-	}
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -146,6 +163,12 @@ LLVOCacheEntry::~LLVOCacheEntry()
 	mDP.freeBuffer();
 }
 
+void LLVOCacheEntry::setBuffer(U8* buffer, S32 size)
+{
+	mDP.freeBuffer();
+	mBuffer = buffer;
+	mDP.assignBuffer(mBuffer, size);
+}
 
 // New CRC means the object has changed.
 void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
@@ -157,17 +180,18 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mHitCount = 0;
 		mCRCChangeCount++;
 
-		mDP.freeBuffer();
-		mBuffer = new U8[dp.getBufferSize()];
-		mDP.assignBuffer(mBuffer, dp.getBufferSize());
+		setBuffer(new U8[dp.getBufferSize()], dp.getBufferSize());
 		mDP = dp;
+
+		// The copy on disk is stale now.
+		mFile = NULL;
 	}
 }
 
 LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP(U32 crc)
 {
 	if (  (mCRC != crc)
-		||(mDP.getBufferSize() == 0))
+		||(mDP.getBufferSize() == 0 && !loadPayload()))
 	{
 		//LL_INFOS() << "Not getting cache entry, invalid!" << LL_ENDL;
 		return NULL;
@@ -176,6 +200,46 @@ LLDataPackerBinaryBuffer *LLVOCacheEntry::getDP(U32 crc)
 	return &mDP;
 }
 
+BOOL LLVOCacheEntry::loadPayload()
+{
+	if (mFile.isNull())
+	{
+		return FALSE;
+	}
+
+	BOOL success = mRawSize > 0 && mRawSize <= MAX_PAYLOAD_SIZE && mStoredSize > 0 && mStoredSize <= mRawSize;
+	U8* buffer = NULL;
+	if (success)
+	{
+		buffer = new U8[mRawSize];
+		if (mStoredSize == mRawSize)
+		{
+			success = mFile->read(buffer, mOffset, mStoredSize);
+		}
+		else
+		{
+			std::vector<U8> stored(mStoredSize);
+			success = mFile->read(&stored[0], mOffset, mStoredSize);
+			if (success)
+			{
+				uLongf raw_size = mRawSize;
+				success = uncompress(buffer, &raw_size, &stored[0], mStoredSize) == Z_OK && raw_size == (uLongf)mRawSize;
+			}
+		}
+	}
+
+	if (!success)
+	{
+		LL_WARNS() << "Unable to load cache entry " << mLocalID << " from " << mFile->getFilename() << LL_ENDL;
+		delete[] buffer;
+		// Forget about the bad copy, the object will be fetched from the simulator again.
+		mFile = NULL;
+		return FALSE;
+	}
+
+	setBuffer(buffer, mRawSize);
+	return TRUE;
+}
 
 void LLVOCacheEntry::recordHit()
 {
@@ -193,45 +257,98 @@ void LLVOCacheEntry::dump() const
 		<< LL_ENDL;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
+void LLVOCacheEntry::fillIndexRecord(IndexRecord& record) const
 {
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
+	record.mLocalID = mLocalID;
+	record.mCRC = mCRC;
+	record.mHitCount = mHitCount;
+	record.mDupeCount = mDupeCount;
+	record.mCRCChangeCount = mCRCChangeCount;
+	record.mOffset = mOffset;
+	record.mStoredSize = mStoredSize;
+	record.mRawSize = mRawSize;
+}
+
+BOOL LLVOCacheEntry::packPayload(std::vector<U8>& buffer, LLVOCacheFile* file, U32 file_offset)
+{
+	size_t start = buffer.size();
+	S32 raw_size = mDP.getBufferSize();
+	if (raw_size > 0)
+	{
+		uLongf stored_size = compressBound(raw_size);
+		buffer.resize(start + stored_size);
+		if (raw_size < MIN_COMPRESSED_PAYLOAD_SIZE
+			|| compress2(&buffer[start], &stored_size, mBuffer, raw_size, Z_BEST_SPEED) != Z_OK
+			|| stored_size >= (uLongf)raw_size)
+		{
+			memcpy(&buffer[start], mBuffer, raw_size);		/* Flawfinder: ignore */
+			stored_size = raw_size;
+		}
+		buffer.resize(start + stored_size);
+		mStoredSize = (S32)stored_size;
+		mRawSize = raw_size;
 	}
-	if(success)
+	else if (mFile.notNull())
 	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
+		// Never probed this session: copy the stored bytes over as they are.
+		buffer.resize(start + mStoredSize);
+		if (!mFile->read(&buffer[start], mOffset, mStoredSize))
+		{
+			buffer.resize(start);
+			mFile = NULL;
+			return FALSE;
+		}
 	}
-	if(success)
+	else
 	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
+		return FALSE;
 	}
-	if(success)
+
+	mFile = file;
+	mOffset = file_offset;
+	return TRUE;
+}
+
+//---------------------------------------------------------------------------
+// LLVOCacheWriteResponder
+//---------------------------------------------------------------------------
+
+// Owns the buffer of a background object cache write.
+class LLVOCacheWriteResponder : public LLLFSThread::Responder
+{
+public:
+	LLVOCacheWriteResponder(const std::string& filename, std::vector<U8>& buffer)
+		: mFilename(filename)
 	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
+		mBuffer.swap(buffer);
 	}
-	if(success)
+
+	U8* getBuffer()			{ return &mBuffer[0]; }
+	S32 getSize() const		{ return (S32)mBuffer.size(); }
+
+	/*virtual*/ void completed(S32 bytes)
 	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
+		if (bytes != getSize())
+		{
+			LL_WARNS() << "Failed to write object cache file " << mFilename << LL_ENDL;
+		}
+		else
 		{
-			success = check_write(apr_file, (void*)mBuffer, size);
+			LLVOCache::sBytesWritten += bytes;
 		}
 	}
 
-	return success ;
-}
+private:
+	std::string		mFilename;
+	std::vector<U8>	mBuffer;
+};
 
 //-------------------------------------------------------------------
 //LLVOCache
 //-------------------------------------------------------------------
-// Format string used to construct filename for the object cache
+// Format strings used to construct the filenames for the object cache
 static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
+static const char OBJECT_INDEX_FILENAME[] = "objects_%d_%d.sli";
 
 const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
 const U32 MIN_ENTRIES_TO_PURGE = 16 ;
@@ -239,7 +356,19 @@ const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
 const char* header_filename = "object.cache";
 
+// Sanity limit on the number of entries in a region index.
+const S32 MAX_INDEX_ENTRIES = 65536 ;
+
+// Follows the region ID at the start of a region index file.
+struct ObjectIndexHeader
+{
+	S32 mNumEntries;
+	U32 mDataSize;
+};
+
 LLVOCache* LLVOCache::sInstance = NULL;
+LLAtomicU32 LLVOCache::sBytesRead(0);
+LLAtomicU32 LLVOCache::sBytesWritten(0);
 
 //static 
 LLVOCache* LLVOCache::getInstance() 
@@ -280,6 +409,7 @@ LLVOCache::~LLVOCache()
 {
 	if(mEnabled)
 	{
+		waitForAllWrites();
 		writeCacheHeader();
 		clearCacheInMemory();
 	}
@@ -339,6 +469,8 @@ void LLVOCache::removeCache(ELLPath location)
 
 	LL_INFOS() << "about to remove the object cache due to settings." << LL_ENDL ;
 
+	waitForAllWrites();
+
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	LL_INFOS() << "Removing cache at " << cache_dir << LL_ENDL;
@@ -360,6 +492,8 @@ void LLVOCache::removeCache()
 
 	LL_INFOS() << "about to remove the object cache due to some error." << LL_ENDL ;
 
+	waitForAllWrites();
+
 	std::string mask = "*";
 	LL_INFOS() << "Removing cache at " << mObjectCacheDirName << LL_ENDL;
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
@@ -415,7 +549,7 @@ void LLVOCache::clearCacheInMemory()
 		mHandleEntryMap.clear();
 		mNumEntries = 0 ;
 	}
-
+	mOpenFiles.clear();
 }
 
 void LLVOCache::getObjectCacheFilename(U64 handle, std::string& filename) 
@@ -429,6 +563,53 @@ void LLVOCache::getObjectCacheFilename(U64 handle, std::string& filename)
 	return ;
 }
 
+void LLVOCache::getObjectIndexFilename(U64 handle, std::string& filename) 
+{
+	U32 region_x, region_y;
+
+	grid_from_region_handle(handle, &region_x, &region_y);
+	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, object_cache_dirname,
+			   llformat(OBJECT_INDEX_FILENAME, region_x, region_y));
+}
+
+void LLVOCache::removeRegionFiles(U64 handle)
+{
+	waitForWrite(handle);
+
+	// Whatever the region still holds in memory must be written from scratch.
+	mOpenFiles.erase(handle);
+
+	std::string filename;
+	getObjectIndexFilename(handle, filename);
+	LLAPRFile::remove(filename);
+	getObjectCacheFilename(handle, filename);
+	LLAPRFile::remove(filename);
+}
+
+void LLVOCache::waitForWrite(U64 handle)
+{
+	handle_write_map_t::iterator iter = mPendingWrites.find(handle);
+	if (iter != mPendingWrites.end())
+	{
+		if (LLLFSThread::sLocal)
+		{
+			for (std::vector<LLLFSThread::handle_t>::iterator write = iter->second.begin(); write != iter->second.end(); ++write)
+			{
+				LLLFSThread::sLocal->waitForResult(*write);
+			}
+		}
+		mPendingWrites.erase(iter);
+	}
+}
+
+void LLVOCache::waitForAllWrites()
+{
+	while (!mPendingWrites.empty())
+	{
+		waitForWrite(mPendingWrites.begin()->first);
+	}
+}
+
 void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 {
 	if(mReadOnly)
@@ -437,9 +618,7 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 		return ;
 	}
 
-	std::string filename;
-	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename);
+	removeRegionFiles(entry->mHandle);
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
 }
@@ -603,10 +782,16 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 		return ;
 	}
 
+	LL_RECORD_BLOCK_TIME(FTM_READ_OBJECT_CACHE);
+
+	// The region may have been left moments ago, with its flush still queued.
+	waitForWrite(handle);
+
+	// Only the index is read here; payloads are loaded when probed.
 	bool success = true ;
 	{
 		std::string filename;
-		getObjectCacheFilename(handle, filename);
+		getObjectIndexFilename(handle, filename);
 		LLAPRFile apr_file(filename, APR_READ|APR_BINARY);
 	
 		LLUUID cache_id ;
@@ -620,25 +805,41 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 				success = false ;
 			}
 
+			ObjectIndexHeader header;
 			if(success)
 			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
+				success = check_read(&apr_file, &header, sizeof(ObjectIndexHeader)) ;
+				if(success && (header.mNumEntries < 0 || header.mNumEntries > MAX_INDEX_ENTRIES))
+				{
+					LL_WARNS() << "Bogus entry count " << header.mNumEntries << " in " << filename << LL_ENDL;
+					success = false ;
+				}
+			}
+
+			if(success && header.mNumEntries > 0)
+			{
+				std::vector<LLVOCacheEntry::IndexRecord> records(header.mNumEntries);
+				S32 index_size = header.mNumEntries * sizeof(LLVOCacheEntry::IndexRecord);
+				success = check_read(&apr_file, &records[0], index_size) ;
 				if(success)
 				{
-					for (S32 i = 0; i < num_entries; i++)
+					sBytesRead += UUID_BYTES + sizeof(ObjectIndexHeader) + index_size;
+
+					std::string data_filename;
+					getObjectCacheFilename(handle, data_filename);
+					LLPointer<LLVOCacheFile> data_file = new LLVOCacheFile(data_filename, header.mDataSize);
+					for (S32 i = 0; i < header.mNumEntries; i++)
 					{
-						LLVOCacheEntry* entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
+						const LLVOCacheEntry::IndexRecord& record = records[i];
+						if (!record.mLocalID || record.mOffset + record.mStoredSize > header.mDataSize)
 						{
 							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							delete entry ;
 							success = false ;
 							break ;
 						}
-						cache_entry_map[entry->getLocalID()] = entry;
+						cache_entry_map[record.mLocalID] = new LLVOCacheEntry(record, data_file);
 					}
+					mOpenFiles[handle] = data_file;
 				}
 			}
 		}		
@@ -652,6 +853,8 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 		}
 	}
 
+	LL_DEBUGS("ObjectCache") << "Read " << cache_entry_map.size() << " index entries for region " << handle
+							 << ", " << (U32)sBytesRead << " bytes read from the object cache so far" << LL_ENDL;
 	return ;
 }
 	
@@ -725,34 +928,87 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
+	LL_RECORD_BLOCK_TIME(FTM_WRITE_OBJECT_CACHE);
+
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+
+	LLPointer<LLVOCacheFile> old_file;
+	handle_file_map_t::iterator file_iter = mOpenFiles.find(handle);
+	if (file_iter != mOpenFiles.end())
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
+		old_file = file_iter->second;
+		mOpenFiles.erase(file_iter);
+	}
 
-	
-		if(success)
+	// New and changed entries are appended to the data file; once most of it
+	// is taken by stale payloads the file is rewritten from scratch instead.
+	U32 old_size = old_file.notNull() ? old_file->getDataSize() : 0;
+	U32 live_size = 0;
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		if (iter->second->isStoredIn(old_file))
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-			{
-				success = iter->second->writeToFile(&apr_file) ;
-			}
+			live_size += iter->second->getStoredSize();
 		}
 	}
+	BOOL rewrite = live_size == 0 || live_size < old_size - live_size;
+	U32 base_offset = rewrite ? 0 : old_size;
+	LLPointer<LLVOCacheFile> new_file = rewrite ? new LLVOCacheFile(filename, 0) : old_file.get();
 
-	if(!success)
+	std::vector<U8> data;
+	std::vector<LLVOCacheEntry::IndexRecord> records;
+	records.reserve(cache_entry_map.size());
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		LLVOCacheEntry* cache_entry = iter->second;
+		if ((rewrite || !cache_entry->isStoredIn(old_file))
+			&& !cache_entry->packPayload(data, new_file, base_offset + data.size()))
+		{
+			continue; // nothing left to store for this one
+		}
+		records.push_back(LLVOCacheEntry::IndexRecord());
+		cache_entry->fillIndexRecord(records.back());
+	}
+	U32 payload_size = data.size();
+	new_file->setDataSize(base_offset + payload_size);
+
+	if (old_file.notNull())
+	{
+		old_file->close();
+	}
+	if (rewrite)
 	{
-		removeEntry(entry) ;
+		LLAPRFile::remove(filename);
+	}
 
+	// Both writes go through the LFS thread, which writes in FIFO order, so the
+	// index never references payloads that are not written yet.
+	std::vector<LLLFSThread::handle_t>& pending = mPendingWrites[handle];
+	if (!data.empty())
+	{
+		LLPointer<LLVOCacheWriteResponder> responder = new LLVOCacheWriteResponder(filename, data);
+		pending.push_back(LLLFSThread::sLocal->write(filename, responder->getBuffer(), base_offset, responder->getSize(), responder));
 	}
 
+	std::vector<U8> index(UUID_BYTES + sizeof(ObjectIndexHeader) + records.size() * sizeof(LLVOCacheEntry::IndexRecord));
+	ObjectIndexHeader header;
+	header.mNumEntries = records.size();
+	header.mDataSize = new_file->getDataSize();
+	memcpy(&index[0], id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+	memcpy(&index[UUID_BYTES], &header, sizeof(ObjectIndexHeader));		/* Flawfinder: ignore */
+	if (!records.empty())
+	{
+		memcpy(&index[UUID_BYTES + sizeof(ObjectIndexHeader)], &records[0], records.size() * sizeof(LLVOCacheEntry::IndexRecord));		/* Flawfinder: ignore */
+	}
+
+	std::string index_filename;
+	getObjectIndexFilename(handle, index_filename);
+	LLPointer<LLVOCacheWriteResponder> responder = new LLVOCacheWriteResponder(index_filename, index);
+	pending.push_back(LLLFSThread::sLocal->write(index_filename, responder->getBuffer(), 0, responder->getSize(), responder));
+
+	LL_DEBUGS("ObjectCache") << (rewrite ? "Rewrote " : "Appended to ") << "object cache for region " << handle
+							 << ": " << records.size() << " entries, " << payload_size << " payload bytes queued, "
+							 << (U32)sBytesWritten << " bytes written so far" << LL_ENDL;
 	return ;
 }
-
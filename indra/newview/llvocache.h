@@ -36,8 +36,43 @@
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldir.h"
+#include "llapr.h"
+#include "llatomic.h"
+#include "llpointer.h"
+#include "llrefcount.h"
+#include "lllfsthread.h"
 
 
+//---------------------------------------------------------------------------
+// Region data file
+//
+// Each region has an append-only data file holding the (zlib compressed)
+// object update payloads, and a small index file listing, per local id, the
+// CRC, the statistics and where the payload lives in the data file.
+// Payloads are only read back when the viewer probes the entry with a
+// matching CRC.
+class LLVOCacheFile : public LLRefCount
+{
+public:
+	LLVOCacheFile(const std::string& filename, U32 data_size);
+
+	const std::string& getFilename() const	{ return mFilename; }
+	U32 getDataSize() const					{ return mDataSize; }
+	void setDataSize(U32 size)				{ mDataSize = size; }
+
+	// Reads numbytes at offset into buffer; returns FALSE on short reads.
+	BOOL read(U8* buffer, U32 offset, S32 numbytes);
+	void close();
+
+protected:
+	~LLVOCacheFile();
+
+private:
+	std::string	mFilename;
+	U32			mDataSize;	// Bytes of the data file referenced by the index
+	LLAPRFile	mFile;		// Opened on first read, kept open while the region is cached
+};
+
 //---------------------------------------------------------------------------
 // Cache entries
 class LLVOCacheEntry;
@@ -45,8 +80,21 @@ class LLVOCacheEntry;
 class LLVOCacheEntry
 {
 public:
+	// On-disk index record for one entry.
+	struct IndexRecord
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		U32 mOffset;		// Offset of the payload in the data file
+		S32 mStoredSize;	// Size of the payload in the data file
+		S32 mRawSize;		// Size once inflated; equal to mStoredSize when stored uncompressed
+	};
+
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	LLVOCacheEntry(const IndexRecord& record, LLVOCacheFile* file);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
@@ -55,8 +103,16 @@ public:
 	S32 getHitCount() const			{ return mHitCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
 
+	// TRUE when the payload already lives in the given data file, in which
+	// case only the index record needs to be written back.
+	BOOL isStoredIn(const LLVOCacheFile* file) const { return file && mFile.get() == file; }
+	S32 getStoredSize() const		{ return mStoredSize; }
+
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
+	void fillIndexRecord(IndexRecord& record) const;
+	// Appends the payload as it should be stored on disk to buffer, and
+	// records where in file it is going to be written.
+	BOOL packPayload(std::vector<U8>& buffer, LLVOCacheFile* file, U32 file_offset);
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
@@ -65,6 +121,10 @@ public:
 public:
 	typedef std::map<U32, LLVOCacheEntry*>	vocache_entry_map_t;
 
+private:
+	BOOL loadPayload();
+	void setBuffer(U8* buffer, S32 size);
+
 protected:
 	U32							mLocalID;
 	U32							mCRC;
@@ -73,6 +133,12 @@ protected:
 	S32							mCRCChangeCount;
 	LLDataPackerBinaryBuffer	mDP;
 	U8							*mBuffer;
+
+	// Location of the payload on disk, if any.
+	LLPointer<LLVOCacheFile>	mFile;
+	U32							mOffset;
+	S32							mStoredSize;
+	S32							mRawSize;
 };
 
 //
@@ -110,6 +176,8 @@ private:
 	};
 	typedef std::set<HeaderEntryInfo*, header_entry_less> header_entry_queue_t;
 	typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
+	typedef std::map<U64, LLPointer<LLVOCacheFile> > handle_file_map_t;
+	typedef std::map<U64, std::vector<LLLFSThread::handle_t> > handle_write_map_t;
 private:
 	LLVOCache() ;
 
@@ -129,6 +197,11 @@ private:
 	void setDirNames(ELLPath location);	
 	// determine the cache filename for the region from the region handle	
 	void getObjectCacheFilename(U64 handle, std::string& filename);
+	void getObjectIndexFilename(U64 handle, std::string& filename);
+	void removeRegionFiles(U64 handle);
+	// Blocks until the background flush of a region (or of all regions) is on disk.
+	void waitForWrite(U64 handle);
+	void waitForAllWrites();
 	void removeFromCache(HeaderEntryInfo* entry);
 	void readCacheHeader();
 	void writeCacheHeader();
@@ -149,12 +222,18 @@ private:
 	std::string          mObjectCacheDirName;
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
+	handle_file_map_t    mOpenFiles;		// Data files of the regions read since their last write
+	handle_write_map_t   mPendingWrites;	// Payload and index writes queued per region
 
 	static LLVOCache* sInstance ;
 public:
 	static LLVOCache* getInstance() ;
 	static BOOL       hasInstance() ;	
 	static void       destroyClass() ;
+
+	// I/O statistics, for comparing region entry costs.
+	static LLAtomicU32 sBytesRead;
+	static LLAtomicU32 sBytesWritten;
 };
 
 #endif
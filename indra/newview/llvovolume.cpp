@@ -3681,7 +3681,7 @@ const LLMatrix4a& LLVOVolume::getRenderMatrix() const
 // total cost is returned value + 5 * size of the resulting set.
 // Cannot include cost of textures, as they may be re-used in linked
 // children, and cost should only be increased for unique textures  -Nyx
-U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
+U32 LLVOVolume::getRenderCost(texture_cost_t &textures, const LLMeshCostData* mesh_costs) const
 {
 	// Get access to params we'll need at various points.  
 	// Skip if this is object doesn't have a volume (e.g. is an avatar).
@@ -3737,8 +3737,12 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
 		profile_params = volume_params.getProfileParams();
 
         LLMeshCostData costs;
-		if (getCostData(costs))
+		if (mesh_costs || getCostData(costs))
 		{
+            if (mesh_costs)
+            {
+                costs = *mesh_costs;
+            }
             if (isAnimatedObject() && isRiggedMesh())
             {
                 // Scaling here is to make animated object vs
@@ -4022,13 +4026,46 @@ bool LLVOVolume::getCostData(LLMeshCostData& costs) const
 		S32 counts[4];
 		LLVolume::getLoDTriangleCounts(volume->getParams(), counts);
 
-		LLSD header;
-		header["lowest_lod"]["size"] = counts[0] * 10;
-		header["low_lod"]["size"] = counts[1] * 10;
-		header["medium_lod"]["size"] = counts[2] * 10;
-		header["high_lod"]["size"] = counts[3] * 10;
+		costs.init(counts[0] * 10, counts[1] * 10, counts[2] * 10, counts[3] * 10);
+		return true;
+	}
+}
 
-		return LLMeshRepository::getCostData(header, costs);
+//static
+void LLVOVolume::getCostData(const std::vector<const LLVOVolume*>& volumes, std::vector<LLMeshCostData>& costs, std::vector<bool>& found)
+{
+	costs.assign(volumes.size(), LLMeshCostData());
+	found.assign(volumes.size(), false);
+
+	uuid_vec_t mesh_ids;
+	std::vector<U32> mesh_volumes;
+	for (U32 i = 0; i < volumes.size(); ++i)
+	{
+		if (!volumes[i]->getVolume())
+		{
+			continue;
+		}
+		if (volumes[i]->isMesh())
+		{
+			mesh_ids.push_back(volumes[i]->getVolume()->getParams().getSculptID());
+			mesh_volumes.push_back(i);
+		}
+		else
+		{
+			found[i] = volumes[i]->getCostData(costs[i]);
+		}
+	}
+
+	if (!mesh_ids.empty())
+	{
+		std::vector<LLMeshCostData> mesh_costs;
+		std::vector<bool> mesh_found;
+		gMeshRepo.getCostData(mesh_ids, mesh_costs, mesh_found);
+		for (U32 i = 0; i < mesh_volumes.size(); ++i)
+		{
+			costs[mesh_volumes[i]] = mesh_costs[i];
+			found[mesh_volumes[i]] = mesh_found[i];
+		}
 	}
 }
 
@@ -152,11 +152,14 @@ public:
 	const LLMatrix4a&	getRelativeXformInvTrans() const		{ return mRelativeXformInvTrans; }
 	/*virtual*/	const LLMatrix4a&	getRenderMatrix() const;
 	typedef std::map<LLUUID, S32> texture_cost_t;
-				U32 	getRenderCost(texture_cost_t &textures) const;
+				// mesh_costs, when given, is used instead of getCostData()
+				U32 	getRenderCost(texture_cost_t &textures, const LLMeshCostData* mesh_costs = NULL) const;
 	/*virtual*/	F32		getEstTrianglesMax() const;
 	/*virtual*/	F32		getEstTrianglesStreamingCost() const;
 	/* virtual*/ F32	getStreamingCost() const;
 	/*virtual*/ bool getCostData(LLMeshCostData& costs) const;
+	// getCostData() of each of volumes, with one lock of the mesh headers for all of them
+	static void getCostData(const std::vector<const LLVOVolume*>& volumes, std::vector<LLMeshCostData>& costs, std::vector<bool>& found);
 
 	/*virtual*/ U32		getTriangleCount(S32* vcount = NULL) const;
 	/*virtual*/ U32		getHighLODTriangleCount();
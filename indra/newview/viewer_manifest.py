@@ -479,10 +479,6 @@ class WindowsManifest(ViewerManifest):
             self.path('libaprutil-1.dll')
             self.path('libapriconv-1.dll')
 
-            # Mesh 3rd party libs needed for auto LOD and collada reading
-            if self.path("glod.dll") == 0:
-                print "Skipping GLOD library (assumming linked statically)"
-
             # Get fmodstudio dll, continue if missing
             if config is "debug":
                 if self.path("fmodL.dll") == 0:
@@ -887,7 +883,6 @@ class DarwinManifest(ViewerManifest):
                                     "libcollada14dom.dylib",
                                     "libexpat.1.5.2.dylib",
                                     "libexception_handler.dylib",
-                                    "libGLOD.dylib",
                                     "libhunspell-1.3.0.dylib",
                                     "libndofdev.dylib",
                                     ):
@@ -1306,7 +1301,6 @@ class Linux_i686_Manifest(LinuxManifest):
             self.path("libapr-1.so*")
             self.path("libaprutil-1.so*")
             self.path("libexpat.so.*")
-            self.path("libGLOD.so")
             self.path("libSDL-1.2.so.*")
             self.path("libalut.so")
             self.path("libopenal.so.1")
@@ -1359,7 +1353,6 @@ class Linux_x86_64_Manifest(LinuxManifest):
             self.path("libapr-1.so*")
             self.path("libaprutil-1.so*")
             self.path("libexpat.so*")
-            self.path("libGLOD.so")
             self.path("libSDL-1.2.so*")
             self.path("libhunspell*.so*")
             self.path("libalut.so*")